@@ -8,6 +8,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/audio/audio.c
 	src/audio/audio_a5.cpp
 	src/audio/mt32mpu.c
+	src/benchmark.c
 	src/binheap.c
 	src/buildqueue.c
 	src/codec/format40.c
@@ -16,6 +17,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/config_a5.c
 	src/crashlog/crashlog_none.c
 	src/cutscene.c
+	src/drawlist.c
 	src/enhancement.c
 	src/explosion.c
 	src/file.c
@@ -35,6 +37,7 @@ set(DUNEDYNASTY_SRC_FILES
 	src/input/mouse_dd.c
 	src/load.c
 	src/map.c
+	src/minimap.c
 	src/mods/landscape.c
 	src/mods/mapgenerator.c
 	src/mods/multiplayer.c
@@ -58,12 +61,17 @@ set(DUNEDYNASTY_SRC_FILES
 	src/newui/strategicmap.c
 	src/newui/viewport.c
 	src/object.c
+	src/objectgrid.c
 	src/opendune.c
 	src/os/endian.c
+	src/os/thread_a5.c
+	src/pathfinder.c
+	src/pool/pool.c
 	src/pool/pool_house.c
 	src/pool/pool_structure.c
 	src/pool/pool_team.c
 	src/pool/pool_unit.c
+	src/profiler.c
 	src/save.c
 	src/saveload/house.c
 	src/saveload/info.c
@@ -105,8 +113,10 @@ set(DUNEDYNASTY_SRC_FILES
 	src/tile.c
 	src/timer/timer.c
 	src/timer/timer_a5.c
+	src/timerwheel.c
 	src/tools/coord.c
 	src/tools/encoded_index.c
+	src/tools/hash.c
 	src/tools/orientation.c
 	src/tools/random_general.c
 	src/tools/random_lcg.c
@@ -114,7 +124,9 @@ set(DUNEDYNASTY_SRC_FILES
 	src/tools/random_xorshift.c
 	src/unit.c
 	src/video/prim_a5.c
+	src/video/spritebatch_a5.c
 	src/video/video_a5.c
+	src/vision.c
 	src/wsa.c
 	)
 
@@ -152,10 +164,10 @@ endif(WITH_AUD)
 
 if(WIN32)
     set(DUNEDYNASTY_SRC_FILES
-	${DUNEDYNASTY_SRC_FILES} src/crashlog/errorlog_win32.c)
+	${DUNEDYNASTY_SRC_FILES} src/crashlog/errorlog_win32.c src/os/mmap_win32.c)
 else(WIN32)
     set(DUNEDYNASTY_SRC_FILES
-	${DUNEDYNASTY_SRC_FILES} src/crashlog/errorlog_std.c)
+	${DUNEDYNASTY_SRC_FILES} src/crashlog/errorlog_std.c src/os/mmap_posix.c)
 endif(WIN32)
 
 set(OPENDUNE_UNUSED_SRC_FILES
@@ -163,6 +175,4 @@ set(OPENDUNE_UNUSED_SRC_FILES
 	src/audio/sound.c
 	src/crashlog/crashlog.c
 	src/crashlog/crashlog_win32.c
-	src/os/thread_sdl.c
-	src/os/thread_win32.c
 	)
@@ -5,12 +5,17 @@
 
 #include <assert.h>
 #include <math.h>
+#include "errorlog.h"
+#include "os/common.h"
 #include "os/math.h"
 
 #include "ai.h"
 
 #include "enhancement.h"
 #include "map.h"
+#include "net/server.h"
+#include "objectgrid.h"
+#include "opendune.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -407,37 +412,137 @@ StructureAI_PickNextToBuild(const Structure *s)
 
 /*--------------------------------------------------------------*/
 
-uint16
-UnitAI_GetAnyEnemyInRange(const Unit *unit)
+static bool
+UnitAI_IsEnemyUnitInRange(const Unit *unit, const Unit *u, int dist)
+{
+	if (u->o.type == UNIT_SANDWORM) {
+	} else if (House_AreAllied(Unit_GetHouseID(unit), Unit_GetHouseID(u))) {
+	} else if (!g_table_unitInfo[u->o.type].flags.isGroundUnit) {
+	} else if (Tile_GetDistanceRoundedUp(unit->o.position, u->o.position) <= dist) {
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+UnitAI_IsEnemyStructureInRange(const Unit *unit, const Structure *s, int dist)
+{
+	if (House_AreAllied(Unit_GetHouseID(unit), s->o.houseID)) {
+	} else if (Tile_GetDistanceRoundedUp(unit->o.position, s->o.position) <= dist) {
+		return true;
+	}
+
+	return false;
+}
+
+static uint16
+UnitAI_GetAnyEnemyInRange_Scan(const Unit *unit, int dist)
 {
-	const UnitInfo *ui = &g_table_unitInfo[unit->o.type];
-	const enum HouseType houseID = Unit_GetHouseID(unit);
-	const int dist = max(4, ui->fireDistance);
 	PoolFindStruct find;
 
 	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
-		if (u->o.type == UNIT_SANDWORM) {
-		} else if (House_AreAllied(houseID, Unit_GetHouseID(u))) {
-		} else if (!g_table_unitInfo[u->o.type].flags.isGroundUnit) {
-		} else if (Tile_GetDistanceRoundedUp(unit->o.position, u->o.position) <= dist) {
+		if (UnitAI_IsEnemyUnitInRange(unit, u, dist))
 			return Tools_Index_Encode(u->o.index, IT_UNIT);
-		}
 	}
 
 	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
 			s != NULL;
 			s = Structure_FindNext(&find)) {
-		if (House_AreAllied(houseID, s->o.houseID)) {
-		} else if (Tile_GetDistanceRoundedUp(unit->o.position, s->o.position) <= dist) {
+		if (UnitAI_IsEnemyStructureInRange(unit, s, dist))
 			return Tools_Index_Encode(s->o.index, IT_STRUCTURE);
+	}
+
+	return 0;
+}
+
+/* Same result as UnitAI_GetAnyEnemyInRange_Scan, but only looks at
+ * nearby objects.  The first match in the order of the pools wins.
+ */
+static uint16
+UnitAI_GetAnyEnemyInRange_Grid(const Unit *unit, int dist)
+{
+	const uint16 range = (dist << 8) + 0x80;
+	ObjectGridFindStruct find;
+	const Unit *bestUnit = NULL;
+	uint16 bestUnitIndex = UNIT_INDEX_INVALID;
+
+	for (const Unit *u = ObjectGrid_FindFirstUnit(&find, unit->o.position, range);
+			u != NULL;
+			u = ObjectGrid_FindNextUnit(&find)) {
+		if (!UnitAI_IsEnemyUnitInRange(unit, u, dist))
+			continue;
+
+		const uint16 findIndex = Unit_GetFindIndex(u);
+		if (findIndex < bestUnitIndex) {
+			bestUnit = u;
+			bestUnitIndex = findIndex;
 		}
 	}
 
+	if (bestUnit != NULL)
+		return Tools_Index_Encode(bestUnit->o.index, IT_UNIT);
+
+	const Structure *bestStructure = NULL;
+	uint16 bestStructureIndex = STRUCTURE_INDEX_INVALID;
+
+	for (const Structure *s = ObjectGrid_FindFirstStructure(&find, unit->o.position, range);
+			s != NULL;
+			s = ObjectGrid_FindNextStructure(&find)) {
+		if (!UnitAI_IsEnemyStructureInRange(unit, s, dist))
+			continue;
+
+		const uint16 findIndex = Structure_GetFindIndex(s);
+		if (findIndex < bestStructureIndex) {
+			bestStructure = s;
+			bestStructureIndex = findIndex;
+		}
+	}
+
+	if (bestStructure != NULL)
+		return Tools_Index_Encode(bestStructure->o.index, IT_STRUCTURE);
+
+	/* Walls and slabs share a pool element, which Structure_FindNext
+	 * returns after all other structures.
+	 */
+	const int shared[3] = { STRUCTURE_INDEX_WALL, STRUCTURE_INDEX_SLAB_2x2, STRUCTURE_INDEX_SLAB_1x1 };
+	for (unsigned int i = 0; i < lengthof(shared); i++) {
+		const Structure *s = Structure_Get_ByIndex(StructurePool_GetIndex(shared[i]));
+
+		if (s->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		if (UnitAI_IsEnemyStructureInRange(unit, s, dist))
+			return Tools_Index_Encode(s->o.index, IT_STRUCTURE);
+	}
+
 	return 0;
 }
 
+uint16
+UnitAI_GetAnyEnemyInRange(const Unit *unit)
+{
+	const UnitInfo *ui = &g_table_unitInfo[unit->o.type];
+	const int dist = max(4, ui->fireDistance);
+
+	if (!ObjectGrid_IsPositionInside(unit->o.position))
+		return UnitAI_GetAnyEnemyInRange_Scan(unit, dist);
+
+	const uint16 encoded = UnitAI_GetAnyEnemyInRange_Grid(unit, dist);
+
+#ifdef OBJECTGRID_VERIFY
+	const uint16 expected = UnitAI_GetAnyEnemyInRange_Scan(unit, dist);
+	if (encoded != expected) {
+		Warning("ObjectGrid: unit %d found enemy %04X instead of %04X\n",
+				unit->o.index, encoded, expected);
+	}
+#endif
+
+	return encoded;
+}
+
 bool
 UnitAI_CallCarryallToEvadeSandworm(const Unit *harvester)
 {
@@ -475,6 +580,7 @@ UnitAI_CallCarryallToEvadeSandworm(const Unit *harvester)
 	encoded2 = Tools_Index_Encode(carryall->o.index, IT_UNIT);
 	Object_Script_Variable4_Link(encoded, encoded2);
 	carryall->targetMove = encoded;
+	Server_MarkUnitDirty(carryall);
 	return true;
 }
 
@@ -724,6 +830,7 @@ UnitAI_SquadCharge(AISquad *squad)
 			u = UnitAI_SquadFindNext(&find, squad)) {
 		Unit_Server_SetAction(u, ACTION_HUNT);
 		u->targetAttack = squad->target;
+		Server_MarkUnitDirty(u);
 	}
 }
 
@@ -883,6 +990,7 @@ UnitAI_ArrangeBattleFormation(AISquad *squad)
 			u != NULL;
 			u = UnitAI_SquadFindNext(&find, squad)) {
 		u->targetMove = Tools_Index_Encode(Tile_PackXY(ux, uy), IT_TILE);
+		Server_MarkUnitDirty(u);
 
 		/* We need the destination to be precise! */
 		Unit_Server_SetAction(u, ACTION_MOVE);
@@ -1007,10 +1115,10 @@ BrutalAI_Load(FILE *fp, uint32 length)
 }
 
 bool
-BrutalAI_Save(FILE *fp)
+BrutalAI_Save(SaveBuffer *sb)
 {
 	for (int i = 0; i < SQUADID_MAX + 1; i++) {
-		if (!SaveLoad_Save(s_saveBrutalAISquad, fp, &s_aisquad[i]))
+		if (!SaveLoad_Save(s_saveBrutalAISquad, sb, &s_aisquad[i]))
 			return false;
 	}
 
@@ -20,7 +20,9 @@ extern void UnitAI_AbortMission(Unit *unit, uint16 enemy);
 extern uint16 UnitAI_GetSquadDestination(Unit *unit, uint16 destination);
 extern void UnitAI_SquadLoop(void);
 
+struct SaveBuffer;
+
 extern bool BrutalAI_Load(FILE *fp, uint32 length);
-extern bool BrutalAI_Save(FILE *fp);
+extern bool BrutalAI_Save(struct SaveBuffer *sb);
 
 #endif
@@ -2,23 +2,25 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "types.h"
+#include "os/math.h"
 
 #include "animation.h"
 
-#include "binheap.h"
 #include "map.h"
 #include "net/server.h"
 #include "sprites.h"
 #include "structure.h"
 #include "timer/timer.h"
+#include "timerwheel.h"
 #include "tools/coord.h"
 #include "tools/random_general.h"
 
 typedef struct Animation {
-	/* Heap key. */
 	int64_t tickNext;                       /*!< Which tick this Animation should be called again. */
+	uint16 timer;                           /*!< Timer on the animation timer wheel. */
 
 	enum StructureLayout tileLayout;        /*!< Tile layout of the Animation. */
 	enum HouseType houseID;                 /*!< House of the item being animated. */
@@ -28,7 +30,10 @@ typedef struct Animation {
 	tile32 tile;                            /*!< Top-left tile of Animation. */
 } Animation;
 
-static BinHeap s_animations;
+static Animation *s_animation;
+static int s_animationCount;
+static int s_animationMax;
+static TimerWheel s_animationWheel;
 
 /**
  * Stop with this Animation.
@@ -54,6 +59,7 @@ static void Animation_Func_Stop(Animation *animation, int16 parameter)
 		}
 
 		t->overlaySpriteID = 0;
+		Map_InvalidateTile(position);
 	}
 }
 
@@ -98,6 +104,7 @@ static void Animation_Func_SetOverlaySprite(Animation *animation, int16 paramete
 	Tile *t = &g_map[packed];
 	t->overlaySpriteID = g_iconMap[g_iconMap[animation->iconGroup] + parameter];
 	t->houseID = animation->houseID;
+	Map_InvalidateTile(packed);
 }
 
 /**
@@ -149,6 +156,7 @@ static void Animation_Func_SetGroundSprite(Animation *animation, int16 parameter
 		t->groundSpriteID = spriteID;
 		t->overlaySpriteID = 0;
 		t->houseID = animation->houseID;
+		Map_InvalidateTile(position);
 	}
 }
 
@@ -185,16 +193,57 @@ static void Animation_Func_PlayVoice(Animation *animation, int16 parameter)
 	Server_Send_PlaySoundAtTile(FLAG_HOUSE_ALL, parameter, animation->tile);
 }
 
+static bool
+Animation_Reserve(int num)
+{
+	if (num <= s_animationMax)
+		return true;
+
+	int new_size = max(32, s_animationMax);
+	while (new_size < num)
+		new_size *= 2;
+
+	Animation *ptr = realloc(s_animation, new_size * sizeof(s_animation[0]));
+	if (ptr == NULL)
+		return false;
+
+	s_animationMax = new_size;
+	s_animation = ptr;
+	return true;
+}
+
+/**
+ * Forget animation i, moving the last animation into its place.
+ */
+static void
+Animation_Remove(int i)
+{
+	TimerWheel_Remove(&s_animationWheel, s_animation[i].timer);
+	s_animationCount--;
+
+	if (i == s_animationCount)
+		return;
+
+	s_animation[i] = s_animation[s_animationCount];
+	TimerWheel_GetNode(&s_animationWheel, s_animation[i].timer)->index = i;
+}
+
 void
 Animation_Init(void)
 {
-	BinHeap_Init(&s_animations, sizeof(Animation));
+	TimerWheel_Init(&s_animationWheel, Timer_GetTicks());
+	s_animationCount = 0;
+	Animation_Reserve(32);
 }
 
 void
 Animation_Uninit(void)
 {
-	BinHeap_Free(&s_animations);
+	TimerWheel_Free(&s_animationWheel);
+	free(s_animation);
+	s_animation = NULL;
+	s_animationCount = 0;
+	s_animationMax = 0;
 }
 
 /**
@@ -210,8 +259,15 @@ void Animation_Start(const AnimationCommandStruct *commands, tile32 tile, uint16
 	uint16 packed = Tile_PackTile(tile);
 	Animation_Stop_ByTile(packed);
 
-	Animation *animation = BinHeap_Push(&s_animations, Timer_GetTicks());
-	if (animation != NULL) {
+	if (!Animation_Reserve(s_animationCount + 1)) return;
+
+	const int64_t curr_ticks = Timer_GetTicks();
+	const uint16 timer = TimerWheel_Add(&s_animationWheel, curr_ticks, s_animationCount);
+	if (timer != TIMERWHEEL_NONE) {
+		Animation *animation = &s_animation[s_animationCount++];
+
+		animation->tickNext   = curr_ticks;
+		animation->timer      = timer;
 		animation->tileLayout = tileLayout;
 		animation->houseID    = houseID;
 		animation->current    = 0;
@@ -219,8 +275,11 @@ void Animation_Start(const AnimationCommandStruct *commands, tile32 tile, uint16
 		animation->commands   = commands;
 		animation->tile       = tile;
 
+		TimerWheel_SetTile(&s_animationWheel, timer, packed);
+
 		g_map[packed].houseID = houseID;
 		g_map[packed].hasAnimation = true;
+		Map_InvalidateTile(packed);
 	}
 }
 
@@ -232,15 +291,14 @@ void Animation_Stop_ByTile(uint16 packed)
 {
 	if (!g_map[packed].hasAnimation) return;
 
-	for (int i = 1; i < s_animations.num_elem; i++) {
-		Animation *animation = (Animation *)BinHeap_GetElem(&s_animations, i);
+	const uint16 timer = TimerWheel_GetFirstOnTile(&s_animationWheel, packed);
+	if (timer == TIMERWHEEL_NONE) return;
 
-		if (animation->commands == NULL) continue;
-		if (Tile_PackTile(animation->tile) != packed) continue;
+	Animation_Func_Stop(&s_animation[TimerWheel_GetNode(&s_animationWheel, timer)->index], 0);
 
-		Animation_Func_Stop(animation, 0);
-		break;
-	}
+	/* Forget it on the next tick, rather than at the end of its pause. */
+	TimerWheel_SetTile(&s_animationWheel, timer, TIMERWHEEL_NONE);
+	TimerWheel_Schedule(&s_animationWheel, timer, s_animationWheel.now);
 }
 
 /**
@@ -249,9 +307,14 @@ void Animation_Stop_ByTile(uint16 packed)
 void Animation_Tick(void)
 {
 	const int64_t curr_ticks = Timer_GetTicks();
+	uint16 timer;
+
+	TimerWheel_Advance(&s_animationWheel, curr_ticks);
+
+	while ((timer = TimerWheel_PopDue(&s_animationWheel)) != TIMERWHEEL_NONE) {
+		const int i = TimerWheel_GetNode(&s_animationWheel, timer)->index;
+		Animation *animation = &s_animation[i];
 
-	Animation *animation = BinHeap_GetMin(&s_animations);
-	while ((animation != NULL) && (animation->tickNext <= curr_ticks)) {
 		while (animation->commands != NULL) {
 			const AnimationCommandStruct *commands = animation->commands + animation->current;
 			int16 parameter = commands->parameter;
@@ -278,11 +341,9 @@ void Animation_Tick(void)
 		}
 
 		if (animation->commands == NULL) {
-			BinHeap_Pop(&s_animations);
+			Animation_Remove(i);
 		} else {
-			BinHeap_UpdateMin(&s_animations);
+			TimerWheel_Schedule(&s_animationWheel, timer, animation->tickNext);
 		}
-
-		animation = BinHeap_GetMin(&s_animations);
 	}
 }
@@ -41,6 +41,7 @@ float sound_volume = 0.65f;
 float cutscene_sound_volume = 1.0f;
 
 bool g_opl_mame = true;
+int g_adlib_latency = 50;
 char sound_font_path[1024];
 int g_midi_device_id = 0;
 enum MidiFormat g_midi_format = MIDI_FORMAT_GM;
@@ -360,7 +361,7 @@ Audio_IsPositionAudible(uint16 packed)
 			&& (g_host_type == HOSTTYPE_CLIENT_SERVER
 			 || g_host_type == HOSTTYPE_DEDICATED_CLIENT)) {
 		return Map_IsUnveiledToHouse(g_playerHouseID, packed)
-			&& (g_mapVisible[packed].timeout[g_playerHouseID] > g_timerGame);
+			&& !Map_IsTileFogged(g_playerHouseID, packed);
 	}
 
 	return true;
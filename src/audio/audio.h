@@ -32,6 +32,7 @@ extern float cutscene_sound_volume;
 extern bool g_disable_attack_music;
 
 extern bool g_opl_mame;
+extern int g_adlib_latency;
 extern char sound_font_path[1024];
 extern int g_midi_device_id;
 extern enum MidiFormat g_midi_format;
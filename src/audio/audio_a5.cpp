@@ -1,10 +1,13 @@
 /* audio_a5.cpp */
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_audio.h>
 #include <allegro5/allegro_memfile.h>
 #include <stdio.h>
+#include <string.h>
 #include "buildcfg.h"
 
 #include "audio_a5.h"
@@ -82,6 +85,49 @@ static ALLEGRO_SAMPLE_INSTANCE *s_instance[MAX_SAMPLE_INSTANCES];
 static ALLEGRO_VOICE *al_voice;
 static ALLEGRO_MIXER *al_mixer;
 
+/* AdLib synthesis runs on its own thread while s_adlib exists,
+ * rendering ahead into a ring which the stream fragments are copied
+ * from.  Other threads only reach s_adlib through the command queue.
+ * Both are single producer, single consumer.
+ */
+enum AdlibCommandType {
+	ADLIB_PLAY_TRACK,
+	ADLIB_HALT_TRACK,
+	ADLIB_PLAY_SOUND_EFFECT
+};
+
+static const unsigned int ADLIB_RING_LEN = 16384;   /* Samples; a power of two. */
+static const unsigned int ADLIB_CHUNK_LEN = 512;    /* Samples rendered at a time. */
+static const unsigned int ADLIB_COMMAND_LEN = 64;   /* A power of two. */
+
+static struct {
+	ALLEGRO_THREAD *thread;
+	unsigned int target;                    /* Samples to keep rendered. */
+
+	int16 ring[ADLIB_RING_LEN];
+	std::atomic<unsigned int> ringHead;     /* Written by the thread. */
+	std::atomic<unsigned int> ringTail;     /* Written by the main thread. */
+
+	struct { uint8 type, arg; } command[ADLIB_COMMAND_LEN];
+	std::atomic<unsigned int> commandHead;  /* Written by the main thread. */
+	std::atomic<unsigned int> commandTail;  /* Written by the thread. */
+
+	/* Whether the track is playing, as of the last command processed,
+	 * and as the main thread expects it to be once every command is.
+	 */
+	std::atomic<bool> playing;
+	bool expectPlaying;
+
+	/* The first fragment is read before anything could be rendered,
+	 * so it is not counted as an underrun.
+	 */
+	bool firstRead;
+	std::atomic<unsigned int> underruns;
+	std::atomic<unsigned int> chunks;
+	std::atomic<unsigned int> renderTime;   /* Microseconds, in total. */
+	std::atomic<unsigned int> renderTimeMax;
+} s_adlibWorker;
+
 static char *AudioA5_LoadInternalMusic(const MusicInfo *mid, uint32 *ret_length);
 static void AudioA5_InitAdlibEffects(void);
 static void AudioA5_FreeMusicStream(void);
@@ -133,6 +179,217 @@ MPU_ThreadProc(ALLEGRO_THREAD *thread, void *arg0)
 
 /*--------------------------------------------------------------*/
 
+static void
+AdlibWorker_ProcessCommands(void)
+{
+	const unsigned int head = s_adlibWorker.commandHead.load(std::memory_order_acquire);
+	unsigned int tail = s_adlibWorker.commandTail.load(std::memory_order_relaxed);
+
+	if (tail == head)
+		return;
+
+	for (; tail != head; tail++) {
+		const unsigned int i = tail & (ADLIB_COMMAND_LEN - 1);
+
+		switch (s_adlibWorker.command[i].type) {
+			case ADLIB_PLAY_TRACK:
+				s_adlib->playTrack(s_adlibWorker.command[i].arg);
+				break;
+
+			case ADLIB_HALT_TRACK:
+				s_adlib->haltTrack();
+				break;
+
+			case ADLIB_PLAY_SOUND_EFFECT:
+				s_adlib->playSoundEffect(s_adlibWorker.command[i].arg);
+				break;
+		}
+	}
+
+	/* Publish the state before the commands are seen to be done. */
+	s_adlibWorker.playing.store(s_adlib->isPlaying(), std::memory_order_relaxed);
+	s_adlibWorker.commandTail.store(tail, std::memory_order_release);
+}
+
+static void *
+AdlibWorker_ThreadProc(ALLEGRO_THREAD *thread, void *arg)
+{
+	VARIABLE_NOT_USED(arg);
+
+	while (!al_get_thread_should_stop(thread)) {
+		AdlibWorker_ProcessCommands();
+
+		const unsigned int head = s_adlibWorker.ringHead.load(std::memory_order_relaxed);
+		const unsigned int tail = s_adlibWorker.ringTail.load(std::memory_order_acquire);
+
+		if (head - tail + ADLIB_CHUNK_LEN > s_adlibWorker.target) {
+			al_rest(0.002);
+			continue;
+		}
+
+		/* The head is always a multiple of the chunk length, so the
+		 * chunk never wraps around the ring.
+		 */
+		const double start = al_get_time();
+
+		SoundAdLibPC::callback(s_adlib,
+				(SoundAdLibPC::Uint8 *)&s_adlibWorker.ring[head & (ADLIB_RING_LEN - 1)],
+				ADLIB_CHUNK_LEN * sizeof(int16));
+
+		const unsigned int us = 1e6 * (al_get_time() - start);
+
+		s_adlibWorker.chunks++;
+		s_adlibWorker.renderTime += us;
+		if (us > s_adlibWorker.renderTimeMax)
+			s_adlibWorker.renderTimeMax = us;
+
+		s_adlibWorker.playing.store(s_adlib->isPlaying(), std::memory_order_relaxed);
+		s_adlibWorker.ringHead.store(head + ADLIB_CHUNK_LEN, std::memory_order_release);
+	}
+
+	return NULL;
+}
+
+/**
+ * Start synthesising s_adlib, keeping g_adlib_latency milliseconds
+ * rendered beyond the fragment next due.  If the thread cannot be
+ * created, commands and fragments are handled on the calling thread.
+ */
+static void
+AdlibWorker_Start(void)
+{
+	assert(s_adlibWorker.thread == NULL);
+
+	const int latency = std::min(std::max(g_adlib_latency, 10), 250);
+
+	s_adlibWorker.target = std::min(FRAGLEN + latency * SRATE / 1000, (int)ADLIB_RING_LEN);
+	s_adlibWorker.ringHead = 0;
+	s_adlibWorker.ringTail = 0;
+	s_adlibWorker.commandHead = 0;
+	s_adlibWorker.commandTail = 0;
+	s_adlibWorker.playing = s_adlib->isPlaying();
+	s_adlibWorker.expectPlaying = s_adlibWorker.playing;
+	s_adlibWorker.firstRead = true;
+	s_adlibWorker.underruns = 0;
+	s_adlibWorker.chunks = 0;
+	s_adlibWorker.renderTime = 0;
+	s_adlibWorker.renderTimeMax = 0;
+
+	s_adlibWorker.thread = al_create_thread(AdlibWorker_ThreadProc, NULL);
+	if (s_adlibWorker.thread == NULL) {
+		Warning("AdLib: failed to create the synthesis thread, synthesising on the main thread\n");
+		return;
+	}
+
+	al_start_thread(s_adlibWorker.thread);
+}
+
+static void
+AdlibWorker_Stop(void)
+{
+	if (s_adlibWorker.thread == NULL)
+		return;
+
+	al_destroy_thread(s_adlibWorker.thread);
+	s_adlibWorker.thread = NULL;
+
+	/* Render times are per chunk, reported per fragment. */
+	const unsigned int chunks = s_adlibWorker.chunks;
+	if (s_adlibWorker.underruns > 0 && chunks > 0) {
+		Warning("AdLib: %u underruns; %.2f ms average, %.2f ms longest render per fragment\n",
+				(unsigned int)s_adlibWorker.underruns,
+				1e-3 * s_adlibWorker.renderTime / chunks * FRAGLEN / ADLIB_CHUNK_LEN,
+				1e-3 * s_adlibWorker.renderTimeMax * FRAGLEN / ADLIB_CHUNK_LEN);
+	}
+}
+
+static void
+AdlibWorker_Send(enum AdlibCommandType type, uint8 arg)
+{
+	const unsigned int head = s_adlibWorker.commandHead.load(std::memory_order_relaxed);
+
+	/* The thread empties the queue between chunks, so wait for it
+	 * rather than lose the command.
+	 */
+	while (head - s_adlibWorker.commandTail.load(std::memory_order_acquire) >= ADLIB_COMMAND_LEN)
+		al_rest(0.001);
+
+	s_adlibWorker.command[head & (ADLIB_COMMAND_LEN - 1)].type = type;
+	s_adlibWorker.command[head & (ADLIB_COMMAND_LEN - 1)].arg = arg;
+	s_adlibWorker.commandHead.store(head + 1, std::memory_order_release);
+
+	if (type == ADLIB_PLAY_TRACK) {
+		s_adlibWorker.expectPlaying = true;
+	} else if (type == ADLIB_HALT_TRACK) {
+		s_adlibWorker.expectPlaying = false;
+	}
+
+	if (s_adlibWorker.thread == NULL)
+		AdlibWorker_ProcessCommands();
+}
+
+static bool
+AdlibWorker_IsPlaying(void)
+{
+	const unsigned int head = s_adlibWorker.commandHead.load(std::memory_order_relaxed);
+	const unsigned int tail = s_adlibWorker.commandTail.load(std::memory_order_acquire);
+
+	return (tail != head) ? s_adlibWorker.expectPlaying : s_adlibWorker.playing.load();
+}
+
+/**
+ * Copy the samples rendered into the fragment, padding it with silence
+ * if there are not enough.  Without the thread, the fragment is
+ * rendered here.
+ */
+static void
+AdlibWorker_Read(int16 *frag, unsigned int len)
+{
+	if (s_adlibWorker.thread == NULL) {
+		SoundAdLibPC::callback(s_adlib, (SoundAdLibPC::Uint8 *)frag, len * sizeof(int16));
+		s_adlibWorker.playing.store(s_adlib->isPlaying(), std::memory_order_relaxed);
+		return;
+	}
+
+	const unsigned int head = s_adlibWorker.ringHead.load(std::memory_order_acquire);
+	unsigned int tail = s_adlibWorker.ringTail.load(std::memory_order_relaxed);
+	const unsigned int n = std::min(head - tail, len);
+
+	for (unsigned int i = 0; i < n; ) {
+		const unsigned int start = tail & (ADLIB_RING_LEN - 1);
+		const unsigned int count = std::min(n - i, ADLIB_RING_LEN - start);
+
+		memcpy(&frag[i], &s_adlibWorker.ring[start], count * sizeof(int16));
+		i += count;
+		tail += count;
+	}
+
+	if (n < len) {
+		memset(&frag[n], 0, (len - n) * sizeof(int16));
+
+		if (!s_adlibWorker.firstRead)
+			s_adlibWorker.underruns++;
+	}
+
+	s_adlibWorker.firstRead = false;
+
+	s_adlibWorker.ringTail.store(tail, std::memory_order_release);
+}
+
+/**
+ * Stop the synthesis thread and delete s_adlib.
+ */
+static void
+AudioA5_DeleteAdlib(void)
+{
+	AdlibWorker_Stop();
+
+	delete s_adlib;
+	s_adlib = NULL;
+}
+
+/*--------------------------------------------------------------*/
+
 static void
 AudioA5_DisableMusicSet(enum MusicSet music_set)
 {
@@ -238,8 +495,7 @@ AudioA5_Uninit(void)
 		al_destroy_audio_stream(s_effect_stream);
 		s_effect_stream = NULL;
 
-		delete s_adlib;
-		s_adlib = NULL;
+		AudioA5_DeleteAdlib();
 	}
 
 	midi_uninit();
@@ -316,12 +572,14 @@ AudioA5_InitAdlib(const MusicInfo *mid)
 	}
 
 	ALLEGRO_FILE *f = al_open_memfile(buf, length, "r");
-	delete s_adlib;
+	AudioA5_DeleteAdlib();
 	s_adlib = new SoundAdLibPC(f, SRATE, g_opl_mame);
 	s_adlib->init();
 	al_fclose(f);
 	delete[] buf;
 
+	AdlibWorker_Start();
+
 	al_set_audio_stream_gain(stream, music_volume);
 	al_set_audio_stream_pan(stream, ALLEGRO_AUDIO_PAN_NONE);
 	al_attach_audio_stream_to_mixer(stream, al_mixer);
@@ -385,8 +643,7 @@ AudioA5_FreeMusicStream(void)
 
 		case MUSICSTREAM_ADLIB:
 			if (s_adlib != NULL) {
-				delete s_adlib;
-				s_adlib = NULL;
+				AudioA5_DeleteAdlib();
 
 				if (s_music_stream == s_effect_stream)
 					s_effect_stream = NULL;
@@ -455,7 +712,7 @@ AudioA5_InitAdlibMusic(const MusicInfo *mid)
 	if (s_effect_stream != NULL)
 		al_destroy_audio_stream(s_effect_stream);
 
-	s_adlib->playTrack(track);
+	AdlibWorker_Send(ADLIB_PLAY_TRACK, track);
 	s_music_stream = stream;
 	s_effect_stream = stream;
 	curr_music_stream_type = MUSICSTREAM_ADLIB;
@@ -619,7 +876,7 @@ AudioA5_StopMusic(void)
 
 		case MUSICSTREAM_ADLIB:
 			if (s_adlib != NULL)
-				s_adlib->haltTrack();
+				AdlibWorker_Send(ADLIB_HALT_TRACK, 0);
 			break;
 
 		case MUSICSTREAM_MIDI:
@@ -669,9 +926,7 @@ AudioA5_PollMusic(void)
 	if (frag == NULL)
 		return;
 
-	s_adlib->callback(s_adlib, (SoundAdLibPC::Uint8 *)frag,
-			FRAGLEN * al_get_audio_depth_size(ALLEGRO_AUDIO_DEPTH_INT16));
-
+	AdlibWorker_Read((int16 *)frag, FRAGLEN);
 	al_set_audio_stream_fragment(stream, frag);
 }
 
@@ -687,7 +942,7 @@ AudioA5_MusicIsPlaying(void)
 			return false;
 
 		case MUSICSTREAM_ADLIB:
-			return s_adlib->isPlaying();
+			return AdlibWorker_IsPlaying();
 
 		case MUSICSTREAM_MIDI:
 			return (s_music_thread != NULL) && (!al_get_thread_should_stop(s_music_thread));
@@ -707,7 +962,7 @@ void
 AudioA5_PlaySoundEffect(enum SoundID effectID)
 {
 	if (s_adlib != NULL)
-		s_adlib->playSoundEffect(effectID);
+		AdlibWorker_Send(ADLIB_PLAY_SOUND_EFFECT, effectID);
 }
 
 void
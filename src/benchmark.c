@@ -0,0 +1,515 @@
+/** @file src/benchmark.c
+ *
+ * Headless simulation benchmark.
+ *
+ *   dunedynasty --benchmark skirmish <seed> <ticks>
+ *   dunedynasty --benchmark scenario <scenarioID> <ticks>
+ *   dunedynasty --benchmark bullets <seed> <rounds>
+ *   dunedynasty --benchmark explosions <seed> <ticks>
+ *   dunedynasty --benchmark tiles <seed> <rounds>
+ *   dunedynasty --benchmark drawlist <seed> <frames>
+ *
+ * Starts a skirmish generated from the seed, or a Dune II scenario as
+ * the Atreides, then runs the server logic for the given number of
+ * ticks as fast as possible.  Nothing is drawn or played, and the
+ * player's house is left idle while the computer houses play.
+ *
+ * Prints the ticks per second, the time spent in each subsystem, and a
+ * hash of the final state.  Two runs with the same arguments must
+ * print the same hash.
+ *
+ * The bullets benchmark instead starts the skirmish and, each round,
+ * fires bullets between the structures until the unit pool is full,
+ * then removes them in a random order.  It prints the time taken to
+ * create and remove each bullet.
+ *
+ * The explosions benchmark starts the skirmish and, each tick, starts
+ * a large battle's worth of explosions at random tiles, each stopping
+ * the one already on its tile, then runs Explosion_Tick and
+ * Animation_Tick.  It prints the time per tick for each.
+ *
+ * The tiles benchmark starts the skirmish and, each round, scores
+ * entering every tile from every direction for each unit, with the
+ * landscape type and movement speed planes and again without them.
+ * It prints the time per call for each.
+ *
+ * The drawlist benchmark does not start a game either.  It moves the
+ * most units there can be a little each frame, and sorts them for
+ * drawing with a single bubble pass, as Unit_Sort used to, with the
+ * draw list's insertion sort, and with its radix sort.  It prints the
+ * time per frame for each.
+ *
+ * Every benchmark that runs a game checks the planes against the map
+ * at the end.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+
+#include "benchmark.h"
+
+#include "animation.h"
+#include "audio/audio.h"
+#include "config.h"
+#include "drawlist.h"
+#include "explosion.h"
+#include "gameloop.h"
+#include "gui/gui.h"
+#include "house.h"
+#include "map.h"
+#include "mods/skirmish.h"
+#include "os/common.h"
+#include "opendune.h"
+#include "pool/pool.h"
+#include "pool/pool_house.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_unit.h"
+#include "scenario.h"
+#include "sprites.h"
+#include "structure.h"
+#include "timer/timer.h"
+#include "tools/coord.h"
+#include "tools/encoded_index.h"
+#include "tools/hash.h"
+#include "tools/random_general.h"
+#include "tools/random_lcg.h"
+#include "tools/random_xorshift.h"
+#include "unit.h"
+
+enum BenchmarkMode {
+	BENCHMARK_NONE,
+	BENCHMARK_SKIRMISH,
+	BENCHMARK_SCENARIO,
+	BENCHMARK_BULLETS,
+	BENCHMARK_EXPLOSIONS,
+	BENCHMARK_TILES,
+	BENCHMARK_DRAWLIST
+};
+
+enum {
+	BENCHMARK_EXPLOSIONS_PER_TICK = 40
+};
+
+static enum BenchmarkMode s_mode = BENCHMARK_NONE;
+static uint32 s_seed;
+static int64_t s_ticks;
+
+/**
+ * @return True if the benchmark was asked for on the command line.
+ *         Exits on malformed arguments.
+ */
+bool
+Benchmark_ParseArgs(int argc, char **argv)
+{
+	if (argc < 2 || strcmp(argv[1], "--benchmark") != 0)
+		return false;
+
+	if (argc == 5 && strcmp(argv[2], "skirmish") == 0) {
+		s_mode = BENCHMARK_SKIRMISH;
+	} else if (argc == 5 && strcmp(argv[2], "scenario") == 0) {
+		s_mode = BENCHMARK_SCENARIO;
+	} else if (argc == 5 && strcmp(argv[2], "bullets") == 0) {
+		s_mode = BENCHMARK_BULLETS;
+	} else if (argc == 5 && strcmp(argv[2], "explosions") == 0) {
+		s_mode = BENCHMARK_EXPLOSIONS;
+	} else if (argc == 5 && strcmp(argv[2], "tiles") == 0) {
+		s_mode = BENCHMARK_TILES;
+	} else if (argc == 5 && strcmp(argv[2], "drawlist") == 0) {
+		s_mode = BENCHMARK_DRAWLIST;
+	} else {
+		fprintf(stderr, "Usage: %s --benchmark skirmish <seed> <ticks>\n", argv[0]);
+		fprintf(stderr, "       %s --benchmark scenario <scenarioID> <ticks>\n", argv[0]);
+		fprintf(stderr, "       %s --benchmark bullets <seed> <rounds>\n", argv[0]);
+		fprintf(stderr, "       %s --benchmark explosions <seed> <ticks>\n", argv[0]);
+		fprintf(stderr, "       %s --benchmark tiles <seed> <rounds>\n", argv[0]);
+		fprintf(stderr, "       %s --benchmark drawlist <seed> <frames>\n", argv[0]);
+		exit(1);
+	}
+
+	s_seed = strtoul(argv[3], NULL, 0);
+	s_ticks = strtoll(argv[4], NULL, 0);
+	return true;
+}
+
+/**
+ * Seed every random number generator the game logic uses, which are
+ * otherwise seeded from the time.
+ */
+static void
+Benchmark_SeedRandom(uint32 seed)
+{
+	srand(seed);
+	Tools_Random_Seed(seed);
+	Tools_RandomLCG_Seed(seed & 0xFFFF);
+	Random_Xorshift_Seed(seed, seed ^ 0x9E3779B9, seed ^ 0x7F4A7C15, seed ^ 0x3C6EF372);
+}
+
+/**
+ * Load what GameLoop_Main loads for the player's house before starting
+ * a scenario.
+ */
+static void
+Benchmark_PreparePlayerHouse(void)
+{
+	Sprites_UnloadTiles();
+	Sprites_LoadTiles();
+	GUI_Palette_CreateRemap(g_playerHouseID);
+	Timer_ResetScriptTimers();
+}
+
+static bool
+Benchmark_StartSkirmish(uint32 seed)
+{
+	g_campaign_selected = CAMPAIGNID_SKIRMISH;
+	Skirmish_Initialise();
+	g_skirmish.seed = seed;
+
+	g_skirmish.player_config[HOUSE_ATREIDES].brain = BRAIN_HUMAN;
+	g_skirmish.player_config[HOUSE_HARKONNEN].brain = BRAIN_CPU;
+	g_skirmish.player_config[HOUSE_ORDOS].brain = BRAIN_CPU;
+	g_skirmish.player_config[HOUSE_SARDAUKAR].brain = BRAIN_CPU;
+
+	if (!Skirmish_GenerateMap(MAP_GENERATOR_FINAL)) {
+		fprintf(stderr, "Seed %u does not generate a playable map.\n", seed);
+		return false;
+	}
+
+	Benchmark_PreparePlayerHouse();
+	Skirmish_StartScenario();
+	return true;
+}
+
+static bool
+Benchmark_StartScenario(uint16 scenarioID)
+{
+	g_campaign_selected = CAMPAIGNID_DUNE_II;
+	g_campaignID = 0;
+	g_playerHouseID = HOUSE_ATREIDES;
+	Campaign_Load();
+
+	Benchmark_PreparePlayerHouse();
+	Game_LoadScenario(g_playerHouseID, scenarioID);
+	return true;
+}
+
+#define Benchmark_HashField(hash, field) Tools_HashFNV1a((hash), &(field), sizeof(field))
+
+/**
+ * Hash the state the game logic works on: the map, and the objects and
+ * houses in pool order.  Only fields are hashed, not whole structs,
+ * which hold padding and pointers.
+ */
+static uint64_t
+Benchmark_HashState(void)
+{
+	PoolFindStruct find;
+	uint64_t hash = TOOLS_HASH_FNV1A_BASIS;
+
+	hash = Benchmark_HashField(hash, g_timerGame);
+	hash = Tools_HashFNV1a(hash, g_map, sizeof(g_map));
+
+	for (const House *h = House_FindFirst(&find, HOUSE_INVALID);
+			h != NULL;
+			h = House_FindNext(&find)) {
+		hash = Benchmark_HashField(hash, h->index);
+		hash = Benchmark_HashField(hash, h->credits);
+		hash = Benchmark_HashField(hash, h->unitCount);
+		hash = Benchmark_HashField(hash, h->structuresBuilt);
+	}
+
+	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
+			s != NULL;
+			s = Structure_FindNext(&find)) {
+		hash = Benchmark_HashField(hash, s->o.index);
+		hash = Benchmark_HashField(hash, s->o.type);
+		hash = Benchmark_HashField(hash, s->o.houseID);
+		hash = Benchmark_HashField(hash, s->o.position.x);
+		hash = Benchmark_HashField(hash, s->o.position.y);
+		hash = Benchmark_HashField(hash, s->o.hitpoints);
+		hash = Benchmark_HashField(hash, s->state);
+		hash = Benchmark_HashField(hash, s->countDown);
+	}
+
+	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+			u != NULL;
+			u = Unit_FindNext(&find)) {
+		hash = Benchmark_HashField(hash, u->o.index);
+		hash = Benchmark_HashField(hash, u->o.type);
+		hash = Benchmark_HashField(hash, u->o.houseID);
+		hash = Benchmark_HashField(hash, u->o.position.x);
+		hash = Benchmark_HashField(hash, u->o.position.y);
+		hash = Benchmark_HashField(hash, u->o.hitpoints);
+		hash = Benchmark_HashField(hash, u->actionID);
+		hash = Benchmark_HashField(hash, u->amount);
+		hash = Benchmark_HashField(hash, u->orientation[0].current);
+		hash = Benchmark_HashField(hash, u->orientation[1].current);
+	}
+
+	return hash;
+}
+
+/**
+ * Fill the unit pool with bullets fired between the structures, then
+ * remove them in a random order, for the given number of rounds.
+ */
+static void
+Benchmark_RunBullets(int64_t rounds)
+{
+	static const enum UnitType type[3] = { UNIT_BULLET, UNIT_MISSILE_ROCKET, UNIT_SONIC_BLAST };
+	static Unit *bullet[UNIT_INDEX_MAX_RAISED];
+	PoolFindStruct find;
+	const Structure *structure[STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDEX_RAISED_AMOUNT];
+	int structureCount = 0;
+	clock_t elapsed[2] = { 0, 0 };
+	int64_t created = 0;
+
+	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
+			s != NULL;
+			s = Structure_FindNext(&find)) {
+		if (!Structure_SharesPoolElement(s->o.type))
+			structure[structureCount++] = s;
+	}
+
+	if (structureCount < 2) {
+		fprintf(stderr, "Not enough structures to fire between.\n");
+		return;
+	}
+
+	for (int64_t r = 0; r < rounds; r++) {
+		int count = 0;
+		int failures = 0;
+
+		clock_t start = clock();
+
+		/* Stop once no type of bullet can be created. */
+		for (int i = 0; failures < (int)lengthof(type); i++) {
+			const Structure *from = structure[i % structureCount];
+			const Structure *to = structure[(i + 1) % structureCount];
+			Unit *u = Unit_CreateBullet(from->o.position, type[i % lengthof(type)],
+					from->o.houseID, 1, Tools_Index_Encode(to->o.index, IT_STRUCTURE));
+
+			if (u == NULL) {
+				failures++;
+			} else {
+				failures = 0;
+				bullet[count++] = u;
+			}
+		}
+
+		elapsed[0] += clock() - start;
+		created += count;
+
+		for (int i = count - 1; i > 0; i--) {
+			const int j = rand() % (i + 1);
+			Unit *u = bullet[i];
+
+			bullet[i] = bullet[j];
+			bullet[j] = u;
+		}
+
+		start = clock();
+
+		for (int i = 0; i < count; i++)
+			Unit_Remove(bullet[i]);
+
+		elapsed[1] += clock() - start;
+	}
+
+	if (created == 0)
+		return;
+
+	printf("%"PRId64" bullets over %"PRId64" rounds:\n", created, rounds);
+	printf("  create: %8.3f us/bullet\n", 1e6 * elapsed[0] / CLOCKS_PER_SEC / created);
+	printf("  remove: %8.3f us/bullet\n", 1e6 * elapsed[1] / CLOCKS_PER_SEC / created);
+}
+
+/**
+ * Start explosions of every type at random tiles each tick, each
+ * stopping the one already on its tile, for the given number of ticks.
+ * Time starting them, Explosion_Tick, and Animation_Tick for the
+ * craters and flames they leave behind.
+ */
+static void
+Benchmark_RunExplosions(int64_t ticks)
+{
+	clock_t elapsed[3] = { 0, 0, 0 };
+	int64_t started = 0;
+
+	/* The explosions and animations run on the GUI timer, so stop it
+	 * and move it on by hand, one tick at a time.  It is left stopped,
+	 * as the benchmark exits afterwards.
+	 */
+	Timer_SetTimer(TIMER_GUI, false);
+
+	for (int64_t tick = 0; tick < ticks; tick++) {
+		Timer_AddTicks(TIMER_GUI, 1);
+
+		clock_t start = clock();
+
+		for (int i = 0; i < BENCHMARK_EXPLOSIONS_PER_TICK; i++) {
+			const uint16 packed = Tools_RandomLCG_Range(0, MAP_SIZE_MAX * MAP_SIZE_MAX - 1);
+			const uint16 explosionType = Tools_RandomLCG_Range(0, EXPLOSION_SPICE_BLOOM_TREMOR);
+
+			if (!Map_IsValidPosition(packed))
+				continue;
+
+			Explosion_Start(explosionType, Tile_UnpackTile(packed), HOUSE_HARKONNEN);
+			started++;
+		}
+
+		elapsed[0] += clock() - start;
+
+		start = clock();
+		Explosion_Tick();
+		elapsed[1] += clock() - start;
+
+		start = clock();
+		Animation_Tick();
+		elapsed[2] += clock() - start;
+	}
+
+	if (ticks <= 0)
+		return;
+
+	printf("%"PRId64" explosions over %"PRId64" ticks:\n", started, ticks);
+	printf("  Explosion_Start: %8.3f us/tick\n", 1e6 * elapsed[0] / CLOCKS_PER_SEC / ticks);
+	printf("  Explosion_Tick:  %8.3f us/tick\n", 1e6 * elapsed[1] / CLOCKS_PER_SEC / ticks);
+	printf("  Animation_Tick:  %8.3f us/tick\n", 1e6 * elapsed[2] / CLOCKS_PER_SEC / ticks);
+}
+
+static int64_t
+Benchmark_ScoreAllTiles(Unit * const *unit, int count, int64_t rounds)
+{
+	int64_t sum = 0;
+
+	for (int64_t r = 0; r < rounds; r++) {
+		for (int i = 0; i < count; i++) {
+			for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+				for (uint16 orient8 = 0; orient8 < 8; orient8++)
+					sum += Unit_GetTileEnterScore(unit[i], packed, orient8);
+			}
+		}
+	}
+
+	return sum;
+}
+
+/**
+ * Score entering every tile for each unit on the map, with the
+ * landscape type and movement speed planes and without them.
+ */
+static bool
+Benchmark_RunTiles(int64_t rounds)
+{
+	static Unit *unit[UNIT_INDEX_MAX_RAISED];
+	PoolFindStruct find;
+	int count = 0;
+
+	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
+			u != NULL;
+			u = Unit_FindNext(&find)) {
+		if (!u->o.flags.s.isNotOnMap)
+			unit[count++] = u;
+	}
+
+	if (count == 0 || rounds <= 0) {
+		fprintf(stderr, "No units to score tiles for.\n");
+		return false;
+	}
+
+	clock_t start = clock();
+	const int64_t planesSum = Benchmark_ScoreAllTiles(unit, count, rounds);
+	const clock_t planesElapsed = clock() - start;
+
+	Map_ClearPlanes();
+
+	start = clock();
+	const int64_t mapSum = Benchmark_ScoreAllTiles(unit, count, rounds);
+	const clock_t mapElapsed = clock() - start;
+
+	Map_InvalidateAll();
+
+	const int64_t calls = rounds * count * MAP_SIZE_MAX * MAP_SIZE_MAX * 8;
+
+	printf("%"PRId64" calls to Unit_GetTileEnterScore for %d units:\n", calls, count);
+	printf("  planes: %8.3f ns/call\n", 1e9 * planesElapsed / CLOCKS_PER_SEC / calls);
+	printf("  g_map:  %8.3f ns/call\n", 1e9 * mapElapsed / CLOCKS_PER_SEC / calls);
+
+	if (planesSum != mapSum) {
+		fprintf(stderr, "Scores differ: %"PRId64" with planes, %"PRId64" without.\n", planesSum, mapSum);
+		return false;
+	}
+
+	return true;
+}
+
+static int
+Benchmark_RunMode(void)
+{
+	Benchmark_SeedRandom(s_seed);
+
+	if (s_mode == BENCHMARK_DRAWLIST) {
+		DrawList_Benchmark(s_seed, s_ticks);
+		return 0;
+	}
+
+	const bool started
+		= (s_mode == BENCHMARK_SCENARIO)
+		? Benchmark_StartScenario(s_seed)
+		: Benchmark_StartSkirmish(s_seed);
+
+	if (!started)
+		return 1;
+
+	g_gameMode = GM_NORMAL;
+	g_gameOverlay = GAMEOVERLAY_NONE;
+
+	if (s_mode == BENCHMARK_TILES) {
+		if (!Benchmark_RunTiles(s_ticks))
+			return 1;
+	} else if (s_mode == BENCHMARK_BULLETS) {
+		Benchmark_RunBullets(s_ticks);
+		printf("Final state: %016"PRIx64"\n", Benchmark_HashState());
+	} else if (s_mode == BENCHMARK_EXPLOSIONS) {
+		Benchmark_RunExplosions(s_ticks);
+		printf("Final state: %016"PRIx64"\n", Benchmark_HashState());
+	} else {
+		const int64_t ticks = GameLoop_RunHeadless(s_ticks);
+
+		printf("Final state after %"PRId64" ticks: %016"PRIx64"\n",
+				ticks, Benchmark_HashState());
+	}
+
+	const int stale = Map_CheckPlanes();
+	if (stale != 0) {
+		fprintf(stderr, "%d tiles out of date in the map planes.\n", stale);
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Run the benchmark given on the command line.  Call after the game
+ * has been initialised, instead of the menu.
+ *
+ * @return The exit code.
+ */
+int
+Benchmark_Run(void)
+{
+	/* Hints are saved with the options on exit, so put them back. */
+	const bool hints = g_gameConfig.hints;
+
+	g_enable_audio = false;
+	g_gameConfig.hints = false;
+
+	const int ret = Benchmark_RunMode();
+
+	g_gameConfig.hints = hints;
+	return ret;
+}
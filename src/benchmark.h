@@ -0,0 +1,11 @@
+/** @file src/benchmark.h Headless simulation benchmark. */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "types.h"
+
+extern bool Benchmark_ParseArgs(int argc, char **argv);
+extern int Benchmark_Run(void);
+
+#endif
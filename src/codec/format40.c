@@ -11,7 +11,7 @@
  * @param dst The place the decoded fragment will be loaded.
  * @param src The encoded fragment.
  */
-void Format40_Decode(uint8 *dst, uint8 *src)
+void Format40_Decode(uint8 *dst, const uint8 *src)
 {
 	while (true) {
 		uint16 flag;
@@ -76,7 +76,7 @@ void Format40_Decode(uint8 *dst, uint8 *src)
  * @param src Data source.
  * @param width Width of the rectangle.
  */
-void Format40_Decode_XorToScreen(uint8 *base, uint8 *src, uint16 width)
+void Format40_Decode_XorToScreen(uint8 *base, const uint8 *src, uint16 width)
 {
 	uint8 *dst;
 	uint16 length;
@@ -189,7 +189,7 @@ void Format40_Decode_XorToScreen(uint8 *base, uint8 *src, uint16 width)
  * @param src Data source.
  * @param width Width of the rectangle.
  */
-void Format40_Decode_ToScreen(uint8 *base, uint8 *src, uint16 width)
+void Format40_Decode_ToScreen(uint8 *base, const uint8 *src, uint16 width)
 {
 	uint8 *dst;
 	uint16 length;
@@ -33,6 +33,8 @@ typedef struct GameCfg {
 	bool holdControlToZoom;
 	float panSensitivity;
 	bool hardwareCursor;
+	bool terrainCache;      /* Draw the map from cached chunks rather than tile by tile. */
+	bool atlasCache;        /* Load the sprite textures from the personal data directory. */
 	struct DisplayMode displayMode;
 } GameCfg;
 
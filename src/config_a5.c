@@ -95,6 +95,8 @@ GameCfg g_gameConfig = {
 #else
 	true,   /* hardwareCursor */
 #endif
+	true,   /* terrainCache */
+	true,   /* atlasCache */
 	DISPLAY_MODE_INITIALIZER
 };
 
@@ -115,6 +117,8 @@ static const GameOption s_game_option[] = {
 	{ "graphics",   "sidebar_scale",    CONFIG_FLOAT_1_8,       .d._float = &g_screenDiv[SCREENDIV_SIDEBAR].scalex },
 	{ "graphics",   "viewport_scale",   CONFIG_FLOAT_1_8,       .d._float = &g_screenDiv[SCREENDIV_VIEWPORT].scalex },
 	{ "graphics",   "hardware_cursor",  CONFIG_BOOL,            .d._bool = &g_gameConfig.hardwareCursor },
+	{ "graphics",   "terrain_cache",    CONFIG_BOOL,            .d._bool = &g_gameConfig.terrainCache },
+	{ "graphics",   "atlas_cache",      CONFIG_BOOL,            .d._bool = &g_gameConfig.atlasCache },
 
 	{ "controls",   "auto_scroll",              CONFIG_BOOL,    .d._bool = &g_gameConfig.autoScroll },
 	{ "controls",   "scroll_speed",             CONFIG_INT_1_16,.d._int = &g_gameConfig.scrollSpeed },
@@ -130,6 +134,7 @@ static const GameOption s_game_option[] = {
 	{ "audio",  "music_volume",     CONFIG_FLOAT,   .d._float = &music_volume },
 	{ "audio",  "sound_volume",     CONFIG_FLOAT,   .d._float = &sound_volume },
 	{ "audio",  "opl_mame",         CONFIG_BOOL,    .d._bool = &g_opl_mame },
+	{ "audio",  "adlib_latency",    CONFIG_INT,     .d._int = &g_adlib_latency },
 	{ "audio",  "sound_font",       CONFIG_STRING,  .d._string = sound_font_path },
 	{ "audio",  "midi_device_id",   CONFIG_INT,  	.d._int = &g_midi_device_id },
 	{ "audio",  "midi_format",     	CONFIG_MIDI_FORMAT,  	.d._midi_format = &g_midi_format },
@@ -178,6 +183,7 @@ static const GameOption s_game_option[] = {
 	{ "enhancement",    "subtitle_override",        CONFIG_SUBTITLE,.d._subtitle = &enhancement_subtitle_override },	
 	{ "enhancement",    "target_lines", 			CONFIG_BOOL,.d._bool = &enhancement_draw_target_lines },
 	{ "enhancement",    "extend_spice_sensor",		CONFIG_BOOL,.d._bool = &enhancement_extend_spice_sensor },
+	{ "enhancement",    "hierarchical_pathfinder",	CONFIG_BOOL,.d._bool = &enhancement_hierarchical_pathfinder },
 
 	{ "multiplayer",    "name",         CONFIG_STRING_NAME, .d._string = g_net_name },
 	{ "multiplayer",    "host_address", CONFIG_STRING,      .d._string = g_host_addr },
@@ -0,0 +1,299 @@
+/** @file src/drawlist.c
+ *
+ * Depth-sorted list of units to draw.
+ *
+ * Units are drawn in order of their y position, with foot soldiers
+ * raised by a tile so that vehicles are drawn over them, then by
+ * movement type.  The list is kept separately from g_unitFindArray so
+ * that sorting for drawing does not change the order the game logic
+ * visits units in.
+ *
+ * Units only move a little between frames, so the list from the
+ * previous frame is nearly sorted and an insertion sort is cheap.
+ * After many units appear or disappear, or when the insertion sort
+ * has to move too far, the list is radix sorted instead.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+
+#include "drawlist.h"
+
+#include "map.h"
+#include "opendune.h"
+#include "pool/pool_unit.h"
+#include "unit.h"
+
+
+enum {
+	DRAWLIST_INDEX_BITS     = 9,
+	DRAWLIST_LAYER_BITS     = 7,
+	DRAWLIST_MAX            = UNIT_INDEX_MAX_RAISED,
+
+	/* Insertion sort gives up after this many moves per unit. */
+	DRAWLIST_INSERTION_BUDGET = 4
+};
+
+assert_compile(UNIT_INDEX_MAX_RAISED <= (1 << DRAWLIST_INDEX_BITS));
+assert_compile(MOVEMENT_MAX <= (1 << DRAWLIST_LAYER_BITS));
+
+typedef struct DrawListEntry {
+	uint32 key;                                             /*!< y, then movement type, then index. */
+	uint16 index;                                           /*!< Index of the Unit. */
+} DrawListEntry;
+
+static DrawListEntry s_entry[DRAWLIST_MAX];
+static DrawListEntry s_scratch[DRAWLIST_MAX];
+static int s_count;
+
+static uint32
+DrawList_GetKey(const Unit *u)
+{
+	const uint16 movementType = g_table_unitInfo[u->o.type].movementType;
+	uint16 y = u->o.position.y;
+
+	if (movementType == MOVEMENT_FOOT)
+		y -= 0x100;
+
+	/* Order (int16)y as unsigned. */
+	y ^= 0x8000;
+
+	return ((uint32)y << (DRAWLIST_LAYER_BITS + DRAWLIST_INDEX_BITS))
+		| ((uint32)movementType << DRAWLIST_INDEX_BITS)
+		| u->o.index;
+}
+
+/**
+ * Sort the entries by key, stopping once more than budget entries have
+ * been moved.
+ *
+ * @return False if the budget ran out and the entries are not sorted.
+ */
+static bool
+DrawList_InsertionSort(DrawListEntry *entry, int count, int budget)
+{
+	for (int i = 1; i < count; i++) {
+		const DrawListEntry e = entry[i];
+		int j = i;
+
+		for (; j > 0 && entry[j - 1].key > e.key; j--) {
+			entry[j] = entry[j - 1];
+
+			if (--budget < 0) {
+				entry[j - 1] = e;
+				return false;
+			}
+		}
+
+		entry[j] = e;
+	}
+
+	return true;
+}
+
+/**
+ * Sort the entries by key, eight bits at a time from the lowest.
+ */
+static void
+DrawList_RadixSort(DrawListEntry *entry, DrawListEntry *scratch, int count)
+{
+	DrawListEntry *src = entry;
+	DrawListEntry *dst = scratch;
+
+	for (int shift = 0; shift < 32; shift += 8) {
+		int offset[256];
+
+		memset(offset, 0, sizeof(offset));
+
+		for (int i = 0; i < count; i++)
+			offset[(src[i].key >> shift) & 0xFF]++;
+
+		for (int b = 0, sum = 0; b < 256; b++) {
+			const int n = offset[b];
+
+			offset[b] = sum;
+			sum += n;
+		}
+
+		for (int i = 0; i < count; i++)
+			dst[offset[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+		DrawListEntry *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	/* An even number of passes leaves the result in entry. */
+	assert(src == entry);
+}
+
+/**
+ * Bring the list up to date with the unit pool and sort it.  Call
+ * before iterating the list to draw units.
+ */
+void
+DrawList_Update(void)
+{
+	uint32 inPool[(DRAWLIST_MAX + 31) / 32];
+	int changes = 0;
+	int count = 0;
+
+	memset(inPool, 0, sizeof(inPool));
+
+	for (uint16 i = 0; i < g_unitFindCount; i++) {
+		const Unit *u = g_unitFindArray[i];
+
+		/* Units in a structure or being carried keep their position,
+		 *  but are not on the map, as for Unit_FindNext. */
+		if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		inPool[u->o.index / 32] |= 1u << (u->o.index % 32);
+	}
+
+	/* Keep the units still on the map, in their previous order. */
+	for (int i = 0; i < s_count; i++) {
+		const uint16 index = s_entry[i].index;
+		const uint32 bit = 1u << (index % 32);
+
+		if (inPool[index / 32] & bit) {
+			inPool[index / 32] &= ~bit;
+			s_entry[count++] = s_entry[i];
+		} else {
+			changes++;
+		}
+	}
+
+	/* Append the new units. */
+	for (uint16 i = 0; i < g_unitFindCount; i++) {
+		const uint16 index = g_unitFindArray[i]->o.index;
+		const uint32 bit = 1u << (index % 32);
+
+		if (inPool[index / 32] & bit) {
+			inPool[index / 32] &= ~bit;
+			s_entry[count++].index = index;
+			changes++;
+		}
+	}
+
+	s_count = count;
+
+	for (int i = 0; i < s_count; i++)
+		s_entry[i].key = DrawList_GetKey(Unit_Get_ByIndex(s_entry[i].index));
+
+	if (changes > s_count / 4
+			|| !DrawList_InsertionSort(s_entry, s_count, DRAWLIST_INSERTION_BUDGET * s_count)) {
+		DrawList_RadixSort(s_entry, s_scratch, s_count);
+	}
+}
+
+int
+DrawList_GetCount(void)
+{
+	return s_count;
+}
+
+Unit *
+DrawList_Get(int i)
+{
+	assert(0 <= i && i < s_count);
+
+	return Unit_Get_ByIndex(s_entry[i].index);
+}
+
+/*--------------------------------------------------------------*/
+
+/**
+ * One pass of adjacent swaps, as Unit_Sort used to do over
+ * g_unitFindArray every tick.
+ */
+static void
+DrawList_BubblePass(DrawListEntry *entry, int count)
+{
+	for (int i = 0; i < count - 1; i++) {
+		if (entry[i].key > entry[i + 1].key) {
+			const DrawListEntry e = entry[i];
+
+			entry[i] = entry[i + 1];
+			entry[i + 1] = e;
+		}
+	}
+}
+
+static void
+DrawList_BenchmarkMove(DrawListEntry *entry, int count, const uint16 *y)
+{
+	for (int i = 0; i < count; i++) {
+		const uint16 index = entry[i].index;
+
+		entry[i].key = ((uint32)(y[index] ^ 0x8000) << (DRAWLIST_LAYER_BITS + DRAWLIST_INDEX_BITS)) | index;
+	}
+}
+
+/**
+ * Time each way of sorting the maximum number of units, moving every
+ * unit up to half a tile each frame.
+ */
+void
+DrawList_Benchmark(uint32 seed, int frames)
+{
+	const int count = DRAWLIST_MAX;
+	static DrawListEntry entry[3][DRAWLIST_MAX];
+	uint16 y[DRAWLIST_MAX];
+	clock_t elapsed[3] = { 0, 0, 0 };
+	int unsorted = 0;
+	int fallbacks = 0;
+
+	srand(seed);
+
+	for (int i = 0; i < count; i++) {
+		y[i] = rand() % (MAP_SIZE_MAX << 8);
+
+		for (int n = 0; n < 3; n++)
+			entry[n][i].index = i;
+	}
+
+	for (int f = 0; f < frames; f++) {
+		for (int i = 0; i < count; i++)
+			y[i] = (y[i] + (rand() % 257) - 128) & 0x3FFF;
+
+		for (int n = 0; n < 3; n++) {
+			const clock_t start = clock();
+
+			DrawList_BenchmarkMove(entry[n], count, y);
+
+			if (n == 0) {
+				DrawList_BubblePass(entry[n], count);
+			} else if (n == 1) {
+				if (!DrawList_InsertionSort(entry[n], count, DRAWLIST_INSERTION_BUDGET * count)) {
+					DrawList_RadixSort(entry[n], s_scratch, count);
+					fallbacks++;
+				}
+			} else {
+				DrawList_RadixSort(entry[n], s_scratch, count);
+			}
+
+			elapsed[n] += clock() - start;
+		}
+
+		for (int i = 0; i < count - 1; i++) {
+			if (entry[0][i].key > entry[0][i + 1].key)
+				unsorted++;
+		}
+	}
+
+	if (frames <= 0)
+		return;
+
+	printf("Draw list of %d units over %d frames:\n", count, frames);
+	printf("  single bubble pass: %8.3f us/frame, %d pairs out of order\n",
+			1e6 * elapsed[0] / CLOCKS_PER_SEC / frames, unsorted);
+	printf("  insertion sort:     %8.3f us/frame, %d radix fallbacks\n",
+			1e6 * elapsed[1] / CLOCKS_PER_SEC / frames, fallbacks);
+	printf("  radix sort:         %8.3f us/frame\n",
+			1e6 * elapsed[2] / CLOCKS_PER_SEC / frames);
+}
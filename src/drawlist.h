@@ -0,0 +1,15 @@
+/** @file src/drawlist.h Depth-sorted list of units to draw. */
+
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "types.h"
+
+struct Unit;
+
+extern void DrawList_Update(void);
+extern int DrawList_GetCount(void);
+extern struct Unit *DrawList_Get(int i);
+extern void DrawList_Benchmark(uint32 seed, int frames);
+
+#endif
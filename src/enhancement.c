@@ -276,6 +276,13 @@ bool enhancement_draw_target_lines = false;
  */
 bool enhancement_extend_spice_sensor = false;
 
+/**
+ * Units find their routes with a hierarchical A* search over the map,
+ * rather than the original wall-following pathfinder.  Routes are
+ * shorter and units no longer get stuck in concave obstacles.
+ */
+bool enhancement_hierarchical_pathfinder = false;
+
 /*--------------------------------------------------------------*/
 /* Tweaks for campaigns. */
 
@@ -81,6 +81,7 @@ extern bool enhancement_show_outpost_unit_info;
 extern bool enhancement_instant_walls;
 extern bool enhancement_draw_target_lines;
 extern bool enhancement_extend_spice_sensor;
+extern bool enhancement_hierarchical_pathfinder;
 
 extern bool enhancement_fix_scenario_typos;
 extern bool enhancement_read_scenario_structure_health;
@@ -2,13 +2,13 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "os/math.h"
 
 #include "explosion.h"
 
 #include "animation.h"
-#include "binheap.h"
 #include "enhancement.h"
 #include "house.h"
 #include "map.h"
@@ -18,11 +18,16 @@
 #include "structure.h"
 #include "tile.h"
 #include "timer/timer.h"
+#include "timerwheel.h"
 #include "tools/coord.h"
 #include "tools/random_general.h"
 #include "tools/random_lcg.h"
 
-static BinHeap s_explosions;
+/* Explosions are numbered from 1, for the network protocol. */
+static Explosion *s_explosion;
+static int s_explosionCount = 1;
+static int s_explosionMax;
+static TimerWheel s_explosionWheel;
 
 extern const ExplosionCommandStruct * const g_table_explosion[EXPLOSIONTYPE_MAX];
 
@@ -57,6 +62,7 @@ static void Explosion_Func_TileDamage(Explosion *e, uint16 parameter)
 
 	if (type == LST_CONCRETE_SLAB) {
 		t->groundSpriteID = g_mapSpriteID[packed];
+		Map_InvalidateTile(packed);
 	}
 
 	if (g_table_landscapeInfo[type].craterType == 0) return;
@@ -85,6 +91,7 @@ static void Explosion_Func_TileDamage(Explosion *e, uint16 parameter)
 
 	/* Update the tile with the crater */
 	t->overlaySpriteID = overlaySpriteID + iconMap[0];
+	Map_InvalidateTile(packed);
 }
 
 /**
@@ -150,6 +157,8 @@ static void Explosion_Func_SetAnimation(Explosion *e, uint16 animationMapID)
 static void Explosion_Func_MoveYPosition(Explosion *e, uint16 row)
 {
 	e->position.y += (int16)row;
+
+	TimerWheel_SetTile(&s_explosionWheel, e->timer, Tile_PackTile(e->position));
 }
 
 /**
@@ -209,27 +218,65 @@ static void Explosion_StopAtPosition(uint16 packed)
 {
 	if (!g_map[packed].hasExplosion) return;
 
-	for (int i = 1; i < s_explosions.num_elem; i++) {
-		Explosion *e = (Explosion *)BinHeap_GetElem(&s_explosions, i);
+	const uint16 timer = TimerWheel_GetFirstOnTile(&s_explosionWheel, packed);
+	if (timer == TIMERWHEEL_NONE) return;
 
-		if (e->commands == NULL) continue;
-		if (Tile_PackTile(e->position) != packed) continue;
+	/* It stays on the wheel, and is drawn, until its timeout. */
+	Explosion_Func_Stop(&s_explosion[TimerWheel_GetNode(&s_explosionWheel, timer)->index], 0);
+	TimerWheel_SetTile(&s_explosionWheel, timer, TIMERWHEEL_NONE);
+}
 
-		Explosion_Func_Stop(e, 0);
-		break;
-	}
+static bool
+Explosion_Reserve(int num)
+{
+	if (num <= s_explosionMax)
+		return true;
+
+	int new_size = max(32, s_explosionMax);
+	while (new_size < num)
+		new_size *= 2;
+
+	Explosion *ptr = realloc(s_explosion, new_size * sizeof(s_explosion[0]));
+	if (ptr == NULL)
+		return false;
+
+	s_explosionMax = new_size;
+	s_explosion = ptr;
+	return true;
+}
+
+/**
+ * Forget explosion i, moving the last explosion into its place.
+ */
+static void
+Explosion_Remove(int i)
+{
+	TimerWheel_Remove(&s_explosionWheel, s_explosion[i].timer);
+	s_explosionCount--;
+
+	if (i == s_explosionCount)
+		return;
+
+	s_explosion[i] = s_explosion[s_explosionCount];
+	TimerWheel_GetNode(&s_explosionWheel, s_explosion[i].timer)->index = i;
 }
 
 void
 Explosion_Init(void)
 {
-	BinHeap_Init(&s_explosions, sizeof(Explosion));
+	TimerWheel_Init(&s_explosionWheel, Timer_GetTicks());
+	s_explosionCount = 1;
+	Explosion_Reserve(32);
 }
 
 void
 Explosion_Uninit(void)
 {
-	BinHeap_Free(&s_explosions);
+	TimerWheel_Free(&s_explosionWheel);
+	free(s_explosion);
+	s_explosion = NULL;
+	s_explosionCount = 1;
+	s_explosionMax = 0;
 }
 
 /**
@@ -245,13 +292,22 @@ void Explosion_Start(uint16 explosionType, tile32 position, uint8 houseID)
 	uint16 packed = Tile_PackTile(position);
 	Explosion_StopAtPosition(packed);
 
-	Explosion *e = BinHeap_Push(&s_explosions, Timer_GetTicks());
-	if (e != NULL) {
+	if (!Explosion_Reserve(s_explosionCount + 1)) return;
+
+	const int64_t curr_ticks = Timer_GetTicks();
+	const uint16 timer = TimerWheel_Add(&s_explosionWheel, curr_ticks, s_explosionCount);
+	if (timer != TIMERWHEEL_NONE) {
+		Explosion *e = &s_explosion[s_explosionCount++];
+
+		e->timeOut  = curr_ticks;
 		e->commands = g_table_explosion[explosionType];
 		e->current  = 0;
 		e->spriteID = 0;
 		e->position = position;
 		e->houseID = houseID;
+		e->timer    = timer;
+
+		TimerWheel_SetTile(&s_explosionWheel, timer, packed);
 
 		g_map[packed].hasExplosion = true;
 
@@ -278,10 +334,18 @@ void Explosion_Start(uint16 explosionType, tile32 position, uint8 houseID)
 void Explosion_Tick(void)
 {
 	const int64_t curr_ticks = Timer_GetTicks();
+	uint16 timer;
+
+	TimerWheel_Advance(&s_explosionWheel, curr_ticks);
 
-	Explosion *e = BinHeap_GetMin(&s_explosions);
-	while ((e != NULL) && (e->timeOut <= curr_ticks)) {
-		while (e->commands != NULL) {
+	while ((timer = TimerWheel_PopDue(&s_explosionWheel)) != TIMERWHEEL_NONE) {
+		const int i = TimerWheel_GetNode(&s_explosionWheel, timer)->index;
+
+		/* Look the explosion up after every command, as starting
+		 * another explosion may move them.
+		 */
+		while (s_explosion[i].commands != NULL) {
+			Explosion *e = &s_explosion[i];
 			uint16 parameter = e->commands[e->current].parameter;
 			uint16 command   = e->commands[e->current].command;
 
@@ -302,26 +366,23 @@ void Explosion_Tick(void)
 				case EXPLOSION_BLOOM_EXPLOSION:    Explosion_Func_BloomExplosion(e, parameter); break;
 			}
 
-			if (e->timeOut > curr_ticks)
+			if (s_explosion[i].timeOut > curr_ticks)
 				break;
 		}
 
-		/* Push explosion with updated time before pop. */
-		if (e->commands == NULL) {
-			BinHeap_Pop(&s_explosions);
+		if (s_explosion[i].commands == NULL) {
+			Explosion_Remove(i);
 		} else {
-			BinHeap_UpdateMin(&s_explosions);
+			TimerWheel_Schedule(&s_explosionWheel, timer, s_explosion[i].timeOut);
 		}
-
-		e = BinHeap_GetMin(&s_explosions);
 	}
 }
 
 void
 Explosion_Draw(void)
 {
-	for (int i = 1; i < s_explosions.num_elem; i++) {
-		const Explosion *e = (const Explosion *)BinHeap_GetElem(&s_explosions, i);
+	for (int i = 1; i < s_explosionCount; i++) {
+		const Explosion *e = &s_explosion[i];
 
 		if (e->spriteID == 0) continue;
 
@@ -340,23 +401,25 @@ Explosion_Draw(void)
 uint8
 Explosion_Get_NumActive(void)
 {
-	return min(s_explosions.num_elem, 0xFF);
+	return min(s_explosionCount, 0xFF);
 }
 
+/**
+ * Make room for the explosions sent by the server.  They are only
+ * drawn, so they are not put on the timer wheel.
+ */
 void
 Explosion_Set_NumActive(int num)
 {
-	if (s_explosions.max_elem < num) {
-		BinHeap_Resize(&s_explosions, num);
-	}
+	Explosion_Reserve(num);
 
-	s_explosions.num_elem = num;
+	s_explosionCount = num;
 }
 
 Explosion *
 Explosion_Get_ByIndex(int i)
 {
-	assert(1 <= i && i < s_explosions.num_elem);
+	assert(1 <= i && i < s_explosionCount);
 
-	return (Explosion *)BinHeap_GetElem(&s_explosions, i);
+	return &s_explosion[i];
 }
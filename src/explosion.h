@@ -61,8 +61,8 @@ typedef struct ExplosionCommandStruct {
 } ExplosionCommandStruct;
 
 typedef struct Explosion {
-	/* Heap key. */
 	int64_t timeOut;                        /*!< Time out for the next command. */
+	uint16 timer;                           /*!< Timer on the explosion timer wheel. */
 
 	uint8 current;                          /*!< Index in #commands pointing to the next command. */
 	enum ShapeID spriteID;                  /*!< SpriteID. */
@@ -6,12 +6,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "errorlog.h"
 #include "multichar.h"
 #include "types.h"
 #include "os/endian.h"
 #include "os/file.h"
 #include "os/math.h"
+#include "os/mmap.h"
 #include "os/strings.h"
 
 #include "file.h"
@@ -29,13 +31,34 @@
  */
 typedef struct File {
 	FILE *fp;
+	const uint8 *data;  /* Content of the PAK, if the file is inside one. */
 	uint32 size;
 	uint32 start;
 	uint32 position;
 } File;
 
+/**
+ * A PAK file in memory.  PAK files are mapped the first time a file
+ * inside them is opened, and stay mapped until exit.
+ */
+typedef struct PAKFile {
+	char path[1024];
+	MappedFile map;
+	bool mapped;        /* False if read into memory instead. */
+	uint64_t mtime;     /* Modification time when it was mapped. */
+} PAKFile;
+
 static File s_file[FILE_MAX];
 static FileInfo s_hash_file[HASH_SIZE];
+static PAKFile *s_pak;
+static unsigned int s_pakCount;
+static void (*s_readCallback)(enum SearchDirectory dir, const char *filename);
+
+/* Views from File_GetView_Ex which were read into memory, rather than
+ *  pointing into a mapped PAK, and so are freed when released. */
+static const uint8 **s_viewAllocated;
+static unsigned int s_viewAllocatedCount;
+static unsigned int s_viewAllocatedSize;
 
 char g_dune_data_dir[PATH_MAX];
 char g_personal_data_dir[PATH_MAX];
@@ -162,6 +185,16 @@ bool fwrite_le_uint16(uint16 value, FILE *stream)
 
 /*--------------------------------------------------------------*/
 
+/**
+ * Set a function to be told the name of every file looked up for
+ * reading, whether or not it is found.  NULL stops the calls.
+ */
+void
+File_SetReadCallback(void (*callback)(enum SearchDirectory dir, const char *filename))
+{
+	s_readCallback = callback;
+}
+
 void
 File_MakeCompleteFilename(char *buf, size_t len, enum SearchDirectory dir, const char *filename, bool convert_to_lowercase)
 {
@@ -239,6 +272,143 @@ static uint16 FileInfo_FindIndex_ByName(const char *filename)
 }
 #endif
 
+static bool
+File_IsOpen(uint8 index)
+{
+	return (s_file[index].fp != NULL) || (s_file[index].data != NULL);
+}
+
+/**
+ * Get a PAK file in memory, mapping it if this is the first time.
+ *
+ * @param pakName The name of the PAK file.
+ * @return The content of the PAK file, or NULL if it could not be opened.
+ */
+static const MappedFile *
+File_MapPAK(enum SearchDirectory dir, const char *pakName)
+{
+	char path[1024];
+
+	File_MakeCompleteFilename(path, sizeof(path), dir, pakName, false);
+
+	for (unsigned int i = 0; i < s_pakCount; i++) {
+		if (strcmp(s_pak[i].path, path) == 0)
+			return &s_pak[i].map;
+	}
+
+	FILE *fp = File_Open_CaseInsensitive(dir, pakName, "rb");
+	if (fp == NULL) return NULL;
+
+	PAKFile pak;
+	struct stat st;
+	snprintf(pak.path, sizeof(pak.path), "%s", path);
+	pak.mtime = (fstat(fileno(fp), &st) == 0) ? (uint64_t)st.st_mtime : 0;
+	pak.mapped = MappedFile_Open(&pak.map, fp);
+
+	/* Fall back to reading the whole PAK file into memory. */
+	if (!pak.mapped) {
+		uint8 *data = NULL;
+		long size;
+
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		if (size > 0) data = malloc(size);
+		if (data == NULL || fread(data, size, 1, fp) != 1) {
+			free(data);
+			fclose(fp);
+			return NULL;
+		}
+
+		pak.map.data = data;
+		pak.map.size = size;
+		pak.map.handle = NULL;
+	}
+
+	fclose(fp);
+
+	PAKFile *list = realloc(s_pak, (s_pakCount + 1) * sizeof(s_pak[0]));
+	if (list == NULL) {
+		if (pak.mapped) {
+			MappedFile_Close(&pak.map);
+		} else {
+			free((void *)pak.map.data);
+		}
+
+		return NULL;
+	}
+
+	s_pak = list;
+	s_pak[s_pakCount] = pak;
+	return &s_pak[s_pakCount++].map;
+}
+
+/**
+ * Read the index of a PAK file, storing the position and size of the
+ *  files we expect in it.
+ *
+ * @param pak The content of the PAK file.
+ * @param fileInfoIndex A file expected in the PAK file.
+ * @return False if the index is corrupt.
+ */
+static bool
+File_IndexPAK(enum SearchDirectory dir, const MappedFile *pak, const FileInfo *fileInfoIndex)
+{
+	FileInfo *pakIndexLast = NULL;
+	uint32 offset = 0;
+
+	while (true) {
+		char pakFilename[1024];
+		uint32 pakPosition;
+		uint16 i;
+
+		if (pak->size - offset < 4) return false;
+
+		pakPosition = READ_LE_UINT32(pak->data + offset);
+		offset += 4;
+		if (pakPosition == 0) break;
+
+		/* Add campaign directory (and slash) to filename. */
+		if ((dir == SEARCHDIR_CAMPAIGN_DIR) && (g_campaign_selected != CAMPAIGNID_DUNE_II)) {
+			i = snprintf(pakFilename, sizeof(pakFilename), "%s", g_campaign_list[g_campaign_selected].dir_name);
+		} else {
+			i = 0;
+		}
+
+		/* Read the name of the file inside the PAK */
+		for (; i < sizeof(pakFilename); i++) {
+			if (offset >= pak->size) return false;
+
+			pakFilename[i] = pak->data[offset++];
+			if (pakFilename[i] == '\0') break;
+
+			/* We always work in lowercase */
+			if (pakFilename[i] >= 'A' && pakFilename[i] <= 'Z') pakFilename[i] += 32;
+		}
+		if (i == sizeof(pakFilename)) return false;
+
+		/* Check if we expected this file in this PAK */
+		FileInfo *pakIndex = FileHash_Find(pakFilename);
+		if (pakIndex == NULL) continue;
+		if (pakIndex->parentIndex != fileInfoIndex->parentIndex) continue;
+
+		/* Update the information of the file */
+		pakIndex->flags.isLoaded = true;
+		pakIndex->filePosition = pakPosition;
+		if (pakIndexLast != NULL)
+			pakIndexLast->fileSize = pakPosition - pakIndexLast->filePosition;
+
+		pakIndexLast = pakIndex;
+	}
+
+	/* Make sure we set the right size of the last entry */
+	if (pakIndexLast != NULL)
+		pakIndexLast->fileSize = pak->size - pakIndexLast->filePosition;
+
+	return true;
+}
+
 /**
  * Internal function to truly open a file.
  *
@@ -252,13 +422,14 @@ _File_OpenInDir(enum SearchDirectory dir, const char *filename, uint8 mode)
 	const char *mode_str = (mode == FILE_MODE_WRITE) ? "wb" : ((mode == FILE_MODE_READ_WRITE) ? "wb+" : "rb");
 
 	const char *pakName;
+	const MappedFile *pak;
 	uint8 fileIndex;
 
 	if ((mode & FILE_MODE_READ_WRITE) == 0) return FILE_INVALID;
 
 	/* Find a free spot in our limited array */
 	for (fileIndex = 0; fileIndex < FILE_MAX; fileIndex++) {
-		if (s_file[fileIndex].fp == NULL) break;
+		if (!File_IsOpen(fileIndex)) break;
 	}
 	if (fileIndex == FILE_MAX) return FILE_INVALID;
 
@@ -290,85 +461,21 @@ _File_OpenInDir(enum SearchDirectory dir, const char *filename, uint8 mode)
 	if (!fileInfoIndex->flags.inPAKFile) return FILE_INVALID;
 
 	pakName = s_hash_file[fileInfoIndex->parentIndex].filename;
-	s_file[fileIndex].fp = File_Open_CaseInsensitive(dir, pakName, "rb");
-	if (s_file[fileIndex].fp == NULL) return FILE_INVALID;
+	pak = File_MapPAK(dir, pakName);
+	if (pak == NULL) return FILE_INVALID;
 
 	/* If this file is not yet read from the PAK, read the complete index
 	 *  of the PAK and index all files */
-	if (!fileInfoIndex->flags.isLoaded) {
-		FileInfo *pakIndexLast = NULL;
-
-		while (true) {
-			char pakFilename[1024];
-			uint32 pakPosition;
-			uint16 i;
-
-			if (fread(&pakPosition, sizeof(uint32), 1, s_file[fileIndex].fp) != 1) {
-				fclose(s_file[fileIndex].fp);
-				s_file[fileIndex].fp = NULL;
-				return FILE_INVALID;
-			}
-			if (pakPosition == 0) break;
-
-			/* Add campaign directory (and slash) to filename. */
-			if ((dir == SEARCHDIR_CAMPAIGN_DIR) && (g_campaign_selected != CAMPAIGNID_DUNE_II)) {
-				i = snprintf(pakFilename, sizeof(pakFilename), "%s", g_campaign_list[g_campaign_selected].dir_name);
-			} else {
-				i = 0;
-			}
-
-			/* Read the name of the file inside the PAK */
-			for (; i < sizeof(pakFilename); i++) {
-				if (fread(&pakFilename[i], 1, 1, s_file[fileIndex].fp) != 1) {
-					fclose(s_file[fileIndex].fp);
-					s_file[fileIndex].fp = NULL;
-					return FILE_INVALID;
-				}
-				if (pakFilename[i] == '\0') break;
-
-				/* We always work in lowercase */
-				if (pakFilename[i] >= 'A' && pakFilename[i] <= 'Z') pakFilename[i] += 32;
-			}
-			if (i == sizeof(pakFilename)) {
-				fclose(s_file[fileIndex].fp);
-				s_file[fileIndex].fp = NULL;
-				return FILE_INVALID;
-			}
-
-			/* Check if we expected this file in this PAK */
-			FileInfo *pakIndex = FileHash_Find(pakFilename);
-			if (pakIndex == NULL) continue;
-			if (pakIndex->parentIndex != fileInfoIndex->parentIndex) continue;
-
-			/* Update the information of the file */
-			pakIndex->flags.isLoaded = true;
-			pakIndex->filePosition = pakPosition;
-			if (pakIndexLast != NULL)
-				pakIndexLast->fileSize = pakPosition - pakIndexLast->filePosition;
-
-			pakIndexLast = pakIndex;
-		}
-
-		/* Make sure we set the right size of the last entry */
-		if (pakIndexLast != NULL) {
-			fseek(s_file[fileIndex].fp, 0, SEEK_END);
-			pakIndexLast->fileSize = ftell(s_file[fileIndex].fp) - pakIndexLast->filePosition;
-		}
-	}
+	if (!fileInfoIndex->flags.isLoaded && !File_IndexPAK(dir, pak, fileInfoIndex)) return FILE_INVALID;
 
 	/* Check if the file is inside the PAK file */
-	if (!fileInfoIndex->flags.isLoaded) {
-		fclose(s_file[fileIndex].fp);
-		s_file[fileIndex].fp = NULL;
-		return FILE_INVALID;
-	}
+	if (!fileInfoIndex->flags.isLoaded) return FILE_INVALID;
+	if (fileInfoIndex->filePosition > pak->size || fileInfoIndex->fileSize > pak->size - fileInfoIndex->filePosition) return FILE_INVALID;
 
+	s_file[fileIndex].data     = pak->data;
 	s_file[fileIndex].start    = fileInfoIndex->filePosition;
 	s_file[fileIndex].position = 0;
 	s_file[fileIndex].size     = fileInfoIndex->fileSize;
-
-	/* Go to the start of the file now */
-	fseek(s_file[fileIndex].fp, s_file[fileIndex].start, SEEK_SET);
 	return fileIndex;
 }
 
@@ -377,6 +484,9 @@ _File_Open(enum SearchDirectory dir, const char *filename, uint8 mode)
 {
 	uint8 ret;
 
+	if (s_readCallback != NULL && (mode & FILE_MODE_WRITE) == 0)
+		s_readCallback(dir, filename);
+
 	/* Try campaign file. */
 	if (dir == SEARCHDIR_CAMPAIGN_DIR) {
 		if (g_campaign_selected != CAMPAIGNID_DUNE_II) {
@@ -415,6 +525,46 @@ File_Exists_Ex(enum SearchDirectory dir, const char *filename)
 	return true;
 }
 
+/**
+ * Describe where a file would be read from, without reading it, so
+ *  that a change to it can be noticed cheaply.  A file inside a PAK is
+ *  described by its entry in the PAK index and the time the PAK was
+ *  modified.
+ *
+ * @param filename The filename to look for.
+ * @param stamp Where to store the description.
+ * @return False if the file cannot be found.
+ */
+bool
+File_GetStamp_Ex(enum SearchDirectory dir, const char *filename, FileStamp *stamp)
+{
+	const uint8 index = _File_Open(dir, filename, FILE_MODE_READ);
+	if (index == FILE_INVALID) return false;
+
+	const File *f = &s_file[index];
+
+	memset(stamp, 0, sizeof(*stamp));
+	stamp->size     = f->size;
+	stamp->position = f->start;
+
+	if (f->fp != NULL) {
+		struct stat st;
+
+		if (fstat(fileno(f->fp), &st) == 0)
+			stamp->mtime = st.st_mtime;
+	} else {
+		for (unsigned int i = 0; i < s_pakCount; i++) {
+			if (s_pak[i].map.data == f->data) {
+				stamp->mtime = s_pak[i].mtime;
+				break;
+			}
+		}
+	}
+
+	File_Close(index);
+	return true;
+}
+
 /**
  * Open a file for reading/writing/appending.
  *
@@ -445,10 +595,11 @@ File_Open_Ex(enum SearchDirectory dir, const char *filename, uint8 mode)
 void File_Close(uint8 index)
 {
 	if (index >= FILE_MAX) return;
-	if (s_file[index].fp == NULL) return;
+	if (!File_IsOpen(index)) return;
 
-	fclose(s_file[index].fp);
+	if (s_file[index].fp != NULL) fclose(s_file[index].fp);
 	s_file[index].fp = NULL;
+	s_file[index].data = NULL;
 }
 
 /**
@@ -462,13 +613,15 @@ void File_Close(uint8 index)
 uint32 File_Read(uint8 index, void *buffer, uint32 length)
 {
 	if (index >= FILE_MAX) return 0;
-	if (s_file[index].fp == NULL) return 0;
+	if (!File_IsOpen(index)) return 0;
 	if (s_file[index].position >= s_file[index].size) return 0;
 	if (length == 0) return 0;
 
 	if (length > s_file[index].size - s_file[index].position) length = s_file[index].size - s_file[index].position;
 
-	if (fread(buffer, length, 1, s_file[index].fp) != 1) {
+	if (s_file[index].data != NULL) {
+		memcpy(buffer, s_file[index].data + s_file[index].start + s_file[index].position, length);
+	} else if (fread(buffer, length, 1, s_file[index].fp) != 1) {
 		Error("Read error\n");
 		File_Close(index);
 
@@ -541,24 +694,25 @@ uint32 File_Write(uint8 index, void *buffer, uint32 length)
 uint32 File_Seek(uint8 index, uint32 position, uint8 mode)
 {
 	if (index >= FILE_MAX) return 0;
-	if (s_file[index].fp == NULL) return 0;
+	if (!File_IsOpen(index)) return 0;
 	if (mode > 2) { File_Close(index); return 0; }
 
 	switch (mode) {
 		case 0:
-			fseek(s_file[index].fp, s_file[index].start + position, SEEK_SET);
 			s_file[index].position = position;
 			break;
 		case 1:
-			fseek(s_file[index].fp, (int32)position, SEEK_CUR);
 			s_file[index].position += (int32)position;
 			break;
 		case 2:
-			fseek(s_file[index].fp, s_file[index].start + s_file[index].size - position, SEEK_SET);
 			s_file[index].position = s_file[index].size - position;
 			break;
 	}
 
+	/* Files inside a PAK are read straight from memory. */
+	if (s_file[index].fp != NULL)
+		fseek(s_file[index].fp, s_file[index].start + s_file[index].position, SEEK_SET);
+
 	return s_file[index].position;
 }
 
@@ -571,7 +725,7 @@ uint32 File_Seek(uint8 index, uint32 position, uint8 mode)
 uint32 File_GetSize(uint8 index)
 {
 	if (index >= FILE_MAX) return 0;
-	if (s_file[index].fp == NULL) return 0;
+	if (!File_IsOpen(index)) return 0;
 
 	return s_file[index].size;
 }
@@ -641,6 +795,81 @@ File_ReadWholeFile_Ex(enum SearchDirectory dir, const char *filename)
 	return buffer;
 }
 
+static bool
+File_RememberView(const uint8 *view)
+{
+	if (s_viewAllocatedCount == s_viewAllocatedSize) {
+		const unsigned int size = (s_viewAllocatedSize == 0) ? 8 : 2 * s_viewAllocatedSize;
+		const uint8 **list = realloc(s_viewAllocated, size * sizeof(*list));
+
+		if (list == NULL) return false;
+
+		s_viewAllocated = list;
+		s_viewAllocatedSize = size;
+	}
+
+	s_viewAllocated[s_viewAllocatedCount++] = view;
+	return true;
+}
+
+/**
+ * Get the content of a whole file without copying it, if it is inside a
+ *  PAK file.  Other files are read into memory.  Unlike
+ *  File_ReadWholeFile, the content is not terminated with a '\0'.
+ *
+ * @param filename The name of the file to open.
+ * @param length Where to store the length of the file.
+ * @return The content of the file, to be released with File_ReleaseView(),
+ *  or NULL with a length of 0 if there is no memory to read it into.
+ */
+const uint8 *
+File_GetView_Ex(enum SearchDirectory dir, const char *filename, uint32 *length)
+{
+	const uint8 index = File_Open_Ex(dir, filename, FILE_MODE_READ);
+	const uint8 *view;
+
+	*length = File_GetSize(index);
+
+	if (s_file[index].data != NULL) {
+		view = s_file[index].data + s_file[index].start;
+	} else {
+		uint8 *buffer = malloc(*length + 1);
+
+		if (buffer == NULL || !File_RememberView(buffer)) {
+			free(buffer);
+			File_Close(index);
+			*length = 0;
+			return NULL;
+		}
+
+		File_Read(index, buffer, *length);
+		view = buffer;
+	}
+
+	File_Close(index);
+
+	return view;
+}
+
+/**
+ * Release the content returned by File_GetView_Ex().
+ *
+ * @param view The content of the file.
+ */
+void
+File_ReleaseView(const uint8 *view)
+{
+	if (view == NULL) return;
+
+	for (unsigned int i = 0; i < s_viewAllocatedCount; i++) {
+		if (s_viewAllocated[i] != view) continue;
+
+		s_viewAllocated[i] = s_viewAllocated[--s_viewAllocatedCount];
+		free((void *)view);
+		return;
+	}
+}
+
 /**
  * Reads the whole file in the memory. The file should contain little endian
  * 16bits unsigned integers. It is converted to host byte ordering if needed.
@@ -700,6 +929,53 @@ File_ReadFile_Ex(enum SearchDirectory dir, const char *filename, void *buf)
 	return length;
 }
 
+/**
+ * Find a chunk in the content of a chunk file (starting with FORM).
+ *
+ * @param view The content of the file, from File_GetView_Ex().
+ * @param length The length of the file.
+ * @param chunk The chunk to find.
+ * @param chunkLength Where to store the length of the chunk.
+ * @return The content of the chunk, or NULL if not found.
+ */
+const uint8 *
+ChunkFile_Find(const uint8 *view, uint32 length, uint32 chunk, uint32 *chunkLength)
+{
+	uint32 offset = 12;
+
+	*chunkLength = 0;
+
+	if (length < offset || READ_BE_UINT32(view) != CC_FORM) return NULL;
+
+	while (length - offset >= 8) {
+		uint32 value;
+
+		/* Chunks are given as in ChunkFile_Read(), e.g. HTOBE32(CC_TEXT). */
+		memcpy(&value, view + offset, 4);
+
+		/* Skip padding between chunks. */
+		if (value == 0) {
+			offset += 4;
+			continue;
+		}
+
+		const uint32 size = READ_BE_UINT32(view + offset + 4);
+		offset += 8;
+
+		if (size > length - offset) return NULL;
+
+		if (value == chunk) {
+			*chunkLength = size;
+			return view + offset;
+		}
+
+		offset += (size + 1) & 0xFFFFFFFE;
+		if (offset > length) return NULL;
+	}
+
+	return NULL;
+}
+
 /**
  * Open a chunk file (starting with FORM) for reading.
  *
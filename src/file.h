@@ -3,6 +3,7 @@
 #ifndef FILE_H
 #define FILE_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <limits.h>
 #include "types.h"
@@ -40,6 +41,15 @@ typedef struct FileInfo {
 	} flags;                                                /*!< General flags of the FileInfo. */
 } FileInfo;
 
+/**
+ * Where a file is read from, for telling whether it has changed.
+ */
+typedef struct FileStamp {
+	uint32 size;                                            /*!< The size of the file. */
+	uint32 position;                                        /*!< Where the file starts in its PAK file, or 0. */
+	uint64_t mtime;                                         /*!< When the file, or its PAK file, was modified. */
+} FileStamp;
+
 extern char g_dune_data_dir[PATH_MAX];
 extern char g_personal_data_dir[PATH_MAX];
 
@@ -47,6 +57,7 @@ extern void FileHash_Init(void);
 extern FileInfo *FileHash_Store(const char *key);
 extern unsigned int FileHash_FindIndex(const char *key);
 
+extern void File_SetReadCallback(void (*callback)(enum SearchDirectory dir, const char *filename));
 extern void File_MakeCompleteFilename(char *buf, size_t len, enum SearchDirectory dir, const char *filename, bool convert_to_lowercase);
 extern FILE *File_Open_CaseInsensitive(enum SearchDirectory dir, const char *filename, const char *mode);
 extern void File_Close(uint8 index);
@@ -61,6 +72,7 @@ extern uint16 *File_ReadWholeFileLE16(const char *filename);
 extern void ChunkFile_Close(uint8 index);
 extern uint32 ChunkFile_Seek(uint8 index, uint32 header);
 extern uint32 ChunkFile_Read(uint8 index, uint32 header, void *buffer, uint32 buflen);
+extern const uint8 *ChunkFile_Find(const uint8 *view, uint32 length, uint32 chunk, uint32 *chunkLength);
 
 #define File_Exists(FILENAME)               File_Exists_Ex(SEARCHDIR_GLOBAL_DATA_DIR,   FILENAME)
 #define File_Exists_Personal(FILENAME)      File_Exists_Ex(SEARCHDIR_PERSONAL_DATA_DIR, FILENAME)
@@ -73,9 +85,12 @@ extern uint32 ChunkFile_Read(uint8 index, uint32 header, void *buffer, uint32 bu
 #define ChunkFile_Open_Personal(FILENAME)   ChunkFile_Open_Ex(SEARCHDIR_PERSONAL_DATA_DIR, FILENAME)
 
 extern bool File_Exists_Ex(enum SearchDirectory dir, const char *filename);
+extern bool File_GetStamp_Ex(enum SearchDirectory dir, const char *filename, FileStamp *stamp);
 extern uint8 File_Open_Ex(enum SearchDirectory dir, const char *filename, uint8 mode);
 extern uint32 File_ReadBlockFile_Ex(enum SearchDirectory dir, const char *filename, void *buffer, uint32 length);
 extern void *File_ReadWholeFile_Ex(enum SearchDirectory dir, const char *filename);
+extern const uint8 *File_GetView_Ex(enum SearchDirectory dir, const char *filename, uint32 *length);
+extern void File_ReleaseView(const uint8 *view);
 extern uint32 File_ReadFile_Ex(enum SearchDirectory dir, const char *filename, void *buf);
 extern uint8 ChunkFile_Open_Ex(enum SearchDirectory dir, const char *filename);
 
@@ -2,7 +2,10 @@
 
 #include <assert.h>
 #include <allegro5/allegro.h>
+#include <inttypes.h>
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 #include "os/common.h"
 #include "os/math.h"
 
@@ -32,6 +35,7 @@
 #include "pool/pool.h"
 #include "pool/pool_structure.h"
 #include "pool/pool_unit.h"
+#include "profiler.h"
 #include "sprites.h"
 #include "structure.h"
 #include "team.h"
@@ -40,59 +44,43 @@
 #include "tools/coord.h"
 #include "unit.h"
 #include "video/video.h"
+#include "vision.h"
 
 /*--------------------------------------------------------------*/
 
-static void
-GameLoop_Client_Structure(void)
-{
-	PoolFindStruct find;
-
-	if (!enhancement_fog_of_war)
-		return;
-
-	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
-			s != NULL;
-			s = Structure_FindNext(&find)) {
-		Structure_RemoveFog(UNVEILCAUSE_STRUCTURE_VISION, s);
-	}
-}
-
-static void
-GameLoop_Client_Unit(void)
-{
-	if (!enhancement_fog_of_war)
-		return;
-
-	PoolFindStruct find;
-
-	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
-			u != NULL;
-			u = Unit_FindNext(&find)) {
-		const UnitInfo *ui = &g_table_unitInfo[u->o.type];
-
-		Unit_RefreshFog(UNVEILCAUSE_UNIT_VISION, u, ui->flags.isGroundUnit);
-	}
-}
+/* Server logic, in the order it is run every tick.  Named so that the
+ * headless benchmark can time each subsystem.
+ */
+static const struct {
+	const char *name;
+	void (*tick)(void);
+	enum ProfilerScope scope;
+} s_serverLogic[] = {
+	{ "UnitAI_SquadLoop",   UnitAI_SquadLoop,   PROFILER_NONE },
+	{ "GameLoop_Team",      GameLoop_Team,      PROFILER_NONE },
+	{ "Vision_Tick",        Vision_Tick,        PROFILER_NONE },
+	{ "GameLoop_Unit",      GameLoop_Unit,      PROFILER_UNIT },
+	{ "GameLoop_Structure", GameLoop_Structure, PROFILER_STRUCTURE },
+	{ "GameLoop_House",     GameLoop_House,     PROFILER_NONE },
+	{ "Explosion_Tick",     Explosion_Tick,     PROFILER_NONE },
+	{ "Animation_Tick",     Animation_Tick,     PROFILER_NONE },
+	{ "Unit_Sort",          Unit_Sort,          PROFILER_NONE },
+};
 
 static void
 GameLoop_Server_Logic(void)
 {
-	UnitAI_SquadLoop();
-	GameLoop_Team();
-	GameLoop_Unit();
-	GameLoop_Structure();
-	GameLoop_House();
-	Explosion_Tick();
-	Animation_Tick();
-	Unit_Sort();
+	for (unsigned int i = 0; i < lengthof(s_serverLogic); i++) {
+		Profiler_Begin(s_serverLogic[i].scope);
+		s_serverLogic[i].tick();
+		Profiler_End(s_serverLogic[i].scope);
+	}
 }
 
 static void
 GameLoop_Client_Logic(void)
 {
-	GameLoop_Client_Unit();
-	GameLoop_Client_Structure();
+	Vision_Tick();
 	Unit_Sort();
 }
 
@@ -387,6 +375,8 @@ GameLoop_Client_ProcessInput(void)
 static void
 GameLoop_Client_Draw(void)
 {
+	Profiler_Begin(PROFILER_CLIENT_DRAW);
+
 	if (g_gameOverlay == GAMEOVERLAY_NONE) {
 		GUI_DrawInterfaceAndRadar();
 		ChatBox_DrawInGame(g_chat_buf);
@@ -406,6 +396,8 @@ GameLoop_Client_Draw(void)
 
 	Video_Tick();
 	A5_UseTransform(SCREENDIV_MAIN);
+
+	Profiler_End(PROFILER_CLIENT_DRAW);
 }
 
 /*--------------------------------------------------------------*/
@@ -415,7 +407,10 @@ GameLoop_ProcessGUITimer(void)
 {
 	GameLoop_Client_ProcessInput();
 
+	Profiler_Begin(PROFILER_AUDIO_POLL);
 	const bool narrator_speaking = Audio_Poll();
+	Profiler_End(PROFILER_AUDIO_POLL);
+
 	if (!narrator_speaking) {
 		if (!g_enable_audio || !g_enable_music
 				|| g_gameOverlay == GAMEOVERLAY_WIN
@@ -510,8 +505,14 @@ GameLoop_Loop(void)
 
 	while (g_gameMode == GM_NORMAL) {
 		const enum TimerType source = Timer_WaitForEvent();
+
+		Profiler_Begin(PROFILER_LOOP);
+		Profiler_Begin(PROFILER_CLIENT_RECV);
 		const enum NetEvent e = Client_RecvMessages();
+		Profiler_End(PROFILER_CLIENT_RECV);
+
 		if (e == NETEVENT_DISCONNECT) {
+			Profiler_End(PROFILER_LOOP);
 			g_gameMode = GM_QUITGAME;
 			break;
 		}
@@ -520,16 +521,26 @@ GameLoop_Loop(void)
 			redraw = true;
 			GameLoop_ProcessGUITimer();
 		} else {
+			Profiler_Begin(PROFILER_GAME_TIMER);
 			GameLoop_ProcessGameTimer();
+			Profiler_End(PROFILER_GAME_TIMER);
 		}
 
+		Profiler_Begin(PROFILER_SERVER_SEND);
 		Server_SendMessages();
+		Profiler_End(PROFILER_SERVER_SEND);
 
-		if (redraw && Timer_QueueIsEmpty()) {
+		const bool draw = (redraw && Timer_QueueIsEmpty());
+		if (draw) {
 			redraw = false;
 			GUI_PaletteAnimate();
 			GameLoop_Client_Draw();
 		}
+
+		Profiler_End(PROFILER_LOOP);
+
+		if (draw)
+			Profiler_EndFrame();
 	}
 
 	if (g_host_type != HOSTTYPE_NONE) {
@@ -543,3 +554,55 @@ GameLoop_Loop(void)
 	g_inGame = false;
 	g_isEnteringChat = false;
 }
+
+/*--------------------------------------------------------------*/
+
+/**
+ * Run the server logic for the given number of ticks as fast as
+ * possible, without drawing, input or timers, and print the time
+ * spent in each subsystem.
+ *
+ * @return The number of ticks run, which is fewer if the game ended.
+ */
+int64_t
+GameLoop_RunHeadless(int64_t ticks)
+{
+	double elapsed[lengthof(s_serverLogic)];
+	int64_t tick;
+
+	memset(elapsed, 0, sizeof(elapsed));
+
+	g_inGame = true;
+	const double start = al_get_time();
+
+	for (tick = 0; tick < ticks && g_gameMode == GM_NORMAL; tick++) {
+		g_timerGame++;
+
+		Server_RecvMessages();
+
+		for (unsigned int i = 0; i < lengthof(s_serverLogic); i++) {
+			const double t0 = al_get_time();
+
+			s_serverLogic[i].tick();
+			elapsed[i] += al_get_time() - t0;
+		}
+
+		GameLoop_LevelEnd();
+		Server_SendMessages();
+	}
+
+	const double total = al_get_time() - start;
+	g_inGame = false;
+
+	printf("%"PRId64" ticks in %.3f s, %.1f ticks/s\n",
+			tick, total, (total > 0.0) ? tick / total : 0.0);
+
+	for (unsigned int i = 0; i < lengthof(s_serverLogic); i++) {
+		printf("  %-20s %10.3f ms %8.3f us/tick %5.1f%%\n",
+				s_serverLogic[i].name, 1e3 * elapsed[i],
+				(tick > 0) ? 1e6 * elapsed[i] / tick : 0.0,
+				(total > 0.0) ? 100.0 * elapsed[i] / total : 0.0);
+	}
+
+	return tick;
+}
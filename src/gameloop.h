@@ -1,6 +1,9 @@
 #ifndef GAMELOOP_H
 #define GAMELOOP_H
 
+#include <stdint.h>
+
 extern void GameLoop_Loop(void);
+extern int64_t GameLoop_RunHeadless(int64_t ticks);
 
 #endif
@@ -6,6 +6,7 @@
 #include "gui.h"
 #include "widget.h"
 #include "../common_a5.h"
+#include "../drawlist.h"
 #include "../enhancement.h"
 #include "../explosion.h"
 #include "../map.h"
@@ -34,6 +35,9 @@ void GUI_Widget_Viewport_Draw(void)
 
 	Viewport_DrawTiles();
 
+	/* Batch the sprites drawn over the terrain. */
+	Video_HoldBitmapDrawing(true);
+
 	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_SANDWORM);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
@@ -50,9 +54,10 @@ void GUI_Widget_Viewport_Draw(void)
 		Prim_Rect_i(x1, y1, x2, y2, 0xFF);
 	}
 
-	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
-			u != NULL;
-			u = Unit_FindNext(&find)) {
+	DrawList_Update();
+
+	for (int i = 0; i < DrawList_GetCount(); i++) {
+		const Unit *u = DrawList_Get(i);
 
 		if (u->o.index < 19 || u->o.index > UnitPool_GetMaxIndex() -1 )
 			continue;
@@ -94,6 +99,8 @@ void GUI_Widget_Viewport_Draw(void)
 			Viewport_DrawAirUnit(u);
 	}
 
+	Video_HoldBitmapDrawing(false);
+
 	if ((g_viewportMessageCounter & 1) != 0 && g_viewportMessageText != NULL) {
 		const enum ScreenDivID old_div = A5_SaveTransform();
 		A5_UseTransform(SCREENDIV_MENU);
@@ -13,6 +13,7 @@
 #include "../opendune.h"
 #include "../house.h"
 #include "../map.h"
+#include "../net/server.h"
 #include "../newui/actionpanel.h"
 #include "../newui/editbox.h"
 #include "../newui/savemenu.h"
@@ -353,7 +354,10 @@ void GUI_Widget_ActionPanel_Draw(bool forceDraw)
 
 			h = House_Get_ByIndex(s->o.houseID);
 
-			if (s->upgradeTimeLeft == 0 && Structure_IsUpgradable(s)) s->upgradeTimeLeft = 100;
+			if (s->upgradeTimeLeft == 0 && Structure_IsUpgradable(s)) {
+				s->upgradeTimeLeft = 100;
+				Server_MarkStructureDirty(s);
+			}
 			GUI_UpdateProductionStringID();
 		} break;
 
@@ -163,6 +163,7 @@ void GameLoop_House(void)
 					u->o.linkedID = nu->o.linkedID;
 					nu->o.linkedID = (uint8)u->o.index;
 					nu->o.flags.s.inTransport = true;
+					Server_MarkUnitDirty(nu);
 					g_scenario.reinforcement[i].unitID = UNIT_INDEX_INVALID;
 					deployed = true;
 				} else {
@@ -277,6 +278,7 @@ void GameLoop_House(void)
 					u->o.linkedID = (uint8)h->starportLinkedID;
 					h->starportLinkedID = UNIT_INDEX_INVALID;
 					u->o.flags.s.inTransport = true;
+					Server_MarkUnitDirty(u);
 
 					Server_Send_PlayVoice(1 << h->index,
 							VOICE_FRIGATE_HAS_ARRIVED);
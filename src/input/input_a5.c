@@ -155,6 +155,9 @@ InputA5_ProcessEvent(ALLEGRO_EVENT *event, bool apply_mouse_transform)
 			} else if (event->keyboard.keycode == ALLEGRO_KEY_F10) {
 				VideoA5_ToggleFPS();
 				return true;
+			} else if (event->keyboard.keycode == ALLEGRO_KEY_F12 && (event->keyboard.modifiers & ALLEGRO_KEYMOD_SHIFT)) {
+				VideoA5_DumpProfile();
+				return true;
 			} else if (event->keyboard.keycode == ALLEGRO_KEY_F12) {
 				VideoA5_CaptureScreenshot();
 				return true;
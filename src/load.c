@@ -18,6 +18,7 @@
 #include "mods/skirmish.h"
 #include "newui/menubar.h"
 #include "opendune.h"
+#include "save.h"
 #include "saveload/saveload.h"
 #include "scenario.h"
 #include "sprites.h"
@@ -213,6 +214,8 @@ LoadFile(const char *filename)
 
 	Game_Init();
 
+	Save_Wait();
+
 	fp = File_Open_CaseInsensitive(SEARCHDIR_PERSONAL_DATA_DIR, filename, "rb");
 	if (fp == NULL) {
 		Error("Failed to open file '%s' for reading.\n", filename);
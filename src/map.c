@@ -4,6 +4,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include "errorlog.h"
 #include "types.h"
 #include "os/common.h"
 #include "os/math.h"
@@ -17,10 +18,12 @@
 #include "gui/gui.h"
 #include "gui/widget.h"
 #include "house.h"
+#include "minimap.h"
 #include "net/server.h"
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
 #include "opendune.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
@@ -38,6 +41,7 @@
 #include "tile.h"
 #include "unit.h"
 #include "video/video.h"
+#include "vision.h"
 
 
 uint16 g_mapSpriteID[64 * 64];
@@ -49,6 +53,35 @@ uint16 g_mapSpriteID[64 * 64];
 Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
 
+/* Which tiles each house has scouted, and for how long they stay
+ * visible.  Kept out of g_mapVisible, which is only for the player.
+ */
+FogOfWarPlanes g_mapFogOfWar;
+
+/* Chunks of g_mapVisible whose sprites changed since they were last
+ * rendered, one bit per chunk.
+ */
+static uint32 s_visibleChunkDirty = (1u << MAP_CHUNK_MAX) - 1;
+
+/* The landscape type of each tile, and the speed on it for each
+ * movement type, kept in step with g_map by Map_InvalidateTile while
+ * a game is running.  Until Map_InvalidateAll builds them, e.g. while
+ * a map is loaded or generated, they are computed from g_map instead.
+ */
+static uint8 s_landscapeType[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint8 s_movementSpeed[MOVEMENT_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX];
+static bool s_planesValid = false;
+
+/* The number of spice and thick spice tiles in each block of 8x8 tiles,
+ * kept with the planes, so Map_SearchSpice can skip blocks without any.
+ */
+enum {
+	MAP_SPICE_BLOCK_SHIFT = 3,
+	MAP_SPICE_BLOCKS      = MAP_SIZE_MAX >> MAP_SPICE_BLOCK_SHIFT
+};
+
+static uint8 s_spiceCount[MAP_SPICE_BLOCKS * MAP_SPICE_BLOCKS];
+
 const uint8 g_functions[3][3] = {{0, 1, 0}, {2, 3, 0}, {0, 1, 0}};
 
 static bool s_debugNoExplosionDamage = false;               /*!< When non-zero, explosions do no damage to their surrounding. */
@@ -313,7 +346,19 @@ uint16 Map_Clamp_Packed(uint16 position)
 bool
 Map_IsUnveiledToHouse(enum HouseType houseID, uint16 packed)
 {
-	return (g_mapVisible[packed].isUnveiled & (1 << houseID));
+	const uint64_t row = g_mapFogOfWar.unveiled[houseID][packed / MAP_SIZE_MAX];
+
+	return (row >> (packed % MAP_SIZE_MAX)) & 1;
+}
+
+void
+Map_SetUnveiledToHouse(enum HouseType houseID, uint16 packed)
+{
+	g_mapFogOfWar.unveiled[houseID][packed / MAP_SIZE_MAX] |= (uint64_t)1 << (packed % MAP_SIZE_MAX);
+	Server_MarkVisionDirty(houseID, packed);
+
+	if (houseID == g_playerHouseID)
+		Minimap_InvalidateTile(packed);
 }
 
 bool
@@ -325,14 +370,12 @@ Map_IsPositionUnveiled(enum HouseType houseID, uint16 packed)
 	if (!House_IsHuman(houseID))
 		return true;
 
-	const enum HouseFlag houseIDBit = (1 << houseID);
-
 	return (65 <= packed && packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65)
-		&& (g_mapVisible[packed].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed - 1].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed + 1].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed - MAP_SIZE_MAX].isUnveiled & houseIDBit)
-		&& (g_mapVisible[packed + MAP_SIZE_MAX].isUnveiled & houseIDBit);
+		&& Map_IsUnveiledToHouse(houseID, packed)
+		&& Map_IsUnveiledToHouse(houseID, packed - 1)
+		&& Map_IsUnveiledToHouse(houseID, packed + 1)
+		&& Map_IsUnveiledToHouse(houseID, packed - MAP_SIZE_MAX)
+		&& Map_IsUnveiledToHouse(houseID, packed + MAP_SIZE_MAX);
 }
 
 /**
@@ -398,6 +441,138 @@ Map_FindHousesInRadius(tile32 tile, int radius)
 	return houses;
 }
 
+static bool
+Map_IsSpiceType(enum LandscapeType lst)
+{
+	return (lst == LST_SPICE || lst == LST_THICK_SPICE);
+}
+
+static uint16
+Map_GetSpiceBlock(uint16 x, uint16 y)
+{
+	return (y >> MAP_SPICE_BLOCK_SHIFT) * MAP_SPICE_BLOCKS + (x >> MAP_SPICE_BLOCK_SHIFT);
+}
+
+/**
+ * @return The movement types whose speed changed, as a mask of
+ *   (1 << movementType).
+ */
+static uint8
+Map_UpdatePlanes(uint16 packed)
+{
+	const enum LandscapeType lst = Map_GetLandscapeType_ByTile(&g_map[packed]);
+	uint8 *spiceCount = &s_spiceCount[Map_GetSpiceBlock(Tile_GetPackedX(packed), Tile_GetPackedY(packed))];
+	uint8 changed = 0;
+
+	if (Map_IsSpiceType(s_landscapeType[packed])) (*spiceCount)--;
+	if (Map_IsSpiceType(lst)) (*spiceCount)++;
+
+	s_landscapeType[packed] = lst;
+
+	for (enum UnitMovementType mt = 0; mt < MOVEMENT_MAX; mt++) {
+		const uint8 speed = g_table_landscapeInfo[lst].movementSpeed[mt];
+
+		if (s_movementSpeed[mt][packed] == speed) continue;
+
+		s_movementSpeed[mt][packed] = speed;
+		changed |= 1 << mt;
+	}
+
+	return changed;
+}
+
+/**
+ * Stop using the landscape type and movement speed planes, before
+ * g_map is changed without Map_InvalidateTile.
+ */
+void
+Map_ClearPlanes(void)
+{
+	s_planesValid = false;
+}
+
+/**
+ * Rebuild data derived from g_map after the whole map changed, e.g.
+ * after loading a scenario or savegame.
+ */
+void
+Map_InvalidateAll(void)
+{
+	memset(s_landscapeType, LST_NORMAL_SAND, sizeof(s_landscapeType));
+	memset(s_spiceCount, 0, sizeof(s_spiceCount));
+
+	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+		Map_UpdatePlanes(packed);
+	}
+
+	s_planesValid = true;
+	Pathfinder_InvalidateAll();
+}
+
+/**
+ * Compare the landscape type and movement speed planes, and the spice
+ * counts, with g_map.
+ * @return The number of tiles and blocks that are out of date.
+ */
+int
+Map_CheckPlanes(void)
+{
+	uint8 spiceCount[MAP_SPICE_BLOCKS * MAP_SPICE_BLOCKS];
+	int count = 0;
+
+	if (!s_planesValid) return 0;
+
+	memset(spiceCount, 0, sizeof(spiceCount));
+
+	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+		const enum LandscapeType lst = Map_GetLandscapeType_ByTile(&g_map[packed]);
+		bool same = (s_landscapeType[packed] == lst);
+
+		if (Map_IsSpiceType(lst)) spiceCount[Map_GetSpiceBlock(Tile_GetPackedX(packed), Tile_GetPackedY(packed))]++;
+
+		for (enum UnitMovementType mt = 0; mt < MOVEMENT_MAX; mt++) {
+			if (s_movementSpeed[mt][packed] != g_table_landscapeInfo[lst].movementSpeed[mt]) same = false;
+		}
+
+		if (same) continue;
+
+		if (count == 0) {
+			Warning("Map planes out of date at tile (%d, %d): type %d, expected %d\n",
+					Tile_GetPackedX(packed), Tile_GetPackedY(packed), s_landscapeType[packed], lst);
+		}
+
+		count++;
+	}
+
+	for (uint16 block = 0; block < lengthof(spiceCount); block++) {
+		if (s_spiceCount[block] == spiceCount[block]) continue;
+
+		Warning("Spice count out of date in block (%d, %d): %d, expected %d\n",
+				block % MAP_SPICE_BLOCKS, block / MAP_SPICE_BLOCKS, s_spiceCount[block], spiceCount[block]);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Update data derived from g_map after the ground, overlay, or
+ * structure of a tile changed.
+ * @param packed The tile that changed.
+ */
+void
+Map_InvalidateTile(uint16 packed)
+{
+	/* Without the planes, which speeds changed is not known. */
+	uint8 changed = 0xFF;
+
+	if (s_planesValid && !Tile_IsOutOfMap(packed)) changed = Map_UpdatePlanes(packed);
+
+	Pathfinder_InvalidateTile(packed, changed);
+	Server_MarkTileDirty(packed);
+	Minimap_InvalidateTile(packed);
+}
+
 static bool Map_UpdateWall(uint16 packed)
 {
 	Tile *t;
@@ -408,6 +583,7 @@ static bool Map_UpdateWall(uint16 packed)
 
 	t->groundSpriteID = g_mapSpriteID[packed] & 0x1FF;
 	t->overlaySpriteID = g_wallSpriteID;
+	Map_InvalidateTile(packed);
 
 	Structure_ConnectWall(packed, true);
 
@@ -517,6 +693,7 @@ void Map_MakeExplosion(uint16 type, tile32 position, uint16 hitpoints, uint16 un
 					if (u->actionID != ACTION_MOVE)
 						Unit_Server_SetAction(u, ACTION_MOVE);
 					u->targetMove = unitOriginEncoded;
+					Server_MarkUnitDirty(u);
 					continue;
 				}
 			}
@@ -622,15 +799,37 @@ Map_GetLandscapeType_BySpriteID(uint16 spriteID, bool hasStructure)
 	return _landscapeSpriteMap[spriteOffset];
 }
 
-uint16 Map_GetLandscapeType(uint16 packed)
+/**
+ * Get type of landscape of a tile that may not be on g_map, e.g. of a
+ *  landscape being generated.
+ */
+enum LandscapeType
+Map_GetLandscapeType_ByTile(const Tile *t)
 {
-	Tile *t = &g_map[packed];
-
 	if (t->overlaySpriteID == g_wallSpriteID) return LST_DESTROYED_WALL;
 
 	return Map_GetLandscapeType_BySpriteID(t->groundSpriteID, t->hasStructure);
 }
 
+uint16 Map_GetLandscapeType(uint16 packed)
+{
+	if (s_planesValid) return s_landscapeType[packed];
+
+	return Map_GetLandscapeType_ByTile(&g_map[packed]);
+}
+
+/**
+ * Get the speed of the movement type on the landscape of a tile,
+ *  whether or not the tile is inside the map.
+ */
+uint8
+Map_GetMovementSpeed(uint16 packed, enum UnitMovementType movementType)
+{
+	if (s_planesValid) return s_movementSpeed[movementType][packed];
+
+	return g_table_landscapeInfo[Map_GetLandscapeType_ByTile(&g_map[packed])].movementSpeed[movementType];
+}
+
 enum LandscapeType
 Map_GetLandscapeTypeVisible(uint16 packed)
 {
@@ -678,6 +877,7 @@ void Map_Bloom_ExplodeSpice(uint16 packed, enum HouseFlag houses)
 	if (g_validateStrictIfZero == 0) {
 		Unit_Remove(Unit_Get_ByPackedTile(packed));
 		g_map[packed].groundSpriteID = g_mapSpriteID[packed] & 0x1FF;
+		Map_InvalidateTile(packed);
 		Map_MakeExplosion(EXPLOSION_SPICE_BLOOM_TREMOR, Tile_UnpackTile(packed), 0, 0);
 	}
 
@@ -767,6 +967,7 @@ static void Map_FixupSpiceEdges(uint16 packed)
 		spriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE] + spriteID] & 0x1FF;
 		g_mapSpriteID[packed] = 0x8000 | spriteID;
 		g_map[packed].groundSpriteID = spriteID;
+		Map_InvalidateTile(packed);
 	}
 }
 
@@ -801,6 +1002,7 @@ void Map_ChangeSpiceAmount(uint16 packed, int16 dir)
 	spriteID = g_iconMap[g_iconMap[ICM_ICONGROUP_LANDSCAPE] + spriteID] & 0x1FF;
 	g_mapSpriteID[packed] = 0x8000 | spriteID;
 	g_map[packed].groundSpriteID = spriteID;
+	Map_InvalidateTile(packed);
 
 	Map_FixupSpiceEdges(packed);
 	Map_FixupSpiceEdges(packed + 1);
@@ -825,6 +1027,7 @@ void Map_Bloom_ExplodeSpecial(uint16 packed, uint8 houseID)
 
 	g_map[packed].groundSpriteID = g_landscapeSpriteID;
 	g_mapSpriteID[packed] = 0x8000 | g_landscapeSpriteID;
+	Map_InvalidateTile(packed);
 
 	enemyHouseID = houseID;
 
@@ -1095,18 +1298,28 @@ uint16 Map_SearchSpice(uint16 packed, uint16 radius, enum HouseType visibleToHou
 	ymin = max(Tile_GetPackedY(packed) - radius, mapInfo->minY);
 	ymax = min(Tile_GetPackedY(packed) + radius, mapInfo->minY + mapInfo->sizeY - 1);
 
+	/* Tiles are still visited in the same order, as the last of the
+	 * closest tiles is kept, but blocks without spice are skipped.
+	 */
 	for (y = ymin; y <= ymax; y++) {
 		for (x = xmin; x <= xmax; x++) {
 			uint16 curPacked = Tile_PackXY(x, y);
 			uint16 type;
 			uint16 distance;
 
+			if (s_planesValid && s_spiceCount[Map_GetSpiceBlock(x, y)] == 0) {
+				x |= (1 << MAP_SPICE_BLOCK_SHIFT) - 1;
+				continue;
+			}
+
+			type = Map_GetLandscapeType(curPacked);
+			if (type != LST_SPICE && type != LST_THICK_SPICE) continue;
+
 			if (!Map_IsValidPosition(curPacked)) continue;
 			if (g_map[curPacked].hasStructure) continue;
 			if (Unit_Get_ByPackedTile(curPacked) != NULL) continue;
 			if (visibleToHouseID < HOUSE_NEUTRAL && !Map_IsUnveiledToHouse(g_playerHouseID, curPacked)) continue;
 
-			type = Map_GetLandscapeType(curPacked);
 			distance = Tile_GetDistancePacked(curPacked, packed);
 
 			if (type == LST_THICK_SPICE && distance < 4) {
@@ -1182,12 +1395,32 @@ Map_UnveilTile_Neighbour(enum HouseType houseID, uint16 packed)
 	}
 
 	if (houseID == g_playerHouseID) {
-		g_mapVisible[packed].fogSpriteID
+		const uint8 fogSpriteID
 			= (bits != 0)
 			? g_iconMap[g_iconMap[ICM_ICONGROUP_FOG_OF_WAR] + bits] : 0;
+
+		if (g_mapVisible[packed].fogSpriteID != fogSpriteID) {
+			g_mapVisible[packed].fogSpriteID = fogSpriteID;
+			Map_InvalidateVisibleTile(packed);
+		}
 	}
 }
 
+/**
+ * Keep the tile unfogged until Map_ReleaseTile, for tiles in view.
+ */
+static void
+Map_HoldTile(enum HouseType houseID, uint16 packed)
+{
+	uint32 *t = &g_mapFogOfWar.timeout[houseID][packed];
+
+	if (houseID == g_playerHouseID && *t <= Map_GetFogOfWarTicks())
+		Minimap_InvalidateTile(packed);
+
+	*t = FOGOFWAR_TIMEOUT_HELD;
+	Server_MarkVisionDirty(houseID, packed);
+}
+
 void
 Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause,
 		uint16 packed)
@@ -1198,10 +1431,15 @@ Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause,
 	if (Tile_IsOutOfMap(packed))
 		return;
 
-	FogOfWarTile *f = &g_mapVisible[packed];
+	uint8 *c = &g_mapFogOfWar.cause[houseID][packed];
 
-	f->cause[houseID] = max(f->cause[houseID], cause);
-	f->timeout[houseID] = Map_GetUnveilTimeout(cause);
+	*c = max(*c, cause);
+
+	if (Vision_IsTileObserved(houseID, packed)) {
+		Map_HoldTile(houseID, packed);
+	} else {
+		Map_SetTileTimeout(houseID, packed, Map_GetUnveilTimeout(cause));
+	}
 
 	u = Unit_Get_ByPackedTile(packed);
 	if (u != NULL && (House_IsHuman(houseID) || u->o.type != UNIT_SANDWORM)) Unit_HouseUnitCount_Add(u, houseID);
@@ -1217,7 +1455,7 @@ Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause,
 	if (Map_IsPositionUnveiled(houseID, packed))
 		return;
 
-	f->isUnveiled |= (1 << houseID);
+	Map_SetUnveiledToHouse(houseID, packed);
 	Map_UnveilTile_Neighbour(houseID, packed);
 	Map_UnveilTile_Neighbour(houseID, packed + 1);
 	Map_UnveilTile_Neighbour(houseID, packed - 1);
@@ -1233,19 +1471,38 @@ Map_RefreshTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packe
 
 	if (Map_IsUnveiledToHouse(houseID, packed)) {
 		const int64_t timeout = Map_GetUnveilTimeout(cause);
-		FogOfWarTile *f = &g_mapVisible[packed];
 
-		if (f->timeout[houseID] < timeout) {
-			f->cause[houseID] = max(f->cause[houseID], cause);
-			f->timeout[houseID] = timeout;
+		if (Map_GetTileTimeout(houseID, packed) < timeout) {
+			uint8 *c = &g_mapFogOfWar.cause[houseID][packed];
+
+			*c = max(*c, cause);
+			Map_SetTileTimeout(houseID, packed, timeout);
 		}
+
+		if (Vision_IsTileObserved(houseID, packed))
+			Map_HoldTile(houseID, packed);
 	}
 }
 
+/**
+ * Start the timeout of a tile that was held while in view.
+ */
+void
+Map_ReleaseTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packed)
+{
+	if (g_mapFogOfWar.timeout[houseID][packed] == FOGOFWAR_TIMEOUT_HELD)
+		Map_SetTileTimeout(houseID, packed, Map_GetUnveilTimeout(cause));
+}
+
 void
 Map_ResetFogOfWar(void)
 {
 	memset(g_mapVisible, 0, sizeof(g_mapVisible));
+	memset(&g_mapFogOfWar, 0, sizeof(g_mapFogOfWar));
+	g_mapFogOfWar.epoch = g_timerGame;
+	Vision_Init();
+	Minimap_InvalidateAll();
+	Map_InvalidateVisibleAll();
 
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		FogOfWarTile *f = &g_mapVisible[packed];
@@ -1255,41 +1512,150 @@ Map_ResetFogOfWar(void)
 	}
 }
 
+/**
+ * Get the current tick relative to g_mapFogOfWar.epoch.  A tile is
+ *  fogged when its timeout is not after this.
+ */
+uint32
+Map_GetFogOfWarTicks(void)
+{
+	const int64_t ticks = g_timerGame - g_mapFogOfWar.epoch;
+
+	return (uint32)clamp(ticks, 0, (int64_t)UINT32_MAX);
+}
+
+/**
+ * Get the tick at which the tile will be fogged for the house.  Tiles
+ *  in view are treated as if they were refreshed this tick.
+ * @return The tick, or 0 if it already is fogged.
+ */
+int64_t
+Map_GetTileTimeout(enum HouseType houseID, uint16 packed)
+{
+	const uint32 timeout = g_mapFogOfWar.timeout[houseID][packed];
+
+	if (timeout == FOGOFWAR_TIMEOUT_HELD)
+		return Map_GetUnveilTimeout(UNVEILCAUSE_UNIT_VISION);
+
+	return (timeout == 0) ? 0 : (g_mapFogOfWar.epoch + timeout);
+}
+
+/**
+ * Set the tick at which the tile will be fogged for the house.
+ *  Timeouts before g_mapFogOfWar.epoch are stored as 0.
+ */
+void
+Map_SetTileTimeout(enum HouseType houseID, uint16 packed, int64_t timeout)
+{
+	const int64_t ticks = timeout - g_mapFogOfWar.epoch;
+	const uint32 now = Map_GetFogOfWarTicks();
+	uint32 *t = &g_mapFogOfWar.timeout[houseID][packed];
+	const bool wasFogged = (*t <= now);
+
+	*t = (uint32)clamp(ticks, 0, (int64_t)FOGOFWAR_TIMEOUT_HELD - 1);
+	Server_MarkVisionDirty(houseID, packed);
+
+	if (houseID == g_playerHouseID && wasFogged != (*t <= now))
+		Minimap_InvalidateTile(packed);
+}
+
+bool
+Map_IsTileFogged(enum HouseType houseID, uint16 packed)
+{
+	return g_mapFogOfWar.timeout[houseID][packed] <= Map_GetFogOfWarTicks();
+}
+
+/**
+ * Copy the sprites of the tile into g_mapVisible, invalidating its
+ *  chunk if they changed, and queuing it for the minimap if its
+ *  landscape type or owner changed.
+ */
+static void
+Map_Client_CopyVisibleTile(uint16 packed)
+{
+	const Tile *t = &g_map[packed];
+	FogOfWarTile *f = &g_mapVisible[packed];
+
+	if (f->groundSpriteID != t->groundSpriteID
+			|| f->overlaySpriteID != t->overlaySpriteID
+			|| f->houseID != t->houseID) {
+		Map_InvalidateVisibleTile(packed);
+	}
+
+	if (f->groundSpriteID != t->groundSpriteID
+			|| f->houseID != t->houseID
+			|| f->hasStructure != t->hasStructure) {
+		Minimap_InvalidateTile(packed);
+	}
+
+	f->groundSpriteID = t->groundSpriteID;
+	f->overlaySpriteID = t->overlaySpriteID;
+	f->houseID = t->houseID;
+	f->hasStructure = t->hasStructure;
+}
+
 void
 Map_Client_UpdateFogOfWar(void)
 {
 	if (enhancement_fog_of_war) {
+		const uint32 *timeout = g_mapFogOfWar.timeout[g_playerHouseID];
+		const uint32 ticks = Map_GetFogOfWarTicks();
+
 		for (uint16 packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
 			FogOfWarTile *f = &g_mapVisible[packed];
 
 			if (!Map_IsUnveiledToHouse(g_playerHouseID, packed)
-					|| (f->timeout[g_playerHouseID] <= g_timerGame)) {
+					|| (timeout[packed] <= ticks)) {
 				f->fogOverlayBits = 0xF;
 			} else {
-				const Tile *t = &g_map[packed];
-
-				f->groundSpriteID = t->groundSpriteID;
-				f->overlaySpriteID = t->overlaySpriteID;
-				f->houseID = t->houseID;
-				f->hasStructure = t->hasStructure;
+				Map_Client_CopyVisibleTile(packed);
 				f->fogOverlayBits = 0;
 
-				if (g_mapVisible[packed - 64].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x1;
-				if (g_mapVisible[packed +  1].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x2;
-				if (g_mapVisible[packed + 64].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x4;
-				if (g_mapVisible[packed -  1].timeout[g_playerHouseID] <= g_timerGame) f->fogOverlayBits |= 0x8;
+				if (timeout[packed - 64] <= ticks) f->fogOverlayBits |= 0x1;
+				if (timeout[packed +  1] <= ticks) f->fogOverlayBits |= 0x2;
+				if (timeout[packed + 64] <= ticks) f->fogOverlayBits |= 0x4;
+				if (timeout[packed -  1] <= ticks) f->fogOverlayBits |= 0x8;
 			}
 		}
 	} else {
 		for (uint16 packed = 65; packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65; packed++) {
-			const Tile *t = &g_map[packed];
 			FogOfWarTile *f = &g_mapVisible[packed];
 
-			f->groundSpriteID = t->groundSpriteID;
-			f->overlaySpriteID = t->overlaySpriteID;
-			f->houseID = t->houseID;
-			f->hasStructure = t->hasStructure;
+			Map_Client_CopyVisibleTile(packed);
 			f->fogOverlayBits = Map_IsUnveiledToHouse(g_playerHouseID, packed) ? 0x0 : 0xF;
 		}
 	}
 }
+
+/**
+ * Invalidate the rendered terrain of the chunk containing the tile,
+ *  after its sprites in g_mapVisible changed.
+ */
+void
+Map_InvalidateVisibleTile(uint16 packed)
+{
+	const int cx = Tile_GetPackedX(packed) / MAP_CHUNK_SIZE;
+	const int cy = Tile_GetPackedY(packed) / MAP_CHUNK_SIZE;
+
+	s_visibleChunkDirty |= 1u << (MAP_CHUNKS_PER_ROW * cy + cx);
+}
+
+void
+Map_InvalidateVisibleAll(void)
+{
+	s_visibleChunkDirty = (1u << MAP_CHUNK_MAX) - 1;
+}
+
+/**
+ * @return True if the chunk needs to be rendered again.  Its dirty
+ *         flag is cleared.
+ */
+bool
+Map_PopVisibleChunkDirty(int chunk)
+{
+	const uint32 bit = 1u << chunk;
+	const bool dirty = (s_visibleChunkDirty & bit) != 0;
+
+	s_visibleChunkDirty &= ~bit;
+	return dirty;
+}
@@ -10,9 +10,21 @@
 #include "types.h"
 
 enum {
-	MAP_SIZE_MAX = 64
+	MAP_SIZE_MAX = 64,
+
+	/* g_mapVisible is split into square chunks of tiles, for caching
+	 * the rendered terrain.
+	 */
+	MAP_CHUNK_SIZE = 16,
+	MAP_CHUNKS_PER_ROW = MAP_SIZE_MAX / MAP_CHUNK_SIZE,
+	MAP_CHUNK_MAX = MAP_CHUNKS_PER_ROW * MAP_CHUNKS_PER_ROW
 };
 
+/* Timeout of a tile in view of one of the house's units or structures,
+ * until the last of them leaves.
+ */
+#define FOGOFWAR_TIMEOUT_HELD UINT32_MAX
+
 MSVC_PACKED_BEGIN
 /**
  * A Tile as stored in the memory in the map.
@@ -32,20 +44,26 @@ MSVC_PACKED_END
 assert_compile(sizeof(Tile) == 0x04);
 
 typedef struct FogOfWarTile {
-	enum TileUnveilCause cause[HOUSE_MAX];
-	int64_t timeout[HOUSE_MAX];
-
 	uint16 groundSpriteID;
 	uint8 overlaySpriteID;
 	enum HouseType houseID;
 	bool hasStructure;
 
-	enum HouseFlag isUnveiled;
-
 	uint8 fogSpriteID;      /* Opaque fog.  Used to be shared with craters in overlaySpriteID. */
 	uint8 fogOverlayBits;   /* 1,2,4,8 for up, right, down, left. */
 } FogOfWarTile;
 
+/**
+ * Fog of war state, one plane per house.  Scans over the map for a
+ * single house only touch that house's plane.
+ */
+typedef struct FogOfWarPlanes {
+	uint64_t unveiled[HOUSE_MAX][MAP_SIZE_MAX];                 /*!< One word per row, bit x for column x. */
+	uint32 timeout[HOUSE_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX];      /*!< Ticks after epoch until the tile is fogged, 0, or FOGOFWAR_TIMEOUT_HELD. */
+	uint8 cause[HOUSE_MAX][MAP_SIZE_MAX * MAP_SIZE_MAX];         /*!< TileUnveilCause not yet sent to the client. */
+	int64_t epoch;                                              /*!< Tick the timeouts are relative to. */
+} FogOfWarPlanes;
+
 /** Definition of the map size of a map scale. */
 typedef struct MapInfo {
 	uint16 minX;                                            /*!< Minimal X position of the map. */
@@ -74,6 +92,7 @@ struct Unit;
 extern uint16 g_mapSpriteID[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern Tile g_map[MAP_SIZE_MAX * MAP_SIZE_MAX];
 extern FogOfWarTile g_mapVisible[MAP_SIZE_MAX * MAP_SIZE_MAX];
+extern FogOfWarPlanes g_mapFogOfWar;
 extern const uint8 g_functions[3][3];
 
 extern const MapInfo g_mapInfos[3];
@@ -95,11 +114,18 @@ extern void Map_UpdateMinimapPosition(uint16 packed, bool forceUpdate);
 extern bool Map_IsValidPosition(uint16 position);
 extern uint16 Map_Clamp_Packed(uint16 position);
 extern bool Map_IsUnveiledToHouse(enum HouseType houseID, uint16 packed);
+extern void Map_SetUnveiledToHouse(enum HouseType houseID, uint16 packed);
 extern bool Map_IsPositionUnveiled(enum HouseType houseID, uint16 packed);
 extern bool Map_IsPositionInViewport(tile32 position, int *retX, int *retY);
 extern enum HouseFlag Map_FindHousesInRadius(tile32 tile, int radius);
+extern void Map_ClearPlanes(void);
+extern void Map_InvalidateAll(void);
+extern int Map_CheckPlanes(void);
+extern void Map_InvalidateTile(uint16 packed);
 extern void Map_MakeExplosion(uint16 type, tile32 position, uint16 hitpoints, uint16 unitOriginEncoded);
 extern uint16 Map_GetLandscapeType(uint16 packed);
+extern enum LandscapeType Map_GetLandscapeType_ByTile(const Tile *t);
+extern uint8 Map_GetMovementSpeed(uint16 packed, enum UnitMovementType movementType);
 extern enum LandscapeType Map_GetLandscapeTypeVisible(uint16 packed);
 extern enum LandscapeType Map_GetLandscapeTypeOriginal(uint16 packed);
 extern void Map_DeviateArea(uint16 type, tile32 position, uint16 radius, uint8 houseID);
@@ -112,7 +138,15 @@ extern void Map_UpdateAround(uint16 radius, tile32 position, struct Unit *unit,
 extern uint16 Map_SearchSpice(uint16 packed, uint16 radius, enum HouseType visibleToHouseID);
 extern void Map_UnveilTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packed);
 extern void Map_RefreshTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packed);
+extern void Map_ReleaseTile(enum HouseType houseID, enum TileUnveilCause cause, uint16 packed);
 extern void Map_ResetFogOfWar(void);
+extern uint32 Map_GetFogOfWarTicks(void);
+extern int64_t Map_GetTileTimeout(enum HouseType houseID, uint16 packed);
+extern void Map_SetTileTimeout(enum HouseType houseID, uint16 packed, int64_t timeout);
+extern bool Map_IsTileFogged(enum HouseType houseID, uint16 packed);
 extern void Map_Client_UpdateFogOfWar(void);
+extern void Map_InvalidateVisibleTile(uint16 packed);
+extern void Map_InvalidateVisibleAll(void);
+extern bool Map_PopVisibleChunkDirty(int chunk);
 
 #endif /* MAP_H */
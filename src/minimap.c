@@ -0,0 +1,135 @@
+/** @file src/minimap.c
+ *
+ * Minimap change tracking.
+ *
+ * Changes to tiles, to the units on them, to the player's view of them
+ * in g_mapVisible and to the player's fog of war queue the packed tile,
+ * so that the minimap only recolours those texels.
+ *
+ * Nothing changes when a tile's fog timeout passes.  Instead, every
+ * unfogged tile that is drawn goes on a timer wheel at its timeout.
+ * When it is due the tile is queued, or put back on the wheel if the
+ * timeout was extended in the meantime.
+ */
+
+#include <string.h>
+#include "types.h"
+
+#include "minimap.h"
+
+#include "house.h"
+#include "map.h"
+#include "timer/timer.h"
+#include "timerwheel.h"
+
+enum {
+	MINIMAP_TILE_MAX    = MAP_SIZE_MAX * MAP_SIZE_MAX
+};
+
+static uint16 s_queue[MINIMAP_TILE_MAX];
+static uint32 s_queued[MINIMAP_TILE_MAX / 32];
+static int s_queueCount;
+static bool s_invalidateAll = true;
+
+static TimerWheel s_wheel;
+static uint16 s_wheelTimer[MINIMAP_TILE_MAX];               /*!< The tile's timer, or TIMERWHEEL_NONE. */
+
+void
+Minimap_InvalidateTile(uint16 packed)
+{
+	uint32 *word = &s_queued[packed / 32];
+	const uint32 bit = 1u << (packed % 32);
+
+	if (*word & bit)
+		return;
+
+	*word |= bit;
+	s_queue[s_queueCount++] = packed;
+}
+
+/**
+ * Redraw every tile on the next frame, e.g. after loading a map or
+ * changing the player's house.
+ */
+void
+Minimap_InvalidateAll(void)
+{
+	s_invalidateAll = true;
+}
+
+/**
+ * Queue the tile when the player's fog timeout for it passes.  Tiles
+ * already on the wheel are left where they are.
+ */
+void
+Minimap_ScheduleFogExpiry(uint16 packed)
+{
+	if (s_wheelTimer[packed] != TIMERWHEEL_NONE)
+		return;
+
+	const int64_t timeout = Map_GetTileTimeout(g_playerHouseID, packed);
+	if (timeout <= s_wheel.now)
+		return;
+
+	s_wheelTimer[packed] = TimerWheel_Add(&s_wheel, timeout, packed);
+}
+
+static void
+Minimap_AdvanceWheel(int64_t now)
+{
+	uint16 timer;
+
+	TimerWheel_Advance(&s_wheel, now);
+
+	while ((timer = TimerWheel_PopDue(&s_wheel)) != TIMERWHEEL_NONE) {
+		const uint16 packed = TimerWheel_GetNode(&s_wheel, timer)->index;
+		const int64_t timeout = Map_GetTileTimeout(g_playerHouseID, packed);
+
+		if (timeout > now) {
+			TimerWheel_Schedule(&s_wheel, timer, timeout);
+		} else {
+			TimerWheel_Remove(&s_wheel, timer);
+			s_wheelTimer[packed] = TIMERWHEEL_NONE;
+			Minimap_InvalidateTile(packed);
+		}
+	}
+}
+
+/**
+ * Advance the fog timer wheel to the current tick.
+ *
+ * @return True if every tile should be redrawn.  The queue and the
+ *         wheel are then empty, and the tiles drawn unfogged need to
+ *         be scheduled again.
+ */
+bool
+Minimap_Update(void)
+{
+	if (s_invalidateAll || g_timerGame < s_wheel.now) {
+		s_invalidateAll = false;
+
+		memset(s_queued, 0, sizeof(s_queued));
+		memset(s_wheelTimer, 0xFF, sizeof(s_wheelTimer));
+		s_queueCount = 0;
+		TimerWheel_Init(&s_wheel, g_timerGame);
+		return true;
+	}
+
+	Minimap_AdvanceWheel(g_timerGame);
+	return false;
+}
+
+/**
+ * @return The next queued tile, or -1 if there are none.
+ */
+int
+Minimap_PopDirtyTile(void)
+{
+	if (s_queueCount <= 0)
+		return -1;
+
+	const uint16 packed = s_queue[--s_queueCount];
+
+	s_queued[packed / 32] &= ~(1u << (packed % 32));
+	return packed;
+}
@@ -0,0 +1,14 @@
+/** @file src/minimap.h Minimap change tracking. */
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "types.h"
+
+extern void Minimap_InvalidateTile(uint16 packed);
+extern void Minimap_InvalidateAll(void);
+extern void Minimap_ScheduleFogExpiry(uint16 packed);
+extern bool Minimap_Update(void);
+extern int Minimap_PopDirtyTile(void);
+
+#endif
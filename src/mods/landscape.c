@@ -96,36 +96,36 @@ LandscapeGenerator_AddSpiceOnTile(uint16 packed, Tile *map)
  * @details f__B4B8_0000_001F_3BC3 between labels (l__001F, l__0191).
  */
 static void
-LandscapeGenerator_MakeRoughLandscape(Tile *map)
+LandscapeGenerator_MakeRoughLandscape(Tile *map, RandomGeneral *rng)
 {
 	unsigned int i, j;
 	uint8 memory[273];
 
 	for (i = 0; i < 272; i++) {
-		memory[i] = Tools_Random_256() & 0xF;
+		memory[i] = Tools_Random_256_r(rng) & 0xF;
 		if (memory[i] > 0xA)
 			memory[i] = 0xA;
 	}
 
 	memory[272] = 0;
 
-	i = (Tools_Random_256() & 0xF) + 1;
+	i = (Tools_Random_256_r(rng) & 0xF) + 1;
 	while (i-- != 0) {
-		const int base = Tools_Random_256();
+		const int base = Tools_Random_256_r(rng);
 
 		for (j = 0; j < lengthof(k_around); j++) {
 			const int index = clamp(0, base + k_around[j], 272);
-			memory[index] = (memory[index] + (Tools_Random_256() & 0xF)) & 0xF;
+			memory[index] = (memory[index] + (Tools_Random_256_r(rng) & 0xF)) & 0xF;
 		}
 	}
 
-	i = (Tools_Random_256() & 0x3) + 1;
+	i = (Tools_Random_256_r(rng) & 0x3) + 1;
 	while (i-- != 0) {
-		const int base = Tools_Random_256();
+		const int base = Tools_Random_256_r(rng);
 
 		for (j = 0; j < lengthof(k_around); j++) {
 			const int index = clamp(0, base + k_around[j], 272);
-			memory[index] = Tools_Random_256() & 0x3;
+			memory[index] = Tools_Random_256_r(rng) & 0x3;
 		}
 	}
 
@@ -234,19 +234,19 @@ LandscapeGenerator_Average(Tile *map)
  * @details f__B4B8_0000_001F_3BC3 between labels (l__0442, l__004ED).
  */
 static void
-LandscapeGenerator_DetermineLandscapeTypes(Tile *map)
+LandscapeGenerator_DetermineLandscapeTypes(Tile *map, RandomGeneral *rng)
 {
 	unsigned int i;
 	uint16 spriteID1;
 	uint16 spriteID2;
 
-	spriteID1 = Tools_Random_256() & 0xF;
+	spriteID1 = Tools_Random_256_r(rng) & 0xF;
 	if (spriteID1 < 0x8)
 		spriteID1 = 0x8;
 	if (spriteID1 > 0xC)
 		spriteID1 = 0xC;
 
-	spriteID2 = (Tools_Random_256() & 0x3) - 1;
+	spriteID2 = (Tools_Random_256_r(rng) & 0x3) - 1;
 	if (spriteID2 > spriteID1 - 3)
 		spriteID2 = spriteID1 - 3;
 
@@ -267,7 +267,8 @@ LandscapeGenerator_DetermineLandscapeTypes(Tile *map)
  * @details f__B4B8_0000_001F_3BC3 between labels (l__04ED, l__0596).
  */
 static void
-LandscapeGenerator_AddSpice(const LandscapeGeneratorParams *params, Tile *map)
+LandscapeGenerator_AddSpice(const LandscapeGeneratorParams *params, Tile *map,
+		RandomGeneral *rng)
 {
 	const unsigned int max_count = 65535;
 	unsigned int count = 0;
@@ -281,18 +282,18 @@ LandscapeGenerator_AddSpice(const LandscapeGeneratorParams *params, Tile *map)
 		const unsigned int max_spice_fields = max(a, b);
 		const unsigned int range = (max_spice_fields - min_spice_fields + 1);
 
-		i = Tools_Random_256() * range / 256
+		i = Tools_Random_256_r(rng) * range / 256
 			+ min_spice_fields;
 	} else {
-		i = Tools_Random_256() & 0x2F;
+		i = Tools_Random_256_r(rng) & 0x2F;
 	}
 
 	while (i-- != 0) {
 		tile32 tile;
 
 		while (true) {
-			const uint16 y = Tools_Random_256() & 0x3F;
-			const uint16 x = Tools_Random_256() & 0x3F;
+			const uint16 y = Tools_Random_256_r(rng) & 0x3F;
+			const uint16 x = Tools_Random_256_r(rng) & 0x3F;
 			const uint16 packed = Tile_PackXY(x, y);
 			const enum LandscapeType lst = map[packed].groundSpriteID;
 
@@ -307,11 +308,11 @@ LandscapeGenerator_AddSpice(const LandscapeGeneratorParams *params, Tile *map)
 				return;
 		}
 
-		j = Tools_Random_256() & 0x1F;
+		j = Tools_Random_256_r(rng) & 0x1F;
 		while (j-- != 0) {
 			while (true) {
-				const uint16 dist = Tools_Random_256() & 0x3F;
-				const tile32 tile2 = Tile_MoveByRandom(tile, dist, true);
+				const uint16 dist = Tools_Random_256_r(rng) & 0x3F;
+				const tile32 tile2 = Tile_MoveByRandom_r(tile, dist, true, rng);
 				const uint16 packed = Tile_PackTile(tile2);
 
 				if (!Tile_IsOutOfMap(packed)) {
@@ -417,25 +418,21 @@ LandscapeGenerator_Finalise(Tile *map)
 		t->hasExplosion     = false;
 		t->index            = 0;
 	}
-
-	for (i = 0; i < 64 * 64; i++) {
-		g_mapSpriteID[i] = map[i].groundSpriteID;
-	}
 }
 
 /**
- * @brief   f__B4B8_0000_001F_3BC3.
- * @details Refactored into several smaller functions.
- *          params=NULL defaults to original Dune II parameters.
+ * Generate the landscape into map using only rng for random numbers,
+ *  leaving g_mapSpriteID and the general RNG alone, so it can be called
+ *  from any thread.  g_iconMap must be loaded.
  */
 void
-Map_CreateLandscape(uint32 seed, const LandscapeGeneratorParams *params,
-		Tile *map)
+Map_CreateLandscape_r(uint32 seed, const LandscapeGeneratorParams *params,
+		Tile *map, RandomGeneral *rng)
 {
-	Tools_Random_Seed(seed);
+	Tools_Random_Seed_r(rng, seed);
 
 	/* Place random data on a 4x4 grid. */
-	LandscapeGenerator_MakeRoughLandscape(map);
+	LandscapeGenerator_MakeRoughLandscape(map, rng);
 
 	/* Average around the 4x4 grid. */
 	LandscapeGenerator_AverageRoughLandscape(map);
@@ -444,10 +441,10 @@ Map_CreateLandscape(uint32 seed, const LandscapeGeneratorParams *params,
 	LandscapeGenerator_Average(map);
 
 	/* Filter each tile to determine its final type. */
-	LandscapeGenerator_DetermineLandscapeTypes(map);
+	LandscapeGenerator_DetermineLandscapeTypes(map, rng);
 
 	/* Add some spice. */
-	LandscapeGenerator_AddSpice(params, map);
+	LandscapeGenerator_AddSpice(params, map, rng);
 
 	/* Make everything smoother and use the right sprite indexes. */
 	LandscapeGenerator_Smooth(map);
@@ -455,3 +452,19 @@ Map_CreateLandscape(uint32 seed, const LandscapeGeneratorParams *params,
 	/* Finalise the tiles with the real sprites. */
 	LandscapeGenerator_Finalise(map);
 }
+
+/**
+ * @brief   f__B4B8_0000_001F_3BC3.
+ * @details Refactored into several smaller functions.
+ *          params=NULL defaults to original Dune II parameters.
+ */
+void
+Map_CreateLandscape(uint32 seed, const LandscapeGeneratorParams *params,
+		Tile *map)
+{
+	Map_CreateLandscape_r(seed, params, map, &g_randomGeneral);
+
+	for (int i = 0; i < 64 * 64; i++) {
+		g_mapSpriteID[i] = map[i].groundSpriteID;
+	}
+}
@@ -5,6 +5,7 @@
 
 #include "types.h"
 
+struct RandomGeneral;
 struct Tile;
 
 typedef struct {
@@ -13,5 +14,6 @@ typedef struct {
 } LandscapeGeneratorParams;
 
 extern void Map_CreateLandscape(uint32 seed, const LandscapeGeneratorParams *params, struct Tile *map);
+extern void Map_CreateLandscape_r(uint32 seed, const LandscapeGeneratorParams *params, struct Tile *map, struct RandomGeneral *rng);
 
 #endif
@@ -14,6 +14,7 @@
 #include "../opendune.h"
 #include "../pool/pool_house.h"
 #include "../scenario.h"
+#include "../sprites.h"
 #include "../tools/coord.h"
 #include "../tools/random_lcg.h"
 #include "../unit.h"
@@ -154,7 +155,6 @@ Multiplayer_GenerateMap(enum MapGeneratorMode mode)
 
 		case MAP_GENERATOR_TRY_RAND_ELSE_STOP:
 		case MAP_GENERATOR_TRY_RAND_ELSE_RAND:
-			g_multiplayer.test_seed = MapGenerator_PickRandomSeed();
 			break;
 
 		case MAP_GENERATOR_FINAL:
@@ -180,6 +180,14 @@ Multiplayer_GenerateMap(enum MapGeneratorMode mode)
 			Multiplayer_Prepare();
 		}
 
+		/* Does nothing if the tiles are already loaded, as they are
+		 * from the second reroll in the lobby on.
+		 */
+		Sprites_LoadTiles();
+
+		if (mode == MAP_GENERATOR_TRY_RAND_ELSE_STOP || mode == MAP_GENERATOR_TRY_RAND_ELSE_RAND)
+			g_multiplayer.test_seed = Skirmish_PickRandomSeed(&g_multiplayer.landscape_params, is_playable);
+
 		success = Skirmish_GenerateMap1(is_playable);
 
 		if (success) {
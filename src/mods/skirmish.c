@@ -1,5 +1,6 @@
 /* skirmish.c */
 
+#include <allegro5/allegro.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,6 +27,12 @@
 #include "../tools/random_lcg.h"
 #include "../video/video.h"
 
+enum {
+	SKIRMISH_ISLAND_MIN_AREA    = 50,
+	SKIRMISH_SEED_CANDIDATES    = 16,
+	SKIRMISH_SEED_THREADS       = 4
+};
+
 typedef struct {
 	int x, y;
 	uint16 packed;
@@ -439,6 +446,63 @@ Skirmish_IsIslandEnclosed(int start, int end, const SkirmishData *sd)
 	return true;
 }
 
+static bool
+Skirmish_IsBuildable(const Tile *t)
+{
+	const LandscapeInfo *li = &g_table_landscapeInfo[Map_GetLandscapeType_ByTile(t)];
+
+	return li->isValidForStructure || li->isValidForStructure2;
+}
+
+/* Check whether the landscape has an island big enough for
+ * Skirmish_DivideIsland to keep, without which no map can be made.
+ * Only the given map is looked at, so this can run on any thread.
+ */
+static bool
+Skirmish_HasBuildableIsland(const Tile *map)
+{
+	const int dx[4] = {  0, 1, 0, -1 };
+	const int dy[4] = { -1, 0, 1,  0 };
+	const MapInfo *mi = &g_mapInfos[0];
+	uint16 queue[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	bool visited[MAP_SIZE_MAX * MAP_SIZE_MAX];
+
+	memset(visited, 0, sizeof(visited));
+
+	for (int y0 = mi->minY; y0 < mi->minY + mi->sizeY; y0++) {
+		for (int x0 = mi->minX; x0 < mi->minX + mi->sizeX; x0++) {
+			const uint16 start = Tile_PackXY(x0, y0);
+			if (visited[start] || !Skirmish_IsBuildable(&map[start]))
+				continue;
+
+			int n = 0;
+			queue[n++] = start;
+			visited[start] = true;
+
+			for (int i = 0; i < n; i++) {
+				for (int j = 0; j < 4; j++) {
+					const int x = Tile_GetPackedX(queue[i]) + dx[j];
+					const int y = Tile_GetPackedY(queue[i]) + dy[j];
+					if (!(mi->minX <= x && x < mi->minX + mi->sizeX && mi->minY <= y && y < mi->minY + mi->sizeY))
+						continue;
+
+					const uint16 packed = Tile_PackXY(x, y);
+					if (visited[packed] || !Skirmish_IsBuildable(&map[packed]))
+						continue;
+
+					queue[n++] = packed;
+					visited[packed] = true;
+				}
+			}
+
+			if (n >= SKIRMISH_ISLAND_MIN_AREA)
+				return true;
+		}
+	}
+
+	return false;
+}
+
 static void
 Skirmish_DivideIsland(enum HouseType houseID, int island, SkirmishData *sd)
 {
@@ -450,7 +514,7 @@ Skirmish_DivideIsland(enum HouseType houseID, int island, SkirmishData *sd)
 	for (int i = 0; i < len; i++) {
 		const int area = Skirmish_FindBuildableArea(island, orig[i].x, orig[i].y, sd, sd->buildable + start);
 
-		if (area >= 50) {
+		if (area >= SKIRMISH_ISLAND_MIN_AREA) {
 			sd->island = realloc(sd->island, (sd->nislands + 1) * sizeof(sd->island[0]));
 			assert(sd->island != NULL);
 
@@ -1049,8 +1113,6 @@ Skirmish_GenerateMap2(bool only_landscape, SkirmishData *sd)
 		? &g_skirmish.landscape_params : &g_multiplayer.landscape_params;
 
 	Skirmish_GenGeneral(seed);
-	Sprites_UnloadTiles();
-	Sprites_LoadTiles();
 	Tools_RandomLCG_Seed(seed);
 	Map_CreateLandscape(seed, params, g_map);
 
@@ -1117,6 +1179,96 @@ Skirmish_GenerateMap2(bool only_landscape, SkirmishData *sd)
 	return true;
 }
 
+typedef struct SkirmishSeedSearch {
+	const LandscapeGeneratorParams *params;
+	uint32 seed[SKIRMISH_SEED_CANDIDATES];
+	bool hasIsland[SKIRMISH_SEED_CANDIDATES];
+} SkirmishSeedSearch;
+
+typedef struct SkirmishSeedWorker {
+	SkirmishSeedSearch *search;
+	int first;                  /* Tries first, first + SKIRMISH_SEED_THREADS, ... */
+	ALLEGRO_THREAD *thread;
+} SkirmishSeedWorker;
+
+static void
+Skirmish_SeedWorker_Run(SkirmishSeedWorker *w)
+{
+	SkirmishSeedSearch *search = w->search;
+	Tile *map = malloc(MAP_SIZE_MAX * MAP_SIZE_MAX * sizeof(map[0]));
+	RandomGeneral rng;
+
+	if (map == NULL)
+		return;
+
+	for (int i = w->first; i < SKIRMISH_SEED_CANDIDATES; i += SKIRMISH_SEED_THREADS) {
+		memset(map, 0, MAP_SIZE_MAX * MAP_SIZE_MAX * sizeof(map[0]));
+		Map_CreateLandscape_r(search->seed[i], search->params, map, &rng);
+		search->hasIsland[i] = Skirmish_HasBuildableIsland(map);
+	}
+
+	free(map);
+}
+
+static void *
+Skirmish_SeedWorker_ThreadProc(ALLEGRO_THREAD *thread, void *arg)
+{
+	VARIABLE_NOT_USED(thread);
+
+	Skirmish_SeedWorker_Run(arg);
+	return NULL;
+}
+
+/**
+ * Pick a random seed for a new map.  For a playable map, a batch of
+ * seeds is picked and their landscapes are generated on worker threads,
+ * and the first seed in the batch with an island to build on is taken,
+ * so the result does not depend on how the threads are scheduled.  If
+ * none has one, the map generator fails on the first and tries again.
+ *
+ * The tiles must be loaded.
+ */
+uint32
+Skirmish_PickRandomSeed(const LandscapeGeneratorParams *params, bool is_playable)
+{
+	SkirmishSeedSearch search;
+	SkirmishSeedWorker worker[SKIRMISH_SEED_THREADS];
+
+	if (!is_playable)
+		return MapGenerator_PickRandomSeed();
+
+	search.params = params;
+	for (int i = 0; i < SKIRMISH_SEED_CANDIDATES; i++) {
+		search.seed[i] = MapGenerator_PickRandomSeed();
+		search.hasIsland[i] = false;
+	}
+
+	for (int w = 0; w < SKIRMISH_SEED_THREADS; w++) {
+		worker[w].search = &search;
+		worker[w].first = w;
+		worker[w].thread = al_create_thread(Skirmish_SeedWorker_ThreadProc, &worker[w]);
+
+		if (worker[w].thread != NULL)
+			al_start_thread(worker[w].thread);
+	}
+
+	for (int w = 0; w < SKIRMISH_SEED_THREADS; w++) {
+		if (worker[w].thread == NULL) {
+			Skirmish_SeedWorker_Run(&worker[w]);
+		} else {
+			al_join_thread(worker[w].thread, NULL);
+			al_destroy_thread(worker[w].thread);
+		}
+	}
+
+	for (int i = 0; i < SKIRMISH_SEED_CANDIDATES; i++) {
+		if (search.hasIsland[i])
+			return search.seed[i];
+	}
+
+	return search.seed[0];
+}
+
 bool
 Skirmish_GenerateMap1(bool is_playable)
 {
@@ -1160,7 +1312,6 @@ Skirmish_GenerateMap(enum MapGeneratorMode mode)
 
 		case MAP_GENERATOR_TRY_RAND_ELSE_STOP:
 		case MAP_GENERATOR_TRY_RAND_ELSE_RAND:
-			g_skirmish.seed = MapGenerator_PickRandomSeed();
 			break;
 
 		case MAP_GENERATOR_STOP:
@@ -1177,6 +1328,14 @@ Skirmish_GenerateMap(enum MapGeneratorMode mode)
 		Skirmish_Prepare();
 	}
 
+	/* Does nothing if the tiles are already loaded, as they are from
+	 * the second reroll in the lobby on.
+	 */
+	Sprites_LoadTiles();
+
+	if (mode == MAP_GENERATOR_TRY_RAND_ELSE_STOP || mode == MAP_GENERATOR_TRY_RAND_ELSE_RAND)
+		g_skirmish.seed = Skirmish_PickRandomSeed(&g_skirmish.landscape_params, is_playable);
+
 	bool success = Skirmish_GenerateMap1(is_playable);
 
 	if (success) {
@@ -4,6 +4,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include "../os/common.h"
 #include "../os/math.h"
 
 #include "client.h"
@@ -23,6 +24,7 @@
 #include "../newui/menu.h"
 #include "../newui/menubar.h"
 #include "../object.h"
+#include "../objectgrid.h"
 #include "../opendune.h"
 #include "../pool/pool.h"
 #include "../pool/pool_house.h"
@@ -38,8 +40,36 @@
 #define CLIENT_LOG(...)
 #endif
 
+/* The structure and unit states last received, which the delta
+ * records are applied to.  These mirror the server's copies.
+ */
+static StructureDelta s_structureCopy[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static UnitDelta s_unitCopy[UNIT_INDEX_MAX_RAISED];
+
+/* Snapshots received, by seq % NET_SNAPSHOT_HISTORY, which later
+ * snapshots may be based on; the snapshot last applied to the game;
+ * and the seq last acknowledged.
+ */
+static Snapshot s_snapshot[NET_SNAPSHOT_HISTORY];
+static Snapshot s_snapshotApplied;
+static uint32 s_snapshotAckSent;
+
 /*--------------------------------------------------------------*/
 
+static void
+Client_ResetObjectCache(void)
+{
+	memset(s_structureCopy, 0, sizeof(s_structureCopy));
+	memset(s_unitCopy, 0, sizeof(s_unitCopy));
+
+	for (int i = 0; i < NET_SNAPSHOT_HISTORY; i++) {
+		s_snapshot[i].seq = 0;
+	}
+
+	memset(&s_snapshotApplied, 0, sizeof(s_snapshotApplied));
+	s_snapshotAckSent = 0;
+}
+
 void
 Client_ResetCache(void)
 {
@@ -240,6 +270,34 @@ Client_Send_Chat(const char *msg)
 	memcpy(buf, msg, len + 1);
 }
 
+void
+Client_Send_ProtocolVersion(void)
+{
+	unsigned char *buf = Client_GetBuffer(CSMSG_PROTOCOL_VERSION);
+	if (buf == NULL)
+		return;
+
+	Net_Encode_uint8(&buf, NET_PROTOCOL_VERSION);
+}
+
+/**
+ * Acknowledge the snapshot last applied, if it has not been already.
+ * Acks are sent unreliably, separately from the other messages.
+ *
+ * @return True if an ack was encoded.
+ */
+bool
+Client_Send_SnapshotAck(unsigned char **buf)
+{
+	if (s_snapshotApplied.seq == s_snapshotAckSent)
+		return false;
+
+	Net_Encode_ClientServerMsg(buf, CSMSG_SNAPSHOT_ACK);
+	Net_Encode_uint32(buf, s_snapshotApplied.seq);
+	s_snapshotAckSent = s_snapshotApplied.seq;
+	return true;
+}
+
 /*--------------------------------------------------------------*/
 
 static void
@@ -259,6 +317,7 @@ Client_Recv_UpdateLandscape(const unsigned char **buf)
 		t->hasStructure     = s->hasStructure;
 		t->index            = s->index;
 
+		Map_InvalidateTile(packed);
 		(*buf) += sizeof(Tile);
 	}
 }
@@ -280,11 +339,8 @@ Client_Recv_UpdateFogOfWar(const unsigned char **buf)
 }
 
 static void
-Client_Recv_UpdateHouse(const unsigned char **buf)
+Client_Decode_House(const unsigned char **buf, House *h)
 {
-	House *h = g_playerHouse;
-	const uint8 oldMissileCountdown = h->houseMissileCountdown;
-
 	h->structuresBuilt      = Net_Decode_uint32(buf);
 	h->credits              = Net_Decode_uint16(buf);
 	h->creditsStorage       = Net_Decode_uint16(buf);
@@ -300,6 +356,18 @@ Client_Recv_UpdateHouse(const unsigned char **buf)
 	for (enum UnitType u = UNIT_CARRYALL; u <= UNIT_MCV; u++) {
 		h->starportCount[u] = Net_Decode_uint8(buf);
 	}
+}
+
+/**
+ * Replace the player's house with one decoded from the server.
+ */
+static void
+Client_ApplyHouse(const House *d)
+{
+	House *h = g_playerHouse;
+	const uint8 oldMissileCountdown = h->houseMissileCountdown;
+
+	*h = *d;
 
 	House_Client_UpdateRadarState();
 
@@ -309,6 +377,15 @@ Client_Recv_UpdateHouse(const unsigned char **buf)
 	}
 }
 
+static void
+Client_Recv_UpdateHouse(const unsigned char **buf)
+{
+	House h = *g_playerHouse;
+
+	Client_Decode_House(buf, &h);
+	Client_ApplyHouse(&h);
+}
+
 static void
 Client_Recv_UpdateCHOAM(const unsigned char **buf)
 {
@@ -323,93 +400,172 @@ Client_Recv_UpdateCHOAM(const unsigned char **buf)
 }
 
 static void
-Client_Recv_UpdateStructures(const unsigned char **buf)
+Client_Decode_StructureFull(const unsigned char **buf, StructureDelta *d)
+{
+	d->type             = Net_Decode_uint8 (buf);
+	d->linkedID         = Net_Decode_uint8 (buf);
+	d->flags.all        = Net_Decode_uint32(buf);
+	d->houseID          = Net_Decode_uint8 (buf);
+	d->position.x       = Net_Decode_uint16(buf);
+	d->position.y       = Net_Decode_uint16(buf);
+	d->hitpoints        = Net_Decode_uint16(buf);
+
+	d->creatorHouse     = Net_Decode_uint8 (buf);
+	d->rotationSprite   = Net_Decode_uint16(buf);
+	d->objectType       = Net_Decode_uint8 (buf);
+	d->upgradeLevel     = Net_Decode_uint8 (buf);
+	d->upgradeTime      = Net_Decode_uint8 (buf);
+	d->countDown        = Net_Decode_uint16(buf);
+	d->rallyPoint       = Net_Decode_uint16(buf);
+
+	for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+		d->buildQueueCount[objectType] = Net_Decode_uint8(buf);
+	}
+}
+
+static void
+Client_ApplyStructure(uint16 index, const StructureDelta *d)
+{
+	Structure *s = Structure_Get_ByIndex(index);
+	Object *o = &s->o;
+	const uint8 old_upgradeLevel = s->upgradeLevel;
+
+	o->index        = index;
+	o->type         = d->type;
+	o->linkedID     = d->linkedID;
+	o->flags        = d->flags;
+	o->houseID      = d->houseID;
+	o->position     = d->position;
+	o->hitpoints    = d->hitpoints;
+
+	s->creatorHouseID       = d->creatorHouse;
+	s->rotationSpriteDiff   = d->rotationSprite;
+	s->objectType           = d->objectType;
+	s->upgradeLevel         = d->upgradeLevel;
+	s->upgradeTimeLeft      = d->upgradeTime;
+	s->countDown            = d->countDown;
+	s->rallyPoint           = d->rallyPoint;
+
+	for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+		BuildQueue_SetCount(&s->queue, objectType, d->buildQueueCount[objectType]);
+	}
+
+	if (s->objectType == 0xFF)
+		s->objectType = 0xFFFF;
+
+	if (s->upgradeLevel != old_upgradeLevel)
+		g_factoryWindowTotal = -1;
+}
+
+static void
+Client_Recv_UpdateStructures(const unsigned char **buf, bool delta)
 {
 	const int count = Net_Decode_uint8(buf);
 
 	for (int i = 0; i < count; i++) {
 		const uint16 index = Net_Decode_ObjectIndex(buf);
-		Structure *s = Structure_Get_ByIndex(index);
-		Object *o = &s->o;
-		const uint8 old_upgradeLevel = s->upgradeLevel;
-
-		o->index        = index;
-		o->type         = Net_Decode_uint8 (buf);
-		o->linkedID     = Net_Decode_uint8 (buf);
-		o->flags.all    = Net_Decode_uint32(buf);
-		o->houseID      = Net_Decode_uint8 (buf);
-		o->position.x   = Net_Decode_uint16(buf);
-		o->position.y   = Net_Decode_uint16(buf);
-		o->hitpoints    = Net_Decode_uint16(buf);
-
-		s->creatorHouseID       = Net_Decode_uint8 (buf);
-		s->rotationSpriteDiff   = Net_Decode_uint16(buf);
-		s->objectType           = Net_Decode_uint8 (buf);
-		s->upgradeLevel         = Net_Decode_uint8 (buf);
-		s->upgradeTimeLeft      = Net_Decode_uint8 (buf);
-		s->countDown            = Net_Decode_uint16(buf);
-		s->rallyPoint           = Net_Decode_uint16(buf);
-
-		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
-			const uint8 buildQueueCount = Net_Decode_uint8(buf);
-			BuildQueue_SetCount(&s->queue, objectType, buildQueueCount);
-		}
+		StructureDelta *d = &s_structureCopy[index];
 
-		if (s->objectType == 0xFF)
-			s->objectType = 0xFFFF;
+		if (delta) {
+			Net_Decode_StructureDelta(buf, d);
+		} else {
+			Client_Decode_StructureFull(buf, d);
+		}
 
-		if (s->upgradeLevel != old_upgradeLevel)
-			g_factoryWindowTotal = -1;
+		Client_ApplyStructure(index, d);
 	}
 
 	Structure_Recount();
 }
 
 static void
-Client_Recv_UpdateUnits(const unsigned char **buf)
+Client_Decode_UnitFull(const unsigned char **buf, UnitDelta *d)
+{
+	d->type         = Net_Decode_uint8 (buf);
+	d->flags.all    = Net_Decode_uint32(buf);
+	d->houseID      = Net_Decode_uint8 (buf);
+	d->position.x   = Net_Decode_uint16(buf);
+	d->position.y   = Net_Decode_uint16(buf);
+	d->hitpoints    = Net_Decode_uint16(buf);
+
+	d->actionID     = Net_Decode_uint8(buf);
+	d->nextActionID = Net_Decode_uint8(buf);
+	d->amount       = Net_Decode_uint8(buf);
+	d->deviated     = Net_Decode_uint8(buf);
+	d->deviatedHouse= Net_Decode_uint8(buf);
+	d->orientation0_current = Net_Decode_uint8(buf);
+	d->orientation1_current = Net_Decode_uint8(buf);
+	d->wobbleIndex  = Net_Decode_uint8(buf);
+	d->spriteOffset = Net_Decode_uint8(buf);
+	d->blinkHouse   = Net_Decode_uint8(buf);
+	d->targetAttack = Net_Decode_uint16(buf);
+	d->targetMove   = Net_Decode_uint16(buf);
+	d->showMoveIndicator = Net_Decode_uint8(buf);
+}
+
+/**
+ * @return True if the unit was freed or allocated, and the units need
+ *         to be recounted.
+ */
+static bool
+Client_ApplyUnit(uint16 index, const UnitDelta *d)
+{
+	Unit *u = Unit_Get_ByIndex(index);
+	Object *o = &u->o;
+	const ObjectFlags old_flags = o->flags;
+
+	o->index        = index;
+	o->type         = d->type;
+	o->flags        = d->flags;
+	o->houseID      = d->houseID;
+	o->position     = d->position;
+	o->hitpoints    = d->hitpoints;
+
+	u->actionID     = d->actionID;
+	u->nextActionID = d->nextActionID;
+	u->amount       = d->amount;
+	u->deviated     = d->deviated;
+	u->deviatedHouse= d->deviatedHouse;
+	u->orientation[0].current   = d->orientation0_current;
+	u->orientation[1].current   = d->orientation1_current;
+	u->wobbleIndex  = d->wobbleIndex;
+	u->spriteOffset = d->spriteOffset;
+	u->blinkHouse   = d->blinkHouse;
+	u->targetAttack = d->targetAttack;
+	u->targetMove   = d->targetMove;
+	u->showMoveIndicator = d->showMoveIndicator;
+
+	/* XXX -- Smooth animation not yet implemented. */
+	u->lastPosition = o->position;
+	ObjectGrid_UpdateUnit(u);
+
+	if ((!o->flags.s.used && old_flags.s.used)
+	 || (!o->flags.s.allocated && old_flags.s.allocated)
+	 || ( o->flags.s.isNotOnMap && !old_flags.s.isNotOnMap)) {
+		Unit_Unselect(u);
+	}
+
+	return (o->flags.s.used != old_flags.s.used);
+}
+
+static void
+Client_Recv_UpdateUnits(const unsigned char **buf, bool delta)
 {
 	const int count = Net_Decode_uint8(buf);
 	bool recount = false;
 
 	for (int i = 0; i < count; i++) {
 		const uint16 index = Net_Decode_ObjectIndex(buf);
-		Unit *u = Unit_Get_ByIndex(index);
-		Object *o = &u->o;
-		const ObjectFlags old_flags = o->flags;
-
-		o->index        = index;
-		o->type         = Net_Decode_uint8 (buf);
-		o->flags.all    = Net_Decode_uint32(buf);
-		o->houseID      = Net_Decode_uint8 (buf);
-		o->position.x   = Net_Decode_uint16(buf);
-		o->position.y   = Net_Decode_uint16(buf);
-		o->hitpoints    = Net_Decode_uint16(buf);
-
-		u->actionID     = Net_Decode_uint8(buf);
-		u->nextActionID = Net_Decode_uint8(buf);
-		u->amount       = Net_Decode_uint8(buf);
-		u->deviated     = Net_Decode_uint8(buf);
-		u->deviatedHouse= Net_Decode_uint8(buf);
-		u->orientation[0].current   = Net_Decode_uint8(buf);
-		u->orientation[1].current   = Net_Decode_uint8(buf);
-		u->wobbleIndex  = Net_Decode_uint8(buf);
-		u->spriteOffset = Net_Decode_uint8(buf);
-		u->blinkHouse   = Net_Decode_uint8(buf);
-		u->targetAttack = Net_Decode_uint16(buf);
-		u->targetMove   = Net_Decode_uint16(buf);
-		u->showMoveIndicator = Net_Decode_uint8(buf);
-
-		/* XXX -- Smooth animation not yet implemented. */
-		u->lastPosition = o->position;
-
-		if (o->flags.s.used != old_flags.s.used)
-			recount = true;
+		UnitDelta *d = &s_unitCopy[index];
 
-		if ((!o->flags.s.used && old_flags.s.used)
-		 || (!o->flags.s.allocated && old_flags.s.allocated)
-		 || ( o->flags.s.isNotOnMap && !old_flags.s.isNotOnMap)) {
-			Unit_Unselect(u);
+		if (delta) {
+			Net_Decode_UnitDelta(buf, d);
+		} else {
+			Client_Decode_UnitFull(buf, d);
 		}
+
+		if (Client_ApplyUnit(index, d))
+			recount = true;
 	}
 
 	if (recount)
@@ -435,6 +591,154 @@ Client_Recv_UpdateExplosions(const unsigned char **buf)
 	}
 }
 
+/**
+ * Decode a structure delta without reading past end.
+ *
+ * @return false if the delta is truncated.
+ */
+static bool
+Client_Decode_StructureDelta(const unsigned char **buf, const unsigned char *end, StructureDelta *d)
+{
+	unsigned char src[MAX_STRUCTURE_DELTA_LEN] = { 0 };
+	const unsigned char *p = src;
+	const size_t len = min((size_t)(end - *buf), sizeof(src));
+
+	memcpy(src, *buf, len);
+	Net_Decode_StructureDelta(&p, d);
+
+	if ((size_t)(p - src) > len)
+		return false;
+
+	*buf += p - src;
+	return true;
+}
+
+/**
+ * Decode a unit delta without reading past end.
+ *
+ * @return false if the delta is truncated.
+ */
+static bool
+Client_Decode_UnitDelta(const unsigned char **buf, const unsigned char *end, UnitDelta *d)
+{
+	unsigned char src[MAX_UNIT_DELTA_LEN] = { 0 };
+	const unsigned char *p = src;
+	const size_t len = min((size_t)(end - *buf), sizeof(src));
+
+	memcpy(src, *buf, len);
+	Net_Decode_UnitDelta(&p, d);
+
+	if ((size_t)(p - src) > len)
+		return false;
+
+	*buf += p - src;
+	return true;
+}
+
+/**
+ * Decode a snapshot onto the snapshot it is based on, then apply the
+ * structures and units which differ from the snapshot last applied.
+ * Snapshots older than that one, or based on one which is no longer
+ * kept, are dropped.  Nothing is applied until the whole snapshot has
+ * been decoded.
+ *
+ * @return The seq of the snapshot applied, or 0 if it was dropped.
+ */
+uint32
+Client_ProcessSnapshot(const unsigned char *buf, int count)
+{
+	const unsigned char * const end = buf + count;
+
+	if (count < 4 + 4 + 23 + (UNIT_MCV - UNIT_CARRYALL + 1) + 2 + 2)
+		return 0;
+
+	const uint32 seq = Net_Decode_uint32(&buf);
+	const uint32 baselineSeq = Net_Decode_uint32(&buf);
+	const Snapshot *baseline = &s_snapshot[baselineSeq % NET_SNAPSHOT_HISTORY];
+	Snapshot *snapshot = &s_snapshot[seq % NET_SNAPSHOT_HISTORY];
+
+	if (seq <= s_snapshotApplied.seq)
+		return 0;
+
+	if (baselineSeq != 0 && seq - baselineSeq >= NET_SNAPSHOT_HISTORY)
+		return 0;
+
+	if (baselineSeq == 0) {
+		memset(snapshot, 0, sizeof(Snapshot));
+	} else if (baseline->seq == baselineSeq) {
+		memcpy(snapshot, baseline, sizeof(Snapshot));
+		snapshot->seq = 0;
+	} else {
+		return 0;
+	}
+
+	House house = *g_playerHouse;
+	Client_Decode_House(&buf, &house);
+
+	int n = Net_Decode_uint16(&buf);
+	for (int i = 0; i < n; i++) {
+		if (buf + 2 > end)
+			return 0;
+
+		const uint16 index = Net_Decode_ObjectIndex(&buf);
+
+		if (index >= lengthof(snapshot->structure)
+		 || !Client_Decode_StructureDelta(&buf, end, &snapshot->structure[index]))
+			return 0;
+	}
+
+	if (buf + 2 > end)
+		return 0;
+
+	n = Net_Decode_uint16(&buf);
+	for (int i = 0; i < n; i++) {
+		if (buf + 2 > end)
+			return 0;
+
+		const uint16 index = Net_Decode_ObjectIndex(&buf);
+
+		if (index >= lengthof(snapshot->unit)
+		 || !Client_Decode_UnitDelta(&buf, end, &snapshot->unit[index]))
+			return 0;
+	}
+
+	snapshot->seq = seq;
+	s_snapshotApplied.seq = seq;
+
+	bool recount = false;
+
+	for (unsigned int i = 0; i < lengthof(snapshot->structure); i++) {
+		if (memcmp(&s_snapshotApplied.structure[i], &snapshot->structure[i], sizeof(StructureDelta)) == 0)
+			continue;
+
+		s_snapshotApplied.structure[i] = snapshot->structure[i];
+		Client_ApplyStructure(i, &snapshot->structure[i]);
+		recount = true;
+	}
+
+	if (recount)
+		Structure_Recount();
+
+	recount = false;
+
+	for (unsigned int i = 0; i < lengthof(snapshot->unit); i++) {
+		if (memcmp(&s_snapshotApplied.unit[i], &snapshot->unit[i], sizeof(UnitDelta)) == 0)
+			continue;
+
+		s_snapshotApplied.unit[i] = snapshot->unit[i];
+		if (Client_ApplyUnit(i, &snapshot->unit[i]))
+			recount = true;
+	}
+
+	if (recount)
+		Unit_Recount();
+
+	Client_ApplyHouse(&house);
+	Client_ChangeSelectionMode();
+
+	return seq;
+}
+
 static void
 Client_Recv_ScreenShake(const unsigned char **buf)
 {
@@ -661,11 +965,19 @@ Client_ProcessMessage(const unsigned char *buf, int count)
 				break;
 
 			case SCMSG_UPDATE_STRUCTURES:
-				Client_Recv_UpdateStructures(&buf);
+				Client_Recv_UpdateStructures(&buf, false);
 				break;
 
 			case SCMSG_UPDATE_UNITS:
-				Client_Recv_UpdateUnits(&buf);
+				Client_Recv_UpdateUnits(&buf, false);
+				break;
+
+			case SCMSG_UPDATE_STRUCTURES_DELTA:
+				Client_Recv_UpdateStructures(&buf, true);
+				break;
+
+			case SCMSG_UPDATE_UNITS_DELTA:
+				Client_Recv_UpdateUnits(&buf, true);
 				break;
 
 			case SCMSG_UPDATE_EXPLOSIONS:
@@ -714,6 +1026,10 @@ Client_ProcessMessage(const unsigned char *buf, int count)
 				break;
 
 			case SCMSG_START_GAME:
+				/* Not in Client_ResetCache, as updates which follow
+				 * this message may arrive before Net_Synchronise.
+				 */
+				Client_ResetObjectCache();
 				ret = NETEVENT_START_GAME;
 				break;
 
@@ -26,8 +26,11 @@ extern void Client_Send_IssueUnitAction(uint8 actionID, uint16 encoded, const st
 extern bool Client_Send_PrefName(const char *name);
 extern void Client_Send_PrefHouse(enum HouseType houseID);
 extern void Client_Send_Chat(const char *msg);
+extern void Client_Send_ProtocolVersion(void);
+extern bool Client_Send_SnapshotAck(unsigned char **buf);
 
 extern void Client_ChangeSelectionMode(void);
 extern enum NetEvent Client_ProcessMessage(const unsigned char *buf, int count);
+extern uint32 Client_ProcessSnapshot(const unsigned char *buf, int count);
 
 #endif
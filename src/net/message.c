@@ -25,6 +25,8 @@ static const struct {
 	{ 'n', MAX_NAME_LEN }, /* CSMSG_PREFERRED_NAME */
 	{ 'h', 1 }, /* CSMSG_PREFERRED_HOUSE */
 	{'\'', MAX_CHAT_LEN + 2 }, /* CSMSG_CHAT */
+	{ 'v', 1 }, /* CSMSG_PROTOCOL_VERSION */
+	{ 'a', 4 }, /* CSMSG_SNAPSHOT_ACK */
 };
 
 static unsigned char s_table_scmsg[SCMSG_MAX] = {
@@ -36,6 +38,8 @@ static unsigned char s_table_scmsg[SCMSG_MAX] = {
 	'S', /* SCMSG_UPDATE_STRUCTURES */
 	'U', /* SCMSG_UPDATE_UNITS */
 	'E', /* SCMSG_UPDATE_EXPLOSIONS */
+	's', /* SCMSG_UPDATE_STRUCTURES_DELTA */
+	'u', /* SCMSG_UPDATE_UNITS_DELTA */
 	'*', /* SCMSG_SCREEN_SHAKE */
 	'M', /* SCMSG_STATUS_MESSAGE */
 	'<', /* SCMSG_PLAY_SOUND */
@@ -53,6 +57,7 @@ static unsigned char s_table_scmsg[SCMSG_MAX] = {
 unsigned char g_server_broadcast_message_buf[MAX_SERVER_BROADCAST_MESSAGE_LEN];
 unsigned char g_server2client_message_buf[HOUSE_NEUTRAL][MAX_SERVER_TO_CLIENT_MESSAGE_LEN];
 unsigned char g_client2server_message_buf[MAX_CLIENT_MESSAGE_LEN];
+unsigned char g_server_snapshot_buf[MAX_SERVER_SNAPSHOT_LEN];
 int g_server2client_message_len[HOUSE_NEUTRAL];
 int g_client2server_message_len;
 
@@ -107,6 +112,51 @@ Net_Decode_uint32(const unsigned char **buf)
 	return ret;
 }
 
+/* Unsigned LEB128: seven bits per byte, least significant first. */
+void
+Net_Encode_varint(unsigned char **buf, uint32 val)
+{
+	while (val >= 0x80) {
+		Net_Encode_uint8(buf, 0x80 | (val & 0x7F));
+		val >>= 7;
+	}
+
+	Net_Encode_uint8(buf, val);
+}
+
+uint32
+Net_Decode_varint(const unsigned char **buf)
+{
+	uint32 ret = 0;
+
+	for (int shift = 0; shift < 32; shift += 7) {
+		const uint8 c = Net_Decode_uint8(buf);
+
+		ret |= (uint32)(c & 0x7F) << shift;
+		if ((c & 0x80) == 0)
+			break;
+	}
+
+	return ret;
+}
+
+/* Zigzag maps small negative numbers to small varints:
+ * 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+ */
+void
+Net_Encode_zigzag(unsigned char **buf, int32 val)
+{
+	Net_Encode_varint(buf, ((uint32)val << 1) ^ (uint32)(val >> 31));
+}
+
+int32
+Net_Decode_zigzag(const unsigned char **buf)
+{
+	const uint32 val = Net_Decode_varint(buf);
+
+	return (int32)(val >> 1) ^ -(int32)(val & 1);
+}
+
 void
 Net_Encode_ObjectIndex(unsigned char **buf, const Object *o)
 {
@@ -119,6 +169,198 @@ Net_Decode_ObjectIndex(const unsigned char **buf)
 	return Net_Decode_uint16(buf);
 }
 
+/*--------------------------------------------------------------*/
+
+/**
+ * Encode the fields of d which differ from prev, the state the client
+ * last received.  The record starts with a mask of the fields present.
+ * Positions are sent as the difference from prev.
+ */
+void
+Net_Encode_StructureDelta(unsigned char **buf,
+		const StructureDelta *prev, const StructureDelta *d)
+{
+	uint32 mask = 0;
+	uint32 queueMask = 0;
+
+	assert(OBJECTTYPE_MAX <= 32);
+
+	for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+		if (d->buildQueueCount[objectType] != prev->buildQueueCount[objectType])
+			queueMask |= (1u << objectType);
+	}
+
+	if (d->countDown      != prev->countDown)       mask |= STRUCTUREDELTA_COUNTDOWN;
+	if (d->hitpoints      != prev->hitpoints)       mask |= STRUCTUREDELTA_HITPOINTS;
+	if (d->rotationSprite != prev->rotationSprite)  mask |= STRUCTUREDELTA_ROTATIONSPRITE;
+	if (d->flags.all      != prev->flags.all)       mask |= STRUCTUREDELTA_FLAGS;
+	if (d->upgradeTime    != prev->upgradeTime)     mask |= STRUCTUREDELTA_UPGRADETIME;
+	if (d->objectType     != prev->objectType)      mask |= STRUCTUREDELTA_OBJECTTYPE;
+	if (queueMask != 0)                             mask |= STRUCTUREDELTA_BUILDQUEUE;
+	if (d->linkedID       != prev->linkedID)        mask |= STRUCTUREDELTA_LINKEDID;
+	if (d->upgradeLevel   != prev->upgradeLevel)    mask |= STRUCTUREDELTA_UPGRADELEVEL;
+	if (d->rallyPoint     != prev->rallyPoint)      mask |= STRUCTUREDELTA_RALLYPOINT;
+	if (d->position.x     != prev->position.x
+	 || d->position.y     != prev->position.y)      mask |= STRUCTUREDELTA_POSITION;
+	if (d->houseID        != prev->houseID)         mask |= STRUCTUREDELTA_HOUSEID;
+	if (d->creatorHouse   != prev->creatorHouse)    mask |= STRUCTUREDELTA_CREATORHOUSE;
+	if (d->type           != prev->type)            mask |= STRUCTUREDELTA_TYPE;
+
+	Net_Encode_varint(buf, mask);
+
+	if (mask & STRUCTUREDELTA_COUNTDOWN)      Net_Encode_varint(buf, d->countDown);
+	if (mask & STRUCTUREDELTA_HITPOINTS)      Net_Encode_varint(buf, d->hitpoints);
+	if (mask & STRUCTUREDELTA_ROTATIONSPRITE) Net_Encode_varint(buf, d->rotationSprite);
+	if (mask & STRUCTUREDELTA_FLAGS)          Net_Encode_varint(buf, d->flags.all);
+	if (mask & STRUCTUREDELTA_UPGRADETIME)    Net_Encode_uint8 (buf, d->upgradeTime);
+	if (mask & STRUCTUREDELTA_OBJECTTYPE)     Net_Encode_uint8 (buf, d->objectType);
+
+	if (mask & STRUCTUREDELTA_BUILDQUEUE) {
+		Net_Encode_varint(buf, queueMask);
+
+		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+			if (queueMask & (1u << objectType))
+				Net_Encode_uint8(buf, d->buildQueueCount[objectType]);
+		}
+	}
+
+	if (mask & STRUCTUREDELTA_LINKEDID)       Net_Encode_uint8 (buf, d->linkedID);
+	if (mask & STRUCTUREDELTA_UPGRADELEVEL)   Net_Encode_uint8 (buf, d->upgradeLevel);
+	if (mask & STRUCTUREDELTA_RALLYPOINT)     Net_Encode_varint(buf, d->rallyPoint);
+
+	if (mask & STRUCTUREDELTA_POSITION) {
+		Net_Encode_zigzag(buf, (int16)(d->position.x - prev->position.x));
+		Net_Encode_zigzag(buf, (int16)(d->position.y - prev->position.y));
+	}
+
+	if (mask & STRUCTUREDELTA_HOUSEID)        Net_Encode_uint8 (buf, d->houseID);
+	if (mask & STRUCTUREDELTA_CREATORHOUSE)   Net_Encode_uint8 (buf, d->creatorHouse);
+	if (mask & STRUCTUREDELTA_TYPE)           Net_Encode_uint8 (buf, d->type);
+}
+
+/**
+ * Apply a record encoded by Net_Encode_StructureDelta to d, which
+ * must hold the state the client last received.
+ */
+void
+Net_Decode_StructureDelta(const unsigned char **buf, StructureDelta *d)
+{
+	const uint32 mask = Net_Decode_varint(buf);
+
+	if (mask & STRUCTUREDELTA_COUNTDOWN)      d->countDown      = Net_Decode_varint(buf);
+	if (mask & STRUCTUREDELTA_HITPOINTS)      d->hitpoints      = Net_Decode_varint(buf);
+	if (mask & STRUCTUREDELTA_ROTATIONSPRITE) d->rotationSprite = Net_Decode_varint(buf);
+	if (mask & STRUCTUREDELTA_FLAGS)          d->flags.all      = Net_Decode_varint(buf);
+	if (mask & STRUCTUREDELTA_UPGRADETIME)    d->upgradeTime    = Net_Decode_uint8 (buf);
+	if (mask & STRUCTUREDELTA_OBJECTTYPE)     d->objectType     = Net_Decode_uint8 (buf);
+
+	if (mask & STRUCTUREDELTA_BUILDQUEUE) {
+		const uint32 queueMask = Net_Decode_varint(buf);
+
+		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+			if (queueMask & (1u << objectType))
+				d->buildQueueCount[objectType] = Net_Decode_uint8(buf);
+		}
+	}
+
+	if (mask & STRUCTUREDELTA_LINKEDID)       d->linkedID       = Net_Decode_uint8 (buf);
+	if (mask & STRUCTUREDELTA_UPGRADELEVEL)   d->upgradeLevel   = Net_Decode_uint8 (buf);
+	if (mask & STRUCTUREDELTA_RALLYPOINT)     d->rallyPoint     = Net_Decode_varint(buf);
+
+	if (mask & STRUCTUREDELTA_POSITION) {
+		d->position.x += Net_Decode_zigzag(buf);
+		d->position.y += Net_Decode_zigzag(buf);
+	}
+
+	if (mask & STRUCTUREDELTA_HOUSEID)        d->houseID        = Net_Decode_uint8 (buf);
+	if (mask & STRUCTUREDELTA_CREATORHOUSE)   d->creatorHouse   = Net_Decode_uint8 (buf);
+	if (mask & STRUCTUREDELTA_TYPE)           d->type           = Net_Decode_uint8 (buf);
+}
+
+/**
+ * Encode the fields of d which differ from prev, as for structures.
+ */
+void
+Net_Encode_UnitDelta(unsigned char **buf,
+		const UnitDelta *prev, const UnitDelta *d)
+{
+	uint32 mask = 0;
+
+	if (d->position.x           != prev->position.x
+	 || d->position.y           != prev->position.y)            mask |= UNITDELTA_POSITION;
+	if (d->orientation0_current != prev->orientation0_current)  mask |= UNITDELTA_ORIENTATION0;
+	if (d->orientation1_current != prev->orientation1_current)  mask |= UNITDELTA_ORIENTATION1;
+	if (d->hitpoints            != prev->hitpoints)             mask |= UNITDELTA_HITPOINTS;
+	if (d->spriteOffset         != prev->spriteOffset)          mask |= UNITDELTA_SPRITEOFFSET;
+	if (d->wobbleIndex          != prev->wobbleIndex)           mask |= UNITDELTA_WOBBLEINDEX;
+	if (d->actionID             != prev->actionID)              mask |= UNITDELTA_ACTIONID;
+	if (d->flags.all            != prev->flags.all)             mask |= UNITDELTA_FLAGS;
+	if (d->targetMove           != prev->targetMove)            mask |= UNITDELTA_TARGETMOVE;
+	if (d->targetAttack         != prev->targetAttack)          mask |= UNITDELTA_TARGETATTACK;
+	if (d->amount               != prev->amount)                mask |= UNITDELTA_AMOUNT;
+	if (d->nextActionID         != prev->nextActionID)          mask |= UNITDELTA_NEXTACTIONID;
+	if (d->deviated             != prev->deviated)              mask |= UNITDELTA_DEVIATED;
+	if (d->deviatedHouse        != prev->deviatedHouse)         mask |= UNITDELTA_DEVIATEDHOUSE;
+	if (d->blinkHouse           != prev->blinkHouse)            mask |= UNITDELTA_BLINKHOUSE;
+	if (d->showMoveIndicator    != prev->showMoveIndicator)     mask |= UNITDELTA_SHOWMOVEINDICATOR;
+	if (d->houseID              != prev->houseID)               mask |= UNITDELTA_HOUSEID;
+	if (d->type                 != prev->type)                  mask |= UNITDELTA_TYPE;
+
+	Net_Encode_varint(buf, mask);
+
+	if (mask & UNITDELTA_POSITION) {
+		Net_Encode_zigzag(buf, (int16)(d->position.x - prev->position.x));
+		Net_Encode_zigzag(buf, (int16)(d->position.y - prev->position.y));
+	}
+
+	if (mask & UNITDELTA_ORIENTATION0)      Net_Encode_uint8 (buf, d->orientation0_current);
+	if (mask & UNITDELTA_ORIENTATION1)      Net_Encode_uint8 (buf, d->orientation1_current);
+	if (mask & UNITDELTA_HITPOINTS)         Net_Encode_varint(buf, d->hitpoints);
+	if (mask & UNITDELTA_SPRITEOFFSET)      Net_Encode_uint8 (buf, d->spriteOffset);
+	if (mask & UNITDELTA_WOBBLEINDEX)       Net_Encode_uint8 (buf, d->wobbleIndex);
+	if (mask & UNITDELTA_ACTIONID)          Net_Encode_uint8 (buf, d->actionID);
+	if (mask & UNITDELTA_FLAGS)             Net_Encode_varint(buf, d->flags.all);
+	if (mask & UNITDELTA_TARGETMOVE)        Net_Encode_varint(buf, d->targetMove);
+	if (mask & UNITDELTA_TARGETATTACK)      Net_Encode_varint(buf, d->targetAttack);
+	if (mask & UNITDELTA_AMOUNT)            Net_Encode_uint8 (buf, d->amount);
+	if (mask & UNITDELTA_NEXTACTIONID)      Net_Encode_uint8 (buf, d->nextActionID);
+	if (mask & UNITDELTA_DEVIATED)          Net_Encode_uint8 (buf, d->deviated);
+	if (mask & UNITDELTA_DEVIATEDHOUSE)     Net_Encode_uint8 (buf, d->deviatedHouse);
+	if (mask & UNITDELTA_BLINKHOUSE)        Net_Encode_uint8 (buf, d->blinkHouse);
+	if (mask & UNITDELTA_SHOWMOVEINDICATOR) Net_Encode_uint8 (buf, d->showMoveIndicator);
+	if (mask & UNITDELTA_HOUSEID)           Net_Encode_uint8 (buf, d->houseID);
+	if (mask & UNITDELTA_TYPE)              Net_Encode_uint8 (buf, d->type);
+}
+
+void
+Net_Decode_UnitDelta(const unsigned char **buf, UnitDelta *d)
+{
+	const uint32 mask = Net_Decode_varint(buf);
+
+	if (mask & UNITDELTA_POSITION) {
+		d->position.x += Net_Decode_zigzag(buf);
+		d->position.y += Net_Decode_zigzag(buf);
+	}
+
+	if (mask & UNITDELTA_ORIENTATION0)      d->orientation0_current = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_ORIENTATION1)      d->orientation1_current = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_HITPOINTS)         d->hitpoints            = Net_Decode_varint(buf);
+	if (mask & UNITDELTA_SPRITEOFFSET)      d->spriteOffset         = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_WOBBLEINDEX)       d->wobbleIndex          = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_ACTIONID)          d->actionID             = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_FLAGS)             d->flags.all            = Net_Decode_varint(buf);
+	if (mask & UNITDELTA_TARGETMOVE)        d->targetMove           = Net_Decode_varint(buf);
+	if (mask & UNITDELTA_TARGETATTACK)      d->targetAttack         = Net_Decode_varint(buf);
+	if (mask & UNITDELTA_AMOUNT)            d->amount               = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_NEXTACTIONID)      d->nextActionID         = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_DEVIATED)          d->deviated             = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_DEVIATEDHOUSE)     d->deviatedHouse        = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_BLINKHOUSE)        d->blinkHouse           = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_SHOWMOVEINDICATOR) d->showMoveIndicator    = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_HOUSEID)           d->houseID              = Net_Decode_uint8 (buf);
+	if (mask & UNITDELTA_TYPE)              d->type                 = Net_Decode_uint8 (buf);
+}
+
 int
 Net_GetLength_ClientServerMsg(enum ClientServerMsg msg)
 {
@@ -3,11 +3,30 @@
 
 #include "enumeration.h"
 #include "types.h"
+#include "../buildqueue.h"
+#include "../object.h"
+#include "../pool/pool_structure.h"
+#include "../pool/pool_unit.h"
 
 enum {
 	MAX_SERVER_BROADCAST_MESSAGE_LEN = 32768,
 	MAX_SERVER_TO_CLIENT_MESSAGE_LEN = 1024,
-	MAX_CLIENT_MESSAGE_LEN = 32768
+	MAX_CLIENT_MESSAGE_LEN = 32768,
+	MAX_SERVER_SNAPSHOT_LEN = 32768,
+
+	/* Longest encoding of a delta record, excluding the index. */
+	MAX_STRUCTURE_DELTA_LEN = 69,
+	MAX_UNIT_DELTA_LEN = 36,
+
+	/* Snapshots kept as baselines.  Acks older than this are ignored,
+	 * and the next snapshot is sent in full.
+	 */
+	NET_SNAPSHOT_HISTORY = 32,
+
+	/* Longest snapshot sent in one tick, so that it goes out as a
+	 * single packet.  Records which do not fit are sent later.
+	 */
+	NET_SNAPSHOT_BUDGET = 1200
 };
 
 enum ClientServerMsg {
@@ -27,6 +46,8 @@ enum ClientServerMsg {
 	CSMSG_PREFERRED_NAME,
 	CSMSG_PREFERRED_HOUSE,
 	CSMSG_CHAT,
+	CSMSG_PROTOCOL_VERSION,
+	CSMSG_SNAPSHOT_ACK,
 
 	CSMSG_MAX,
 	CSMSG_INVALID
@@ -42,6 +63,8 @@ enum ServerClientMsg {
 	SCMSG_UPDATE_STRUCTURES,
 	SCMSG_UPDATE_UNITS,
 	SCMSG_UPDATE_EXPLOSIONS,
+	SCMSG_UPDATE_STRUCTURES_DELTA,
+	SCMSG_UPDATE_UNITS_DELTA,
 
 	SCMSG_SCREEN_SHAKE,
 	SCMSG_STATUS_MESSAGE,
@@ -61,11 +84,105 @@ enum ServerClientMsg {
 	SCMSG_INVALID
 };
 
-struct Object;
+/* Fields present in a SCMSG_UPDATE_STRUCTURES_DELTA record.  The
+ * fields which change most often come first, so that the mask usually
+ * fits in a single byte.
+ */
+enum StructureDeltaField {
+	STRUCTUREDELTA_COUNTDOWN        = 1 << 0,
+	STRUCTUREDELTA_HITPOINTS        = 1 << 1,
+	STRUCTUREDELTA_ROTATIONSPRITE   = 1 << 2,
+	STRUCTUREDELTA_FLAGS            = 1 << 3,
+	STRUCTUREDELTA_UPGRADETIME      = 1 << 4,
+	STRUCTUREDELTA_OBJECTTYPE       = 1 << 5,
+	STRUCTUREDELTA_BUILDQUEUE       = 1 << 6,
+	STRUCTUREDELTA_LINKEDID         = 1 << 7,
+	STRUCTUREDELTA_UPGRADELEVEL     = 1 << 8,
+	STRUCTUREDELTA_RALLYPOINT       = 1 << 9,
+	STRUCTUREDELTA_POSITION         = 1 << 10,
+	STRUCTUREDELTA_HOUSEID          = 1 << 11,
+	STRUCTUREDELTA_CREATORHOUSE     = 1 << 12,
+	STRUCTUREDELTA_TYPE             = 1 << 13
+};
+
+/* Fields present in a SCMSG_UPDATE_UNITS_DELTA record. */
+enum UnitDeltaField {
+	UNITDELTA_POSITION          = 1 << 0,
+	UNITDELTA_ORIENTATION0      = 1 << 1,
+	UNITDELTA_ORIENTATION1      = 1 << 2,
+	UNITDELTA_HITPOINTS         = 1 << 3,
+	UNITDELTA_SPRITEOFFSET      = 1 << 4,
+	UNITDELTA_WOBBLEINDEX       = 1 << 5,
+	UNITDELTA_ACTIONID          = 1 << 6,
+	UNITDELTA_FLAGS             = 1 << 7,
+	UNITDELTA_TARGETMOVE        = 1 << 8,
+	UNITDELTA_TARGETATTACK      = 1 << 9,
+	UNITDELTA_AMOUNT            = 1 << 10,
+	UNITDELTA_NEXTACTIONID      = 1 << 11,
+	UNITDELTA_DEVIATED          = 1 << 12,
+	UNITDELTA_DEVIATEDHOUSE     = 1 << 13,
+	UNITDELTA_BLINKHOUSE        = 1 << 14,
+	UNITDELTA_SHOWMOVEINDICATOR = 1 << 15,
+	UNITDELTA_HOUSEID           = 1 << 16,
+	UNITDELTA_TYPE              = 1 << 17
+};
+
+/* The state of a structure or unit as last sent to the clients. */
+typedef struct StructureDelta {
+	uint8       type;
+	uint8       linkedID;
+	ObjectFlags flags;
+	uint8       houseID;
+	tile32      position;
+	uint16      hitpoints;
+
+	uint8       creatorHouse;
+	uint16      rotationSprite;
+	uint8       objectType;
+	uint8       upgradeLevel;
+	uint8       upgradeTime;
+	uint16      countDown;
+	uint16      rallyPoint;
+
+	uint8       buildQueueCount[OBJECTTYPE_MAX];
+} StructureDelta;
+
+typedef struct UnitDelta {
+	uint8   type;
+	ObjectFlags flags;
+	uint8   houseID;
+	tile32  position;
+	uint16  hitpoints;
+
+	uint8   actionID;
+	uint8   nextActionID;
+	uint8   amount;
+	uint8   deviated;
+	uint8   deviatedHouse;
+	int8    orientation0_current;
+	int8    orientation1_current;
+	uint8   wobbleIndex;
+	uint8   spriteOffset;
+	uint8   blinkHouse;
+	uint16  targetAttack;
+	uint16  targetMove;
+	uint8   showMoveIndicator;
+} UnitDelta;
+
+/* The structures and units as a house saw them at one tick.  Sent on
+ * NET_CHANNEL_SNAPSHOT as the difference from a snapshot the client has
+ * acknowledged.
+ */
+typedef struct Snapshot {
+	uint32          seq;
+	StructureDelta  structure[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+	UnitDelta       unit[UNIT_INDEX_MAX_RAISED];
+} Snapshot;
 
 extern unsigned char g_server_broadcast_message_buf[MAX_SERVER_BROADCAST_MESSAGE_LEN];
 extern unsigned char g_server2client_message_buf[HOUSE_NEUTRAL][MAX_SERVER_TO_CLIENT_MESSAGE_LEN];
 extern unsigned char g_client2server_message_buf[MAX_CLIENT_MESSAGE_LEN];
+extern unsigned char g_server_snapshot_buf[MAX_SERVER_SNAPSHOT_LEN];
 extern int g_server2client_message_len[HOUSE_NEUTRAL];
 extern int g_client2server_message_len;
 
@@ -75,10 +192,19 @@ extern void   Net_Encode_uint16(unsigned char **buf, uint16 val);
 extern uint16 Net_Decode_uint16(const unsigned char **buf);
 extern void   Net_Encode_uint32(unsigned char **buf, uint32 val);
 extern uint32 Net_Decode_uint32(const unsigned char **buf);
+extern void   Net_Encode_varint(unsigned char **buf, uint32 val);
+extern uint32 Net_Decode_varint(const unsigned char **buf);
+extern void   Net_Encode_zigzag(unsigned char **buf, int32 val);
+extern int32  Net_Decode_zigzag(const unsigned char **buf);
 
 extern void   Net_Encode_ObjectIndex(unsigned char **buf, const struct Object *o);
 extern uint16 Net_Decode_ObjectIndex(const unsigned char **buf);
 
+extern void Net_Encode_StructureDelta(unsigned char **buf, const StructureDelta *prev, const StructureDelta *d);
+extern void Net_Decode_StructureDelta(const unsigned char **buf, StructureDelta *d);
+extern void Net_Encode_UnitDelta(unsigned char **buf, const UnitDelta *prev, const UnitDelta *d);
+extern void Net_Decode_UnitDelta(const unsigned char **buf, UnitDelta *d);
+
 extern int Net_GetLength_ClientServerMsg(enum ClientServerMsg msg);
 extern void Net_Encode_ClientServerMsg(unsigned char **buf, enum ClientServerMsg msg);
 extern enum ClientServerMsg Net_Decode_ClientServerMsg(unsigned char c);
@@ -22,6 +22,28 @@ enum {
 
 #define DEFAULT_PORT_STR "10700"
 
+/* Clients which never send CSMSG_PROTOCOL_VERSION are at
+ * NET_PROTOCOL_BASE.
+ */
+enum NetProtocol {
+	NET_PROTOCOL_BASE,
+	NET_PROTOCOL_DELTA,         /* Field-level structure and unit updates. */
+	NET_PROTOCOL_SNAPSHOT,      /* Structures, units and house on NET_CHANNEL_SNAPSHOT. */
+
+	NET_PROTOCOL_VERSION = NET_PROTOCOL_SNAPSHOT
+};
+
+/* Commands, chat, events, landscape and fog of war are sent reliably.
+ * Snapshots and their acks are sent unreliably, as a lost snapshot is
+ * superseded by the next one.
+ */
+enum NetChannel {
+	NET_CHANNEL_RELIABLE,
+	NET_CHANNEL_SNAPSHOT,
+
+	NET_CHANNEL_MAX
+};
+
 enum NetHostType {
 	HOSTTYPE_NONE,
 	HOSTTYPE_DEDICATED_SERVER,
@@ -40,6 +62,7 @@ typedef struct PeerData {
 	int id;
 	void *peer;
 	char name[MAX_NAME_LEN + 1];
+	enum NetProtocol protocol;
 } PeerData;
 
 extern char g_net_name[MAX_NAME_LEN + 1];
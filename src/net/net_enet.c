@@ -3,7 +3,9 @@
 #include <assert.h>
 #include <enet/enet.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "../os/common.h"
 
 #include "net.h"
 
@@ -26,6 +28,12 @@
 #define NET_LOG(...)
 #endif
 
+/* Define NET_SIMULATE_LOSS as a percentage to drop that many incoming
+ * datagrams before ENet sees them.  Playing through a loopback
+ * connection then shows how long clients take to recover from lost
+ * snapshots, logged with NET_LOG.  ENet resends whatever was reliable.
+ */
+
 char g_net_name[MAX_NAME_LEN + 1] = "Name";
 char g_host_addr[MAX_ADDR_LEN + 1] = "0.0.0.0";
 char g_host_port[MAX_PORT_LEN + 1] = DEFAULT_PORT_STR;
@@ -43,6 +51,11 @@ static ENetPeer *s_enet_peer;
 int g_local_client_id;
 PeerData g_peer_data[MAX_CLIENTS];
 
+#ifdef NET_SIMULATE_LOSS
+static uint32 s_lastSnapshotSeq;
+static enet_uint32 s_lastSnapshotTime;
+#endif
+
 /*--------------------------------------------------------------*/
 
 static PeerData *
@@ -55,6 +68,7 @@ Net_NewPeerData(int peerID)
 			data->state = CLIENTSTATE_IN_LOBBY;
 			data->id = peerID;
 			data->name[0] = '\0';
+			data->protocol = NET_PROTOCOL_BASE;
 			return data;
 		}
 	}
@@ -114,6 +128,36 @@ Net_GetClientHouse(int peerID)
 
 /*--------------------------------------------------------------*/
 
+static void
+Net_SendUnreliable(ENetPeer *peer, const unsigned char *buf, size_t len)
+{
+	ENetPacket *packet
+		= enet_packet_create(buf, len, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+
+	if (enet_peer_send(peer, NET_CHANNEL_SNAPSHOT, packet) < 0)
+		enet_packet_destroy(packet);
+}
+
+#ifdef NET_SIMULATE_LOSS
+/**
+ * ENet intercept callback, dropping incoming datagrams at random.  It
+ * has its own generator so that rand() is left alone.
+ */
+static int ENET_CALLBACK
+Net_SimulateLoss(ENetHost *host, ENetEvent *event)
+{
+	static uint32 l_seed = 1;
+
+	VARIABLE_NOT_USED(host);
+	VARIABLE_NOT_USED(event);
+
+	l_seed = l_seed * 1103515245 + 12345;
+	return ((l_seed >> 16) % 100 < NET_SIMULATE_LOSS) ? 1 : 0;
+}
+#endif
+
+/*--------------------------------------------------------------*/
+
 void
 Net_Initialise(void)
 {
@@ -169,10 +213,14 @@ Net_CreateServer(const char *addr, int port, const char *name)
 		enet_address_set_host(&address, addr);
 		address.port = port;
 
-		s_enet_host = enet_host_create(&address, max_clients, 2, 0, 0);
+		s_enet_host = enet_host_create(&address, max_clients, NET_CHANNEL_MAX, 0, 0);
 		if (s_enet_host == NULL)
 			goto error_host_create;
 
+#ifdef NET_SIMULATE_LOSS
+		s_enet_host->intercept = Net_SimulateLoss;
+#endif
+
 		ChatBox_ClearHistory();
 		ChatBox_AddLog(CHATTYPE_LOG, "Server created");
 
@@ -202,11 +250,15 @@ Net_ConnectToServer(const char *hostname, int port, const char *name)
 		enet_address_set_host(&address, hostname);
 		address.port = port;
 
-		s_enet_host = enet_host_create(NULL, 1, 2, 57600/8, 14400/8);
+		s_enet_host = enet_host_create(NULL, 1, NET_CHANNEL_MAX, 57600/8, 14400/8);
 		if (s_enet_host == NULL)
 			goto error_host_create;
 
-		s_enet_peer = enet_host_connect(s_enet_host, &address, 2, 0);
+#ifdef NET_SIMULATE_LOSS
+		s_enet_host->intercept = Net_SimulateLoss;
+#endif
+
+		s_enet_peer = enet_host_connect(s_enet_host, &address, NET_CHANNEL_MAX, 0);
 		if (s_enet_peer == NULL)
 			goto error_host_connect;
 
@@ -225,6 +277,7 @@ Net_ConnectToServer(const char *hostname, int port, const char *name)
 		g_local_client_id = 0;
 
 		Client_Send_PrefName(name);
+		Client_Send_ProtocolVersion();
 		return true;
 	}
 
@@ -245,6 +298,10 @@ error_host_create:
 void
 Net_Disconnect(void)
 {
+#ifdef NET_SIMULATE_LOSS
+	s_lastSnapshotSeq = 0;
+#endif
+
 	if (s_enet_host != NULL) {
 		if (g_host_type == HOSTTYPE_DEDICATED_SERVER
 		 || g_host_type == HOSTTYPE_CLIENT_SERVER) {
@@ -483,10 +540,6 @@ Server_SendMessages(void)
 	}
 
 	Server_Send_UpdateCHOAM(&buf);
-	Server_Send_UpdateLandscape(&buf);
-	Server_Send_UpdateStructures(&buf);
-	Server_Send_UpdateUnits(&buf);
-	Server_Send_UpdateExplosions(&buf);
 
 	unsigned char * const buf_start_client_specific = buf;
 
@@ -496,7 +549,28 @@ Server_SendMessages(void)
 
 		buf = buf_start_client_specific;
 
-		Server_Send_UpdateHouse(houseID, &buf);
+		Server_Send_UpdateLandscape(houseID, &buf);
+		Server_Send_UpdateExplosions(houseID, &buf);
+
+		unsigned char *snapshot = g_server_snapshot_buf;
+
+		if (Server_Send_Snapshot(houseID, &snapshot)) {
+			const size_t snapshot_len = snapshot - g_server_snapshot_buf;
+
+			for (int i = 0; i < MAX_CLIENTS; i++) {
+				const PeerData *data = &g_peer_data[i];
+
+				if (data->peer == NULL || Net_GetClientHouse(data->id) != houseID)
+					continue;
+
+				Net_SendUnreliable(data->peer, g_server_snapshot_buf, snapshot_len);
+			}
+		} else {
+			Server_Send_UpdateStructures(houseID, &buf);
+			Server_Send_UpdateUnits(houseID, &buf);
+			Server_Send_UpdateHouse(houseID, &buf);
+		}
+
 		Server_Send_UpdateFogOfWar(houseID, &buf);
 
 		if ((g_server2client_message_len[houseID] > 0)
@@ -659,6 +733,12 @@ Client_SendMessages(void)
 	if (g_host_type != HOSTTYPE_DEDICATED_CLIENT)
 		return;
 
+	unsigned char ack[5];
+	unsigned char *p = ack;
+
+	if (Client_Send_SnapshotAck(&p))
+		Net_SendUnreliable(s_enet_peer, ack, p - ack);
+
 	if (g_client2server_message_len <= 0)
 		return;
 
@@ -675,6 +755,29 @@ Client_SendMessages(void)
 	g_client2server_message_len = 0;
 }
 
+static void
+Client_Recv_Snapshot(const unsigned char *buf, int count)
+{
+	const uint32 seq = Client_ProcessSnapshot(buf, count);
+
+#ifdef NET_SIMULATE_LOSS
+	if (seq == 0)
+		return;
+
+	const enet_uint32 now = enet_time_get();
+
+	if (s_lastSnapshotSeq != 0 && seq > s_lastSnapshotSeq + 1) {
+		NET_LOG("lost %u snapshots, recovered after %u ms",
+				seq - s_lastSnapshotSeq - 1, now - s_lastSnapshotTime);
+	}
+
+	s_lastSnapshotSeq = seq;
+	s_lastSnapshotTime = now;
+#else
+	VARIABLE_NOT_USED(seq);
+#endif
+}
+
 enum NetEvent
 Client_RecvMessages(void)
 {
@@ -694,7 +797,13 @@ Client_RecvMessages(void)
 			case ENET_EVENT_TYPE_RECEIVE:
 				{
 					ENetPacket *packet = event.packet;
-					ret = Client_ProcessMessage(packet->data, packet->dataLength);
+
+					if (event.channelID == NET_CHANNEL_SNAPSHOT) {
+						Client_Recv_Snapshot(packet->data, packet->dataLength);
+					} else {
+						ret = Client_ProcessMessage(packet->data, packet->dataLength);
+					}
+
 					enet_packet_destroy(packet);
 				}
 				break;
@@ -9,6 +9,7 @@
 #include "../os/math.h"
 #include "../os/strings.h"
 #include "enum_string.h"
+#include "errorlog.h"
 
 #include "server.h"
 
@@ -26,6 +27,7 @@
 #include "../newui/menu.h"
 #include "../newui/menubar.h"
 #include "../newui/viewport.h"
+#include "../objectgrid.h"
 #include "../opendune.h"
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
@@ -37,6 +39,7 @@
 #include "../tools/coord.h"
 #include "../tools/encoded_index.h"
 #include "../tools/random_starport.h"
+#include "../timerwheel.h"
 #include "../unit.h"
 
 #if 0
@@ -46,52 +49,75 @@
 #define SERVER_LOG(...)
 #endif
 
-typedef struct StructureDelta {
-	uint8       type;
-	uint8       linkedID;
-	ObjectFlags flags;
-	uint8       houseID;
-	tile32      position;
-	uint16      hitpoints;
-
-	uint8       creatorHouse;
-	uint16      rotationSprite;
-	uint8       objectType;
-	uint8       upgradeLevel;
-	uint8       upgradeTime;
-	uint16      countDown;
-	uint16      rallyPoint;
-
-	uint8       buildQueueCount[OBJECTTYPE_MAX];
-} StructureDelta;
-
-typedef struct UnitDelta {
-	uint8   type;
-	ObjectFlags flags;
-	uint8   houseID;
-	tile32  position;
-	uint16  hitpoints;
-
-	uint8   actionID;
-	uint8   nextActionID;
-	uint8   amount;
-	uint8   deviated;
-	uint8   deviatedHouse;
-	int8    orientation0_current;
-	int8    orientation1_current;
-	uint8   wobbleIndex;
-	uint8   spriteOffset;
-	uint8   blinkHouse;
-	uint16  targetAttack;
-	uint16  targetMove;
-	uint8   showMoveIndicator;
-} UnitDelta;
-
-static Tile s_mapCopy[MAP_SIZE_MAX * MAP_SIZE_MAX];
+/* Define SERVER_VERIFY_DIRTY to compare every clean tile, structure
+ * and unit against its copy, as the encoders did before tracking
+ * dirty entries, and assert that none of them changed unmarked.  Debug
+ * builds always do.
+ */
+#if !defined(NDEBUG) && !defined(SERVER_VERIFY_DIRTY)
+#define SERVER_VERIFY_DIRTY
+#endif
+
+/* How a house sees a structure or unit. */
+enum ServerView {
+	SERVER_VIEW_HIDDEN,     /* Out of view; the client keeps what it last saw. */
+	SERVER_VIEW_VISIBLE,    /* In view; sent as it is. */
+	SERVER_VIEW_CLEARED     /* Sent as freed, so the client stops drawing it. */
+};
+
 static int64_t s_choamLastUpdate;
-static StructureDelta s_structureCopy[STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
-static UnitDelta s_unitCopy[UNIT_INDEX_MAX_RAISED];
-static int s_explosionLastCount;
+
+/* Tiles, explosions, structures and units are sent to each house
+ * separately, so that clients only learn about what they can see.
+ */
+static Tile s_mapCopy[HOUSE_NEUTRAL][MAP_SIZE_MAX * MAP_SIZE_MAX];
+static int s_explosionLastCount[HOUSE_NEUTRAL];
+static StructureDelta s_structureCopy[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static UnitDelta s_unitCopy[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+static uint8 s_structureView[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static uint8 s_unitView[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+
+/* Send SCMSG_UPDATE_STRUCTURES_DELTA and SCMSG_UPDATE_UNITS_DELTA to
+ * the house, or snapshots instead, decided at the start of each game.
+ */
+static bool s_sendDeltas[HOUSE_NEUTRAL];
+static bool s_sendSnapshots[HOUSE_NEUTRAL];
+
+/* Snapshots sent to each house, by seq % NET_SNAPSHOT_HISTORY, and the
+ * latest one it acknowledged.  The history is only allocated for houses
+ * whose client takes snapshots.  The changed arrays hold the seq of the
+ * snapshot in which each copy last changed, so that only entries which
+ * changed since the acknowledged snapshot are compared.
+ */
+static Snapshot *s_snapshot[HOUSE_NEUTRAL];
+static uint32 s_snapshotSeq[HOUSE_NEUTRAL];
+static uint32 s_snapshotAck[HOUSE_NEUTRAL];
+static uint32 s_structureChanged[HOUSE_NEUTRAL][STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT];
+static uint32 s_unitChanged[HOUSE_NEUTRAL][UNIT_INDEX_MAX_RAISED];
+
+/* Entries which may differ from their copies.  Whatever changes a
+ * tracked field must mark the entry dirty, or the change is never
+ * sent.
+ */
+static uint32 s_tileDirty[HOUSE_NEUTRAL][MAP_SIZE_MAX * MAP_SIZE_MAX / 32];
+static uint32 s_structureDirty[HOUSE_NEUTRAL][(STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT + 31) / 32];
+static uint32 s_unitDirty[HOUSE_NEUTRAL][(UNIT_INDEX_MAX_RAISED + 31) / 32];
+
+/* The tiles each house sees, as of its last update.  Tiles whose fog
+ * changed are marked in s_visionDirty, and tiles in view go on the
+ * house's timer wheel at their fog timeout, so that only those tiles
+ * are looked at again.
+ */
+static uint32 s_tileVisible[HOUSE_NEUTRAL][MAP_SIZE_MAX * MAP_SIZE_MAX / 32];
+static uint32 s_visionDirty[HOUSE_NEUTRAL][MAP_SIZE_MAX * MAP_SIZE_MAX / 32];
+static TimerWheel s_fogWheel[HOUSE_NEUTRAL];
+static uint16 s_fogTimer[HOUSE_NEUTRAL][MAP_SIZE_MAX * MAP_SIZE_MAX]; /*!< The tile's timer, or TIMERWHEEL_NONE. */
+
+/* Structures hidden from the house whose copy no longer matches where
+ * the structure is, so that the grid will not find them when the
+ * house comes to see the place they were last seen.
+ */
+static uint32 s_structureStale[HOUSE_NEUTRAL][(STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT + 31) / 32];
 
 static void Server_ReturnToLobbyNow(bool win);
 
@@ -124,6 +150,82 @@ Server_DepleteStarport(enum UnitType unitType)
 
 /*--------------------------------------------------------------*/
 
+static void
+Server_SetDirty(uint32 *dirty, int i)
+{
+	dirty[i / 32] |= (1u << (i % 32));
+}
+
+static void
+Server_ClearDirty(uint32 *dirty, int i)
+{
+	dirty[i / 32] &= ~(1u << (i % 32));
+}
+
+static bool
+Server_IsDirty(const uint32 *dirty, int i)
+{
+	return (dirty[i / 32] & (1u << (i % 32))) != 0;
+}
+
+/**
+ * Find the first dirty entry from i onwards, skipping clean words.
+ * @return The index of the entry, or end if there is none.
+ */
+static int
+Server_NextDirty(const uint32 *dirty, int i, int end)
+{
+	while (i < end) {
+		const uint32 word = dirty[i / 32] >> (i % 32);
+
+		if (word == 0) {
+			i = (i / 32 + 1) * 32;
+		} else if (word & 1) {
+			return i;
+		} else {
+			i++;
+		}
+	}
+
+	return end;
+}
+
+void
+Server_MarkTileDirty(uint16 packed)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		Server_SetDirty(s_tileDirty[h], packed);
+	}
+}
+
+/**
+ * The tile was unveiled to the house, or its fog timeout changed.
+ */
+void
+Server_MarkVisionDirty(enum HouseType houseID, uint16 packed)
+{
+	if (houseID < HOUSE_NEUTRAL)
+		Server_SetDirty(s_visionDirty[houseID], packed);
+}
+
+void
+Server_MarkStructureDirty(const Structure *s)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		Server_SetDirty(s_structureDirty[h], s->o.index);
+	}
+}
+
+void
+Server_MarkUnitDirty(const Unit *u)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		Server_SetDirty(s_unitDirty[h], u->o.index);
+	}
+}
+
+/*--------------------------------------------------------------*/
+
 static bool
 Server_CanEncodeFixedWidthBuffer(unsigned char **buf, size_t len)
 {
@@ -147,6 +249,248 @@ Server_MaxElementsToEncode(unsigned char **buf,
 	}
 }
 
+static enum NetProtocol
+Server_GetClientProtocol(enum HouseType houseID)
+{
+	if (g_multiplayer.client[houseID] == 0)
+		return NET_PROTOCOL_BASE;
+
+	const PeerData *data = Net_GetPeerData(g_multiplayer.client[houseID]);
+	if (data == NULL || data->peer == NULL)
+		return NET_PROTOCOL_BASE;
+
+	return data->protocol;
+}
+
+/*--------------------------------------------------------------*/
+
+static bool
+Server_IsTileVisible(enum HouseType houseID, uint16 packed)
+{
+	if (!Map_IsUnveiledToHouse(houseID, packed))
+		return false;
+
+	return !enhancement_fog_of_war || !Map_IsTileFogged(houseID, packed);
+}
+
+/**
+ * Whether the tile was visible to the house at its last update.  Views
+ * are worked out from this rather than from the fog, so that they only
+ * change when the tile is marked.
+ */
+static bool
+Server_IsTileInView(enum HouseType houseID, uint16 packed)
+{
+	return Server_IsDirty(s_tileVisible[houseID], packed);
+}
+
+static bool
+Server_IsFootprintVisible(enum HouseType houseID, uint8 type, tile32 position)
+{
+	const StructureInfo *si = &g_table_structureInfo[type];
+	const uint16 *layoutTile = g_table_structure_layoutTiles[si->layout];
+	const uint16 packed = Tile_PackTile(position);
+
+	for (int i = 0; i < g_table_structure_layoutTileCount[si->layout]; i++) {
+		const uint16 p = packed + layoutTile[i];
+
+		if (p < MAP_SIZE_MAX * MAP_SIZE_MAX && Server_IsTileInView(houseID, p))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Structures stay on the client under fog as they were last seen, and
+ * are cleared when the house sees that they are gone.
+ */
+static enum ServerView
+Server_GetStructureView(enum HouseType houseID, int i)
+{
+	const Structure *s = Structure_Get_ByIndex(i);
+	const Object *o = &s->o;
+	const StructureDelta *copy = &s_structureCopy[houseID][i];
+
+	if (o->flags.s.used
+			&& (Structure_SharesPoolElement(o->type) || House_AreAllied(o->houseID, houseID)))
+		return SERVER_VIEW_VISIBLE;
+
+	if (Server_IsFootprintVisible(houseID, o->type, o->position))
+		return SERVER_VIEW_VISIBLE;
+
+	if (copy->flags.s.used && Server_IsFootprintVisible(houseID, copy->type, copy->position))
+		return SERVER_VIEW_CLEARED;
+
+	return SERVER_VIEW_HIDDEN;
+}
+
+/**
+ * Units out of view are cleared, rather than left where they were last
+ * seen.
+ */
+static enum ServerView
+Server_GetUnitView(enum HouseType houseID, int i)
+{
+	const Unit *u = Unit_Get_ByIndex(i);
+	const Object *o = &u->o;
+
+	if (!o->flags.s.used)
+		return SERVER_VIEW_CLEARED;
+
+	if (House_AreAllied(o->houseID, houseID)
+			|| (u->deviated != 0 && u->deviatedHouse == houseID))
+		return SERVER_VIEW_VISIBLE;
+
+	if (o->flags.s.isNotOnMap)
+		return SERVER_VIEW_CLEARED;
+
+	return Server_IsTileInView(houseID, Tile_PackTile(o->position))
+		? SERVER_VIEW_VISIBLE : SERVER_VIEW_CLEARED;
+}
+
+/**
+ * Mark the structures and units which may be on the tile dirty for the
+ * house, now that it came to see the tile or lost sight of it.
+ */
+static void
+Server_MarkTileObjectsDirty(enum HouseType houseID, uint16 packed)
+{
+	const tile32 position = Tile_Center(Tile_UnpackTile(packed));
+	ObjectGridFindStruct find;
+
+	for (const Unit *u = ObjectGrid_FindFirstUnit(&find, position, 0x80);
+			u != NULL;
+			u = ObjectGrid_FindNextUnit(&find)) {
+		if (Tile_PackTile(u->o.position) == packed)
+			Server_SetDirty(s_unitDirty[houseID], u->o.index);
+	}
+
+	/* Structures are found by their top-left tile, and are at most
+	 * three tiles across.
+	 */
+	for (const Structure *s = ObjectGrid_FindFirstStructure(&find, position, 0x300);
+			s != NULL;
+			s = ObjectGrid_FindNextStructure(&find)) {
+		Server_SetDirty(s_structureDirty[houseID], s->o.index);
+	}
+}
+
+/**
+ * Put the tile on the house's timer wheel at its fog timeout, unless it
+ * is held in view or already on the wheel.  If the timeout was extended
+ * in the meantime, the tile is simply looked at again and put back.
+ */
+static void
+Server_ScheduleFogExpiry(enum HouseType houseID, uint16 packed)
+{
+	uint16 *timer = &s_fogTimer[houseID][packed];
+
+	if (*timer != TIMERWHEEL_NONE)
+		return;
+
+	if (g_mapFogOfWar.timeout[houseID][packed] == FOGOFWAR_TIMEOUT_HELD)
+		return;
+
+	*timer = TimerWheel_Add(&s_fogWheel[houseID],
+			Map_GetTileTimeout(houseID, packed), packed);
+}
+
+/**
+ * Work out which tiles the house came to see or lost sight of since its
+ * last update, from the tiles whose fog changed and those whose fog
+ * timeout passed.  Those tiles, and the objects on them, are marked
+ * dirty for the house.
+ */
+static void
+Server_UpdateVision(enum HouseType houseID)
+{
+	const int end = MAP_SIZE_MAX * MAP_SIZE_MAX;
+	TimerWheel *wheel = &s_fogWheel[houseID];
+	uint32 *dirty = s_visionDirty[houseID];
+	bool cameIntoView = false;
+	uint16 timer;
+
+	TimerWheel_Advance(wheel, g_timerGame);
+
+	while ((timer = TimerWheel_PopDue(wheel)) != TIMERWHEEL_NONE) {
+		const uint16 packed = TimerWheel_GetNode(wheel, timer)->index;
+
+		TimerWheel_Remove(wheel, timer);
+		s_fogTimer[houseID][packed] = TIMERWHEEL_NONE;
+		Server_SetDirty(dirty, packed);
+	}
+
+	for (int packed = Server_NextDirty(dirty, 0, end);
+			packed < end;
+			packed = Server_NextDirty(dirty, packed + 1, end)) {
+		const bool visible = Server_IsTileVisible(houseID, packed);
+
+		Server_ClearDirty(dirty, packed);
+
+		if (visible && enhancement_fog_of_war)
+			Server_ScheduleFogExpiry(houseID, packed);
+
+		if (visible == Server_IsTileInView(houseID, packed))
+			continue;
+
+		if (visible) {
+			Server_SetDirty(s_tileVisible[houseID], packed);
+			cameIntoView = true;
+		} else {
+			Server_ClearDirty(s_tileVisible[houseID], packed);
+		}
+
+		Server_SetDirty(s_tileDirty[houseID], packed);
+		Server_MarkTileObjectsDirty(houseID, packed);
+	}
+
+	if (!cameIntoView)
+		return;
+
+	for (int i = 0; i < (int)lengthof(s_structureStale[houseID]); i++) {
+		s_structureDirty[houseID][i] |= s_structureStale[houseID][i];
+	}
+}
+
+/**
+ * Recompute how the house sees the structure, now that it is dirty.
+ */
+static void
+Server_UpdateStructureView(enum HouseType houseID, int i)
+{
+	const enum ServerView view = Server_GetStructureView(houseID, i);
+	const Object *o = &Structure_Get_ByIndex(i)->o;
+	const StructureDelta *copy = &s_structureCopy[houseID][i];
+
+	s_structureView[houseID][i] = view;
+
+	if (view == SERVER_VIEW_HIDDEN && copy->flags.s.used
+			&& (!o->flags.s.used || copy->type != o->type
+				|| copy->position.x != o->position.x || copy->position.y != o->position.y)) {
+		Server_SetDirty(s_structureStale[houseID], i);
+	} else {
+		Server_ClearDirty(s_structureStale[houseID], i);
+	}
+}
+
+static void
+Server_GetTileDelta(enum HouseType houseID, uint16 packed, bool visible, Tile *d)
+{
+	if (visible) {
+		*d = g_map[packed];
+		d->hasAnimation = 0;
+		d->hasExplosion = 0;
+	} else {
+		/* As the house last saw it, without the units. */
+		*d = s_mapCopy[houseID][packed];
+		d->hasUnit = 0;
+
+		if (!d->hasStructure)
+			d->index = 0;
+	}
+}
+
 static void
 Server_InitStructureDelta(const Structure *s, StructureDelta *d)
 {
@@ -203,6 +547,87 @@ Server_InitUnitDelta(const Unit *u, UnitDelta *d)
 	d->showMoveIndicator  	= u->showMoveIndicator;
 }
 
+/**
+ * The structure as the house should see it.  Clearing only touches the
+ * flags, so nothing else about an unseen structure is sent.
+ */
+static void
+Server_GetStructureDelta(enum HouseType houseID, int i, enum ServerView view,
+		StructureDelta *d)
+{
+	if (view == SERVER_VIEW_VISIBLE) {
+		Server_InitStructureDelta(Structure_Get_ByIndex(i), d);
+	} else {
+		memcpy(d, &s_structureCopy[houseID][i], sizeof(StructureDelta));
+
+		if (view == SERVER_VIEW_CLEARED)
+			d->flags.all = 0;
+	}
+}
+
+static void
+Server_GetUnitDelta(enum HouseType houseID, int i, enum ServerView view,
+		UnitDelta *d)
+{
+	if (view == SERVER_VIEW_VISIBLE) {
+		Server_InitUnitDelta(Unit_Get_ByIndex(i), d);
+	} else {
+		memcpy(d, &s_unitCopy[houseID][i], sizeof(UnitDelta));
+		d->flags.all = 0;
+	}
+}
+
+#ifdef SERVER_VERIFY_DIRTY
+/* The verifiers work the views out afresh, so that a missed change in
+ * what the house can see fails as well.
+ */
+static void
+Server_VerifyLandscape(enum HouseType houseID, int end)
+{
+	for (int packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
+		assert(Server_IsTileInView(houseID, packed) == Server_IsTileVisible(houseID, packed));
+	}
+
+	for (int packed = 65; packed < end; packed++) {
+		Tile d;
+
+		if (Server_IsDirty(s_tileDirty[houseID], packed))
+			continue;
+
+		Server_GetTileDelta(houseID, packed, Server_IsTileVisible(houseID, packed), &d);
+		assert(memcmp(&s_mapCopy[houseID][packed], &d, sizeof(Tile)) == 0);
+	}
+}
+
+static void
+Server_VerifyStructures(enum HouseType houseID, int end)
+{
+	for (int i = 0; i < end; i++) {
+		StructureDelta d;
+
+		if (Server_IsDirty(s_structureDirty[houseID], i))
+			continue;
+
+		Server_GetStructureDelta(houseID, i, Server_GetStructureView(houseID, i), &d);
+		assert(memcmp(&s_structureCopy[houseID][i], &d, sizeof(StructureDelta)) == 0);
+	}
+}
+
+static void
+Server_VerifyUnits(enum HouseType houseID, int end)
+{
+	for (int i = 0; i < end; i++) {
+		UnitDelta d;
+
+		if (Server_IsDirty(s_unitDirty[houseID], i))
+			continue;
+
+		Server_GetUnitDelta(houseID, i, Server_GetUnitView(houseID, i), &d);
+		assert(memcmp(&s_unitCopy[houseID][i], &d, sizeof(UnitDelta)) == 0);
+	}
+}
+#endif
+
 void
 Server_ResetCache(void)
 {
@@ -216,15 +641,66 @@ Server_ResetCache(void)
 	memset(s_mapCopy, 0, sizeof(s_mapCopy));
 	memset(s_structureCopy, 0, sizeof(s_structureCopy));
 	memset(s_unitCopy, 0, sizeof(s_unitCopy));
+	memset(s_structureView, SERVER_VIEW_HIDDEN, sizeof(s_structureView));
+	memset(s_unitView, SERVER_VIEW_HIDDEN, sizeof(s_unitView));
+	memset(s_tileDirty, 0xFF, sizeof(s_tileDirty));
+	memset(s_structureDirty, 0xFF, sizeof(s_structureDirty));
+	memset(s_unitDirty, 0xFF, sizeof(s_unitDirty));
+	memset(s_tileVisible, 0, sizeof(s_tileVisible));
+	memset(s_visionDirty, 0xFF, sizeof(s_visionDirty));
+	memset(s_fogTimer, 0xFF, sizeof(s_fogTimer));
+	memset(s_structureStale, 0, sizeof(s_structureStale));
+	memset(s_snapshotSeq, 0, sizeof(s_snapshotSeq));
+	memset(s_snapshotAck, 0, sizeof(s_snapshotAck));
+	memset(s_structureChanged, 0, sizeof(s_structureChanged));
+	memset(s_unitChanged, 0, sizeof(s_unitChanged));
+	memset(s_explosionLastCount, 0, sizeof(s_explosionLastCount));
 	s_choamLastUpdate = 0;
-	s_explosionLastCount = 0;
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		const enum NetProtocol protocol = Server_GetClientProtocol(h);
+
+		TimerWheel_Init(&s_fogWheel[h], g_timerGame);
+
+		s_sendDeltas[h] = (protocol >= NET_PROTOCOL_DELTA);
+		s_sendSnapshots[h] = (protocol >= NET_PROTOCOL_SNAPSHOT);
+
+		if (!s_sendSnapshots[h]) {
+			free(s_snapshot[h]);
+			s_snapshot[h] = NULL;
+			continue;
+		}
+
+		/* Kept from the last game; only the seqs need clearing. */
+		if (s_snapshot[h] == NULL) {
+			s_snapshot[h] = calloc(NET_SNAPSHOT_HISTORY, sizeof(Snapshot));
+
+			/* Fall back to sending deltas. */
+			if (s_snapshot[h] == NULL) {
+				s_sendSnapshots[h] = false;
+				continue;
+			}
+		}
+
+		for (int i = 0; i < NET_SNAPSHOT_HISTORY; i++) {
+			s_snapshot[h][i].seq = 0;
+		}
+	}
 }
 
 /*--------------------------------------------------------------*/
 
+/**
+ * Send the tiles the house can see which changed, and strip the units
+ * from those it lost sight of.  This is the first update sent to the
+ * house each tick, so it brings the house's view up to date for the
+ * others.
+ */
 void
-Server_Send_UpdateLandscape(unsigned char **buf)
+Server_Send_UpdateLandscape(enum HouseType houseID, unsigned char **buf)
 {
+	Server_UpdateVision(houseID);
+
 	const size_t header_len  = 1 + 2;
 	const size_t element_len = 2 + sizeof(Tile);
 	const int max = Server_MaxElementsToEncode(buf, header_len, element_len);
@@ -234,20 +710,27 @@ Server_Send_UpdateLandscape(unsigned char **buf)
 
 	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_LANDSCAPE);
 
+	const int end = MAP_SIZE_MAX * MAP_SIZE_MAX - 65;
+	uint32 *dirty = s_tileDirty[houseID];
+	Tile *copy = s_mapCopy[houseID];
 	unsigned char *buf_count = *buf; (*buf) += 2;
 	uint16 count = 0;
 
-	for (uint16 packed = 65;
-			packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65 && count < max;
-			packed++) {
-		Tile d = g_map[packed];
-		d.hasAnimation = 0;
-		d.hasExplosion = 0;
+#ifdef SERVER_VERIFY_DIRTY
+	Server_VerifyLandscape(houseID, end);
+#endif
+
+	for (int packed = Server_NextDirty(dirty, 65, end);
+			packed < end && count < max;
+			packed = Server_NextDirty(dirty, packed + 1, end)) {
+		Tile d;
 
-		if (memcmp(&s_mapCopy[packed], &d, sizeof(Tile)) == 0)
+		Server_GetTileDelta(houseID, packed, Server_IsTileInView(houseID, packed), &d);
+		Server_ClearDirty(dirty, packed);
+		if (memcmp(&copy[packed], &d, sizeof(Tile)) == 0)
 			continue;
 
-		s_mapCopy[packed] = d;
+		copy[packed] = d;
 
 		Net_Encode_uint16(buf, packed);
 		memcpy(*buf, &d, sizeof(Tile));
@@ -278,21 +761,31 @@ Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf)
 	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_FOG_OF_WAR);
 
 	unsigned char *buf_count = *buf; (*buf) += 2;
+	uint8 *cause = g_mapFogOfWar.cause[houseID];
 	uint16 count = 0;
 
 	for (uint16 packed = 65;
 			packed < MAP_SIZE_MAX * MAP_SIZE_MAX - 65 && count < max;
 			packed++) {
-		FogOfWarTile *f = &g_mapVisible[packed];
+		/* Skip eight unchanged tiles at a time. */
+		if ((packed % 8) == 0 && packed + 8 <= MAP_SIZE_MAX * MAP_SIZE_MAX - 65) {
+			uint64_t word;
 
-		if (f->cause[houseID] == UNVEILCAUSE_UNCHANGED)
+			memcpy(&word, &cause[packed], sizeof(word));
+			if (word == 0) {
+				packed += 7;
+				continue;
+			}
+		}
+
+		if (cause[packed] == UNVEILCAUSE_UNCHANGED)
 			continue;
 
-		if (f->cause[houseID] < UNVEILCAUSE_STRUCTURE_VISION) {
+		if (cause[packed] < UNVEILCAUSE_STRUCTURE_VISION) {
 			uint16 encoded = packed;
 
 			/* Short unveil. */
-			if (f->cause[houseID] == UNVEILCAUSE_EXPLOSION)
+			if (cause[packed] == UNVEILCAUSE_EXPLOSION)
 				encoded |= 0x8000;
 
 			Net_Encode_uint16(buf, encoded);
@@ -300,7 +793,7 @@ Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf)
 			count++;
 		}
 
-		f->cause[houseID] = UNVEILCAUSE_UNCHANGED;
+		cause[packed] = UNVEILCAUSE_UNCHANGED;
 	}
 
 	SERVER_LOG("unveiled tiles=%d, %lu bytes",
@@ -309,17 +802,9 @@ Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf)
 	Net_Encode_uint16(&buf_count, count);
 }
 
-void
-Server_Send_UpdateHouse(enum HouseType houseID, unsigned char **buf)
+static void
+Server_Encode_House(unsigned char **buf, const House *h)
 {
-	const size_t len = 1 + 23 + (UNIT_MCV - UNIT_CARRYALL + 1) * 1;
-	if (!Server_CanEncodeFixedWidthBuffer(buf, len))
-		return;
-
-	const House *h = House_Get_ByIndex(houseID);
-
-	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_HOUSE);
-
 	/* 23 bytes. */
 	Net_Encode_uint32(buf, h->structuresBuilt);     /* XXX - client. */
 	Net_Encode_uint16(buf, h->credits);
@@ -338,6 +823,17 @@ Server_Send_UpdateHouse(enum HouseType houseID, unsigned char **buf)
 	}
 }
 
+void
+Server_Send_UpdateHouse(enum HouseType houseID, unsigned char **buf)
+{
+	const size_t len = 1 + 23 + (UNIT_MCV - UNIT_CARRYALL + 1) * 1;
+	if (!Server_CanEncodeFixedWidthBuffer(buf, len))
+		return;
+
+	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_HOUSE);
+	Server_Encode_House(buf, House_Get_ByIndex(houseID));
+}
+
 void
 Server_Send_UpdateCHOAM(unsigned char **buf)
 {
@@ -360,58 +856,120 @@ Server_Send_UpdateCHOAM(unsigned char **buf)
 	s_choamLastUpdate = g_tickHouseStarportRecalculatePrices;
 }
 
+static void
+Server_Encode_StructureFull(unsigned char **buf, const StructureDelta *d)
+{
+	/* 13 bytes. */
+	Net_Encode_uint8 (buf, d->type);
+	Net_Encode_uint8 (buf, d->linkedID);
+	Net_Encode_uint32(buf, d->flags.all);
+	Net_Encode_uint8 (buf, d->houseID);
+	Net_Encode_uint16(buf, d->position.x);
+	Net_Encode_uint16(buf, d->position.y);
+	Net_Encode_uint16(buf, d->hitpoints);
+
+	/* 10 bytes. */
+	Net_Encode_uint8 (buf, d->creatorHouse);
+	Net_Encode_uint16(buf, d->rotationSprite);
+	Net_Encode_uint8 (buf, d->objectType);
+	Net_Encode_uint8 (buf, d->upgradeLevel);
+	Net_Encode_uint8 (buf, d->upgradeTime);
+	Net_Encode_uint16(buf, d->countDown);
+	Net_Encode_uint16(buf, d->rallyPoint);
+
+	/* 32 bytes */
+	for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
+		Net_Encode_uint8(buf, d->buildQueueCount[objectType]);
+	}
+}
+
+/**
+ * Recompute how the house sees the dirty structures.  Those it came to
+ * see or lost sight of were marked by Server_UpdateVision.
+ */
+static void
+Server_PrepareStructures(enum HouseType houseID, int end)
+{
+	const uint32 *dirty = s_structureDirty[houseID];
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end;
+			i = Server_NextDirty(dirty, i + 1, end)) {
+		Server_UpdateStructureView(houseID, i);
+	}
+
+#ifdef SERVER_VERIFY_DIRTY
+	Server_VerifyStructures(houseID, end);
+#endif
+}
+
+static void
+Server_PrepareUnits(enum HouseType houseID, int end)
+{
+	const uint32 *dirty = s_unitDirty[houseID];
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end;
+			i = Server_NextDirty(dirty, i + 1, end)) {
+		s_unitView[houseID][i] = Server_GetUnitView(houseID, i);
+	}
+
+#ifdef SERVER_VERIFY_DIRTY
+	Server_VerifyUnits(houseID, end);
+#endif
+}
+
 void
-Server_Send_UpdateStructures(unsigned char **buf)
+Server_Send_UpdateStructures(enum HouseType houseID, unsigned char **buf)
 {
+	const bool sendDeltas = s_sendDeltas[houseID];
+	StructureDelta *copy = s_structureCopy[houseID];
+	uint32 *dirty = s_structureDirty[houseID];
 	const size_t header_len  = 1 + 1;
-	const size_t element_len = 2 + 13 + 10 + OBJECTTYPE_MAX;
-	const int max = Server_MaxElementsToEncode(buf, header_len, element_len);
+	const size_t element_len = sendDeltas
+		? 2 + MAX_STRUCTURE_DELTA_LEN : 2 + 13 + 10 + OBJECTTYPE_MAX;
+	int max = Server_MaxElementsToEncode(buf, header_len, element_len);
 
 	if (max <= 0)
 		return;
 
-	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_STRUCTURES);
+	/* Delta records are usually much shorter than the worst case, so
+	 * check the space left before each one instead.
+	 */
+	if (sendDeltas)
+		max = 0xFF;
+
+	Net_Encode_ServerClientMsg(buf,
+			sendDeltas ? SCMSG_UPDATE_STRUCTURES_DELTA : SCMSG_UPDATE_STRUCTURES);
 
+	const int end = StructurePool_GetIndex(STRUCTURE_INDEX_MAX_HARD);
 	unsigned char *buf_count = *buf; (*buf) += 1;
 	uint8 count = 0;
 
-	for (int i = 0;
-			i < StructurePool_GetIndex(STRUCTURE_INDEX_MAX_HARD) && count < max;
-			i++) {
-		const Structure *s = Structure_Get_ByIndex(i);
+	Server_PrepareStructures(houseID, end);
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end && count < max;
+			i = Server_NextDirty(dirty, i + 1, end)) {
 		StructureDelta d;
 
-		Server_InitStructureDelta(s, &d);
-		if (memcmp(&s_structureCopy[i], &d, sizeof(StructureDelta)) == 0)
+		if (sendDeltas && !Server_CanEncodeFixedWidthBuffer(buf, element_len))
+			break;
+
+		Server_GetStructureDelta(houseID, i, s_structureView[houseID][i], &d);
+		Server_ClearDirty(dirty, i);
+		if (memcmp(&copy[i], &d, sizeof(StructureDelta)) == 0)
 			continue;
 
-		memcpy(&s_structureCopy[i], &d, sizeof(StructureDelta));
-
-		Net_Encode_ObjectIndex(buf, &s->o);
-
-		/* 13 bytes. */
-		Net_Encode_uint8 (buf, d.type);
-		Net_Encode_uint8 (buf, d.linkedID);
-		Net_Encode_uint32(buf, d.flags.all);
-		Net_Encode_uint8 (buf, d.houseID);
-		Net_Encode_uint16(buf, d.position.x);
-		Net_Encode_uint16(buf, d.position.y);
-		Net_Encode_uint16(buf, d.hitpoints);
-
-		/* 10 bytes. */
-		Net_Encode_uint8 (buf, d.creatorHouse);
-		Net_Encode_uint16(buf, d.rotationSprite);
-		Net_Encode_uint8 (buf, d.objectType);
-		Net_Encode_uint8 (buf, d.upgradeLevel);
-		Net_Encode_uint8 (buf, d.upgradeTime);
-		Net_Encode_uint16(buf, d.countDown);
-		Net_Encode_uint16(buf, d.rallyPoint);
-
-		/* 32 bytes */
-		for (uint16 objectType = 0; objectType < OBJECTTYPE_MAX; objectType++) {
-			Net_Encode_uint8(buf, d.buildQueueCount[objectType]);
+		Net_Encode_ObjectIndex(buf, &Structure_Get_ByIndex(i)->o);
+
+		if (sendDeltas) {
+			Net_Encode_StructureDelta(buf, &copy[i], &d);
+		} else {
+			Server_Encode_StructureFull(buf, &d);
 		}
 
+		memcpy(&copy[i], &d, sizeof(StructureDelta));
 		count++;
 	}
 
@@ -421,58 +979,81 @@ Server_Send_UpdateStructures(unsigned char **buf)
 	Net_Encode_uint8(&buf_count, count);
 }
 
+static void
+Server_Encode_UnitFull(unsigned char **buf, const UnitDelta *d)
+{
+	/* 12 bytes. */
+	Net_Encode_uint8 (buf, d->type);
+	Net_Encode_uint32(buf, d->flags.all);
+	Net_Encode_uint8 (buf, d->houseID);
+	Net_Encode_uint16(buf, d->position.x);
+	Net_Encode_uint16(buf, d->position.y);
+	Net_Encode_uint16(buf, d->hitpoints);
+
+	/* 10 bytes. */
+	Net_Encode_uint8 (buf, d->actionID);
+	Net_Encode_uint8 (buf, d->nextActionID);
+	Net_Encode_uint8 (buf, d->amount);
+	Net_Encode_uint8 (buf, d->deviated);
+	Net_Encode_uint8 (buf, d->deviatedHouse);
+	Net_Encode_uint8 (buf, d->orientation0_current);
+	Net_Encode_uint8 (buf, d->orientation1_current);
+	Net_Encode_uint8 (buf, d->wobbleIndex);
+	Net_Encode_uint8 (buf, d->spriteOffset);
+	Net_Encode_uint8 (buf, d->blinkHouse);
+	Net_Encode_uint16(buf, d->targetAttack);
+	Net_Encode_uint16(buf, d->targetMove);
+	Net_Encode_uint8 (buf, d->showMoveIndicator);
+}
+
 void
-Server_Send_UpdateUnits(unsigned char **buf)
+Server_Send_UpdateUnits(enum HouseType houseID, unsigned char **buf)
 {
+	const bool sendDeltas = s_sendDeltas[houseID];
+	UnitDelta *copy = s_unitCopy[houseID];
+	uint32 *dirty = s_unitDirty[houseID];
 	const size_t header_len  = 1 + 1;
-	const size_t element_len = 2 + 12 + 10;
-	const int max = Server_MaxElementsToEncode(buf, header_len, element_len);
+	const size_t element_len = sendDeltas
+		? 2 + MAX_UNIT_DELTA_LEN : 2 + 12 + 10;
+	int max = Server_MaxElementsToEncode(buf, header_len, element_len);
 
 	if (max <= 0)
 		return;
 
-	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_UNITS);
+	if (sendDeltas)
+		max = 0xFF;
+
+	Net_Encode_ServerClientMsg(buf,
+			sendDeltas ? SCMSG_UPDATE_UNITS_DELTA : SCMSG_UPDATE_UNITS);
 
+	const int end = UnitPool_GetMaxIndex();
 	unsigned char *buf_count = *buf; (*buf) += 1;
 	uint8 count = 0;
 
-	for (int i = 0;
-			i < UnitPool_GetMaxIndex() && count < max;
-			i++) {
-		const Unit *u = Unit_Get_ByIndex(i);
+	Server_PrepareUnits(houseID, end);
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end && count < max;
+			i = Server_NextDirty(dirty, i + 1, end)) {
 		UnitDelta d;
 
-		Server_InitUnitDelta(u, &d);
-		if (memcmp(&s_unitCopy[i], &d, sizeof(UnitDelta)) == 0)
+		if (sendDeltas && !Server_CanEncodeFixedWidthBuffer(buf, element_len))
+			break;
+
+		Server_GetUnitDelta(houseID, i, s_unitView[houseID][i], &d);
+		Server_ClearDirty(dirty, i);
+		if (memcmp(&copy[i], &d, sizeof(UnitDelta)) == 0)
 			continue;
 
-		memcpy(&s_unitCopy[i], &d, sizeof(UnitDelta));
-
-		Net_Encode_ObjectIndex(buf, &u->o);
-
-		/* 12 bytes. */
-		Net_Encode_uint8 (buf, d.type);
-		Net_Encode_uint32(buf, d.flags.all);
-		Net_Encode_uint8 (buf, d.houseID);
-		Net_Encode_uint16(buf, d.position.x);
-		Net_Encode_uint16(buf, d.position.y);
-		Net_Encode_uint16(buf, d.hitpoints);
-
-		/* 10 bytes. */
-		Net_Encode_uint8 (buf, d.actionID);
-		Net_Encode_uint8 (buf, d.nextActionID);
-		Net_Encode_uint8 (buf, d.amount);
-		Net_Encode_uint8 (buf, d.deviated);
-		Net_Encode_uint8 (buf, d.deviatedHouse);
-		Net_Encode_uint8 (buf, d.orientation0_current);
-		Net_Encode_uint8 (buf, d.orientation1_current);
-		Net_Encode_uint8 (buf, d.wobbleIndex);
-		Net_Encode_uint8 (buf, d.spriteOffset);
-		Net_Encode_uint8 (buf, d.blinkHouse);
-		Net_Encode_uint16(buf, d.targetAttack);
-		Net_Encode_uint16(buf, d.targetMove);
-		Net_Encode_uint8 (buf, d.showMoveIndicator);
+		Net_Encode_ObjectIndex(buf, &Unit_Get_ByIndex(i)->o);
+
+		if (sendDeltas) {
+			Net_Encode_UnitDelta(buf, &copy[i], &d);
+		} else {
+			Server_Encode_UnitFull(buf, &d);
+		}
 
+		memcpy(&copy[i], &d, sizeof(UnitDelta));
 		count++;
 	}
 
@@ -482,11 +1063,190 @@ Server_Send_UpdateUnits(unsigned char **buf)
 	Net_Encode_uint8(&buf_count, count);
 }
 
+/*--------------------------------------------------------------*/
+
+assert_compile(4 + 4 + 23 + (UNIT_MCV - UNIT_CARRYALL + 1)
+		+ 2 + (STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT) * (2 + MAX_STRUCTURE_DELTA_LEN)
+		+ 2 + UNIT_INDEX_MAX_RAISED * (2 + MAX_UNIT_DELTA_LEN)
+		<= MAX_SERVER_SNAPSHOT_LEN);
+
+/**
+ * Bring the house's copies up to date, recording the seq of the
+ * snapshot in which each one changed.
+ */
+static void
+Server_Snapshot_UpdateStructures(enum HouseType houseID, int end, uint32 seq)
+{
+	StructureDelta *copy = s_structureCopy[houseID];
+	uint32 *dirty = s_structureDirty[houseID];
+
+	Server_PrepareStructures(houseID, end);
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end;
+			i = Server_NextDirty(dirty, i + 1, end)) {
+		StructureDelta d;
+
+		Server_GetStructureDelta(houseID, i, s_structureView[houseID][i], &d);
+		Server_ClearDirty(dirty, i);
+		if (memcmp(&copy[i], &d, sizeof(StructureDelta)) == 0)
+			continue;
+
+		memcpy(&copy[i], &d, sizeof(StructureDelta));
+		s_structureChanged[houseID][i] = seq;
+	}
+}
+
+static void
+Server_Snapshot_UpdateUnits(enum HouseType houseID, int end, uint32 seq)
+{
+	UnitDelta *copy = s_unitCopy[houseID];
+	uint32 *dirty = s_unitDirty[houseID];
+
+	Server_PrepareUnits(houseID, end);
+
+	for (int i = Server_NextDirty(dirty, 0, end);
+			i < end;
+			i = Server_NextDirty(dirty, i + 1, end)) {
+		UnitDelta d;
+
+		Server_GetUnitDelta(houseID, i, s_unitView[houseID][i], &d);
+		Server_ClearDirty(dirty, i);
+		if (memcmp(&copy[i], &d, sizeof(UnitDelta)) == 0)
+			continue;
+
+		memcpy(&copy[i], &d, sizeof(UnitDelta));
+		s_unitChanged[houseID][i] = seq;
+	}
+}
+
+/**
+ * Encode the next snapshot for the house into g_server_snapshot_buf,
+ * as the difference from the latest snapshot it acknowledged.  Without
+ * a usable baseline, the difference is taken from nothing.
+ *
+ * At most NET_SNAPSHOT_BUDGET bytes are encoded.  Records left out keep
+ * their baseline in the stored snapshot, as that is what the client
+ * will have, and count as changed after it so they go out next.
+ *
+ * @return False if the house's client does not take snapshots, in
+ *         which case its structures, units and house are sent with the
+ *         other updates.
+ */
+bool
+Server_Send_Snapshot(enum HouseType houseID, unsigned char **buf)
+{
+	static const StructureDelta noStructure;
+	static const UnitDelta noUnit;
+
+	if (!s_sendSnapshots[houseID])
+		return false;
+
+	const uint32 seq = ++s_snapshotSeq[houseID];
+	const uint32 ack = s_snapshotAck[houseID];
+	const Snapshot *baseline = &s_snapshot[houseID][ack % NET_SNAPSHOT_HISTORY];
+	Snapshot *snapshot = &s_snapshot[houseID][seq % NET_SNAPSHOT_HISTORY];
+
+	if (ack == 0 || seq - ack >= NET_SNAPSHOT_HISTORY || baseline->seq != ack)
+		baseline = NULL;
+
+	const uint32 baselineSeq = (baseline != NULL) ? ack : 0;
+	const int structureEnd = StructurePool_GetIndex(STRUCTURE_INDEX_MAX_HARD);
+	const int unitEnd = UnitPool_GetMaxIndex();
+
+	Server_Snapshot_UpdateStructures(houseID, structureEnd, seq);
+	Server_Snapshot_UpdateUnits(houseID, unitEnd, seq);
+
+	snapshot->seq = seq;
+	memcpy(snapshot->structure, s_structureCopy[houseID], sizeof(snapshot->structure));
+	memcpy(snapshot->unit, s_unitCopy[houseID], sizeof(snapshot->unit));
+
+	const unsigned char * const budget_end = *buf + NET_SNAPSHOT_BUDGET;
+
+	Net_Encode_uint32(buf, seq);
+	Net_Encode_uint32(buf, baselineSeq);
+	Server_Encode_House(buf, House_Get_ByIndex(houseID));
+
+	unsigned char *buf_count = *buf; (*buf) += 2;
+	uint16 count = 0;
+
+	for (int i = 0; i < structureEnd; i++) {
+		const StructureDelta *prev = (baseline != NULL) ? &baseline->structure[i] : &noStructure;
+
+		if (s_structureChanged[houseID][i] <= baselineSeq)
+			continue;
+
+		if (memcmp(prev, &snapshot->structure[i], sizeof(StructureDelta)) == 0)
+			continue;
+
+		/* Leave room for the unit count. */
+		if (*buf + 2 + MAX_STRUCTURE_DELTA_LEN + 2 > budget_end) {
+			snapshot->structure[i] = *prev;
+			s_structureChanged[houseID][i] = seq + 1;
+			continue;
+		}
+
+		Net_Encode_ObjectIndex(buf, &Structure_Get_ByIndex(i)->o);
+		Net_Encode_StructureDelta(buf, prev, &snapshot->structure[i]);
+		count++;
+	}
+
+	Net_Encode_uint16(&buf_count, count);
+
+	buf_count = *buf; (*buf) += 2;
+	count = 0;
+
+	for (int i = 0; i < unitEnd; i++) {
+		const UnitDelta *prev = (baseline != NULL) ? &baseline->unit[i] : &noUnit;
+
+		if (s_unitChanged[houseID][i] <= baselineSeq)
+			continue;
+
+		if (memcmp(prev, &snapshot->unit[i], sizeof(UnitDelta)) == 0)
+			continue;
+
+		if (*buf + 2 + MAX_UNIT_DELTA_LEN > budget_end) {
+			snapshot->unit[i] = *prev;
+			s_unitChanged[houseID][i] = seq + 1;
+			continue;
+		}
+
+		Net_Encode_ObjectIndex(buf, &Unit_Get_ByIndex(i)->o);
+		Net_Encode_UnitDelta(buf, prev, &snapshot->unit[i]);
+		count++;
+	}
+
+	Net_Encode_uint16(&buf_count, count);
+
+	SERVER_LOG("snapshot seq=%u baseline=%u, %lu bytes",
+			seq, baselineSeq, *buf - g_server_snapshot_buf);
+
+	return true;
+}
+
+/*--------------------------------------------------------------*/
+
+static bool
+Server_IsExplosionInView(enum HouseType houseID, const Explosion *e)
+{
+	return Server_IsTileInView(houseID, Tile_PackTile(e->position));
+}
+
+/**
+ * Send the explosions on tiles the house can see.
+ */
 void
-Server_Send_UpdateExplosions(unsigned char **buf)
+Server_Send_UpdateExplosions(enum HouseType houseID, unsigned char **buf)
 {
-	const int num = Explosion_Get_NumActive();
-	if (num <= 1 && num == s_explosionLastCount)
+	const int numActive = Explosion_Get_NumActive();
+	int num = 1;
+
+	for (int i = 1; i < numActive; i++) {
+		if (Server_IsExplosionInView(houseID, Explosion_Get_ByIndex(i)))
+			num++;
+	}
+
+	if (num <= 1 && num == s_explosionLastCount[houseID])
 		return;
 
 	const size_t len = 2 + (num - 1) * 7;
@@ -496,16 +1256,19 @@ Server_Send_UpdateExplosions(unsigned char **buf)
 	Net_Encode_ServerClientMsg(buf, SCMSG_UPDATE_EXPLOSIONS);
 	Net_Encode_uint8(buf, num);
 
-	for (int i = 1; i < num; i++) {
+	for (int i = 1; i < numActive; i++) {
 		const Explosion *e = Explosion_Get_ByIndex(i);
 
+		if (!Server_IsExplosionInView(houseID, e))
+			continue;
+
 		Net_Encode_uint16(buf, e->spriteID);
 		Net_Encode_uint16(buf, e->position.x);
 		Net_Encode_uint16(buf, e->position.y);
 		Net_Encode_uint8 (buf, e->houseID);
 	}
 
-	s_explosionLastCount = num;
+	s_explosionLastCount[houseID] = num;
 }
 
 static void
@@ -887,6 +1650,8 @@ Server_Recv_RepairUpgradeStructure(enum HouseType houseID, const unsigned char *
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	Server_MarkStructureDirty(s);
+
 	if (!Structure_Server_SetRepairingState(s, -1))
 		Structure_Server_SetUpgradingState(s, -1);
 }
@@ -907,6 +1672,8 @@ Server_Recv_SetRallyPoint(enum HouseType houseID, const unsigned char *buf)
 			|| !Structure_SupportsRallyPoints(s->o.type))
 		return;
 
+	Server_MarkStructureDirty(s);
+
 	if (Tile_IsOutOfMap(packed)) {
 		s->rallyPoint = 0xFFFF;
 	} else {
@@ -1039,6 +1806,8 @@ Server_Recv_PurchaseResumeItem(enum HouseType houseID, const unsigned char *buf)
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	Server_MarkStructureDirty(s);
+
 	if (s->o.type == STRUCTURE_STARPORT) {
 		Server_Recv_PurchaseItemStarport(s, objectType);
 		return;
@@ -1096,6 +1865,8 @@ Server_Recv_PauseCancelItem(enum HouseType houseID, const unsigned char *buf)
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	Server_MarkStructureDirty(s);
+
 	if (s->o.type == STRUCTURE_STARPORT) {
 		Server_Recv_CancelItemStarport(s, objectType);
 	} else if (s->objectType == objectType && s->o.linkedID != 0xFF) {
@@ -1131,6 +1902,8 @@ Server_Recv_EnterLeavePlacementMode(enum HouseType houseID, const unsigned char
 				|| !Server_PlayerCanControlStructure(houseID, s))
 			return;
 
+		Server_MarkStructureDirty(s);
+
 		if (s->countDown == 0
 				&& s->o.linkedID != STRUCTURE_INVALID
 				&& h->structureActiveID == STRUCTURE_INDEX_INVALID) {
@@ -1152,6 +1925,7 @@ Server_Recv_EnterLeavePlacementMode(enum HouseType houseID, const unsigned char
 				&& s->o.linkedID == STRUCTURE_INVALID
 				&& Server_PlayerCanControlStructure(houseID, s)) {
 			s->o.linkedID = h->structureActiveID;
+			Server_MarkStructureDirty(s);
 		} else {
 			Structure_Free(Structure_Get_ByIndex(h->structureActiveID));
 		}
@@ -1191,6 +1965,8 @@ Server_Recv_ActivateStructureAbility(enum HouseType houseID, const unsigned char
 	if (!Server_PlayerCanControlStructure(houseID, s))
 		return;
 
+	Server_MarkStructureDirty(s);
+
 	if (s->o.type == STRUCTURE_PALACE) {
 		if (s->countDown == 0)
 			Structure_Server_ActivateSpecial(s);
@@ -1318,6 +2094,7 @@ Server_Recv_IssueUnitActionTargetted(Unit *u,
 	if (target != NULL) {
 		target->blinkCounter = 8;
 		target->blinkHouse = Unit_GetHouseID(u);
+		Server_MarkUnitDirty(target);
 	}
 	else {
 		u->moveIndicatorCounter = 10;
@@ -1342,6 +2119,8 @@ Server_Recv_IssueUnitAction(enum HouseType houseID, const unsigned char *buf)
 	if (!Server_PlayerCanControlUnit(houseID, u))
 		return;
 
+	Server_MarkUnitDirty(u);
+
 	if (actionID == ACTION_CANCEL) {
 		u->deviationDecremented = false;
 	} else if (Tools_Index_GetType(encoded) == IT_NONE) {
@@ -1351,6 +2130,31 @@ Server_Recv_IssueUnitAction(enum HouseType houseID, const unsigned char *buf)
 	}
 }
 
+void
+Server_Recv_ProtocolVersion(int peerID, const unsigned char *buf)
+{
+	PeerData *data = Net_GetPeerData(peerID);
+	const uint8 protocol = Net_Decode_uint8(&buf);
+
+	if (data == NULL)
+		return;
+
+	data->protocol = min(protocol, NET_PROTOCOL_VERSION);
+}
+
+static void
+Server_Recv_SnapshotAck(enum HouseType houseID, const unsigned char *buf)
+{
+	const uint32 seq = Net_Decode_uint32(&buf);
+
+	if (houseID >= HOUSE_NEUTRAL)
+		return;
+
+	/* Acks may arrive out of order. */
+	if (seq > s_snapshotAck[houseID] && seq <= s_snapshotSeq[houseID])
+		s_snapshotAck[houseID] = seq;
+}
+
 void
 Server_Recv_PrefName(int peerID, const char *name)
 {
@@ -1541,6 +2345,14 @@ Server_ProcessMessage(int peerID, enum HouseType houseID,
 				Server_Recv_Chat(peerID, buf[0], (const char *)buf + 1);
 				break;
 
+			case CSMSG_PROTOCOL_VERSION:
+				Server_Recv_ProtocolVersion(peerID, buf);
+				break;
+
+			case CSMSG_SNAPSHOT_ACK:
+				Server_Recv_SnapshotAck(houseID, buf);
+				break;
+
 			case CSMSG_MAX:
 			case CSMSG_INVALID:
 				assert(false);
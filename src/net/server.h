@@ -5,17 +5,25 @@
 #include "types.h"
 #include "../table/sound.h"
 
+struct Structure;
+struct Unit;
+
 extern void Server_RestockStarport(enum UnitType type);
 
 extern void Server_ResetCache(void);
+extern void Server_MarkTileDirty(uint16 packed);
+extern void Server_MarkStructureDirty(const struct Structure *s);
+extern void Server_MarkUnitDirty(const struct Unit *u);
+extern void Server_MarkVisionDirty(enum HouseType houseID, uint16 packed);
 
-extern void Server_Send_UpdateLandscape(unsigned char **buf);
+extern void Server_Send_UpdateLandscape(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateFogOfWar(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateHouse(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_UpdateCHOAM(unsigned char **buf);
-extern void Server_Send_UpdateStructures(unsigned char **buf);
-extern void Server_Send_UpdateUnits(unsigned char **buf);
-extern void Server_Send_UpdateExplosions(unsigned char **buf);
+extern void Server_Send_UpdateStructures(enum HouseType houseID, unsigned char **buf);
+extern void Server_Send_UpdateUnits(enum HouseType houseID, unsigned char **buf);
+extern bool Server_Send_Snapshot(enum HouseType houseID, unsigned char **buf);
+extern void Server_Send_UpdateExplosions(enum HouseType houseID, unsigned char **buf);
 extern void Server_Send_ScreenShake(uint16 packed);
 extern void Server_Send_StatusMessage1(enum HouseFlag houses, uint8 priority, uint16 str1);
 extern void Server_Send_StatusMessage2(enum HouseFlag houses, uint8 priority, uint16 str1, uint16 str2);
@@ -31,6 +39,7 @@ extern void Server_Send_Scenario(unsigned char **buf);
 
 extern void Server_Recv_ReturnToLobby(enum HouseType houseID, bool log_message);
 extern void Server_Recv_PrefName(int peerID, const char *name);
+extern void Server_Recv_ProtocolVersion(int peerID, const unsigned char *buf);
 extern void Server_Recv_PrefHouse(int peerID, enum HouseType houseID);
 extern void Server_ProcessMessage(int peerID, enum HouseType houseID, const unsigned char *buf, int count);
 extern bool Server_ProcessCommand(const char *msg);
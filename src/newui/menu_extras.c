@@ -658,6 +658,10 @@ VideoOptions_Initialize(void)
 	si->d.checkbox = &g_gameConfig.hardwareCursor;
 	snprintf(si->text, sizeof(si->text), "Hardware mouse cursor");
 
+	si = Scrollbar_AllocItem(w, SCROLLBAR_CHECKBOX);
+	si->d.checkbox = &g_gameConfig.terrainCache;
+	snprintf(si->text, sizeof(si->text), "Cache map terrain");
+
 	GUI_Widget_Scrollbar_Init(w, ws->scrollMax, 6, 0);
 }
 
@@ -13,6 +13,7 @@
 #include "savemenu.h"
 
 #include "editbox.h"
+#include "menubar.h"
 #include "scrollbar.h"
 #include "../audio/audio.h"
 #include "../file.h"
@@ -56,6 +57,11 @@ static void
 SaveMenu_FindSavedGames(bool save, Widget *scrollbar)
 {
 	char dirname[1024];
+
+	/* A savegame still being written is not in its place yet. */
+	if (!Save_Wait())
+		GUI_DisplayModalMessage("Failed to write the last savegame.", SHAPE_INVALID);
+
 	File_MakeCompleteFilename(dirname, sizeof(dirname), SEARCHDIR_PERSONAL_DATA_DIR, "", false);
 
 	WidgetScrollbar *ws = scrollbar->data;
@@ -25,6 +25,7 @@
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
 #include "../pool/pool_unit.h"
+#include "../profiler.h"
 #include "../scenario.h"
 #include "../sprites.h"
 #include "../string.h"
@@ -1050,6 +1051,100 @@ Viewport_TileIsDebris(uint16 iconID)
 	return false;
 }
 
+/**
+ * Windtraps are tinted with a cycling palette colour, so they cannot be
+ * cached with the rest of the terrain.
+ */
+static bool
+Viewport_TileIsWindtrap(uint16 iconID)
+{
+	return (g_iconMap[g_iconMap[ICM_ICONGROUP_WINDTRAP_POWER] + 8] <= iconID && iconID <= g_iconMap[g_iconMap[ICM_ICONGROUP_WINDTRAP_POWER] + 15]);
+}
+
+static bool
+Viewport_TileIsVeiled(const FogOfWarTile *f)
+{
+	return (f->fogSpriteID == g_veiledSpriteID - 1) || (f->fogSpriteID == g_veiledSpriteID);
+}
+
+static void
+Viewport_DrawTerrainTile(uint16 packed, const FogOfWarTile *f, int left, int top)
+{
+	if (Viewport_TileIsDebris(f->groundSpriteID)) {
+		const uint16 iconID = g_mapSpriteID[packed] & ~0x8000;
+
+		Video_DrawIcon(iconID, HOUSE_HARKONNEN, left, top);
+	}
+
+	if (f->groundSpriteID)
+		Video_DrawIcon(f->groundSpriteID, f->houseID, left, top);
+
+	if (f->overlaySpriteID != 0)
+		Video_DrawIcon(f->overlaySpriteID, f->houseID, left, top);
+}
+
+static void
+Viewport_RenderTerrainChunk(int chunk)
+{
+	const int x0 = MAP_CHUNK_SIZE * (chunk % MAP_CHUNKS_PER_ROW);
+	const int y0 = MAP_CHUNK_SIZE * (chunk / MAP_CHUNKS_PER_ROW);
+
+	Video_BeginTerrainChunk(chunk);
+	Video_HoldBitmapDrawing(true);
+
+	for (int dy = 0; dy < MAP_CHUNK_SIZE; dy++) {
+		uint16 packed = Tile_PackXY(x0, y0 + dy);
+
+		for (int dx = 0; dx < MAP_CHUNK_SIZE; dx++, packed++) {
+			const FogOfWarTile *f = &g_mapVisible[packed];
+
+			if (Viewport_TileIsVeiled(f) || Viewport_TileIsWindtrap(f->groundSpriteID))
+				continue;
+
+			Viewport_DrawTerrainTile(packed, f, TILE_SIZE * dx, TILE_SIZE * dy);
+		}
+	}
+
+	Video_HoldBitmapDrawing(false);
+	Video_EndTerrainChunk();
+}
+
+/**
+ * Draw the static terrain of tiles x0 <= x < x1, y0 <= y < y1 from the
+ * cached chunks, rendering the chunks that changed first.
+ *
+ * @return False if there is no cache, in which case the terrain must
+ *         be drawn tile by tile.
+ */
+static bool
+Viewport_DrawTerrainChunks(int x0, int y0, int x1, int y1, int viewportX1, int viewportY1)
+{
+	if (!g_gameConfig.terrainCache || !Video_PrepareTerrainChunks())
+		return false;
+
+	for (int cy = y0 / MAP_CHUNK_SIZE; cy * MAP_CHUNK_SIZE < y1; cy++) {
+		for (int cx = x0 / MAP_CHUNK_SIZE; cx * MAP_CHUNK_SIZE < x1; cx++) {
+			const int chunk = MAP_CHUNKS_PER_ROW * cy + cx;
+
+			/* Region of the chunk to draw, in tiles. */
+			const int tx1 = max(x0, MAP_CHUNK_SIZE * cx);
+			const int ty1 = max(y0, MAP_CHUNK_SIZE * cy);
+			const int tx2 = min(x1, MAP_CHUNK_SIZE * (cx + 1));
+			const int ty2 = min(y1, MAP_CHUNK_SIZE * (cy + 1));
+
+			if (Map_PopVisibleChunkDirty(chunk))
+				Viewport_RenderTerrainChunk(chunk);
+
+			Video_DrawTerrainChunk(chunk,
+					TILE_SIZE * (tx1 - MAP_CHUNK_SIZE * cx), TILE_SIZE * (ty1 - MAP_CHUNK_SIZE * cy),
+					TILE_SIZE * (tx2 - tx1), TILE_SIZE * (ty2 - ty1),
+					viewportX1 + TILE_SIZE * (tx1 - x0), viewportY1 + TILE_SIZE * (ty1 - y0));
+		}
+	}
+
+	return true;
+}
+
 static void
 Viewport_DrawTilesInRange(int x0, int y0,
 		int viewportX1, int viewportY1, int viewportX2, int viewportY2,
@@ -1071,6 +1166,10 @@ Viewport_DrawTilesInRange(int x0, int y0,
 	viewportX2 = left;
 	viewportY2 = top;
 
+	/* ENHANCEMENT -- Draw the static terrain from the cached chunks. */
+	const bool cached = draw_tile
+		&& Viewport_DrawTerrainChunks(x0, y0, x, y, viewportX1, viewportY1);
+
 	Video_HoldBitmapDrawing(true);
 
 	y = y0;
@@ -1080,18 +1179,9 @@ Viewport_DrawTilesInRange(int x0, int y0,
 		const FogOfWarTile *f = &g_mapVisible[curPos];
 
 		for (left = viewportX1; left < viewportX2; left += TILE_SIZE, curPos++, t++, f++) {
-			if (draw_tile && (f->fogSpriteID != g_veiledSpriteID - 1) && (f->fogSpriteID != g_veiledSpriteID)) {
-				if (Viewport_TileIsDebris(f->groundSpriteID)) {
-					const uint16 iconID = g_mapSpriteID[curPos] & ~0x8000;
-
-					Video_DrawIcon(iconID, HOUSE_HARKONNEN, left, top);
-				}
-
-				if (f->groundSpriteID)
-					Video_DrawIcon(f->groundSpriteID, f->houseID, left, top);
-
-				if (f->overlaySpriteID != 0)
-					Video_DrawIcon(f->overlaySpriteID, f->houseID, left, top);
+			if (draw_tile && !Viewport_TileIsVeiled(f)) {
+				if (!cached || Viewport_TileIsWindtrap(f->groundSpriteID))
+					Viewport_DrawTerrainTile(curPos, f, left, top);
 
 				/* Draw the transparent fog UNDER units, which doesn't
 				 * really conceal units anyway.  This prevents it from
@@ -1138,7 +1228,9 @@ Viewport_DrawTiles(void)
 	/* ENHANCEMENT -- Draw fog over the top of units. */
 	const bool draw_fog = enhancement_fog_covers_units ? false : true;
 
+	Profiler_Begin(PROFILER_VIEWPORT_TILES);
 	Viewport_DrawTilesInRange(x0, y0, viewportX1, viewportY1, viewportX2, viewportY2, true, draw_fog);
+	Profiler_End(PROFILER_VIEWPORT_TILES);
 }
 
 void
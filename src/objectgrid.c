@@ -0,0 +1,352 @@
+/** @file src/objectgrid.c
+ *
+ * Spatial index of units and structures.
+ *
+ * The map is divided into 16x16 cells of 4x4 tiles.  Every Unit and
+ * Structure in the pools is kept in a linked list of the cell holding
+ * its position, so range searches only look at nearby objects.
+ * Objects with a position outside of the map are kept in a separate
+ * list that is included in every search.
+ *
+ * Searches return objects in no particular order, and may return
+ * objects outside of the requested distance.  Callers do the exact
+ * distance check, and break ties on the order of the pool.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "os/math.h"
+
+#include "objectgrid.h"
+
+#include "map.h"
+#include "opendune.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_unit.h"
+#include "structure.h"
+#include "unit.h"
+
+enum {
+	OBJECTGRID_CELL_SHIFT       = 10,
+	OBJECTGRID_CELLS_PER_ROW    = MAP_SIZE_MAX >> 2,
+	OBJECTGRID_CELL_MAX         = OBJECTGRID_CELLS_PER_ROW * OBJECTGRID_CELLS_PER_ROW,
+	OBJECTGRID_CELL_OUTSIDE     = OBJECTGRID_CELL_MAX,
+	OBJECTGRID_CELL_NONE        = 0xFFFF,
+
+	OBJECTGRID_INDEX_MAX        = UNIT_INDEX_MAX_RAISED,
+	OBJECTGRID_INDEX_NONE       = 0xFFFF,
+
+	OBJECTGRID_RING_ALL         = 0xFF
+};
+
+assert_compile(STRUCTURE_INDEX_MAX_HARD + STRUCTURE_INDEX_RAISED_AMOUNT <= OBJECTGRID_INDEX_MAX);
+
+typedef struct ObjectGridList {
+	uint16 head[OBJECTGRID_CELL_MAX + 1];                   /*!< First object in each cell, and outside. */
+	uint16 next[OBJECTGRID_INDEX_MAX];                      /*!< Next object in the same cell. */
+	uint16 prev[OBJECTGRID_INDEX_MAX];                      /*!< Previous object in the same cell. */
+	uint16 cell[OBJECTGRID_INDEX_MAX];                      /*!< Cell of each object, or OBJECTGRID_CELL_NONE. */
+} ObjectGridList;
+
+static ObjectGridList s_unitGrid;
+static ObjectGridList s_structureGrid;
+
+bool
+ObjectGrid_IsPositionInside(tile32 position)
+{
+	return (position.x < (MAP_SIZE_MAX << 8) && position.y < (MAP_SIZE_MAX << 8));
+}
+
+static uint16
+ObjectGrid_GetCell(tile32 position)
+{
+	if (!ObjectGrid_IsPositionInside(position)) return OBJECTGRID_CELL_OUTSIDE;
+
+	return (position.y >> OBJECTGRID_CELL_SHIFT) * OBJECTGRID_CELLS_PER_ROW + (position.x >> OBJECTGRID_CELL_SHIFT);
+}
+
+static void
+ObjectGrid_Clear(ObjectGridList *list)
+{
+	memset(list->head, 0xFF, sizeof(list->head));
+	memset(list->cell, 0xFF, sizeof(list->cell));
+}
+
+static void
+ObjectGrid_Move(ObjectGridList *list, uint16 index, uint16 cell)
+{
+	assert(index < OBJECTGRID_INDEX_MAX);
+
+	if (list->cell[index] == cell) return;
+
+	/* Unlink from the old cell. */
+	if (list->cell[index] != OBJECTGRID_CELL_NONE) {
+		const uint16 prev = list->prev[index];
+		const uint16 next = list->next[index];
+
+		if (prev != OBJECTGRID_INDEX_NONE) {
+			list->next[prev] = next;
+		} else {
+			list->head[list->cell[index]] = next;
+		}
+
+		if (next != OBJECTGRID_INDEX_NONE) list->prev[next] = prev;
+	}
+
+	list->cell[index] = cell;
+	if (cell == OBJECTGRID_CELL_NONE) return;
+
+	/* Link to the front of the new cell. */
+	list->prev[index] = OBJECTGRID_INDEX_NONE;
+	list->next[index] = list->head[cell];
+	if (list->head[cell] != OBJECTGRID_INDEX_NONE) list->prev[list->head[cell]] = index;
+	list->head[cell] = index;
+}
+
+/**
+ * Keep the Unit in the cell of its position, or remove it when it is
+ *  no longer in use.  Call after changing the position of a Unit.
+ * @param u The Unit that changed.
+ */
+void
+ObjectGrid_UpdateUnit(const Unit *u)
+{
+	const uint16 cell = u->o.flags.s.used ? ObjectGrid_GetCell(u->o.position) : OBJECTGRID_CELL_NONE;
+
+	ObjectGrid_Move(&s_unitGrid, u->o.index, cell);
+}
+
+/**
+ * Keep the Structure in the cell of its position, or remove it when it
+ *  is no longer in use.  Walls and slabs share a pool element and are
+ *  never indexed.
+ * @param s The Structure that changed.
+ */
+void
+ObjectGrid_UpdateStructure(const Structure *s)
+{
+	if (Structure_SharesPoolElement(s->o.type)) return;
+
+	const uint16 cell = s->o.flags.s.used ? ObjectGrid_GetCell(s->o.position) : OBJECTGRID_CELL_NONE;
+
+	ObjectGrid_Move(&s_structureGrid, s->o.index, cell);
+}
+
+/**
+ * Rebuild the index of units from g_unitFindArray, for when the pool
+ *  was replaced as a whole.
+ */
+void
+ObjectGrid_RebuildUnits(void)
+{
+	ObjectGrid_Clear(&s_unitGrid);
+
+	for (uint16 i = 0; i < g_unitFindCount; i++) {
+		ObjectGrid_UpdateUnit(g_unitFindArray[i]);
+	}
+}
+
+/**
+ * Rebuild the index of structures from the pool, for when the pool
+ *  was replaced as a whole.
+ */
+void
+ObjectGrid_RebuildStructures(void)
+{
+	ObjectGrid_Clear(&s_structureGrid);
+
+	for (uint16 i = 0; i < StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT); i++) {
+		const Structure *s = Structure_Get_ByIndex(i);
+
+		if (s->o.flags.s.used) ObjectGrid_UpdateStructure(s);
+	}
+}
+
+/*--------------------------------------------------------------*/
+
+static void
+ObjectGrid_Start(ObjectGridFindStruct *find, const ObjectGridList *list, tile32 position, uint16 distance)
+{
+	if (ObjectGrid_IsPositionInside(position)) {
+		find->x1 = max(0, position.x - distance) >> OBJECTGRID_CELL_SHIFT;
+		find->y1 = max(0, position.y - distance) >> OBJECTGRID_CELL_SHIFT;
+		find->x2 = min((MAP_SIZE_MAX << 8) - 1, position.x + distance) >> OBJECTGRID_CELL_SHIFT;
+		find->y2 = min((MAP_SIZE_MAX << 8) - 1, position.y + distance) >> OBJECTGRID_CELL_SHIFT;
+	} else {
+		find->x1 = 0;
+		find->y1 = 0;
+		find->x2 = OBJECTGRID_CELLS_PER_ROW - 1;
+		find->y2 = OBJECTGRID_CELLS_PER_ROW - 1;
+	}
+
+	find->ring  = OBJECTGRID_RING_ALL;
+	find->x     = find->x1;
+	find->y     = find->y1;
+	find->cell  = OBJECTGRID_CELL_OUTSIDE;
+	find->index = list->head[OBJECTGRID_CELL_OUTSIDE];
+}
+
+static bool
+ObjectGrid_NextCell(ObjectGridFindStruct *find)
+{
+	while (find->y <= find->y2) {
+		const int x = find->x;
+		const int y = find->y;
+
+		if (find->x < find->x2) {
+			find->x++;
+		} else {
+			find->x = find->x1;
+			find->y++;
+		}
+
+		if (find->ring != OBJECTGRID_RING_ALL
+				&& max(abs(x - find->ox), abs(y - find->oy)) != find->ring)
+			continue;
+
+		find->cell = y * OBJECTGRID_CELLS_PER_ROW + x;
+		return true;
+	}
+
+	return false;
+}
+
+static uint16
+ObjectGrid_FindNextIndex(ObjectGridFindStruct *find, const ObjectGridList *list)
+{
+	while (find->index == OBJECTGRID_INDEX_NONE) {
+		if (!ObjectGrid_NextCell(find)) return OBJECTGRID_INDEX_NONE;
+
+		find->index = list->head[find->cell];
+	}
+
+	const uint16 index = find->index;
+	find->index = list->next[index];
+	return index;
+}
+
+/**
+ * Start finding units close to a position.  All units within the
+ *  given distance on both axes are found, with possibly some more.
+ * @param find The search state.
+ * @param position The centre of the search.
+ * @param distance The distance along either axis.
+ * @return The first Unit found, or NULL if none.
+ */
+Unit *
+ObjectGrid_FindFirstUnit(ObjectGridFindStruct *find, tile32 position, uint16 distance)
+{
+	ObjectGrid_Start(find, &s_unitGrid, position, distance);
+
+	return ObjectGrid_FindNextUnit(find);
+}
+
+/**
+ * Start finding the units in a ring of cells around a position.  Ring
+ *  0 is the cell of the position, together with units outside of the
+ *  map.  Every unit is in exactly one ring.
+ * @param find The search state.
+ * @param position The centre of the search, which must be on the map.
+ * @param ring The ring to search.
+ * @return The first Unit found, or NULL if none.
+ */
+Unit *
+ObjectGrid_FindFirstUnitInRing(ObjectGridFindStruct *find, tile32 position, uint8 ring)
+{
+	assert(ObjectGrid_IsPositionInside(position));
+	assert(ring < OBJECTGRID_RING_MAX);
+
+	find->ox = position.x >> OBJECTGRID_CELL_SHIFT;
+	find->oy = position.y >> OBJECTGRID_CELL_SHIFT;
+	find->x1 = max(0, find->ox - ring);
+	find->y1 = max(0, find->oy - ring);
+	find->x2 = min(OBJECTGRID_CELLS_PER_ROW - 1, find->ox + ring);
+	find->y2 = min(OBJECTGRID_CELLS_PER_ROW - 1, find->oy + ring);
+
+	find->ring  = ring;
+	find->x     = find->x1;
+	find->y     = find->y1;
+	find->cell  = (ring == 0) ? OBJECTGRID_CELL_OUTSIDE : OBJECTGRID_CELL_NONE;
+	find->index = (ring == 0) ? s_unitGrid.head[OBJECTGRID_CELL_OUTSIDE] : OBJECTGRID_INDEX_NONE;
+
+	return ObjectGrid_FindNextUnit(find);
+}
+
+/**
+ * Continue finding units.  Like Unit_FindNext, units that are not on
+ *  the map are skipped.
+ * @param find The search state.
+ * @return The next Unit found, or NULL if none.
+ */
+Unit *
+ObjectGrid_FindNextUnit(ObjectGridFindStruct *find)
+{
+	while (true) {
+		const uint16 index = ObjectGrid_FindNextIndex(find, &s_unitGrid);
+		if (index == OBJECTGRID_INDEX_NONE) return NULL;
+
+		Unit *u = Unit_Get_ByIndex(index);
+		assert(u->o.flags.s.used);
+
+		if (u->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		return u;
+	}
+}
+
+/**
+ * Start finding structures close to a position.  All structures with
+ *  their top-left corner within the given distance on both axes are
+ *  found, with possibly some more.  Walls and slabs are not found.
+ * @param find The search state.
+ * @param position The centre of the search.
+ * @param distance The distance along either axis.
+ * @return The first Structure found, or NULL if none.
+ */
+Structure *
+ObjectGrid_FindFirstStructure(ObjectGridFindStruct *find, tile32 position, uint16 distance)
+{
+	ObjectGrid_Start(find, &s_structureGrid, position, distance);
+
+	return ObjectGrid_FindNextStructure(find);
+}
+
+/**
+ * Continue finding structures.  Like Structure_FindNext, structures
+ *  that are not on the map are skipped.
+ * @param find The search state.
+ * @return The next Structure found, or NULL if none.
+ */
+Structure *
+ObjectGrid_FindNextStructure(ObjectGridFindStruct *find)
+{
+	while (true) {
+		const uint16 index = ObjectGrid_FindNextIndex(find, &s_structureGrid);
+		if (index == OBJECTGRID_INDEX_NONE) return NULL;
+
+		Structure *s = Structure_Get_ByIndex(index);
+		assert(s->o.flags.s.used);
+
+		if (s->o.flags.s.isNotOnMap && g_validateStrictIfZero == 0)
+			continue;
+
+		return s;
+	}
+}
+
+/**
+ * Get the smallest distance along either axis between a position and
+ *  any position in a ring of cells around it.
+ * @param ring The ring.
+ * @return The distance, in 1/256th of a tile.
+ */
+uint16
+ObjectGrid_GetRingDistance(uint8 ring)
+{
+	if (ring == 0) return 0;
+
+	return (ring - 1) << OBJECTGRID_CELL_SHIFT;
+}
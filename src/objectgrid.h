@@ -0,0 +1,48 @@
+/** @file src/objectgrid.h Spatial index of units and structures. */
+
+#ifndef OBJECTGRID_H
+#define OBJECTGRID_H
+
+#include "types.h"
+
+/* Define OBJECTGRID_VERIFY to compare the result of every indexed
+ * target search against a scan of the whole pool.
+ */
+
+enum {
+	OBJECTGRID_RING_MAX = 16 /* Number of rings of cells around any cell. */
+};
+
+typedef struct ObjectGridFindStruct {
+	/* Cells to search, inclusive. */
+	uint8 x1, y1, x2, y2;
+
+	/* Ring of cells to search around the cell ox, oy, or 0xFF for
+	 * the whole rectangle.
+	 */
+	uint8 ring;
+	uint8 ox, oy;
+
+	/* Internal cell and index for where the search reached. */
+	uint16 cell;
+	uint16 index;
+	uint8 x, y;
+} ObjectGridFindStruct;
+
+struct Structure;
+struct Unit;
+
+extern void ObjectGrid_UpdateUnit(const struct Unit *u);
+extern void ObjectGrid_UpdateStructure(const struct Structure *s);
+extern void ObjectGrid_RebuildUnits(void);
+extern void ObjectGrid_RebuildStructures(void);
+
+extern struct Unit *ObjectGrid_FindFirstUnit(ObjectGridFindStruct *find, tile32 position, uint16 distance);
+extern struct Unit *ObjectGrid_FindFirstUnitInRing(ObjectGridFindStruct *find, tile32 position, uint8 ring);
+extern struct Unit *ObjectGrid_FindNextUnit(ObjectGridFindStruct *find);
+extern struct Structure *ObjectGrid_FindFirstStructure(ObjectGridFindStruct *find, tile32 position, uint16 distance);
+extern struct Structure *ObjectGrid_FindNextStructure(ObjectGridFindStruct *find);
+extern uint16 ObjectGrid_GetRingDistance(uint8 ring);
+extern bool ObjectGrid_IsPositionInside(tile32 position);
+
+#endif
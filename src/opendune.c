@@ -27,6 +27,7 @@ extern int _al_mangled_main(int argc, char **argv);
 #include "ai.h"
 #include "animation.h"
 #include "audio/audio.h"
+#include "benchmark.h"
 #include "common_a5.h"
 #include "config.h"
 #include "crashlog/crashlog.h"
@@ -45,6 +46,7 @@ extern int _al_mangled_main(int argc, char **argv);
 #include "input/input.h"
 #include "input/mouse.h"
 #include "map.h"
+#include "minimap.h"
 #include "mods/multiplayer.h"
 #include "mods/skirmish.h"
 #include "net/net.h"
@@ -54,11 +56,13 @@ extern int _al_mangled_main(int argc, char **argv);
 #include "newui/menu.h"
 #include "newui/menubar.h"
 #include "newui/viewport.h"
+#include "pathfinder.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
 #include "pool/pool_structure.h"
 #include "pool/pool_team.h"
 #include "pool/pool_unit.h"
+#include "save.h"
 #include "scenario.h"
 #include "shape.h"
 #include "sprites.h"
@@ -457,9 +461,9 @@ GameLoop_TweakWidgetDimensions(void)
 }
 
 /**
- * Intro menu.
+ * Load the palettes, scripts and pools shared by the menu and games.
  */
-static void GameLoop_GameIntroAnimationMenu(void)
+static void GameLoop_InitialiseMenu(void)
 {
 	Timer_SetTimer(TIMER_GUI, true);
 
@@ -509,15 +513,20 @@ static void GameLoop_GameIntroAnimationMenu(void)
 	House_Init();
 	Structure_Init();
 
-	{
-		Audio_PlayMusic(MUSIC_STOP);
+	Audio_PlayMusic(MUSIC_STOP);
 
-		free(g_readBuffer);
-		g_readBufferSize = 0x6D60;
-		g_readBuffer = calloc(1, g_readBufferSize);
+	free(g_readBuffer);
+	g_readBufferSize = 0x6D60;
+	g_readBuffer = calloc(1, g_readBufferSize);
+}
 
-		Menu_Run();
-	}
+/**
+ * Intro menu.
+ */
+static void GameLoop_GameIntroAnimationMenu(void)
+{
+	GameLoop_InitialiseMenu();
+	Menu_Run();
 
 	GFX_SetPalette(g_palette1);
 }
@@ -629,8 +638,7 @@ static bool Unknown_25C4_000E(void)
 
 int main(int argc, char **argv)
 {
-	VARIABLE_NOT_USED(argc);
-	VARIABLE_NOT_USED(argv);
+	const bool benchmark = Benchmark_ParseArgs(argc, argv);
 
 	CrashLog_Init();
 	FileHash_Init();
@@ -680,6 +688,14 @@ int main(int argc, char **argv)
 
 	Net_Initialise();
 
+	if (benchmark) {
+		GameLoop_InitialiseMenu();
+		const int ret = Benchmark_Run();
+
+		PrepareEnd();
+		exit(ret);
+	}
+
 	GameLoop_GameIntroAnimationMenu();
 
 	printf("%s\n", String_Get_ByIndex(STR_THANK_YOU_FOR_PLAYING_DUNE_II));
@@ -710,22 +726,24 @@ void Game_Prepare(void)
 		const Structure *s = Structure_Get_ByPackedTile(packed);
 		const Unit *u = Unit_Get_ByPackedTile(packed);
 		Tile *t = &g_map[packed];
-		FogOfWarTile *f = &g_mapVisible[packed];
 
 		if (u == NULL || !u->o.flags.s.used) t->hasUnit = false;
 		if (s == NULL || !s->o.flags.s.used) t->hasStructure = false;
 
 		if (Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
-			const int64_t backup = f->timeout[g_playerHouseID];
+			const int64_t backup = Map_GetTileTimeout(g_playerHouseID, packed);
 
 			Map_UnveilTile(g_playerHouseID, UNVEILCAUSE_INITIALISATION,
 					packed);
 
-			f->timeout[g_playerHouseID] = backup;
+			Map_SetTileTimeout(g_playerHouseID, packed, backup);
 		}
 	}
 
 	Map_Client_UpdateFogOfWar();
+	Map_InvalidateAll();
+	Minimap_InvalidateAll();
+	Map_InvalidateVisibleAll();
 
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
@@ -752,6 +770,7 @@ void Game_Prepare(void)
 			if (!u->o.flags.s.used || !u->o.flags.s.isNotOnMap) {
 				s->o.linkedID = 0xFF;
 				s->countDown = 0;
+				Server_MarkStructureDirty(s);
 			} else {
 				Structure_Server_SetState(s, STRUCTURE_STATE_READY);
 			}
@@ -809,7 +828,9 @@ void Game_Init(void)
 	Animation_Init();
 	Explosion_Init();
 	memset(g_map, 0, 64 * 64 * sizeof(Tile));
+	Map_ClearPlanes();
 	Map_ResetFogOfWar();
+	Pathfinder_Init();
 
 	memset(g_mapSpriteID, 0, 64 * 64 * sizeof(uint16));
 	memset(g_starportAvailable, 0, sizeof(g_starportAvailable));
@@ -864,8 +885,11 @@ void Game_LoadScenario(uint8 houseID, uint16 scenarioID)
  */
 void PrepareEnd(void)
 {
+	Save_Wait();
+
 	Animation_Uninit();
 	Explosion_Uninit();
+	Pathfinder_Uninit();
 
 	GameLoop_Uninit();
 
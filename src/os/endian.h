@@ -49,6 +49,8 @@ extern uint32 endian_bswap32(uint32 x);
 #endif
 
 #define READ_LE_UINT16(p) ((uint16)(p)[0] | ((uint16)(p)[1] << 8))
+#define READ_BE_UINT16(p) (((uint16)(p)[0] << 8) | (uint16)(p)[1])
 #define READ_LE_UINT32(p) ((uint32)(p)[0] | ((uint32)(p)[1] << 8) | ((uint32)(p)[2] << 16) | ((uint32)(p)[3] << 24))
+#define READ_BE_UINT32(p) (((uint32)(p)[0] << 24) | ((uint32)(p)[1] << 16) | ((uint32)(p)[2] << 8) | (uint32)(p)[3])
 
 #endif /* OS_ENDIAN_H */
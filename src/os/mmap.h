@@ -0,0 +1,17 @@
+/** @file src/os/mmap.h Platform dependant read-only file mapping. */
+
+#ifndef OS_MMAP_H
+#define OS_MMAP_H
+
+#include <stdio.h>
+
+typedef struct MappedFile {
+	const uint8 *data;                                      /*!< The content of the file. */
+	uint32 size;                                            /*!< The size of the file. */
+	void *handle;                                           /*!< Platform dependant handle of the mapping. */
+} MappedFile;
+
+extern bool MappedFile_Open(MappedFile *map, FILE *fp);
+extern void MappedFile_Close(MappedFile *map);
+
+#endif /* OS_MMAP_H */
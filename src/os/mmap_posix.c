@@ -0,0 +1,45 @@
+/** @file src/os/mmap_posix.c Platform dependant file mapping for POSIX systems. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "types.h"
+
+#include "mmap.h"
+
+/**
+ * Map the whole of an opened file into memory.  The mapping stays valid
+ * after the file is closed.
+ *
+ * @param map The mapping to fill in.
+ * @param fp The file to map.
+ * @return True if the file was mapped.
+ */
+bool
+MappedFile_Open(MappedFile *map, FILE *fp)
+{
+	const int fd = fileno(fp);
+	struct stat st;
+
+	if (fstat(fd, &st) != 0) return false;
+	if (st.st_size <= 0 || (uint64_t)st.st_size > 0xFFFFFFFF) return false;
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) return false;
+
+	map->data = data;
+	map->size = st.st_size;
+	map->handle = NULL;
+	return true;
+}
+
+void
+MappedFile_Close(MappedFile *map)
+{
+	if (map->data == NULL) return;
+
+	munmap((void *)map->data, map->size);
+	map->data = NULL;
+	map->size = 0;
+}
@@ -0,0 +1,53 @@
+/** @file src/os/mmap_win32.c Platform dependant file mapping for win32. */
+
+#include <stdio.h>
+#include <io.h>
+#include <windows.h>
+#include "types.h"
+
+#include "mmap.h"
+
+/**
+ * Map the whole of an opened file into memory.  The mapping stays valid
+ * after the file is closed.
+ *
+ * @param map The mapping to fill in.
+ * @param fp The file to map.
+ * @return True if the file was mapped.
+ */
+bool
+MappedFile_Open(MappedFile *map, FILE *fp)
+{
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+	LARGE_INTEGER size;
+
+	if (file == INVALID_HANDLE_VALUE) return false;
+	if (!GetFileSizeEx(file, &size)) return false;
+	if (size.QuadPart <= 0 || size.QuadPart > 0xFFFFFFFF) return false;
+
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) return false;
+
+	const void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		CloseHandle(mapping);
+		return false;
+	}
+
+	map->data = data;
+	map->size = size.LowPart;
+	map->handle = mapping;
+	return true;
+}
+
+void
+MappedFile_Close(MappedFile *map)
+{
+	if (map->data == NULL) return;
+
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->handle);
+	map->data = NULL;
+	map->size = 0;
+	map->handle = NULL;
+}
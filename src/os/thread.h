@@ -3,22 +3,11 @@
 #ifndef OS_THREAD_H
 #define OS_THREAD_H
 
-#if defined(_WIN32)
-	#include <windows.h>
-	typedef HANDLE Thread;
-	typedef HANDLE Semaphore;
-	typedef DWORD ThreadStatus;
-#else
-	#include <SDL.h>
-	#include <SDL_thread.h>
-	typedef SDL_Thread *Thread;
-	typedef SDL_sem *Semaphore;
-	typedef int ThreadStatus;
+typedef struct OSThread *Thread;
+typedef struct OSSemaphore *Semaphore;
+typedef int ThreadStatus;
 
-	#define WINAPI
-#endif /* _WIN32 */
-
-typedef ThreadStatus (WINAPI *ThreadProc)(void *);
+typedef ThreadStatus (*ThreadProc)(void *);
 
 extern Thread Thread_Create(ThreadProc proc, void *data);
 extern void Thread_Wait(Thread thread, ThreadStatus *status);
@@ -0,0 +1,135 @@
+/** @file src/os/thread_a5.c Platform dependant thread implementation for Allegro. */
+
+#include <allegro5/allegro.h>
+#include <stdlib.h>
+#include "types.h"
+
+#include "thread.h"
+
+struct OSThread {
+	ALLEGRO_THREAD *thread;
+	ThreadProc proc;
+	void *data;
+	ThreadStatus status;
+};
+
+/**
+ * A counting semaphore, which Allegro does not have.
+ */
+struct OSSemaphore {
+	ALLEGRO_MUTEX *mutex;
+	ALLEGRO_COND *cond;
+	int value;
+};
+
+static void *
+Thread_ThreadProc(ALLEGRO_THREAD *thread, void *arg)
+{
+	Thread t = arg;
+	VARIABLE_NOT_USED(thread);
+
+	t->status = t->proc(t->data);
+	return NULL;
+}
+
+/**
+ * Create and start a thread.
+ * @return The thread, or NULL if it could not be created.
+ */
+Thread
+Thread_Create(ThreadProc proc, void *data)
+{
+	Thread t = malloc(sizeof(*t));
+	if (t == NULL)
+		return NULL;
+
+	t->proc = proc;
+	t->data = data;
+	t->status = 0;
+	t->thread = al_create_thread(Thread_ThreadProc, t);
+	if (t->thread == NULL) {
+		free(t);
+		return NULL;
+	}
+
+	al_start_thread(t->thread);
+	return t;
+}
+
+/**
+ * Wait for a thread to return, then free it.
+ */
+void
+Thread_Wait(Thread thread, ThreadStatus *status)
+{
+	al_join_thread(thread->thread, NULL);
+	al_destroy_thread(thread->thread);
+
+	if (status != NULL) *status = thread->status;
+	free(thread);
+}
+
+Semaphore
+Semaphore_Create(int value)
+{
+	Semaphore sem = malloc(sizeof(*sem));
+	if (sem == NULL)
+		return NULL;
+
+	sem->mutex = al_create_mutex();
+	sem->cond = al_create_cond();
+	sem->value = value;
+
+	if (sem->mutex == NULL || sem->cond == NULL) {
+		Semaphore_Destroy(sem);
+		return NULL;
+	}
+
+	return sem;
+}
+
+bool
+Semaphore_Unlock(Semaphore sem)
+{
+	al_lock_mutex(sem->mutex);
+	sem->value++;
+	al_signal_cond(sem->cond);
+	al_unlock_mutex(sem->mutex);
+	return true;
+}
+
+bool
+Semaphore_Lock(Semaphore sem)
+{
+	al_lock_mutex(sem->mutex);
+	while (sem->value <= 0)
+		al_wait_cond(sem->cond, sem->mutex);
+	sem->value--;
+	al_unlock_mutex(sem->mutex);
+	return true;
+}
+
+bool
+Semaphore_TryLock(Semaphore sem)
+{
+	bool res = false;
+
+	al_lock_mutex(sem->mutex);
+	if (sem->value > 0) {
+		sem->value--;
+		res = true;
+	}
+	al_unlock_mutex(sem->mutex);
+	return res;
+}
+
+void
+Semaphore_Destroy(Semaphore sem)
+{
+	if (sem == NULL)
+		return;
+
+	if (sem->cond != NULL) al_destroy_cond(sem->cond);
+	if (sem->mutex != NULL) al_destroy_mutex(sem->mutex);
+	free(sem);
+}
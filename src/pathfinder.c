@@ -0,0 +1,913 @@
+/** @file src/pathfinder.c
+ *
+ * Hierarchical A* pathfinder.
+ *
+ * The map is divided into 8x8 clusters of tiles.  For every movement
+ * type, the landscape speed of each tile is read from the movement
+ * speed planes kept by map.c.  From them the entrances between
+ * neighbouring clusters are derived,
+ * together with the cost of travelling between the entrances of a
+ * cluster.  A route is found by searching the graph of entrances for
+ * a corridor of clusters, then running a tile A* restricted to that
+ * corridor.  Corridors are kept in a small cache.
+ *
+ * Units and structures are not part of the cost grid.  They are scored
+ * with Unit_GetTileEnterScore when the tile search runs into them.
+ *
+ * A destination which the landscape cuts off is remembered with the
+ * reachable tile closest to it, so that units which keep trying to get
+ * there are routed to that tile instead of searching the whole map
+ * again.  The entries are dropped when the landscape changes.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "os/math.h"
+
+#include "pathfinder.h"
+
+#include "binheap.h"
+#include "enhancement.h"
+#include "map.h"
+#include "tools/coord.h"
+#include "unit.h"
+
+enum {
+	PATHFINDER_CLUSTER_SIZE     = 8,
+	PATHFINDER_CLUSTERS_PER_ROW = MAP_SIZE_MAX / PATHFINDER_CLUSTER_SIZE,
+	PATHFINDER_CLUSTER_MAX      = PATHFINDER_CLUSTERS_PER_ROW * PATHFINDER_CLUSTERS_PER_ROW,
+
+	/* Each side of a cluster has at most 4 separate openings. */
+	PATHFINDER_ENTRANCE_MAX     = 16,
+	PATHFINDER_ABSTRACT_GOAL    = PATHFINDER_CLUSTER_MAX * PATHFINDER_ENTRANCE_MAX,
+	PATHFINDER_ABSTRACT_MAX     = PATHFINDER_ABSTRACT_GOAL + 1,
+
+	/* Openings at least this wide get an entrance at either end. */
+	PATHFINDER_WIDE_OPENING     = 6,
+
+	PATHFINDER_CACHE_SIZE       = 64,
+	PATHFINDER_UNREACHABLE_SIZE = 32,
+
+	/* Limit on tiles expanded by a search that is not confined to a corridor. */
+	PATHFINDER_EXPAND_MAX       = MAP_SIZE_MAX * MAP_SIZE_MAX / 2,
+
+	PATHFINDER_COST_INFINITE    = 0x7FFFFFFF,
+	PATHFINDER_EDGE_NONE        = 0xFFFF
+};
+
+/* The corridor is stored as a bitmask of clusters. */
+assert_compile(PATHFINDER_CLUSTER_MAX == 64);
+
+#define PATHFINDER_CORRIDOR_ALL     (~(uint64_t)0)
+
+typedef struct PathfinderCluster {
+	bool valid;                                             /*!< False if the entrances must be recomputed. */
+	uint8 numEntrances;                                     /*!< Number of entrances. */
+	uint16 entrance[PATHFINDER_ENTRANCE_MAX];               /*!< Tile of the entrance inside this cluster. */
+	uint16 exit[PATHFINDER_ENTRANCE_MAX];                   /*!< Adjacent tile in the neighbouring cluster. */
+	uint16 cost[PATHFINDER_ENTRANCE_MAX][PATHFINDER_ENTRANCE_MAX]; /*!< Cost between two entrances, or PATHFINDER_EDGE_NONE. */
+} PathfinderCluster;
+
+typedef struct PathfinderCacheEntry {
+	uint32 lastUsed;                                        /*!< Age of the entry, or 0 if it is unused. */
+	uint8 movementType;
+	uint8 clusterSrc;
+	uint8 clusterDst;
+	uint64_t corridor;                                      /*!< Clusters the route passes through. */
+} PathfinderCacheEntry;
+
+typedef struct PathfinderUnreachable {
+	uint32 lastUsed;                                        /*!< Age of the entry, or 0 if it is unused. */
+	uint8 movementType;
+	uint8 clusterSrc;
+	uint16 packedDst;
+	uint16 packedClosest;                                   /*!< Reachable tile closest to the destination. */
+} PathfinderUnreachable;
+
+typedef struct PathfinderQuery {
+	Unit *unit;                                             /*!< Unit to score units and structures for, or NULL. */
+	uint8 movementType;
+	uint16 speedFactor;                                     /*!< Speed factor, where 256 is full speed. */
+	bool exact;                                             /*!< Score every tile with Unit_GetTileEnterScore. */
+	uint16 packedDst;                                       /*!< Destination, or 0xFFFF to visit every reachable tile. */
+	uint64_t corridor;                                      /*!< Clusters the search may enter. */
+	int32 minStepCost;                                      /*!< Lowest cost of a single step, for the heuristic. */
+	int expandMax;                                          /*!< Maximum number of tiles to expand. */
+} PathfinderQuery;
+
+typedef struct PathfinderNode {
+	/* Heap key. */
+	int64_t key;
+
+	int32 cost;
+	uint16 id;
+} PathfinderNode;
+
+static const int16 s_mapDirection[8] = {-64, -63, 1, 65, 64, 63, -1, -65}; /*!< Tile index change when moving in a direction. */
+static const int8 s_directionX[8] = { 0,  1, 1, 1, 0, -1, -1, -1};
+static const int8 s_directionY[8] = {-1, -1, 0, 1, 1,  1,  0, -1};
+
+/* The movement types are passed to Pathfinder_InvalidateTile as a mask. */
+assert_compile(MOVEMENT_MAX <= 8);
+
+static PathfinderCluster s_cluster[MOVEMENT_MAX][PATHFINDER_CLUSTER_MAX];
+
+static PathfinderCacheEntry s_cache[PATHFINDER_CACHE_SIZE];
+static uint32 s_cacheAge;
+
+static PathfinderUnreachable s_unreachable[PATHFINDER_UNREACHABLE_SIZE];
+static uint32 s_unreachableAge;
+
+/* Tile search state.  s_visited holds the generation a tile was last reached in. */
+static BinHeap s_open;
+static int32 s_cost[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint8 s_parent[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint16 s_visited[MAP_SIZE_MAX * MAP_SIZE_MAX];
+static uint16 s_generation;
+
+/* Abstract search state. */
+static BinHeap s_abstractOpen;
+static int32 s_abstractCost[PATHFINDER_ABSTRACT_MAX];
+static int16 s_abstractParent[PATHFINDER_ABSTRACT_MAX];
+static uint16 s_abstractVisited[PATHFINDER_ABSTRACT_MAX];
+static uint16 s_abstractGeneration;
+
+static uint8
+Pathfinder_GetCluster(uint16 packed)
+{
+	const uint8 x = Tile_GetPackedX(packed) / PATHFINDER_CLUSTER_SIZE;
+	const uint8 y = Tile_GetPackedY(packed) / PATHFINDER_CLUSTER_SIZE;
+
+	return y * PATHFINDER_CLUSTERS_PER_ROW + x;
+}
+
+static int
+Pathfinder_GetDistance(uint16 a, uint16 b)
+{
+	const int dx = abs(Tile_GetPackedX(a) - Tile_GetPackedX(b));
+	const int dy = abs(Tile_GetPackedY(a) - Tile_GetPackedY(b));
+
+	return max(dx, dy);
+}
+
+/**
+ * Grow a corridor by one cluster in every direction.
+ * @param corridor The clusters in the corridor.
+ * @return The clusters in or next to the corridor.
+ */
+static uint64_t
+Pathfinder_DilateCorridor(uint64_t corridor)
+{
+	const uint64_t notLeftColumn  = 0xFEFEFEFEFEFEFEFEULL;
+	const uint64_t notRightColumn = 0x7F7F7F7F7F7F7F7FULL;
+	uint64_t res = corridor;
+
+	res |= (corridor << 1) & notLeftColumn;
+	res |= (corridor >> 1) & notRightColumn;
+	res |= (res << PATHFINDER_CLUSTERS_PER_ROW) | (res >> PATHFINDER_CLUSTERS_PER_ROW);
+
+	return res;
+}
+
+/**
+ * Convert a landscape speed into a score, like Unit_GetTileEnterScore.
+ * The speed factor is 256 unless g_dune2_enhanced is set.
+ * @return 256 if the tile is not accessable, or a score otherwise.
+ */
+static int16
+Pathfinder_GetScoreFromSpeed(uint8 speed, uint16 speedFactor, uint8 orient8)
+{
+	uint16 res = speed * speedFactor / 256;
+
+	if (res == 0) return 256;
+
+	if ((orient8 & 1) != 0) {
+		res -= res / 4 + res / 8;
+	}
+
+	res ^= 0xFF;
+
+	return (int16)res;
+}
+
+/**
+ * Get the cost of a step into a tile.  Every step costs one more than
+ * its score, so that the shortest of otherwise equal routes wins.
+ *
+ * @return The cost, or PATHFINDER_COST_INFINITE if the tile is not accessable.
+ */
+/**
+ * Get the landscape speed of a tile, or 0 if it is impassable.  Only
+ * winged units leave the map.
+ */
+static uint8
+Pathfinder_GetSpeed(uint8 movementType, uint16 packed)
+{
+	if (movementType != MOVEMENT_WINGER && !Map_IsValidPosition(packed)) return 0;
+
+	return Map_GetMovementSpeed(packed, movementType);
+}
+
+static int32
+Pathfinder_GetStepCost(const PathfinderQuery *q, uint16 packed, uint8 orient8)
+{
+	/* Like Script_Unit_Pathfind_GetScore, which passes the direction shifted
+	 * unless g_dune2_enhanced is set, so that diagonal steps are not
+	 * made cheaper.
+	 */
+	const uint8 orient = g_dune2_enhanced ? orient8 : (orient8 << 5);
+	int16 res;
+
+	if (q->unit != NULL
+			&& (q->exact || packed == q->packedDst || g_map[packed].hasUnit || g_map[packed].hasStructure)) {
+		res = Unit_GetTileEnterScore(q->unit, packed, orient);
+		if (res == -1) res = 256;
+	} else {
+		res = Pathfinder_GetScoreFromSpeed(Pathfinder_GetSpeed(q->movementType, packed), q->speedFactor, orient);
+	}
+
+	if (res > 255) return PATHFINDER_COST_INFINITE;
+
+	return max(res, 0) + 1;
+}
+
+static int32
+Pathfinder_GetMinStepCost(uint8 movementType, uint16 speedFactor)
+{
+	uint8 speed = 0;
+
+	for (enum LandscapeType lst = LST_NORMAL_SAND; lst < LST_MAX; lst++) {
+		speed = max(speed, g_table_landscapeInfo[lst].movementSpeed[movementType]);
+	}
+
+	return max(Pathfinder_GetScoreFromSpeed(speed, speedFactor, 0), 0) + 1;
+}
+
+static void
+Pathfinder_NextGeneration(uint16 *generation, uint16 *visited, size_t size)
+{
+	(*generation)++;
+
+	if (*generation == 0) {
+		memset(visited, 0, size);
+		*generation = 1;
+	}
+}
+
+static bool
+Pathfinder_IsVisited(uint16 packed)
+{
+	return s_visited[packed] == s_generation;
+}
+
+/**
+ * Run A* over the tiles in the corridor of the query.  Without a
+ * destination, every reachable tile is visited.
+ *
+ * @param q The query.
+ * @param packedSrc The tile to search from.
+ * @return The destination if it was reached, otherwise the reached
+ *   tile closest to the destination.
+ */
+static uint16
+Pathfinder_SearchTiles(const PathfinderQuery *q, uint16 packedSrc)
+{
+	uint16 best = packedSrc;
+	int bestDistance = (q->packedDst == 0xFFFF) ? 0 : Pathfinder_GetDistance(packedSrc, q->packedDst);
+	int32 bestCost = 0;
+	int expanded = 0;
+	PathfinderNode *n;
+
+	Pathfinder_NextGeneration(&s_generation, s_visited, sizeof(s_visited));
+	BinHeap_Init(&s_open, sizeof(PathfinderNode));
+
+	s_visited[packedSrc] = s_generation;
+	s_cost[packedSrc] = 0;
+	s_parent[packedSrc] = 0xFF;
+
+	n = BinHeap_Push(&s_open, 0);
+	if (n == NULL) return packedSrc;
+	n->cost = 0;
+	n->id = packedSrc;
+
+	while ((n = BinHeap_GetMin(&s_open)) != NULL) {
+		const uint16 packed = n->id;
+		const int32 cost = n->cost;
+
+		BinHeap_Pop(&s_open);
+
+		if (cost > s_cost[packed]) continue;
+
+		if (q->packedDst != 0xFFFF) {
+			const int distance = Pathfinder_GetDistance(packed, q->packedDst);
+
+			if (distance < bestDistance || (distance == bestDistance && cost < bestCost)) {
+				best = packed;
+				bestDistance = distance;
+				bestCost = cost;
+			}
+
+			if (packed == q->packedDst) break;
+		}
+
+		if (++expanded > q->expandMax) break;
+
+		const int x = Tile_GetPackedX(packed);
+		const int y = Tile_GetPackedY(packed);
+
+		for (uint8 orient8 = 0; orient8 < 8; orient8++) {
+			const int nx = x + s_directionX[orient8];
+			const int ny = y + s_directionY[orient8];
+
+			if (nx < 0 || nx >= MAP_SIZE_MAX || ny < 0 || ny >= MAP_SIZE_MAX) continue;
+
+			const uint16 next = packed + s_mapDirection[orient8];
+			if ((q->corridor & ((uint64_t)1 << Pathfinder_GetCluster(next))) == 0) continue;
+
+			const int32 step = Pathfinder_GetStepCost(q, next, orient8);
+			if (step == PATHFINDER_COST_INFINITE) continue;
+
+			const int32 nextCost = cost + step;
+			if (Pathfinder_IsVisited(next) && s_cost[next] <= nextCost) continue;
+
+			s_visited[next] = s_generation;
+			s_cost[next] = nextCost;
+			s_parent[next] = orient8;
+
+			int64_t key = nextCost;
+			int distance = 0;
+			if (q->packedDst != 0xFFFF) {
+				distance = Pathfinder_GetDistance(next, q->packedDst);
+				key += (int64_t)distance * q->minStepCost;
+			}
+
+			/* Prefer tiles closer to the destination on equal estimates. */
+			n = BinHeap_Push(&s_open, (key << 8) | distance);
+			if (n == NULL) return best;
+			n->cost = nextCost;
+			n->id = next;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Add the entrances along one side of a cluster.  Neighbouring clusters
+ * scan their shared side in the same order, so entrances are found in
+ * pairs.
+ *
+ * @param cl The cluster.
+ * @param movementType The movement type of the cluster.
+ * @param packedFirst The first tile along the side inside the cluster.
+ * @param step Tile index change along the side.
+ * @param outward Tile index change to cross into the neighbouring cluster.
+ */
+static void
+Pathfinder_AddEntrances(PathfinderCluster *cl, uint8 movementType, uint16 packedFirst, int16 step, int16 outward)
+{
+	int start = -1;
+
+	for (int i = 0; i <= PATHFINDER_CLUSTER_SIZE; i++) {
+		const uint16 packed = packedFirst + i * step;
+		const bool open = (i < PATHFINDER_CLUSTER_SIZE)
+			&& (Pathfinder_GetSpeed(movementType, packed) != 0)
+			&& (Pathfinder_GetSpeed(movementType, packed + outward) != 0);
+
+		if (open) {
+			if (start < 0) start = i;
+			continue;
+		}
+
+		if (start < 0) continue;
+
+		const int end = i - 1;
+		int openings[2];
+		int count;
+
+		if (end - start + 1 < PATHFINDER_WIDE_OPENING) {
+			openings[0] = (start + end) / 2;
+			count = 1;
+		} else {
+			openings[0] = start;
+			openings[1] = end;
+			count = 2;
+		}
+
+		for (int j = 0; j < count; j++) {
+			const uint16 entrance = packedFirst + openings[j] * step;
+
+			assert(cl->numEntrances < PATHFINDER_ENTRANCE_MAX);
+			cl->entrance[cl->numEntrances] = entrance;
+			cl->exit[cl->numEntrances] = entrance + outward;
+			cl->numEntrances++;
+		}
+
+		start = -1;
+	}
+}
+
+/**
+ * Compute the entrances of a cluster and the costs between them.
+ * @param movementType The movement type.
+ * @param c The cluster.
+ */
+static void
+Pathfinder_BuildCluster(uint8 movementType, uint8 c)
+{
+	PathfinderCluster *cl = &s_cluster[movementType][c];
+	const uint16 x0 = (c % PATHFINDER_CLUSTERS_PER_ROW) * PATHFINDER_CLUSTER_SIZE;
+	const uint16 y0 = (c / PATHFINDER_CLUSTERS_PER_ROW) * PATHFINDER_CLUSTER_SIZE;
+	const uint16 x1 = x0 + PATHFINDER_CLUSTER_SIZE - 1;
+	const uint16 y1 = y0 + PATHFINDER_CLUSTER_SIZE - 1;
+	PathfinderQuery q;
+
+	cl->numEntrances = 0;
+
+	if (y0 > 0)                Pathfinder_AddEntrances(cl, movementType, Tile_PackXY(x0, y0), 1, -MAP_SIZE_MAX);
+	if (x1 < MAP_SIZE_MAX - 1) Pathfinder_AddEntrances(cl, movementType, Tile_PackXY(x1, y0), MAP_SIZE_MAX, 1);
+	if (y1 < MAP_SIZE_MAX - 1) Pathfinder_AddEntrances(cl, movementType, Tile_PackXY(x0, y1), 1, MAP_SIZE_MAX);
+	if (x0 > 0)                Pathfinder_AddEntrances(cl, movementType, Tile_PackXY(x0, y0), MAP_SIZE_MAX, -1);
+
+	memset(&q, 0, sizeof(q));
+	q.movementType = movementType;
+	q.speedFactor = 256;
+	q.packedDst = 0xFFFF;
+	q.corridor = (uint64_t)1 << c;
+	q.expandMax = PATHFINDER_CLUSTER_SIZE * PATHFINDER_CLUSTER_SIZE;
+
+	for (int i = 0; i < cl->numEntrances; i++) {
+		Pathfinder_SearchTiles(&q, cl->entrance[i]);
+
+		for (int j = 0; j < cl->numEntrances; j++) {
+			const uint16 packed = cl->entrance[j];
+
+			if (!Pathfinder_IsVisited(packed)) {
+				cl->cost[i][j] = PATHFINDER_EDGE_NONE;
+			} else {
+				cl->cost[i][j] = min(s_cost[packed], PATHFINDER_EDGE_NONE - 1);
+			}
+		}
+	}
+
+	cl->valid = true;
+}
+
+static const PathfinderCluster *
+Pathfinder_GetValidCluster(uint8 movementType, uint8 c)
+{
+	PathfinderCluster *cl = &s_cluster[movementType][c];
+
+	if (!cl->valid) Pathfinder_BuildCluster(movementType, c);
+
+	return cl;
+}
+
+/**
+ * Find the entrance on the other side of an entrance.
+ * @return The index of the entrance in the neighbouring cluster, or -1.
+ */
+static int
+Pathfinder_FindTwinEntrance(const PathfinderCluster *cl, uint16 entrance, uint16 exit)
+{
+	for (int j = 0; j < cl->numEntrances; j++) {
+		if (cl->entrance[j] == exit && cl->exit[j] == entrance) return j;
+	}
+
+	return -1;
+}
+
+static void
+Pathfinder_RelaxAbstract(int id, int32 cost, int parent, uint16 packed, uint16 packedDst, int32 minStepCost)
+{
+	PathfinderNode *n;
+
+	if (s_abstractVisited[id] == s_abstractGeneration && s_abstractCost[id] <= cost) return;
+
+	s_abstractVisited[id] = s_abstractGeneration;
+	s_abstractCost[id] = cost;
+	s_abstractParent[id] = parent;
+
+	const int64_t key = cost + (int64_t)Pathfinder_GetDistance(packed, packedDst) * minStepCost;
+
+	n = BinHeap_Push(&s_abstractOpen, key);
+	if (n == NULL) return;
+	n->cost = cost;
+	n->id = id;
+}
+
+/**
+ * Search the graph of cluster entrances for the clusters a route
+ * between two tiles passes through.
+ *
+ * @param q The query.
+ * @param packedSrc The start tile.
+ * @param corridor Where to store the clusters found.
+ * @return True if a corridor was found.
+ */
+static bool
+Pathfinder_FindCorridor(const PathfinderQuery *q, uint16 packedSrc, uint64_t *corridor)
+{
+	const uint8 mt = q->movementType;
+	const uint8 cSrc = Pathfinder_GetCluster(packedSrc);
+	const uint8 cDst = Pathfinder_GetCluster(q->packedDst);
+	int32 costDst[PATHFINDER_ENTRANCE_MAX];
+	PathfinderQuery local;
+
+	if (cSrc == cDst) {
+		*corridor = (uint64_t)1 << cSrc;
+		return true;
+	}
+
+	const PathfinderCluster *clSrc = Pathfinder_GetValidCluster(mt, cSrc);
+	const PathfinderCluster *clDst = Pathfinder_GetValidCluster(mt, cDst);
+
+	/* The graph of entrances is scored at full speed. */
+	const int32 minStepCost = Pathfinder_GetMinStepCost(mt, 256);
+
+	memset(&local, 0, sizeof(local));
+	local.movementType = mt;
+	local.speedFactor = 256;
+	local.packedDst = 0xFFFF;
+	local.expandMax = PATHFINDER_CLUSTER_SIZE * PATHFINDER_CLUSTER_SIZE;
+
+	/* Connect the destination to the entrances of its cluster.  The
+	 * cost of leaving the destination stands in for the cost of
+	 * reaching it, which is close enough to pick a corridor.
+	 */
+	local.corridor = (uint64_t)1 << cDst;
+	Pathfinder_SearchTiles(&local, q->packedDst);
+	for (int i = 0; i < clDst->numEntrances; i++) {
+		const uint16 packed = clDst->entrance[i];
+		costDst[i] = Pathfinder_IsVisited(packed) ? s_cost[packed] : PATHFINDER_COST_INFINITE;
+	}
+
+	/* Connect the source to the entrances of its cluster. */
+	local.corridor = (uint64_t)1 << cSrc;
+	Pathfinder_SearchTiles(&local, packedSrc);
+
+	Pathfinder_NextGeneration(&s_abstractGeneration, s_abstractVisited, sizeof(s_abstractVisited));
+	BinHeap_Init(&s_abstractOpen, sizeof(PathfinderNode));
+
+	for (int i = 0; i < clSrc->numEntrances; i++) {
+		const uint16 packed = clSrc->entrance[i];
+
+		if (!Pathfinder_IsVisited(packed)) continue;
+
+		Pathfinder_RelaxAbstract(cSrc * PATHFINDER_ENTRANCE_MAX + i, s_cost[packed], -1, packed, q->packedDst, minStepCost);
+	}
+
+	PathfinderNode *n;
+	bool found = false;
+	while ((n = BinHeap_GetMin(&s_abstractOpen)) != NULL) {
+		const int id = n->id;
+		const int32 cost = n->cost;
+
+		BinHeap_Pop(&s_abstractOpen);
+
+		if (cost > s_abstractCost[id]) continue;
+
+		if (id == PATHFINDER_ABSTRACT_GOAL) {
+			found = true;
+			break;
+		}
+
+		const uint8 c = id / PATHFINDER_ENTRANCE_MAX;
+		const int i = id % PATHFINDER_ENTRANCE_MAX;
+		const PathfinderCluster *cl = Pathfinder_GetValidCluster(mt, c);
+
+		if (c == cDst && costDst[i] != PATHFINDER_COST_INFINITE) {
+			Pathfinder_RelaxAbstract(PATHFINDER_ABSTRACT_GOAL, cost + costDst[i], id, q->packedDst, q->packedDst, minStepCost);
+		}
+
+		for (int j = 0; j < cl->numEntrances; j++) {
+			if (j == i || cl->cost[i][j] == PATHFINDER_EDGE_NONE) continue;
+
+			Pathfinder_RelaxAbstract(c * PATHFINDER_ENTRANCE_MAX + j, cost + cl->cost[i][j], id, cl->entrance[j], q->packedDst, minStepCost);
+		}
+
+		const uint16 exit = cl->exit[i];
+		const uint8 c2 = Pathfinder_GetCluster(exit);
+		const int j = Pathfinder_FindTwinEntrance(Pathfinder_GetValidCluster(mt, c2), cl->entrance[i], exit);
+		if (j < 0) continue;
+
+		uint8 orient8;
+		for (orient8 = 0; orient8 < 8; orient8 += 2) {
+			if (cl->entrance[i] + s_mapDirection[orient8] == exit) break;
+		}
+
+		const int32 step = Pathfinder_GetStepCost(&local, exit, orient8);
+		if (step == PATHFINDER_COST_INFINITE) continue;
+
+		Pathfinder_RelaxAbstract(c2 * PATHFINDER_ENTRANCE_MAX + j, cost + step, id, exit, q->packedDst, minStepCost);
+	}
+
+	if (!found) return false;
+
+	*corridor = ((uint64_t)1 << cSrc) | ((uint64_t)1 << cDst);
+	for (int id = s_abstractParent[PATHFINDER_ABSTRACT_GOAL]; id >= 0; id = s_abstractParent[id]) {
+		*corridor |= (uint64_t)1 << (id / PATHFINDER_ENTRANCE_MAX);
+	}
+
+	return true;
+}
+
+static PathfinderCacheEntry *
+Pathfinder_Cache_Find(uint8 movementType, uint8 clusterSrc, uint8 clusterDst)
+{
+	for (int i = 0; i < PATHFINDER_CACHE_SIZE; i++) {
+		PathfinderCacheEntry *e = &s_cache[i];
+
+		if (e->lastUsed == 0) continue;
+		if (e->movementType != movementType || e->clusterSrc != clusterSrc || e->clusterDst != clusterDst) continue;
+
+		e->lastUsed = ++s_cacheAge;
+		return e;
+	}
+
+	return NULL;
+}
+
+static void
+Pathfinder_Cache_Store(uint8 movementType, uint8 clusterSrc, uint8 clusterDst, uint64_t corridor)
+{
+	PathfinderCacheEntry *e = Pathfinder_Cache_Find(movementType, clusterSrc, clusterDst);
+
+	/* Replace the least recently used entry. */
+	if (e == NULL) {
+		e = &s_cache[0];
+
+		for (int i = 1; i < PATHFINDER_CACHE_SIZE; i++) {
+			if (s_cache[i].lastUsed < e->lastUsed) e = &s_cache[i];
+		}
+	}
+
+	e->lastUsed = ++s_cacheAge;
+	e->movementType = movementType;
+	e->clusterSrc = clusterSrc;
+	e->clusterDst = clusterDst;
+	e->corridor = corridor;
+}
+
+static void
+Pathfinder_Cache_Invalidate(uint8 movementType, uint64_t clusters)
+{
+	for (int i = 0; i < PATHFINDER_CACHE_SIZE; i++) {
+		PathfinderCacheEntry *e = &s_cache[i];
+
+		if (e->movementType != movementType || (e->corridor & clusters) == 0) continue;
+
+		e->lastUsed = 0;
+	}
+}
+
+static PathfinderUnreachable *
+Pathfinder_Unreachable_Find(uint8 movementType, uint8 clusterSrc, uint16 packedDst)
+{
+	for (int i = 0; i < PATHFINDER_UNREACHABLE_SIZE; i++) {
+		PathfinderUnreachable *e = &s_unreachable[i];
+
+		if (e->lastUsed == 0) continue;
+		if (e->movementType != movementType || e->clusterSrc != clusterSrc || e->packedDst != packedDst) continue;
+
+		e->lastUsed = ++s_unreachableAge;
+		return e;
+	}
+
+	return NULL;
+}
+
+static void
+Pathfinder_Unreachable_Store(uint8 movementType, uint8 clusterSrc, uint16 packedDst, uint16 packedClosest)
+{
+	PathfinderUnreachable *e = &s_unreachable[0];
+
+	/* Replace the least recently used entry. */
+	for (int i = 1; i < PATHFINDER_UNREACHABLE_SIZE; i++) {
+		if (s_unreachable[i].lastUsed < e->lastUsed) e = &s_unreachable[i];
+	}
+
+	e->lastUsed = ++s_unreachableAge;
+	e->movementType = movementType;
+	e->clusterSrc = clusterSrc;
+	e->packedDst = packedDst;
+	e->packedClosest = packedClosest;
+}
+
+/**
+ * Any change to the landscape may connect a destination, so drop every
+ * entry of the movement type.
+ */
+static void
+Pathfinder_Unreachable_Invalidate(uint8 movementType)
+{
+	for (int i = 0; i < PATHFINDER_UNREACHABLE_SIZE; i++) {
+		PathfinderUnreachable *e = &s_unreachable[i];
+
+		if (e->movementType == movementType) e->lastUsed = 0;
+	}
+}
+
+void
+Pathfinder_Init(void)
+{
+	BinHeap_Init(&s_open, sizeof(PathfinderNode));
+	BinHeap_Init(&s_abstractOpen, sizeof(PathfinderNode));
+
+	Pathfinder_InvalidateAll();
+}
+
+void
+Pathfinder_Uninit(void)
+{
+	BinHeap_Free(&s_open);
+	BinHeap_Free(&s_abstractOpen);
+}
+
+/**
+ * Drop all clusters and cached corridors, e.g. after loading a map.
+ */
+void
+Pathfinder_InvalidateAll(void)
+{
+	for (uint8 mt = 0; mt < MOVEMENT_MAX; mt++) {
+		for (int c = 0; c < PATHFINDER_CLUSTER_MAX; c++) {
+			s_cluster[mt][c].valid = false;
+		}
+	}
+
+	memset(s_cache, 0, sizeof(s_cache));
+	s_cacheAge = 0;
+
+	memset(s_unreachable, 0, sizeof(s_unreachable));
+	s_unreachableAge = 0;
+}
+
+/**
+ * Drop the clusters and cached corridors around a tile after its
+ * landscape speed changed.
+ * @param packed The tile that changed.
+ * @param movementTypes The movement types whose speed changed, as a
+ *   mask of (1 << movementType).
+ */
+void
+Pathfinder_InvalidateTile(uint16 packed, uint8 movementTypes)
+{
+	const uint8 x = Tile_GetPackedX(packed) % PATHFINDER_CLUSTER_SIZE;
+	const uint8 y = Tile_GetPackedY(packed) % PATHFINDER_CLUSTER_SIZE;
+	const uint8 c = Pathfinder_GetCluster(packed);
+	uint64_t clusters;
+
+	if (Tile_IsOutOfMap(packed) || movementTypes == 0) return;
+
+	/* Entrances depend on the tiles on both sides of a cluster border. */
+	clusters = (uint64_t)1 << c;
+	if (x == 0 && c % PATHFINDER_CLUSTERS_PER_ROW != 0) clusters |= (uint64_t)1 << (c - 1);
+	if (x == PATHFINDER_CLUSTER_SIZE - 1 && c % PATHFINDER_CLUSTERS_PER_ROW != PATHFINDER_CLUSTERS_PER_ROW - 1) clusters |= (uint64_t)1 << (c + 1);
+	if (y == 0 && c >= PATHFINDER_CLUSTERS_PER_ROW) clusters |= (uint64_t)1 << (c - PATHFINDER_CLUSTERS_PER_ROW);
+	if (y == PATHFINDER_CLUSTER_SIZE - 1 && c < PATHFINDER_CLUSTER_MAX - PATHFINDER_CLUSTERS_PER_ROW) clusters |= (uint64_t)1 << (c + PATHFINDER_CLUSTERS_PER_ROW);
+
+	for (uint8 mt = 0; mt < MOVEMENT_MAX; mt++) {
+		if ((movementTypes & (1 << mt)) == 0) continue;
+
+		for (int i = 0; i < PATHFINDER_CLUSTER_MAX; i++) {
+			if ((clusters & ((uint64_t)1 << i)) != 0) s_cluster[mt][i].valid = false;
+		}
+
+		Pathfinder_Cache_Invalidate(mt, clusters);
+		Pathfinder_Unreachable_Invalidate(mt);
+	}
+}
+
+/**
+ * Find a route between two tiles.  The route is written to the buffer
+ * as directions, terminated by 0xFF, as Script_Unit_Pathfinder does.
+ * If the destination cannot be reached, the route leads to the
+ * reachable tile closest to it.
+ *
+ * @param u The Unit to find a route for.
+ * @param packedSrc The start tile.
+ * @param packedDst The destination tile.
+ * @param buffer The buffer to store the route in.
+ * @param bufferSize The size of the buffer.
+ * @param score Where to store the total score of the route.
+ * @return The size of the route, including the terminator.
+ */
+uint16
+Pathfinder_FindRoute(Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, int16 bufferSize, int16 *score)
+{
+	static uint8 route[MAP_SIZE_MAX * MAP_SIZE_MAX];
+	const UnitInfo *ui;
+	PathfinderQuery q;
+	PathfinderCacheEntry *e;
+	const PathfinderUnreachable *unreachable;
+	uint64_t corridor;
+	bool cached;
+	bool widened = false;
+	bool blocked;
+	bool noCorridor = false;
+	uint16 packedGoal;
+	uint16 packedEnd;
+	int routeSize;
+
+	buffer[0] = 0xFF;
+	*score = 0;
+
+	if (u == NULL || packedSrc == packedDst || bufferSize < 1) return 1;
+
+	ui = &g_table_unitInfo[u->o.type];
+
+	memset(&q, 0, sizeof(q));
+	q.unit = u;
+	q.movementType = ui->movementType;
+	q.speedFactor = g_dune2_enhanced ? ui->movingSpeedFactor : 256;
+	q.exact = (u->o.type == UNIT_SABOTEUR);
+	q.minStepCost = Pathfinder_GetMinStepCost(q.movementType, q.speedFactor);
+	q.expandMax = PATHFINDER_EXPAND_MAX;
+
+	const uint8 cSrc = Pathfinder_GetCluster(packedSrc);
+
+	/* Head for the closest tile to a destination known to be cut off. */
+	unreachable = Pathfinder_Unreachable_Find(q.movementType, cSrc, packedDst);
+	packedGoal = (unreachable != NULL) ? unreachable->packedClosest : packedDst;
+	if (packedGoal == packedSrc) return 1;
+
+	const uint8 cDst = Pathfinder_GetCluster(packedGoal);
+	q.packedDst = packedGoal;
+
+	e = Pathfinder_Cache_Find(q.movementType, cSrc, cDst);
+	cached = (e != NULL);
+	if (cached) {
+		corridor = e->corridor;
+	} else if (Pathfinder_FindCorridor(&q, packedSrc, &corridor)) {
+		Pathfinder_Cache_Store(q.movementType, cSrc, cDst, corridor);
+	} else {
+		noCorridor = true;
+		corridor = PATHFINDER_CORRIDOR_ALL;
+	}
+
+	/* A destination the unit cannot enter is never reached, so the
+	 * closest tile in the corridor will do.
+	 */
+	blocked = (Pathfinder_GetStepCost(&q, packedGoal, 0) == PATHFINDER_COST_INFINITE);
+
+	/* The corridor ignores units, and a cached corridor may have been
+	 * found for other tiles in the same clusters.  If the destination
+	 * is not reached, retry with a fresh corridor, then a wider one,
+	 * then the whole map.
+	 */
+	while (true) {
+		q.corridor = corridor;
+		packedEnd = Pathfinder_SearchTiles(&q, packedSrc);
+
+		if (packedEnd == packedGoal || blocked || corridor == PATHFINDER_CORRIDOR_ALL) break;
+
+		if (cached) {
+			cached = false;
+
+			if (Pathfinder_FindCorridor(&q, packedSrc, &corridor)) {
+				Pathfinder_Cache_Store(q.movementType, cSrc, cDst, corridor);
+			} else {
+				noCorridor = true;
+				corridor = PATHFINDER_CORRIDOR_ALL;
+			}
+		} else if (!widened) {
+			widened = true;
+			corridor = Pathfinder_DilateCorridor(corridor);
+		} else {
+			corridor = PATHFINDER_CORRIDOR_ALL;
+		}
+	}
+
+	/* Without a corridor the landscape itself cuts the destination off,
+	 * which only a change to the map undoes.  Units in the way are not
+	 * remembered, as they move.
+	 */
+	if (noCorridor && packedGoal == packedDst && packedEnd != packedDst) {
+		Pathfinder_Unreachable_Store(q.movementType, cSrc, packedDst, packedEnd);
+	}
+
+	/* Walk back from the end to the start. */
+	routeSize = 0;
+	for (uint16 packed = packedEnd; packed != packedSrc; packed -= s_mapDirection[s_parent[packed]]) {
+		route[routeSize++] = s_parent[packed];
+	}
+
+	uint16 size = 0;
+	uint16 packed = packedSrc;
+	while (routeSize > 0 && size < bufferSize - 1) {
+		const uint8 orient8 = route[--routeSize];
+
+		packed += s_mapDirection[orient8];
+		buffer[size++] = orient8;
+	}
+
+	/* Every step costs one more than its score. */
+	if (size > 0) *score = (int16)min(s_cost[packed] - size, 0x7FFF);
+
+	buffer[size++] = 0xFF;
+	return size;
+}
@@ -0,0 +1,16 @@
+/** @file src/pathfinder.h Hierarchical pathfinder definitions. */
+
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include "types.h"
+
+struct Unit;
+
+extern void Pathfinder_Init(void);
+extern void Pathfinder_Uninit(void);
+extern void Pathfinder_InvalidateAll(void);
+extern void Pathfinder_InvalidateTile(uint16 packed, uint8 movementTypes);
+extern uint16 Pathfinder_FindRoute(struct Unit *u, uint16 packedSrc, uint16 packedDst, uint8 *buffer, int16 bufferSize, int16 *score);
+
+#endif /* PATHFINDER_H */
@@ -0,0 +1,48 @@
+/**
+ * @file src/pool/pool.c
+ *
+ * Bitmaps of the used indices of a pool, one bit per index, so the
+ * first unused index in a range is found a word at a time.
+ */
+
+#include "pool.h"
+
+void
+Pool_SetUsed(uint64_t *used, uint16 index, bool set)
+{
+	const uint64_t bit = (uint64_t)1 << (index % 64);
+
+	if (set) {
+		used[index / 64] |= bit;
+	} else {
+		used[index / 64] &= ~bit;
+	}
+}
+
+/**
+ * @brief   Find the first unused index from start to end, inclusive.
+ * @return  The index, or POOL_INDEX_NONE.
+ */
+uint16
+Pool_FindUnused(const uint64_t *used, uint16 start, uint16 end)
+{
+	for (uint16 word = start / 64; word <= end / 64; word++) {
+		uint64_t unused = ~used[word];
+
+		if (word == start / 64)
+			unused &= ~(uint64_t)0 << (start % 64);
+
+		if (unused == 0)
+			continue;
+
+		uint16 index = word * 64;
+		while ((unused & 1) == 0) {
+			unused >>= 1;
+			index++;
+		}
+
+		return (index <= end) ? index : POOL_INDEX_NONE;
+	}
+
+	return POOL_INDEX_NONE;
+}
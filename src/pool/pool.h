@@ -3,9 +3,14 @@
 #ifndef POOL_POOL_H
 #define POOL_POOL_H
 
+#include <stdint.h>
 #include "enum_house.h"
 #include "types.h"
 
+enum {
+	POOL_INDEX_NONE = 0xFFFF
+};
+
 typedef struct PoolFindStruct {
 	/* House to find, or HOUSE_INVALID for all. */
 	enum HouseType houseID;
@@ -17,4 +22,7 @@ typedef struct PoolFindStruct {
 	uint16 index;
 } PoolFindStruct;
 
+extern void Pool_SetUsed(uint64_t *used, uint16 index, bool set);
+extern uint16 Pool_FindUnused(const uint64_t *used, uint16 start, uint16 end);
+
 #endif
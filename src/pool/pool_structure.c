@@ -8,6 +8,10 @@
  * in the original game when there are multiple concrete slabs or
  * walls in production.  As a result, there are quite a few special
  * cases here and wherever Structure_FindFirst/Next is used.
+ *
+ * As with Units, the used indices below STRUCTURE_INDEX_MAX_SOFT are
+ * kept in a bitmap along with each Structure's position in
+ * s_structureFindArray.  Both are rebuilt by Structure_Recount.
  */
 
 #include <assert.h>
@@ -19,6 +23,8 @@
 #include "pool.h"
 #include "pool_house.h"
 #include "../house.h"
+#include "../net/server.h"
+#include "../objectgrid.h"
 #include "../opendune.h"
 #include "../structure.h"
 #include "../newui/menubar.h"
@@ -40,6 +46,11 @@ static Structure *s_structureFindArray[STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDE
 /** variable_35F8. */
 static uint16 s_structureFindCount;
 
+static uint64_t s_structureUsed[(STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDEX_RAISED_AMOUNT + 63) / 64];
+
+/** Position of each Structure in s_structureFindArray, by index. */
+static uint16 s_structureFindPosition[STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDEX_RAISED_AMOUNT];
+
 static StructurePool s_structurePoolBackup;
 assert_compile(sizeof(s_structurePoolBackup.pool) == sizeof(s_structureArray));
 assert_compile(sizeof(s_structurePoolBackup.find) == sizeof(s_structureFindArray));
@@ -143,6 +154,50 @@ Structure_FindNext(PoolFindStruct *find)
 	return NULL;
 }
 
+/**
+ * @brief   Get the position of a Structure in the order of
+ *          Structure_FindFirst.
+ * @details Introduced for searches that need to break ties in the
+ *          same order as Structure_FindFirst.
+ */
+uint16
+Structure_GetFindIndex(const Structure *s)
+{
+	if (Structure_SharesPoolElement(s->o.type)) {
+		switch (s->o.type) {
+			case STRUCTURE_WALL:     return s_structureFindCount + 0;
+			case STRUCTURE_SLAB_2x2: return s_structureFindCount + 1;
+			default:                 return s_structureFindCount + 2;
+		}
+	}
+
+	const uint16 i = s_structureFindPosition[s->o.index];
+
+	if (i < s_structureFindCount && s_structureFindArray[i] == s)
+		return i;
+
+	return STRUCTURE_INDEX_INVALID;
+}
+
+/**
+ * @brief   Rebuild the used bitmap and find positions from
+ *          s_structureFindArray.
+ * @details Introduced.
+ */
+static void
+StructurePool_RebuildIndex(void)
+{
+	memset(s_structureUsed, 0, sizeof(s_structureUsed));
+	memset(s_structureFindPosition, 0xFF, sizeof(s_structureFindPosition));
+
+	for (uint16 i = 0; i < s_structureFindCount; i++) {
+		const uint16 index = s_structureFindArray[i]->o.index;
+
+		Pool_SetUsed(s_structureUsed, index, true);
+		s_structureFindPosition[index] = i;
+	}
+}
+
 /**
  * @brief   Initialise the Structure pool.
  * @details f__1082_0098_001C_39E2.
@@ -159,9 +214,13 @@ Structure_Init(void)
 		s_structureArray[i].o.index = i;
 	}
 
+	StructurePool_RebuildIndex();
+
 	Structure_Allocate(0, STRUCTURE_SLAB_1x1);
 	Structure_Allocate(0, STRUCTURE_SLAB_2x2);
 	Structure_Allocate(0, STRUCTURE_WALL);
+
+	ObjectGrid_RebuildStructures();
 }
 
 /**
@@ -191,6 +250,9 @@ Structure_Recount(void)
 			s_structureFindCount++;
 		}
 	}
+
+	StructurePool_RebuildIndex();
+	ObjectGrid_RebuildStructures();
 }
 
 /**
@@ -228,16 +290,17 @@ Structure_Allocate(uint16 index, enum StructureType type)
 					return NULL;
 			} else {
 				/* Find the first unused index. */
-				for (index = 0; index < StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT); index++) {
-					s = Structure_Get_ByIndex(index);
-					if (!s->o.flags.s.used)
-						break;
-				}
-				if (index == StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT))
+				index = Pool_FindUnused(s_structureUsed, 0, StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT) - 1);
+				if (index == POOL_INDEX_NONE)
 					return NULL;
+
+				s = Structure_Get_ByIndex(index);
+				assert(!s->o.flags.s.used);
 			}
 
 			assert(s_structureFindCount < StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT));
+			Pool_SetUsed(s_structureUsed, index, true);
+			s_structureFindPosition[index] = s_structureFindCount;
 			s_structureFindArray[s_structureFindCount] = s;
 			s_structureFindCount++;
 			break;
@@ -252,6 +315,9 @@ Structure_Allocate(uint16 index, enum StructureType type)
 	s->o.flags.s.used      = true;
 	s->o.flags.s.allocated = true;
 
+	ObjectGrid_UpdateStructure(s);
+	Server_MarkStructureDirty(s);
+
 	return s;
 }
 
@@ -275,13 +341,10 @@ Structure_Free(Structure *s)
 
 	/* Find the Structure to remove. */
 	assert(s_structureFindCount <= StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT));
-	for (i = 0; i < s_structureFindCount; i++) {
-		if (s_structureFindArray[i] == s)
-			break;
-	}
+	i = s_structureFindPosition[s->o.index];
 
 	/* We should always find an entry. */
-	assert(i < s_structureFindCount);
+	assert(i < s_structureFindCount && s_structureFindArray[i] == s);
 
 	s_structureFindCount--;
 
@@ -289,7 +352,16 @@ Structure_Free(Structure *s)
 	if (i < s_structureFindCount) {
 		memmove(&s_structureFindArray[i], &s_structureFindArray[i + 1],
 				(s_structureFindCount - i) * sizeof(s_structureFindArray[0]));
+
+		for (; i < s_structureFindCount; i++)
+			s_structureFindPosition[s_structureFindArray[i]->o.index] = i;
 	}
+
+	Pool_SetUsed(s_structureUsed, s->o.index, false);
+	s_structureFindPosition[s->o.index] = STRUCTURE_INDEX_INVALID;
+
+	ObjectGrid_UpdateStructure(s);
+	Server_MarkStructureDirty(s);
 }
 
 /*--------------------------------------------------------------*/
@@ -328,6 +400,9 @@ StructurePool_Load(StructurePool *pool)
 	s_structureFindCount = pool->count;
 
 	pool->allocated = false;
+
+	StructurePool_RebuildIndex();
+	ObjectGrid_RebuildStructures();
 }
 
 uint16
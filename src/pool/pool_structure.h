@@ -31,6 +31,7 @@ extern bool Structure_SharesPoolElement(enum StructureType type);
 extern struct Structure *Structure_Get_ByIndex(uint16 index);
 extern struct Structure *Structure_FindFirst(struct PoolFindStruct *find, enum HouseType houseID, enum StructureType type);
 extern struct Structure *Structure_FindNext(struct PoolFindStruct *find);
+extern uint16 Structure_GetFindIndex(const struct Structure *s);
 
 extern void Structure_Init(void);
 extern void Structure_Recount(void);
@@ -2,6 +2,10 @@
  * @file src/pool/pool_unit.c
  *
  * %Unit pool routines.
+ *
+ * The used indices are also kept in a bitmap, and the position of each
+ * Unit in g_unitFindArray is remembered, so that allocating and finding
+ * a Unit do not scan the pool.  Both are rebuilt by Unit_Recount.
  */
 
 #include <assert.h>
@@ -12,6 +16,8 @@
 #include "pool.h"
 #include "pool_house.h"
 #include "../house.h"
+#include "../net/server.h"
+#include "../objectgrid.h"
 #include "../opendune.h"
 #include "../unit.h"
 #include "../scenario.h"
@@ -32,6 +38,11 @@ struct Unit *g_unitFindArray[UNIT_INDEX_MAX_RAISED];
 /** variable_35EC. */
 uint16 g_unitFindCount;
 
+static uint64_t s_unitUsed[(UNIT_INDEX_MAX_RAISED + 63) / 64];
+
+/** Position of each Unit in g_unitFindArray, by index. */
+static uint16 s_unitFindPosition[UNIT_INDEX_MAX_RAISED];
+
 static UnitPool s_unitPoolBackup;
 assert_compile(sizeof(s_unitPoolBackup.pool) == sizeof(s_unitArray));
 assert_compile(sizeof(s_unitPoolBackup.find) == sizeof(g_unitFindArray));
@@ -101,6 +112,41 @@ Unit_FindNext(PoolFindStruct *find)
 	return NULL;
 }
 
+/**
+ * @brief   Get the position of a Unit in g_unitFindArray.
+ * @details Introduced for searches that need to break ties in the
+ *          same order as Unit_FindFirst.
+ */
+uint16
+Unit_GetFindIndex(const Unit *u)
+{
+	const uint16 i = s_unitFindPosition[u->o.index];
+
+	if (i < g_unitFindCount && g_unitFindArray[i] == u)
+		return i;
+
+	return UNIT_INDEX_INVALID;
+}
+
+/**
+ * @brief   Rebuild the used bitmap and find positions from
+ *          g_unitFindArray.
+ * @details Introduced.
+ */
+static void
+UnitPool_RebuildIndex(void)
+{
+	memset(s_unitUsed, 0, sizeof(s_unitUsed));
+	memset(s_unitFindPosition, 0xFF, sizeof(s_unitFindPosition));
+
+	for (uint16 i = 0; i < g_unitFindCount; i++) {
+		const uint16 index = g_unitFindArray[i]->o.index;
+
+		Pool_SetUsed(s_unitUsed, index, true);
+		s_unitFindPosition[index] = i;
+	}
+}
+
 /**
  * @brief   Initialise the Unit pool.
  * @details f__0FE4_013F_001C_39CA.
@@ -116,6 +162,9 @@ Unit_Init(void)
 	for (unsigned int i = 0; i < UnitPool_GetMaxIndex(); i++) {
 		s_unitArray[i].o.index = i;
 	}
+
+	UnitPool_RebuildIndex();
+	ObjectGrid_RebuildUnits();
 }
 
 /**
@@ -146,6 +195,9 @@ Unit_Recount(void)
 			g_unitFindCount++;
 		}
 	}
+
+	UnitPool_RebuildIndex();
+	ObjectGrid_RebuildUnits();
 }
 
 /**
@@ -177,13 +229,12 @@ Unit_Allocate(uint16 index, enum UnitType type, enum HouseType houseID)
 				return NULL;
 		} else {
 			/* Find the first unused index. */
-			for (index = ui->indexStart; index <= UnitPool_GetIndexEnd(type); index++) {
-				u = Unit_Get_ByIndex(index);
-				if (!u->o.flags.s.used)
-					break;
-			}
-			if (index > UnitPool_GetIndexEnd(type))
+			index = Pool_FindUnused(s_unitUsed, ui->indexStart, UnitPool_GetIndexEnd(type));
+			if (index == POOL_INDEX_NONE)
 				return NULL;
+
+			u = Unit_Get_ByIndex(index);
+			assert(!u->o.flags.s.used);
 		}
 
 		h->unitCount++;
@@ -212,9 +263,14 @@ Unit_Allocate(uint16 index, enum UnitType type, enum HouseType houseID)
 	u->squadID = SQUADID_INVALID;
 	u->aiSquad = SQUADID_INVALID;
 
+	Pool_SetUsed(s_unitUsed, index, true);
+	s_unitFindPosition[index] = g_unitFindCount;
 	g_unitFindArray[g_unitFindCount] = u;
 	g_unitFindCount++;
 
+	ObjectGrid_UpdateUnit(u);
+	Server_MarkUnitDirty(u);
+
 	return u;
 }
 
@@ -232,24 +288,32 @@ Unit_Free(Unit *u)
 	Script_Reset(&u->o.script, g_scriptUnit);
 
 	/* Find the Unit to remove. */
-	for (i = 0; i < g_unitFindCount; i++) {
-		if (g_unitFindArray[i] == u)
-			break;
-	}
+	i = s_unitFindPosition[u->o.index];
 
 	/* We should always find an entry. */
-	assert(i < g_unitFindCount);
+	assert(i < g_unitFindCount && g_unitFindArray[i] == u);
 
 	g_unitFindCount--;
 
 	House *h = House_Get_ByIndex(u->o.houseID);
 	h->unitCount--;
 
-	/* If needed, close the gap. */
+	/* If needed, close the gap.  This keeps the order that
+	 * Unit_FindFirst visits Units in, which the game logic depends on.
+	 */
 	if (i < g_unitFindCount) {
 		memmove(&g_unitFindArray[i], &g_unitFindArray[i + 1],
 				(g_unitFindCount - i) * sizeof(g_unitFindArray[0]));
+
+		for (; i < g_unitFindCount; i++)
+			s_unitFindPosition[g_unitFindArray[i]->o.index] = i;
 	}
+
+	Pool_SetUsed(s_unitUsed, u->o.index, false);
+	s_unitFindPosition[u->o.index] = UNIT_INDEX_INVALID;
+
+	ObjectGrid_UpdateUnit(u);
+	Server_MarkUnitDirty(u);
 }
 
 /*--------------------------------------------------------------*/
@@ -288,6 +352,9 @@ UnitPool_Load(UnitPool *pool)
 	g_unitFindCount = pool->count;
 
 	pool->allocated = false;
+
+	UnitPool_RebuildIndex();
+	ObjectGrid_RebuildUnits();
 }
 
 /**
@@ -27,6 +27,7 @@ extern uint16 g_unitFindCount;
 extern struct Unit *Unit_Get_ByIndex(uint16 index);
 extern struct Unit *Unit_FindFirst(struct PoolFindStruct *find, enum HouseType houseID, enum UnitType type);
 extern struct Unit *Unit_FindNext(struct PoolFindStruct *find);
+extern uint16 Unit_GetFindIndex(const struct Unit *u);
 
 extern void Unit_Init(void);
 extern void Unit_Recount(void);
@@ -0,0 +1,222 @@
+/** @file src/profiler.c
+ *
+ * Frame profiler.
+ *
+ * Profiler_Begin and Profiler_End mark where a scope starts and ends.
+ * Every scope that ends goes in a ring buffer of the latest events,
+ * which can be written out as a Chrome trace to look at in
+ * chrome://tracing or Perfetto.
+ *
+ * The time in each scope is also added up for every frame, with and
+ * without the scopes inside it, and kept for the last
+ * PROFILER_FRAME_MAX frames for the overlay.
+ *
+ * Nothing is allocated; the oldest events and frames are overwritten.
+ */
+
+#include <allegro5/allegro.h>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os/math.h"
+
+#include "profiler.h"
+
+enum {
+	PROFILER_EVENT_MAX = 16384,
+	PROFILER_DEPTH_MAX = 16
+};
+
+typedef struct ProfilerEvent {
+	double start;                                           /*!< Seconds, from al_get_time. */
+	float duration;                                         /*!< Seconds. */
+	uint8 scope;
+} ProfilerEvent;
+
+typedef struct ProfilerFrame {
+	float total[PROFILER_SCOPE_MAX];                        /*!< Milliseconds in the scope. */
+	float self[PROFILER_SCOPE_MAX];                         /*!< Milliseconds not in a scope inside it. */
+} ProfilerFrame;
+
+static const char * const s_name[PROFILER_SCOPE_MAX] = {
+	"GameLoop_Loop",
+	"GameLoop_ProcessGameTimer",
+	"GameLoop_Unit",
+	"GameLoop_Structure",
+	"GameLoop_Client_Draw",
+	"Viewport_DrawTiles",
+	"Server_SendMessages",
+	"Client_RecvMessages",
+	"Audio_Poll",
+};
+
+static ProfilerEvent s_event[PROFILER_EVENT_MAX];
+static int s_eventNext;
+static int s_eventCount;
+
+static ProfilerFrame s_frame[PROFILER_FRAME_MAX];
+static int s_frameNext;                                     /*!< The frame being recorded. */
+static int s_frameCount;                                    /*!< Frames recorded before it. */
+
+static struct {
+	enum ProfilerScope scope;
+	double start;
+	double children;                                        /*!< Seconds in scopes inside it. */
+} s_stack[PROFILER_DEPTH_MAX];
+static int s_depth;
+
+void
+Profiler_Begin(enum ProfilerScope scope)
+{
+	if (scope >= PROFILER_SCOPE_MAX)
+		return;
+
+	/* Scopes nested too deep are not recorded. */
+	if (s_depth < PROFILER_DEPTH_MAX) {
+		s_stack[s_depth].scope = scope;
+		s_stack[s_depth].children = 0.0;
+		s_stack[s_depth].start = al_get_time();
+	}
+
+	s_depth++;
+}
+
+void
+Profiler_End(enum ProfilerScope scope)
+{
+	if (scope >= PROFILER_SCOPE_MAX)
+		return;
+
+	assert(s_depth > 0);
+	if (--s_depth >= PROFILER_DEPTH_MAX)
+		return;
+
+	assert(s_stack[s_depth].scope == scope);
+
+	const double duration = al_get_time() - s_stack[s_depth].start;
+	ProfilerEvent *e = &s_event[s_eventNext];
+	ProfilerFrame *f = &s_frame[s_frameNext];
+
+	e->start = s_stack[s_depth].start;
+	e->duration = duration;
+	e->scope = scope;
+	s_eventNext = (s_eventNext + 1) % PROFILER_EVENT_MAX;
+	s_eventCount = min(s_eventCount + 1, PROFILER_EVENT_MAX);
+
+	f->total[scope] += 1e3 * duration;
+	f->self[scope] += 1e3 * (duration - s_stack[s_depth].children);
+
+	if (s_depth > 0)
+		s_stack[s_depth - 1].children += duration;
+}
+
+/**
+ * Finish the frame, and start adding up the next one.
+ */
+void
+Profiler_EndFrame(void)
+{
+	s_frameNext = (s_frameNext + 1) % PROFILER_FRAME_MAX;
+	s_frameCount = min(s_frameCount + 1, PROFILER_FRAME_MAX - 1);
+	memset(&s_frame[s_frameNext], 0, sizeof(s_frame[0]));
+}
+
+const char *
+Profiler_GetName(enum ProfilerScope scope)
+{
+	assert(scope < PROFILER_SCOPE_MAX);
+
+	return s_name[scope];
+}
+
+int
+Profiler_GetFrameCount(void)
+{
+	return s_frameCount;
+}
+
+static const ProfilerFrame *
+Profiler_GetFrame(int frame)
+{
+	assert(0 <= frame && frame < s_frameCount);
+
+	return &s_frame[(s_frameNext - 1 - frame + PROFILER_FRAME_MAX) % PROFILER_FRAME_MAX];
+}
+
+/**
+ * @param frame 0 for the last frame finished, 1 for the one before it,
+ *        and so on.
+ * @return The milliseconds in the scope but not in a scope inside it,
+ *         so that the scopes add up to the frame time.
+ */
+float
+Profiler_GetSelfTime(int frame, enum ProfilerScope scope)
+{
+	assert(scope < PROFILER_SCOPE_MAX);
+
+	return Profiler_GetFrame(frame)->self[scope];
+}
+
+static int
+Profiler_CompareFloat(const void *a, const void *b)
+{
+	const float x = *(const float *)a;
+	const float y = *(const float *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * Get the median and 99th percentile of the milliseconds per frame in
+ * the scope, over the frames kept.
+ */
+void
+Profiler_GetPercentiles(enum ProfilerScope scope, float *p50, float *p99)
+{
+	static float l_total[PROFILER_FRAME_MAX];
+
+	assert(scope < PROFILER_SCOPE_MAX);
+
+	if (s_frameCount == 0) {
+		*p50 = 0.0f;
+		*p99 = 0.0f;
+		return;
+	}
+
+	for (int i = 0; i < s_frameCount; i++)
+		l_total[i] = Profiler_GetFrame(i)->total[scope];
+
+	qsort(l_total, s_frameCount, sizeof(l_total[0]), Profiler_CompareFloat);
+
+	*p50 = l_total[(s_frameCount - 1) * 50 / 100];
+	*p99 = l_total[(s_frameCount - 1) * 99 / 100];
+}
+
+/**
+ * Write the events in the ring buffer as a Chrome trace.
+ */
+bool
+Profiler_DumpTrace(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+
+	if (fp == NULL)
+		return false;
+
+	const int first = (s_eventNext - s_eventCount + PROFILER_EVENT_MAX) % PROFILER_EVENT_MAX;
+	const double epoch = s_event[first].start;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	for (int i = 0; i < s_eventCount; i++) {
+		const ProfilerEvent *e = &s_event[(first + i) % PROFILER_EVENT_MAX];
+
+		fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				(i == 0) ? "" : ",", s_name[e->scope],
+				1e6 * (e->start - epoch), 1e6 * e->duration);
+	}
+
+	fprintf(fp, "\n]}\n");
+	return (fclose(fp) == 0);
+}
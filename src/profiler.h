@@ -0,0 +1,37 @@
+/** @file src/profiler.h Frame profiler. */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "types.h"
+
+enum ProfilerScope {
+	PROFILER_LOOP,
+	PROFILER_GAME_TIMER,
+	PROFILER_UNIT,
+	PROFILER_STRUCTURE,
+	PROFILER_CLIENT_DRAW,
+	PROFILER_VIEWPORT_TILES,
+	PROFILER_SERVER_SEND,
+	PROFILER_CLIENT_RECV,
+	PROFILER_AUDIO_POLL,
+
+	PROFILER_SCOPE_MAX,
+	PROFILER_NONE = PROFILER_SCOPE_MAX
+};
+
+enum {
+	PROFILER_FRAME_MAX = 240
+};
+
+extern void Profiler_Begin(enum ProfilerScope scope);
+extern void Profiler_End(enum ProfilerScope scope);
+extern void Profiler_EndFrame(void);
+
+extern const char *Profiler_GetName(enum ProfilerScope scope);
+extern int Profiler_GetFrameCount(void);
+extern float Profiler_GetSelfTime(int frame, enum ProfilerScope scope);
+extern void Profiler_GetPercentiles(enum ProfilerScope scope, float *p50, float *p99);
+extern bool Profiler_DumpTrace(const char *filename);
+
+#endif
@@ -1,7 +1,24 @@
-/** @file src/save.c Save routines. */
+/** @file src/save.c
+ *
+ * Save routines.
+ *
+ * The game is first saved into a buffer in memory, which only takes a
+ * moment.  A thread then writes the buffer to a temporary file, syncs
+ * it to disk, and renames it over the savegame, so a crash while
+ * writing never leaves half a savegame behind.  Saving again, loading,
+ * or looking for savegames waits for the previous write to finish.
+ */
 
+#include <allegro5/allegro.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef ALLEGRO_WINDOWS
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 #include "errorlog.h"
 #include "types.h"
 
@@ -27,124 +44,259 @@
 #include "team.h"
 #include "unit.h"
 
+/**
+ * A savegame being written by the writer thread.
+ */
+typedef struct SaveWriter {
+	ALLEGRO_THREAD *thread;                                 /*!< NULL if nothing is being written. */
+	FILE *fp;                                               /*!< The temporary file, already open. */
+	char tmpname[1024];
+	char filename[1024];
+	uint8 *buffer;                                          /*!< The savegame, freed once written. */
+	uint32 length;
+	double snapshotTime;                                    /*!< Milliseconds to fill the buffer. */
+	bool failed;                                            /*!< True if the last savegame failed to be written. */
+} SaveWriter;
+
+static SaveWriter s_writer;
+
+/**
+ * Overwrite a length field already in the buffer, big endian.
+ * @param sb The buffer holding the savegame.
+ * @param position The offset of the length field.
+ * @param length The length to store.
+ */
+static void
+Save_PatchLength(SaveBuffer *sb, uint32 position, uint32 length)
+{
+	const uint32 lengthSwapped = HTOBE32(length);
+
+	memcpy(sb->data + position, &lengthSwapped, 4);
+}
+
 /**
  * Save a chunk of data.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @param header The chunk identification string (4 chars, always).
  * @param saveProc The proc to call to generate the content of the chunk.
  * @return True if and only if all bytes were written successful.
  */
-static bool Save_Chunk(FILE *fp, const char *header, bool (*saveProc)(FILE *fp))
+static bool Save_Chunk(SaveBuffer *sb, const char *header, bool (*saveProc)(SaveBuffer *sb))
 {
 	uint32 position;
 	uint32 length;
-	uint32 lengthSwapped;
 
-	if (fwrite(header, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, header, 4)) return false;
 
 	/* Reserve the length field */
 	length = 0;
-	if (fwrite(&length, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &length, 4)) return false;
 
 	/* Store the content of the chunk, and remember the length */
-	position = ftell(fp);
-	if (!saveProc(fp)) return false;
-	length = ftell(fp) - position;
+	position = sb->length;
+	if (!saveProc(sb)) return false;
+	length = sb->length - position;
 
 	/* Ensure we are word aligned */
 	if ((length & 1) == 1) {
 		uint8 empty = 0;
-		if (fwrite(&empty, 1, 1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &empty, 1)) return false;
 	}
 
 	/* Write back the chunk size */
-	fseek(fp, position - 4, SEEK_SET);
-	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
-	fseek(fp, 0, SEEK_END);
+	Save_PatchLength(sb, position - 4, length);
 
 	return true;
 }
 
 /**
  * Save the game for real. It creates all the required chunks and stores them
- *  to the file. It updates the field lengths where needed.
+ *  in the buffer. It updates the field lengths where needed.
  *
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @param description The description of the savegame.
  * @return True if and only if all bytes were written successful.
  */
 static bool
-Save_Main(FILE *fp, const char *description)
+Save_Main(SaveBuffer *sb, const char *description)
 {
 	uint32 length;
 	uint32 lengthSwapped;
 
 	/* Write the 'FORM' chunk (in which all other chunks are) */
-	if (fwrite("FORM", 4, 1, fp) != 1) return false;
-	/* Write zero length for now. We come back to this value before closing */
+	if (!SaveBuffer_Write(sb, "FORM", 4)) return false;
+	/* Write zero length for now. We come back to this value at the end */
 	length = 0;
-	if (fwrite(&length, 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &length, 4)) return false;
 
 	/* Write the 'SCEN' chunk. Never contains content. */
-	if (fwrite("SCEN", 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, "SCEN", 4)) return false;
 
 	/* Write the 'NAME' chunk. Keep ourself word-aligned. */
-	if (fwrite("NAME", 4, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, "NAME", 4)) return false;
 	length = min(255, strlen(description) + 1);
 	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
-	if (fwrite(description, length, 1, fp) != 1) return false;
+	if (!SaveBuffer_Write(sb, &lengthSwapped, 4)) return false;
+	if (!SaveBuffer_Write(sb, description, length)) return false;
 	/* Ensure we are word aligned */
 	if ((length & 1) == 1) {
 		uint8 empty = 0;
-		if (fwrite(&empty, 1, 1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &empty, 1)) return false;
 	}
 
 	/* Store all additional chunks */
-	if (!Save_Chunk(fp, "INFO", &Info_Save)) return false;
-	if (!Save_Chunk(fp, "PLYR", &House_Save)) return false;
-	if (!Save_Chunk(fp, "UNIT", &Unit_Save)) return false;
-	if (!Save_Chunk(fp, "BLDG", &Structure_Save)) return false;
-	if (!Save_Chunk(fp, "MAP ", &Map_Save)) return false;
-	if (!Save_Chunk(fp, "TEAM", &Team_Save)) return false;
-	if (!Save_Chunk(fp, "ODUN", &UnitNew_Save)) return false;
+	if (!Save_Chunk(sb, "INFO", &Info_Save)) return false;
+	if (!Save_Chunk(sb, "PLYR", &House_Save)) return false;
+	if (!Save_Chunk(sb, "UNIT", &Unit_Save)) return false;
+	if (!Save_Chunk(sb, "BLDG", &Structure_Save)) return false;
+	if (!Save_Chunk(sb, "MAP ", &Map_Save)) return false;
+	if (!Save_Chunk(sb, "TEAM", &Team_Save)) return false;
+	if (!Save_Chunk(sb, "ODUN", &UnitNew_Save)) return false;
 
 	/* Store Dune Dynasty extensions. */
 	if (g_campaign_selected == CAMPAIGNID_SKIRMISH) {
-		if (!Save_Chunk(fp, "DDS2", &Scenario_Save2)) return false;
-		if (!Save_Chunk(fp, "DDS4", &Scenario_Save4)) return false;
+		if (!Save_Chunk(sb, "DDS2", &Scenario_Save2)) return false;
+		if (!Save_Chunk(sb, "DDS4", &Scenario_Save4)) return false;
 	}
 
-	if (!Save_Chunk(fp, "DDS3", &Scenario_Save3)) return false;
-	if (!Save_Chunk(fp, "DDI2", &Info_Save2)) return false;
-	if (!Save_Chunk(fp, "DDH2", &House_Save2)) return false;
-	if (!Save_Chunk(fp, "DDM2", &Map_Save2)) return false;
-	if (!Save_Chunk(fp, "DDB2", &Structure_Save2)) return false;
-	if (!Save_Chunk(fp, "DDU2", &Unit_Save2)) return false;
-	if (!Save_Chunk(fp, "DDAI", &BrutalAI_Save)) return false;
+	if (!Save_Chunk(sb, "DDS3", &Scenario_Save3)) return false;
+	if (!Save_Chunk(sb, "DDI2", &Info_Save2)) return false;
+	if (!Save_Chunk(sb, "DDH2", &House_Save2)) return false;
+	if (!Save_Chunk(sb, "DDM2", &Map_Save2)) return false;
+	if (!Save_Chunk(sb, "DDB2", &Structure_Save2)) return false;
+	if (!Save_Chunk(sb, "DDU2", &Unit_Save2)) return false;
+	if (!Save_Chunk(sb, "DDAI", &BrutalAI_Save)) return false;
 
 	/* Write the total length of all data in the FORM chunk */
-	length = ftell(fp) - 8;
-	fseek(fp, 4, SEEK_SET);
-	lengthSwapped = HTOBE32(length);
-	if (fwrite(&lengthSwapped, 4, 1, fp) != 1) return false;
+	Save_PatchLength(sb, 4, sb->length - 8);
 
 	return true;
 }
 
 /**
- * Save the game to a filename
+ * Save the game into a buffer in memory.
+ *
+ * @param description The description of the savegame.
+ * @param length Where to store the length of the savegame.
+ * @return The savegame, to be freed by the caller, or NULL on failure.
+ */
+static uint8 *
+Save_Snapshot(const char *description, uint32 *length)
+{
+	SaveBuffer sb;
+
+	sb.data = NULL;
+	sb.length = 0;
+	sb.size = 0;
+
+	if (!Save_Main(&sb, description)) {
+		free(sb.data);
+		return NULL;
+	}
+
+	*length = sb.length;
+	return sb.data;
+}
+
+static bool
+Save_Sync(FILE *fp)
+{
+	if (fflush(fp) != 0) return false;
+
+#ifdef ALLEGRO_WINDOWS
+	return (_commit(_fileno(fp)) == 0);
+#else
+	return (fsync(fileno(fp)) == 0);
+#endif
+}
+
+static bool
+Save_Rename(const char *tmpname, const char *filename)
+{
+#ifdef ALLEGRO_WINDOWS
+	/* rename does not replace an existing file here; MoveFileEx does,
+	 *  without a moment where neither file is in place. */
+	return (MoveFileExA(tmpname, filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+#else
+	return (rename(tmpname, filename) == 0);
+#endif
+}
+
+static void
+Save_Writer_Run(SaveWriter *w)
+{
+	const double start = al_get_time();
+	bool res;
+
+	res = (fwrite(w->buffer, w->length, 1, w->fp) == 1) && Save_Sync(w->fp);
+	if (fclose(w->fp) != 0) res = false;
+	w->fp = NULL;
+
+	if (res) res = Save_Rename(w->tmpname, w->filename);
+
+	free(w->buffer);
+	w->buffer = NULL;
+	w->failed = !res;
+
+	if (!res) {
+		remove(w->tmpname);
+
+		Error("Error while writing savegame.\n");
+		return;
+	}
+
+	fprintf(stdout, "save: %s, %u bytes, snapshot %.2fms, write %.2fms\n",
+			w->filename, w->length, w->snapshotTime, 1e3 * (al_get_time() - start));
+}
+
+static void *
+Save_Writer_ThreadProc(ALLEGRO_THREAD *thread, void *arg)
+{
+	VARIABLE_NOT_USED(thread);
+
+	Save_Writer_Run(arg);
+	return NULL;
+}
+
+/**
+ * Wait for the savegame being written, if any, to be on disk.
+ *
+ * @return False if the last savegame failed to be written.  This is
+ *  only reported once.
+ */
+bool
+Save_Wait(void)
+{
+	bool res;
+
+	if (s_writer.thread != NULL) {
+		al_join_thread(s_writer.thread, NULL);
+		al_destroy_thread(s_writer.thread);
+		s_writer.thread = NULL;
+	}
+
+	res = !s_writer.failed;
+	s_writer.failed = false;
+	return res;
+}
+
+/**
+ * Save the game to a filename.  The savegame is written in the
+ *  background; Save_Wait tells whether that succeeded.
  *
  * @param fp The filename of the savegame.
  * @param description The description of the savegame.
- * @return True if and only if all bytes were written successful.
+ * @return True if and only if the savegame is being written.
  */
 bool
 SaveFile(const char *filename, const char *description)
 {
+	SaveWriter *w = &s_writer;
+	char tmpname[1024];
+	uint8 *buffer;
+	uint32 length;
+	double snapshotTime;
 	FILE *fp;
-	bool res;
 
 	/* In debug-scenario mode, the whole map is uncovered. Cover it now in
 	 *  the savegame based on the current position of the units and
@@ -178,24 +330,44 @@ SaveFile(const char *filename, const char *description)
 		}
 	}
 
-	fp = File_Open_CaseInsensitive(SEARCHDIR_PERSONAL_DATA_DIR, filename, "wb");
-	if (fp == NULL) {
-		GUI_DisplayModalMessage("Failed to open file '%s' for writing.", SHAPE_INVALID, filename);
-		return false;
-	}
+	snapshotTime = al_get_time();
 
 	g_validateStrictIfZero++;
-	res = Save_Main(fp, description);
+	buffer = Save_Snapshot(description, &length);
 	g_validateStrictIfZero--;
 
-	fclose(fp);
-
-	if (!res) {
-		/* TODO -- Also remove the savegame now */
+	snapshotTime = 1e3 * (al_get_time() - snapshotTime);
 
+	if (buffer == NULL) {
 		Error("Error while writing savegame.\n");
 		return false;
 	}
 
+	/* The previous savegame could still be written to the same file. */
+	Save_Wait();
+
+	snprintf(tmpname, sizeof(tmpname), "%s.TMP", filename);
+	fp = File_Open_CaseInsensitive(SEARCHDIR_PERSONAL_DATA_DIR, tmpname, "wb");
+	if (fp == NULL) {
+		free(buffer);
+		GUI_DisplayModalMessage("Failed to open file '%s' for writing.", SHAPE_INVALID, filename);
+		return false;
+	}
+
+	File_MakeCompleteFilename(w->tmpname, sizeof(w->tmpname), SEARCHDIR_PERSONAL_DATA_DIR, tmpname, false);
+	File_MakeCompleteFilename(w->filename, sizeof(w->filename), SEARCHDIR_PERSONAL_DATA_DIR, filename, false);
+	w->fp = fp;
+	w->buffer = buffer;
+	w->length = length;
+	w->snapshotTime = snapshotTime;
+
+	w->thread = al_create_thread(Save_Writer_ThreadProc, w);
+	if (w->thread != NULL) {
+		al_start_thread(w->thread);
+	} else {
+		Save_Writer_Run(w);
+		return Save_Wait();
+	}
+
 	return true;
 }
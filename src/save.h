@@ -3,6 +3,7 @@
 #ifndef SAVE_H
 #define SAVE_H
 
+extern bool Save_Wait(void);
 extern bool SaveFile(const char *filename, const char *description);
 
 #endif /* SAVE_H */
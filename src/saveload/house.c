@@ -123,17 +123,17 @@ bool House_LoadOld(FILE *fp, uint32 length)
 
 /**
  * Save all Houses to a file.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool House_Save(FILE *fp)
+bool House_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (House *h = House_FindFirst(&find, HOUSE_INVALID);
 			h != NULL;
 			h = House_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveHouse, fp, h)) return false;
+		if (!SaveLoad_Save(s_saveHouse, sb, h)) return false;
 	}
 
 	return true;
@@ -166,14 +166,14 @@ House_Load2(FILE *fp, uint32 length)
 }
 
 bool
-House_Save2(FILE *fp)
+House_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (House *h = House_FindFirst(&find, HOUSE_INVALID);
 			h != NULL;
 			h = House_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveHouse2, fp, h))
+		if (!SaveLoad_Save(s_saveHouse2, sb, h))
 			return false;
 	}
 
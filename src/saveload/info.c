@@ -179,10 +179,10 @@ Info_Load_PlayerHouseGlobals(House *h)
 
 /**
  * Save all kinds of important info to the savegame.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Info_Save(FILE *fp)
+bool Info_Save(SaveBuffer *sb)
 {
 	const uint16 savegameVersion = 0x0290;
 
@@ -200,10 +200,10 @@ bool Info_Save(FILE *fp)
 		s_starportID            = STRUCTURE_INDEX_INVALID;
 	}
 
-	if (!fwrite_le_uint16(savegameVersion, fp)) return false;
+	if (!SaveBuffer_WriteLE16(sb, savegameVersion)) return false;
 
 	Scenario_Save_OldStats();
-	if (!SaveLoad_Save(s_saveInfo, fp, NULL)) return false;
+	if (!SaveLoad_Save(s_saveInfo, sb, NULL)) return false;
 
 	return true;
 }
@@ -233,13 +233,13 @@ Info_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Info_Save2(FILE *fp)
+Info_Save2(SaveBuffer *sb)
 {
 	int iter;
 
 	Unit *u = Unit_FirstSelected(&iter);
 	while (u != NULL) {
-		if (!SaveLoad_Save(s_saveInfo2, fp, u))
+		if (!SaveLoad_Save(s_saveInfo2, sb, u))
 			return false;
 
 		u = Unit_NextSelected(&iter);
@@ -4,6 +4,7 @@
 
 #include "saveload.h"
 #include "../map.h"
+#include "../minimap.h"
 #include "../sprites.h"
 #include "../timer/timer.h"
 
@@ -33,15 +34,16 @@ static bool fread_tile(Tile *t, FILE *fp)
 /**
  * Save a Tile structure to a file (Little endian)
  *
+ * @param packed The tile position
  * @param t The tile to save
- * @param fp The stream
+ * @param sb The buffer
  * @return True if the tile was saved successfully
  */
-static bool fwrite_tile(const Tile *t, const FogOfWarTile *f, FILE *fp)
+static bool fwrite_tile(uint16 packed, const Tile *t, const FogOfWarTile *f, SaveBuffer *sb)
 {
 	uint8 buffer[4];
 	uint8 overlaySpriteID = f->fogSpriteID ? f->fogSpriteID : t->overlaySpriteID;
-	const bool isUnveiled = f->isUnveiled & (1 << g_playerHouseID);
+	const bool isUnveiled = Map_IsUnveiledToHouse(g_playerHouseID, packed);
 
 	buffer[0] = t->groundSpriteID & 0xff;
 	buffer[1] = (t->groundSpriteID >> 8) | (overlaySpriteID << 1);
@@ -52,7 +54,7 @@ static bool fwrite_tile(const Tile *t, const FogOfWarTile *f, FILE *fp)
 	          | (t->hasAnimation << 6)
 	          | (t->hasExplosion << 7);
 	buffer[3] = t->index;
-	if (fwrite(buffer, 1, 4, fp) != 4) return false;
+	if (!SaveBuffer_Write(sb, buffer, 4)) return false;
 	return true;
 }
 
@@ -95,10 +97,10 @@ bool Map_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Tiles to a file.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Map_Save(FILE *fp)
+bool Map_Save(SaveBuffer *sb)
 {
 	uint16 i;
 
@@ -106,8 +108,8 @@ bool Map_Save(FILE *fp)
 		Tile *tile = &g_map[i];
 
 		/* Store the index, then the tile itself */
-		if (!fwrite_le_uint16(i, fp)) return false;
-		if (!fwrite_tile(tile, &g_mapVisible[i], fp)) return false;
+		if (!SaveBuffer_WriteLE16(sb, i)) return false;
+		if (!fwrite_tile(i, tile, &g_mapVisible[i], sb)) return false;
 	}
 
 	return true;
@@ -119,17 +121,21 @@ bool Map_Save(FILE *fp)
 void
 Map_Load2Fallback(void)
 {
+	memset(g_mapFogOfWar.unveiled, 0, sizeof(g_mapFogOfWar.unveiled));
+	memset(g_mapFogOfWar.timeout, 0, sizeof(g_mapFogOfWar.timeout));
+
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		Tile *t = &g_map[packed];
 		FogOfWarTile *f = &g_mapVisible[packed];
 
-		memset(f->timeout, 0, sizeof(f->timeout));
 		f->groundSpriteID   = t->groundSpriteID;
 		f->houseID          = t->houseID;
 		f->hasStructure     = t->hasStructure;
-		f->isUnveiled       = t->isUnveiled_ ? (1 << g_playerHouseID) : 0;
 		f->fogOverlayBits   = 0;
 
+		if (t->isUnveiled_)
+			Map_SetUnveiledToHouse(g_playerHouseID, packed);
+
 		if (g_veiledSpriteID - 16 <= t->overlaySpriteID && t->overlaySpriteID <= g_veiledSpriteID) {
 			f->fogSpriteID      = t->overlaySpriteID;
 			f->overlaySpriteID  = 0;
@@ -139,6 +145,9 @@ Map_Load2Fallback(void)
 			f->overlaySpriteID  = t->overlaySpriteID;
 		}
 	}
+
+	Map_InvalidateVisibleAll();
+	Minimap_InvalidateAll();
 }
 
 bool
@@ -160,7 +169,7 @@ Map_Load2(FILE *fp, uint32 length)
 		FogOfWarTile *f = &g_mapVisible[packed];
 
 		for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++)
-			f->timeout[h]   = (timeout == 0) ? 0 : (g_timerGame + timeout);
+			Map_SetTileTimeout(h, packed, (timeout == 0) ? 0 : (g_timerGame + timeout));
 
 		f->groundSpriteID   = (spriteID & 0x1FF);
 		f->houseID          = houseID;
@@ -176,25 +185,28 @@ Map_Load2(FILE *fp, uint32 length)
 		length -= 3 * sizeof(uint16) + 2 * sizeof(uint8);
 	}
 
+	Map_InvalidateVisibleAll();
+	Minimap_InvalidateAll();
 	return true;
 }
 
 bool
-Map_Save2(FILE *fp)
+Map_Save2(SaveBuffer *sb)
 {
 	for (uint16 packed = 0; packed < MAP_SIZE_MAX * MAP_SIZE_MAX; packed++) {
 		const FogOfWarTile *f = &g_mapVisible[packed];
-		uint16 timeout      = (f->timeout[g_playerHouseID] <= g_timerGame) ? 0 : (f->timeout[g_playerHouseID] - g_timerGame);
+		const int64_t tileTimeout = Map_GetTileTimeout(g_playerHouseID, packed);
+		uint16 timeout      = (tileTimeout <= g_timerGame) ? 0 : (tileTimeout - g_timerGame);
 		uint8  overlay      = f->fogSpriteID ? f->fogSpriteID : f->overlaySpriteID;
 		uint16 spriteID     = ((overlay & 0x7F) << 9) | (f->groundSpriteID & 0x1FF);
 		uint8 houseID       = f->houseID;
 		uint8 hasStructure  = f->hasStructure;
 
-		if (fwrite(&packed,         sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&timeout,        sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&spriteID,       sizeof(uint16), 1, fp) != 1) return false;
-		if (fwrite(&houseID,        sizeof(uint8),  1, fp) != 1) return false;
-		if (fwrite(&hasStructure,   sizeof(uint8),  1, fp) != 1) return false;
+		if (!SaveBuffer_Write(sb, &packed, sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &timeout, sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &spriteID, sizeof(uint16))) return false;
+		if (!SaveBuffer_Write(sb, &houseID, sizeof(uint8))) return false;
+		if (!SaveBuffer_Write(sb, &hasStructure, sizeof(uint8))) return false;
 	}
 
 	return true;
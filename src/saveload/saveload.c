@@ -1,5 +1,7 @@
 /** @file src/saveload/saveload.c General routines for load/save. */
 
+#include <stdlib.h>
+#include <string.h>
 #include "errorlog.h"
 
 #include "saveload.h"
@@ -115,6 +117,7 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_CUSTOM: {
 					SaveLoad_CustomCallbackData data;
 					data.fp = fp;
+					data.sb = NULL;
 					data.object = object;
 					if (sld->callback(&data, 0, true) == 0) return false;
 				} break;
@@ -217,14 +220,61 @@ bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object)
 	return true;
 }
 
+/**
+ * Append bytes to a savegame buffer, growing it as needed.
+ * @param sb The buffer to write to.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ * @return True if and only if the bytes were written.
+ */
+bool SaveBuffer_Write(SaveBuffer *sb, const void *data, uint32 length)
+{
+	if (sb->length + length > sb->size) {
+		uint32 size = (sb->size == 0) ? 0x10000 : sb->size;
+		uint8 *buffer;
+
+		while (size < sb->length + length) size *= 2;
+
+		buffer = realloc(sb->data, size);
+		if (buffer == NULL) return false;
+
+		sb->data = buffer;
+		sb->size = size;
+	}
+
+	memcpy(sb->data + sb->length, data, length);
+	sb->length += length;
+	return true;
+}
+
+/**
+ * Append a uint16 value to a savegame buffer, little endian.
+ */
+bool SaveBuffer_WriteLE16(SaveBuffer *sb, uint16 value)
+{
+	const uint8 buffer[2] = { value & 0xFF, (value >> 8) & 0xFF };
+
+	return SaveBuffer_Write(sb, buffer, 2);
+}
+
+/**
+ * Append a uint32 value to a savegame buffer, little endian.
+ */
+bool SaveBuffer_WriteLE32(SaveBuffer *sb, uint32 value)
+{
+	const uint8 buffer[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+
+	return SaveBuffer_Write(sb, buffer, 4);
+}
+
 /**
  * Save from a struct to a file.
  * @param sld The description of the struct.
- * @param fp The file to write to.
+ * @param sb The buffer to write to.
  * @param object The object instance to write from.
  * @return True if and only if the writing was successful.
  */
-bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
+bool SaveLoad_Save(const SaveLoadDesc *sld, SaveBuffer *sb, void *object)
 {
 	while (sld->type_disk != SLDT_NULL) {
 		uint32 value = 0;
@@ -282,7 +332,7 @@ bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
 
 
 				case SLDT_SLD:
-					if (!SaveLoad_Save(sld->sld, fp, ptr)) return false;
+					if (!SaveLoad_Save(sld->sld, sb, ptr)) return false;
 					break;
 
 				case SLDT_CALLBACK:
@@ -304,43 +354,44 @@ bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object)
 				case SLDT_UINT8: {
 					uint8 v = (value > 0xFF) ? 0xFF : (uint8)value;
 
-					if (fwrite(&v, sizeof(uint8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Write(sb, &v, sizeof(uint8))) return false;
 				} break;
 
 				case SLDT_UINT16: {
 					uint16 v = (uint16)value;
 
-					if (!fwrite_le_uint16(v, fp)) return false;
+					if (!SaveBuffer_WriteLE16(sb, v)) return false;
 				} break;
 
 				case SLDT_UINT32: {
 					uint32 v = (uint32)value;
 
-					if (!fwrite_le_uint32(v, fp)) return false;
+					if (!SaveBuffer_WriteLE32(sb, v)) return false;
 				} break;
 
 
 				case SLDT_INT8: {
 					int8 v = (int8)value;
 
-					if (fwrite(&v, sizeof(int8), 1, fp) != 1) return false;
+					if (!SaveBuffer_Write(sb, &v, sizeof(int8))) return false;
 				} break;
 
 				case SLDT_INT16: {
 					int16 v = (int16)value;
 
-					if (!fwrite_le_int16(v, fp)) return false;
+					if (!SaveBuffer_WriteLE16(sb, (uint16)v)) return false;
 				} break;
 
 				case SLDT_INT32: {
 					int32 v = (int32)value;
 
-					if (!fwrite_le_int32(v, fp)) return false;
+					if (!SaveBuffer_WriteLE32(sb, (uint32)v)) return false;
 				} break;
 
 				case SLDT_CUSTOM: {
 					SaveLoad_CustomCallbackData data;
-					data.fp = fp;
+					data.fp = NULL;
+					data.sb = sb;
 					data.object = object;
 					if (sld->callback(&data, 0, false) == 0) return false;
 				} break;
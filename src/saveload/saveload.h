@@ -138,8 +138,16 @@ typedef struct SaveLoadDesc {
 	void *address;                                          /*!< The address of the element. */
 } SaveLoadDesc;
 
+/** A growable buffer in memory which a savegame is written into. */
+typedef struct SaveBuffer {
+	uint8 *data;                                            /*!< The bytes written so far. */
+	uint32 length;                                          /*!< The number of bytes written. */
+	uint32 size;                                            /*!< The number of bytes allocated for data. */
+} SaveBuffer;
+
 typedef struct SaveLoad_CustomCallbackData {
 	FILE *fp;
+	SaveBuffer *sb;
 	void *object;
 } SaveLoad_CustomCallbackData;
 
@@ -151,43 +159,46 @@ extern const SaveLoadDesc g_saveScenario[];
 
 extern uint32 SaveLoad_GetLength(const SaveLoadDesc *sld);
 extern bool SaveLoad_Load(const SaveLoadDesc *sld, FILE *fp, void *object);
-extern bool SaveLoad_Save(const SaveLoadDesc *sld, FILE *fp, void *object);
+extern bool SaveLoad_Save(const SaveLoadDesc *sld, SaveBuffer *sb, void *object);
+extern bool SaveBuffer_Write(SaveBuffer *sb, const void *data, uint32 length);
+extern bool SaveBuffer_WriteLE16(SaveBuffer *sb, uint16 value);
+extern bool SaveBuffer_WriteLE32(SaveBuffer *sb, uint32 value);
 
 extern bool House_Load(FILE *fp, uint32 length);
 extern bool House_LoadOld(FILE *fp, uint32 length);
-extern bool House_Save(FILE *fp);
+extern bool House_Save(SaveBuffer *sb);
 extern bool House_Load2(FILE *fp, uint32 length);
-extern bool House_Save2(FILE *fp);
+extern bool House_Save2(SaveBuffer *sb);
 extern bool Info_Load(FILE *fp, uint32 length);
 extern bool Info_LoadOld(FILE *fp, uint32 length);
 extern void Info_Load_PlayerHouseGlobals(struct House *h);
-extern bool Info_Save(FILE *fp);
+extern bool Info_Save(SaveBuffer *sb);
 extern bool Info_Load2(FILE *fp, uint32 length);
-extern bool Info_Save2(FILE *fp);
+extern bool Info_Save2(SaveBuffer *sb);
 extern bool Map_Load(FILE *fp, uint32 length);
-extern bool Map_Save(FILE *fp);
+extern bool Map_Save(SaveBuffer *sb);
 extern void Map_Load2Fallback(void);
 extern bool Map_Load2(FILE *fp, uint32 length);
-extern bool Map_Save2(FILE *fp);
+extern bool Map_Save2(SaveBuffer *sb);
 extern void Scenario_Load_OldStats(void);
 extern void Scenario_Save_OldStats(void);
 extern bool Scenario_Load2(FILE *fp, uint32 length);
-extern bool Scenario_Save2(FILE *fp);
+extern bool Scenario_Save2(SaveBuffer *sb);
 extern bool Scenario_Load3(FILE *fp, uint32 length);
-extern bool Scenario_Save3(FILE *fp);
+extern bool Scenario_Save3(SaveBuffer *sb);
 extern bool Scenario_Load4(FILE *fp, uint32 length);
-extern bool Scenario_Save4(FILE *fp);
+extern bool Scenario_Save4(SaveBuffer *sb);
 extern bool Structure_Load(FILE *fp, uint32 length);
-extern bool Structure_Save(FILE *fp);
+extern bool Structure_Save(SaveBuffer *sb);
 extern bool Structure_Load2(FILE *fp, uint32 length);
-extern bool Structure_Save2(FILE *fp);
+extern bool Structure_Save2(SaveBuffer *sb);
 extern bool Team_Load(FILE *fp, uint32 length);
-extern bool Team_Save(FILE *fp);
+extern bool Team_Save(SaveBuffer *sb);
 extern bool Unit_Load(FILE *fp, uint32 length);
-extern bool Unit_Save(FILE *fp);
+extern bool Unit_Save(SaveBuffer *sb);
 extern bool Unit_Load2(FILE *fp, uint32 length);
-extern bool Unit_Save2(FILE *fp);
+extern bool Unit_Save2(SaveBuffer *sb);
 extern bool UnitNew_Load(FILE *fp, uint32 length);
-extern bool UnitNew_Save(FILE *fp);
+extern bool UnitNew_Save(SaveBuffer *sb);
 
 #endif /* SAVELOAD_SAVELOAD_H */
@@ -97,13 +97,13 @@ Scenario_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Scenario_Save2(FILE *fp)
+Scenario_Save2(SaveBuffer *sb)
 {
 	const char brain_char[3] = { ' ', 'H', 'C' };
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c = brain_char[g_skirmish.player_config[h].brain];
-		fwrite(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Write(sb, &c, sizeof(char))) return false;
 	}
 
 	return true;
@@ -119,9 +119,9 @@ Scenario_Load3(FILE *fp, uint32 length)
 }
 
 bool
-Scenario_Save3(FILE *fp)
+Scenario_Save3(SaveBuffer *sb)
 {
-	return SaveLoad_Save(s_saveScenario3, fp, &g_scenario);
+	return SaveLoad_Save(s_saveScenario3, sb, &g_scenario);
 }
 
 bool
@@ -147,13 +147,13 @@ Scenario_Load4(FILE *fp, uint32 length)
 }
 
 bool
-Scenario_Save4(FILE *fp)
+Scenario_Save4(SaveBuffer *sb)
 {
 	const char team_char[7] = { ' ', '1', '2', '3', '4', '5', '6' };
 
 	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
 		char c = team_char[g_skirmish.player_config[h].team];
-		fwrite(&c, sizeof(char), 1, fp);
+		if (!SaveBuffer_Write(sb, &c, sizeof(char))) return false;
 	}
 
 	return true;
@@ -90,10 +90,10 @@ bool Structure_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Structures to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Structure_Save(FILE *fp)
+bool Structure_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -102,7 +102,7 @@ bool Structure_Save(FILE *fp)
 			s = Structure_FindNext(&find)) {
 		Structure ss = *s;
 
-		if (!SaveLoad_Save(s_saveStructure, fp, &ss)) return false;
+		if (!SaveLoad_Save(s_saveStructure, sb, &ss)) return false;
 	}
 
 	return true;
@@ -120,6 +120,7 @@ Structure_Load2(FILE *fp, uint32 length)
 
 		SaveLoad_CustomCallbackData data;
 		data.fp = NULL;
+		data.sb = NULL;
 		data.object = &sl;
 
 		length -= SaveLoad_GetLength(s_saveStructure2);
@@ -163,14 +164,14 @@ Structure_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Structure_Save2(FILE *fp)
+Structure_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
 			s != NULL;
 			s = Structure_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveStructure2, fp, s))
+		if (!SaveLoad_Save(s_saveStructure2, sb, s))
 			return false;
 	}
 
@@ -182,13 +183,14 @@ SaveLoad_Structure_BuildQueue(void *object, uint32 value, bool loading)
 {
 	SaveLoad_CustomCallbackData *data = object;
 	FILE *fp = data->fp;
+	SaveBuffer *sb = data->sb;
 	Structure *s = data->object;
 	uint32 size = 0;
 	uint32 elem_size = SaveLoad_GetLength(s_saveBuildQueue);
 	VARIABLE_NOT_USED(value);
 
-	/* If fp == NULL, then it is a size query. */
-	if (fp == NULL) {
+	/* If neither is set, then it is a size query. */
+	if (fp == NULL && sb == NULL) {
 		uint32 count = BuildQueue_Count(&s->queue, 0xFFFF);
 
 		size = sizeof(count) + count * elem_size;
@@ -262,14 +264,14 @@ SaveLoad_Structure_BuildQueue(void *object, uint32 value, bool loading)
 
 		uint32 count = BuildQueue_Count(queue, 0xFFFF);
 
-		if (fwrite(&count, sizeof(uint32), 1, fp) != 1)
+		if (!SaveBuffer_Write(sb, &count, sizeof(uint32)))
 			return 0;
 
 		size += sizeof(count);
 
 		BuildQueueItem *item = queue->first;
 		while (item != NULL) {
-			if (!SaveLoad_Save(s_saveBuildQueue, fp, item))
+			if (!SaveLoad_Save(s_saveBuildQueue, sb, item))
 				return 0;
 
 			size += elem_size;
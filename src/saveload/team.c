@@ -66,10 +66,10 @@ bool Team_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Teams to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Team_Save(FILE *fp)
+bool Team_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -78,7 +78,7 @@ bool Team_Save(FILE *fp)
 			t = Team_FindNext(&find)) {
 		Team st = *t;
 
-		if (!SaveLoad_Save(s_saveTeam, fp, &st)) return false;
+		if (!SaveLoad_Save(s_saveTeam, sb, &st)) return false;
 	}
 
 	return true;
@@ -131,10 +131,10 @@ bool Unit_Load(FILE *fp, uint32 length)
 
 /**
  * Save all Units to a file. It converts pointers to indices where needed.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool Unit_Save(FILE *fp)
+bool Unit_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -146,7 +146,7 @@ bool Unit_Save(FILE *fp)
 		/* In original Dune II savegames, speed was shifted right by 4. */
 		su.speed >>= 4;
 
-		if (!SaveLoad_Save(s_saveUnit, fp, &su)) return false;
+		if (!SaveLoad_Save(s_saveUnit, sb, &su)) return false;
 	}
 
 	return true;
@@ -186,10 +186,10 @@ bool UnitNew_Load(FILE *fp, uint32 length)
 /**
  * Save all new Units information to a file. It converts pointers to indices
  *   where needed.
- * @param fp The file to save to.
+ * @param sb The buffer to save to.
  * @return True if and only if all bytes were written successful.
  */
-bool UnitNew_Save(FILE *fp)
+bool UnitNew_Save(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
@@ -198,8 +198,8 @@ bool UnitNew_Save(FILE *fp)
 			u = Unit_FindNext(&find)) {
 		Unit su = *u;
 
-		if (!SaveLoad_Save(s_saveUnitNewIndex, fp, &su.o)) return false;
-		if (!SaveLoad_Save(s_saveUnitNew, fp, &su)) return false;
+		if (!SaveLoad_Save(s_saveUnitNewIndex, sb, &su.o)) return false;
+		if (!SaveLoad_Save(s_saveUnitNew, sb, &su)) return false;
 	}
 
 	return true;
@@ -253,14 +253,14 @@ Unit_Load2(FILE *fp, uint32 length)
 }
 
 bool
-Unit_Save2(FILE *fp)
+Unit_Save2(SaveBuffer *sb)
 {
 	PoolFindStruct find;
 
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
-		if (!SaveLoad_Save(s_saveUnit2, fp, u))
+		if (!SaveLoad_Save(s_saveUnit2, sb, u))
 			return false;
 	}
 
@@ -21,8 +21,10 @@
 #include "house.h"
 #include "ini.h"
 #include "map.h"
+#include "minimap.h"
 #include "mods/landscape.h"
 #include "newui/mentat.h"
+#include "objectgrid.h"
 #include "opendune.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
@@ -1213,6 +1215,7 @@ Scenario_Create_Unit(enum HouseType houseType, enum UnitType unitType,
 
 	u->o.hitpoints   = hitpoints * g_table_unitInfo[unitType].o.hitpoints / 256;
 	u->o.position    = position;
+	ObjectGrid_UpdateUnit(u);
 	u->orientation[0].current = orientation;
 	u->actionID     = actionType;
 	u->nextActionID = ACTION_INVALID;
@@ -1365,11 +1368,14 @@ static void Scenario_Load_Map(const char *key, char *settings)
 	if (g_mapSpriteID[packed] != t->groundSpriteID) g_mapSpriteID[packed] |= 0x8000;
 
 	if (isUnveiled) {
-		f->isUnveiled = (1 << g_playerHouseID);
+		Map_SetUnveiledToHouse(g_playerHouseID, packed);
 		f->fogSpriteID = 0;
 	} else {
 		f->fogSpriteID = g_veiledSpriteID;
 	}
+
+	Map_InvalidateVisibleTile(packed);
+	Minimap_InvalidateTile(packed);
 }
 
 void Scenario_Load_Map_Bloom(uint16 packed, Tile *t)
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include "errorlog.h"
 #include "multichar.h"
 #include "types.h"
@@ -282,13 +283,15 @@ bool Script_IsLoaded(ScriptEngine *script)
 }
 
 /**
- * Run the next opcode of a script.
+ * Run the next opcode of a script, decoding it from the script data.
+ *  This is the original interpreter, kept for instructions that could
+ *  not be decoded on load and to check Script_Run against.
  *
  * @param script The script engine to run.
  * @return Returns false if and only if there was an scripting error, like
  *   invalid opcode.
  */
-bool Script_Run(ScriptEngine *script)
+static bool Script_Run_Reference(ScriptEngine *script)
 {
 	ScriptInfo *scriptInfo;
 	uint16 current, parameter;
@@ -525,6 +528,303 @@ bool Script_Run(ScriptEngine *script)
 	}
 }
 
+/**
+ * Run a decoded instruction.  Follows Script_Run_Reference, except that
+ *  the parameter is already masked and the function looked up.
+ */
+static bool Script_Execute(ScriptEngine *script, const ScriptInstruction *in)
+{
+	const uint16 parameter = in->parameter;
+	ScriptInfo *scriptInfo = script->scriptInfo;
+
+	script->script += in->length;
+
+	switch (in->opcode) {
+		case SCRIPT_JUMP:
+			script->script = scriptInfo->start + parameter;
+			return true;
+
+		case SCRIPT_SETRETURNVALUE:
+			script->returnValue = parameter;
+			return true;
+
+		case SCRIPT_PUSH_RETURN_OR_LOCATION:
+			if (parameter == 0) {
+				STACK_PUSH(script->returnValue);
+				return true;
+			}
+
+			if (parameter == 1) {
+				STACK_PUSH((script->script - scriptInfo->start) + 1);
+				STACK_PUSH(script->framePointer);
+				script->framePointer = script->stackPointer + 2;
+				return true;
+			}
+
+			Script_Error("Unknown parameter %d for opcode 2", parameter);
+			script->script = NULL;
+			return false;
+
+		case SCRIPT_PUSH:
+			STACK_PUSH(parameter);
+			return true;
+
+		case SCRIPT_PUSH_VARIABLE:
+			STACK_PUSH(script->variables[parameter]);
+			return true;
+
+		case SCRIPT_PUSH_LOCAL_VARIABLE:
+			if (script->framePointer - parameter - 2 >= 15) goto overflow;
+
+			STACK_PUSH(script->stack[script->framePointer - parameter - 2]);
+			return true;
+
+		case SCRIPT_PUSH_PARAMETER:
+			if (script->framePointer + parameter - 1 >= 15) goto overflow;
+
+			STACK_PUSH(script->stack[script->framePointer + parameter - 1]);
+			return true;
+
+		case SCRIPT_POP_RETURN_OR_LOCATION:
+			if (parameter == 0) {
+				script->returnValue = STACK_POP();
+				return true;
+			}
+
+			if (parameter == 1) {
+				STACK_PEEK(2); if (script->script == NULL) return false;
+
+				script->framePointer = (uint8)STACK_POP();
+				script->script = scriptInfo->start + STACK_POP();
+				return true;
+			}
+
+			Script_Error("Unknown parameter %d for opcode 8", parameter);
+			script->script = NULL;
+			return false;
+
+		case SCRIPT_POP_VARIABLE:
+			script->variables[parameter] = STACK_POP();
+			return true;
+
+		case SCRIPT_POP_LOCAL_VARIABLE:
+			if (script->framePointer - parameter - 2 >= 15) goto overflow;
+
+			script->stack[script->framePointer - parameter - 2] = STACK_POP();
+			return true;
+
+		case SCRIPT_POP_PARAMETER:
+			if (script->framePointer + parameter - 1 >= 15) goto overflow;
+
+			script->stack[script->framePointer + parameter - 1] = STACK_POP();
+			return true;
+
+		case SCRIPT_STACK_REWIND:
+			script->stackPointer += parameter;
+			return true;
+
+		case SCRIPT_STACK_FORWARD:
+			script->stackPointer -= parameter;
+			return true;
+
+		case SCRIPT_FUNCTION:
+			if (in->function == NULL) {
+				Script_Error("Unknown function %d for opcode 14", parameter);
+				return false;
+			}
+
+			script->returnValue = in->function(script);
+			return true;
+
+		case SCRIPT_JUMP_NE:
+			STACK_PEEK(1); if (script->script == NULL) return false;
+
+			if (STACK_POP() == 0)
+				script->script = scriptInfo->start + parameter;
+			return true;
+
+		case SCRIPT_UNARY:
+			if (parameter == 0) {
+				STACK_PUSH((STACK_POP() == 0) ? 1 : 0);
+			} else if (parameter == 1) {
+				STACK_PUSH(-STACK_POP());
+			} else {
+				STACK_PUSH(~STACK_POP());
+			}
+			return true;
+
+		case SCRIPT_BINARY: {
+			const int16 right = STACK_POP();
+			const int16 left  = STACK_POP();
+
+			switch (parameter) {
+				case 0:  STACK_PUSH((left && right) ? 1 : 0); break;
+				case 1:  STACK_PUSH((left || right) ? 1 : 0); break;
+				case 2:  STACK_PUSH((left == right) ? 1 : 0); break;
+				case 3:  STACK_PUSH((left != right) ? 1 : 0); break;
+				case 4:  STACK_PUSH((left <  right) ? 1 : 0); break;
+				case 5:  STACK_PUSH((left <= right) ? 1 : 0); break;
+				case 6:  STACK_PUSH((left >  right) ? 1 : 0); break;
+				case 7:  STACK_PUSH((left >= right) ? 1 : 0); break;
+				case 8:  STACK_PUSH( left +  right         ); break;
+				case 9:  STACK_PUSH( left -  right         ); break;
+				case 10: STACK_PUSH( left *  right         ); break;
+				case 11: STACK_PUSH( left /  right         ); break;
+				case 12: STACK_PUSH( left >> right         ); break;
+				case 13: STACK_PUSH( left << right         ); break;
+				case 14: STACK_PUSH( left &  right         ); break;
+				case 15: STACK_PUSH( left |  right         ); break;
+				case 16: STACK_PUSH( left %  right         ); break;
+				default: STACK_PUSH( left ^  right         ); break;
+			}
+			return true;
+		}
+
+		case SCRIPT_RETURN:
+			STACK_PEEK(2); if (script->script == NULL) return false;
+
+			script->returnValue = STACK_POP();
+			script->script = scriptInfo->start + STACK_POP();
+
+			script->isSubroutine = 0;
+			return true;
+
+		default:
+			Script_Error("Unknown opcode %d", in->opcode);
+			script->script = NULL;
+			return false;
+	}
+
+overflow:
+	/* Local variable or parameter outside of the stack. */
+	Script_Error("Stack Overflow at %s:%d", __FILE__, __LINE__);
+	script->script = NULL;
+	return false;
+}
+
+#ifdef SCRIPT_VERIFY
+/**
+ * Compare the engine after an instruction with the reference
+ *  interpreter's run of the same instruction.
+ */
+static void Script_Verify(const ScriptEngine *script, const ScriptEngine *reference, bool ret, bool expected, uint16 offset)
+{
+	if (ret == expected
+			&& script->script == reference->script
+			&& script->returnValue == reference->returnValue
+			&& script->framePointer == reference->framePointer
+			&& script->stackPointer == reference->stackPointer
+			&& script->isSubroutine == reference->isSubroutine
+			&& memcmp(script->variables, reference->variables, sizeof(script->variables)) == 0
+			&& memcmp(script->stack, reference->stack, sizeof(script->stack)) == 0) {
+		return;
+	}
+
+	Script_Error("Decoded instruction at %04X differs from the reference", offset);
+}
+#endif
+
+/**
+ * Run the next opcode of a script.
+ *
+ * @param script The script engine to run.
+ * @return Returns false if and only if there was an scripting error, like
+ *   invalid opcode.
+ */
+bool Script_Run(ScriptEngine *script)
+{
+	const ScriptInfo *scriptInfo;
+	const ScriptInstruction *in;
+	size_t offset;
+
+	if (!Script_IsLoaded(script)) return false;
+	scriptInfo = script->scriptInfo;
+
+	offset = script->script - scriptInfo->start;
+	if (scriptInfo->decoded == NULL || offset >= scriptInfo->startCount) return Script_Run_Reference(script);
+
+	in = &scriptInfo->decoded[offset];
+	if (in->opcode == SCRIPT_UNDECODED) return Script_Run_Reference(script);
+
+#ifdef SCRIPT_VERIFY
+	/* Functions change the game, so they can only be run once. */
+	if (in->opcode != SCRIPT_FUNCTION) {
+		ScriptEngine reference = *script;
+		const bool expected = Script_Run_Reference(&reference);
+		const bool ret = Script_Execute(script, in);
+
+		Script_Verify(script, &reference, ret, expected, offset);
+		return ret;
+	}
+#endif
+
+	return Script_Execute(script, in);
+}
+
+/**
+ * Decode the instruction at every word of the script data, following
+ *  Script_Run_Reference.
+ *
+ * @param scriptInfo The scriptInfo, with start and functions loaded.
+ */
+static void Script_Decode(ScriptInfo *scriptInfo)
+{
+	scriptInfo->decoded = calloc(scriptInfo->startCount, sizeof(ScriptInstruction));
+	if (scriptInfo->decoded == NULL) return;
+
+	for (uint16 i = 0; i < scriptInfo->startCount; i++) {
+		ScriptInstruction *in = &scriptInfo->decoded[i];
+		const uint16 current = BETOH16(scriptInfo->start[i]);
+		uint8 opcode = (current >> 8) & 0x1F;
+		uint16 parameter = 0;
+
+		in->opcode = SCRIPT_UNDECODED;
+		in->length = 1;
+
+		if ((current & 0x8000) != 0) {
+			opcode = SCRIPT_JUMP;
+			parameter = current & 0x7FFF;
+		} else if ((current & 0x4000) != 0) {
+			parameter = (int16)(int8)(current & 0xFF);
+		} else if ((current & 0x2000) != 0) {
+			if (i + 1 >= scriptInfo->startCount) continue;
+
+			parameter = BETOH16(scriptInfo->start[i + 1]);
+			in->length = 2;
+		}
+
+		switch (opcode) {
+			case SCRIPT_PUSH2:
+				opcode = SCRIPT_PUSH;
+				break;
+
+			case SCRIPT_FUNCTION:
+				parameter &= 0xFF;
+				if (parameter < SCRIPT_FUNCTIONS_COUNT) in->function = scriptInfo->functions[parameter];
+				break;
+
+			case SCRIPT_JUMP_NE:
+				parameter &= 0x7FFF;
+				break;
+
+			case SCRIPT_UNARY:
+				if (parameter > 2) continue;
+				break;
+
+			case SCRIPT_BINARY:
+				if (parameter > 17) continue;
+				break;
+
+			default:
+				if (opcode > SCRIPT_RETURN) continue;
+				break;
+		}
+
+		in->opcode = opcode;
+		in->parameter = parameter;
+	}
+}
+
 /**
  * Load a script in an engine without removing the previously loaded script.
  *
@@ -562,7 +862,10 @@ void Script_ClearInfo(ScriptInfo *scriptInfo)
 		free(scriptInfo->start);
 	}
 
+	free(scriptInfo->decoded);
+
 	scriptInfo->text = NULL;
+	scriptInfo->decoded = NULL;
 	scriptInfo->offsets = NULL;
 	scriptInfo->start = NULL;
 }
@@ -579,7 +882,9 @@ uint16 Script_LoadFromFile(const char *filename, ScriptInfo *scriptInfo, const S
 {
 	uint32 total = 0;
 	uint32 length = 0;
-	uint8 index;
+	uint32 fileLength;
+	const uint8 *file;
+	const uint8 *chunk;
 	int16 i;
 
 	if (scriptInfo == NULL) return 0;
@@ -593,9 +898,9 @@ uint16 Script_LoadFromFile(const char *filename, ScriptInfo *scriptInfo, const S
 
 	if (!File_Exists(filename)) return 0;
 
-	index = ChunkFile_Open(filename);
+	file = File_GetView_Ex(SEARCHDIR_GLOBAL_DATA_DIR, filename, &fileLength);
 
-	length = ChunkFile_Seek(index, HTOBE32(CC_TEXT));
+	chunk = ChunkFile_Find(file, fileLength, HTOBE32(CC_TEXT), &length);
 	total += length;
 
 	if (length != 0) {
@@ -606,15 +911,15 @@ uint16 Script_LoadFromFile(const char *filename, ScriptInfo *scriptInfo, const S
 			scriptInfo->text = calloc(1, length);
 		}
 
-		ChunkFile_Read(index, HTOBE32(CC_TEXT), scriptInfo->text, length);
+		memcpy(scriptInfo->text, chunk, length);
 	}
 
-	length = ChunkFile_Seek(index, HTOBE32(CC_ORDR));
+	chunk = ChunkFile_Find(file, fileLength, HTOBE32(CC_ORDR), &length);
 	total += length;
 
 	if (length == 0) {
 		Script_ClearInfo(scriptInfo);
-		ChunkFile_Close(index);
+		File_ReleaseView(file);
 		return 0;
 	}
 
@@ -626,18 +931,17 @@ uint16 Script_LoadFromFile(const char *filename, ScriptInfo *scriptInfo, const S
 	}
 
 	scriptInfo->offsetsCount = (length >> 1) & 0xFFFF;
-	ChunkFile_Read(index, HTOBE32(CC_ORDR), scriptInfo->offsets, length);
 
 	for(i = 0; i < (int16)((length >> 1) & 0xFFFF); i++) {
-		scriptInfo->offsets[i] = BETOH16(scriptInfo->offsets[i]);
+		scriptInfo->offsets[i] = READ_BE_UINT16(chunk + 2 * i);
 	}
 
-	length = ChunkFile_Seek(index, HTOBE32(CC_DATA));
+	chunk = ChunkFile_Find(file, fileLength, HTOBE32(CC_DATA), &length);
 	total += length;
 
 	if (length == 0) {
 		Script_ClearInfo(scriptInfo);
-		ChunkFile_Close(index);
+		File_ReleaseView(file);
 		return 0;
 	}
 
@@ -649,9 +953,11 @@ uint16 Script_LoadFromFile(const char *filename, ScriptInfo *scriptInfo, const S
 	}
 
 	scriptInfo->startCount = (length >> 1) & 0xFFFF;
-	ChunkFile_Read(index, HTOBE32(CC_DATA), scriptInfo->start, length);
+	memcpy(scriptInfo->start, chunk, length);
+
+	File_ReleaseView(file);
 
-	ChunkFile_Close(index);
+	Script_Decode(scriptInfo);
 
 	return total & 0xFFFF;
 }
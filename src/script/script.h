@@ -3,6 +3,10 @@
 #ifndef SCRIPT_H
 #define SCRIPT_H
 
+/* Define SCRIPT_VERIFY to run the reference interpreter on a copy of
+ * the engine for every decoded instruction, and compare the results.
+ */
+
 enum {
 	SCRIPT_UNIT_OPCODES_PER_TICK = 50,                      /*!< The amount of opcodes a unit can execute per tick. */
 
@@ -31,7 +35,9 @@ enum ScriptCommand {
 	SCRIPT_JUMP_NE                 = 15,                    /*!< Jump to the instruction given by the parameter if the last entry on the stack is non-zero. */
 	SCRIPT_UNARY                   = 16,                    /*!< Perform unary operations. */
 	SCRIPT_BINARY                  = 17,                    /*!< Perform binary operations. */
-	SCRIPT_RETURN                  = 18                     /*!< Return from a subroutine. */
+	SCRIPT_RETURN                  = 18,                    /*!< Return from a subroutine. */
+
+	SCRIPT_UNDECODED               = 0xFF                   /*!< Left to Script_Run_Reference, e.g. unknown opcodes. */
 };
 
 /**
@@ -51,6 +57,17 @@ typedef struct ScriptEngine {
 
 typedef uint16 (*ScriptFunction)(ScriptEngine *script);
 
+/**
+ * An instruction decoded on load.  There is one for every word in
+ *  ScriptInfo->start, as a jump can go to any word.
+ */
+typedef struct ScriptInstruction {
+	uint8  opcode;                                          /*!< The ScriptCommand, or SCRIPT_UNDECODED. */
+	uint8  length;                                          /*!< Number of words the instruction takes. */
+	uint16 parameter;                                       /*!< The parameter, masked as the opcode uses it. */
+	ScriptFunction function;                                /*!< Function called by SCRIPT_FUNCTION, or NULL. */
+} ScriptInstruction;
+
 /**
  * A ScriptInfo as stored in the memory.
  */
@@ -61,6 +78,7 @@ typedef struct ScriptInfo {
 	uint16 offsetsCount;                                    /*!< Number of words in offsets array. */
 	uint16 startCount;                                      /*!< Number of words in start. */
 	const ScriptFunction *functions;                        /*!< Pointer to an array of functions pointers which scripts with this scriptInfo can call. */
+	ScriptInstruction *decoded;                             /*!< The instruction at each word of start, or NULL. */
 	uint16 isAllocated;                                     /*!< Memory has been allocated on load. */
 } ScriptInfo;
 
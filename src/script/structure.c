@@ -155,6 +155,7 @@ uint16 Script_Structure_RefineSpice(ScriptEngine *script)
 	u->amount -= harvesterStep;
 
 	if (u->amount == 0) u->o.flags.s.inTransport = false;
+	Server_MarkUnitDirty(u);
 	s->o.script.delay = 6;
 	return 1;
 }
@@ -266,6 +267,7 @@ uint16 Script_Structure_Unknown0C5A(ScriptEngine *script)
 	if (g_table_unitInfo[u->o.type].movementType == MOVEMENT_WINGER && Unit_SetPosition(u, s->o.position)) {
 		s->o.linkedID = u->o.linkedID;
 		u->o.linkedID = 0xFF;
+		Server_MarkStructureDirty(s);
 
 		if (s->o.linkedID == 0xFF)
 			Structure_Server_SetState(s, STRUCTURE_STATE_IDLE);
@@ -288,6 +290,7 @@ uint16 Script_Structure_Unknown0C5A(ScriptEngine *script)
 
 	s->o.linkedID = u->o.linkedID;
 	u->o.linkedID = 0xFF;
+	Server_MarkStructureDirty(s);
 
 	if (s->rallyPoint != 0xFFFF) {
 		const int encoded = Tools_Index_Encode(s->rallyPoint, IT_TILE);
@@ -335,6 +338,7 @@ uint16 Script_Structure_Unknown0C5A(ScriptEngine *script)
 		new_hitpoints = clamp(u->o.hitpoints, new_hitpoints, ui->o.hitpoints);
 
 		u->o.hitpoints = new_hitpoints;
+		Server_MarkUnitDirty(u);
 
 		s->countDown = 0;
 		return 1;
@@ -473,6 +477,8 @@ uint16 Script_Structure_RotateTurret(ScriptEngine *script)
 	/* Set the new sprites */
 	tile->groundSpriteID = baseSpriteID + rotation;
 	s->rotationSpriteDiff = rotation;
+	Server_MarkStructureDirty(s);
+	Map_InvalidateTile(Tile_PackTile(s->o.position));
 
 	return 1;
 }
@@ -526,6 +532,7 @@ uint16 Script_Structure_Unknown11B9(ScriptEngine *script)
 
 	Object_Script_Variable4_Clear(&u->o);
 	u->targetMove = 0;
+	Server_MarkUnitDirty(u);
 
 	return 0;
 }
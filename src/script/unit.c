@@ -21,7 +21,9 @@
 #include "../house.h"
 #include "../map.h"
 #include "../net/server.h"
+#include "../objectgrid.h"
 #include "../opendune.h"
+#include "../pathfinder.h"
 #include "../pool/pool.h"
 #include "../pool/pool_house.h"
 #include "../pool/pool_structure.h"
@@ -155,8 +157,10 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 			if (s->state == STRUCTURE_STATE_BUSY) {
 				s->o.linkedID = u->o.linkedID;
 				u->o.linkedID = 0xFF;
+				Server_MarkStructureDirty(s);
 				u->o.flags.s.inTransport = false;
 				u->amount = 0;
+				Server_MarkUnitDirty(u);
 
 				Unit_UpdateMap(2, u);
 
@@ -170,6 +174,7 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 
 			Object_Script_Variable4_Clear(&u->o);
 			u->targetMove = 0;
+			Server_MarkUnitDirty(u);
 
 			return ret;
 		}
@@ -186,6 +191,7 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 			u->o.linkedID = 0xFF;
 			u->o.flags.s.inTransport = false;
 			u->amount = 0;
+			Server_MarkUnitDirty(u);
 
 			Unit_UpdateMap(2, u);
 
@@ -194,6 +200,7 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 
 		Object_Script_Variable4_Clear(&u->o);
 		u->targetMove = 0;
+		Server_MarkUnitDirty(u);
 
 		return 0;
 	}
@@ -220,6 +227,7 @@ uint16 Script_Unit_TransportDeliver(ScriptEngine *script)
 
 	Object_Script_Variable4_Clear(&u->o);
 	u->targetMove = 0;
+	Server_MarkUnitDirty(u);
 
 	return 1;
 }
@@ -254,6 +262,7 @@ uint16 Script_Unit_Pickup(ScriptEngine *script)
 			if (s->state != STRUCTURE_STATE_READY) {
 				Object_Script_Variable4_Clear(&u->o);
 				u->targetMove = 0;
+				Server_MarkUnitDirty(u);
 				return 0;
 			}
 
@@ -261,6 +270,7 @@ uint16 Script_Unit_Pickup(ScriptEngine *script)
 
 			Object_Script_Variable4_Clear(&u->o);
 			u->targetMove = 0;
+			Server_MarkUnitDirty(u);
 
 			u2 = Unit_Get_ByIndex(s->o.linkedID);
 
@@ -268,6 +278,8 @@ uint16 Script_Unit_Pickup(ScriptEngine *script)
 			u->o.linkedID = u2->o.index & 0xFF;
 			s->o.linkedID = u2->o.linkedID;
 			u2->o.linkedID = 0xFF;
+			Server_MarkStructureDirty(s);
+			Server_MarkUnitDirty(u2);
 
 			if (s->o.linkedID == 0xFF)
 				Structure_Server_SetState(s, STRUCTURE_STATE_IDLE);
@@ -344,6 +356,7 @@ uint16 Script_Unit_Pickup(ScriptEngine *script)
 			/* Pickup the unit */
 			u->o.linkedID = u2->o.index & 0xFF;
 			u->o.flags.s.inTransport = true;
+			Server_MarkUnitDirty(u);
 
 			Unit_UpdateMap(0, u2);
 
@@ -435,6 +448,7 @@ uint16 Script_Unit_SetSprite(ScriptEngine *script)
 	u = g_scriptCurrentUnit;
 
 	u->spriteOffset = -(STACK_PEEK(1) & 0xFF);
+	Server_MarkUnitDirty(u);
 
 	Unit_UpdateMap(2, u);
 
@@ -473,6 +487,8 @@ uint16 Script_Unit_MoveToTarget(ScriptEngine *script)
 
 		u->o.position.x += clamp((int16)(tile.x - u->o.position.x), -16, 16);
 		u->o.position.y += clamp((int16)(tile.y - u->o.position.y), -16, 16);
+		ObjectGrid_UpdateUnit(u);
+		Server_MarkUnitDirty(u);
 
 		Unit_UpdateMap(2, u);
 
@@ -667,8 +683,10 @@ uint16 Script_Unit_Fire(ScriptEngine *script)
 
 			Unit_UpdateMap(1, u);
 
-			if (!enhancement_insatiable_sandworms)
+			if (!enhancement_insatiable_sandworms) {
 				u->amount--;
+				Server_MarkUnitDirty(u);
+			}
 
 			script->delay = 12;
 
@@ -720,6 +738,7 @@ uint16 Script_Unit_Fire(ScriptEngine *script)
 	} else {
 		u->o.flags.s.fireTwiceFlip = false;
 	}
+	Server_MarkUnitDirty(u);
 
 	u->fireDelay += Tools_Random_256() & 1;
 
@@ -835,6 +854,7 @@ uint16 Script_Unit_SetDestination(ScriptEngine *script)
 
 	if (encoded == 0 || !Tools_Index_IsValid(encoded)) {
 		u->targetMove = 0;
+		Server_MarkUnitDirty(u);
 		return 0;
 	}
 
@@ -845,6 +865,7 @@ uint16 Script_Unit_SetDestination(ScriptEngine *script)
 		if (s == NULL) {
 			u->targetMove = encoded;
 			u->route[0] = 0xFF;
+			Server_MarkUnitDirty(u);
 			return 0;
 		}
 
@@ -876,6 +897,7 @@ uint16 Script_Unit_SetTarget(ScriptEngine *script)
 
 	if (target == 0 || !Tools_Index_IsValid(target)) {
 		u->targetAttack = 0;
+		Server_MarkUnitDirty(u);
 		return 0;
 	}
 
@@ -888,6 +910,7 @@ uint16 Script_Unit_SetTarget(ScriptEngine *script)
 		u->targetMove = target;
 		Unit_SetOrientation(u, orientation, false, 0);
 	}
+	Server_MarkUnitDirty(u);
 	Unit_SetOrientation(u, orientation, false, 1);
 
 	return u->targetAttack;
@@ -1238,6 +1261,11 @@ static Pathfinder_Data Script_Unit_Pathfinder(uint16 packedSrc, uint16 packedDst
 
 	res.buffer[0] = 0xFF;
 
+	if (enhancement_hierarchical_pathfinder && g_scriptCurrentUnit != NULL) {
+		res.routeSize = Pathfinder_FindRoute(g_scriptCurrentUnit, packedSrc, packedDst, res.buffer, bufferSize, &res.score);
+		return res;
+	}
+
 	bufferSize--;
 
 	packedCur = packedSrc;
@@ -1426,6 +1454,7 @@ uint16 Script_Unit_CalculateRoute(ScriptEngine *script)
 	if (packedDst == packedSrc) {
 		u->route[0] = 0xFF;
 		u->targetMove = 0;
+		Server_MarkUnitDirty(u);
 		return 0;
 	}
 
@@ -1451,8 +1480,10 @@ uint16 Script_Unit_CalculateRoute(ScriptEngine *script)
 
 		if (u->route[0] == 0xFF) {
 			/* ENHANCEMENT -- Follow mode similar to Sega Mega Drive version of Dune II. */
-			if (!(u->actionID == ACTION_MOVE && u->permanentFollow) || (Tools_Index_GetUnit(u->targetMove) == NULL))
+			if (!(u->actionID == ACTION_MOVE && u->permanentFollow) || (Tools_Index_GetUnit(u->targetMove) == NULL)) {
 				u->targetMove = 0;
+				Server_MarkUnitDirty(u);
+			}
 
 			if (u->o.type == UNIT_SANDWORM) {
 				script->delay = 720;
@@ -1511,6 +1542,7 @@ uint16 Script_Unit_MoveToStructure(ScriptEngine *script)
 			Object_Script_Variable4_Link(Tools_Index_Encode(u->o.index, IT_UNIT), encoded);
 
 			u->targetMove = u->o.script.variables[4];
+			Server_MarkUnitDirty(u);
 
 			return encoded;
 		}
@@ -1527,6 +1559,7 @@ uint16 Script_Unit_MoveToStructure(ScriptEngine *script)
 		Object_Script_Variable4_Link(Tools_Index_Encode(u->o.index, IT_UNIT), encoded);
 
 		u->targetMove = encoded;
+		Server_MarkUnitDirty(u);
 
 		return encoded;
 	}
@@ -1599,6 +1632,7 @@ uint16 Script_Unit_StartAnimation(ScriptEngine *script)
 	if (u->o.script.variables[1] == 1) animationUnitID += 2;
 
 	g_map[position].houseID = Unit_GetHouseID(u);
+	Map_InvalidateTile(position);
 
 	assert(animationUnitID < 4);
 	if (g_table_unitInfo[u->o.type].displayMode == DISPLAYMODE_INFANTRY_3_FRAMES) {
@@ -1640,6 +1674,7 @@ uint16 Script_Unit_CallUnitByType(ScriptEngine *script)
 
 	Object_Script_Variable4_Link(encoded, encoded2);
 	u2->targetMove = encoded;
+	Server_MarkUnitDirty(u2);
 
 	return encoded2;
 }
@@ -1667,6 +1702,7 @@ uint16 Script_Unit_Unknown2552(ScriptEngine *script)
 
 	Object_Script_Variable4_Clear(&u->o);
 	u2->targetMove = 0;
+	Server_MarkUnitDirty(u2);
 
 	return 0;
 }
@@ -1762,6 +1798,7 @@ uint16 Script_Unit_Harvest(ScriptEngine *script)
 		/* In brutal AI, call for a carryall if a worm attack is imminent. */
 		if (UnitAI_CallCarryallToEvadeSandworm(u)) {
 			u->actionID = ACTION_STOP;
+			Server_MarkUnitDirty(u);
 			return 0;
 		}
 	}
@@ -1776,6 +1813,7 @@ uint16 Script_Unit_Harvest(ScriptEngine *script)
 
 	u->amount += Tools_Random_256() & 1;
 	u->o.flags.s.inTransport = true;
+	Server_MarkUnitDirty(u);
 
 	Unit_UpdateMap(2, u);
 
@@ -1815,9 +1853,12 @@ uint16 Script_Unit_IsValidDestination(ScriptEngine *script)
 			if (u->o.linkedID == 0xFF) return 1;
 			u2 = Unit_Get_ByIndex(u->o.linkedID);
 			u2->o.position = Tools_Index_GetTile(encoded);
+			ObjectGrid_UpdateUnit(u2);
+			Server_MarkUnitDirty(u2);
 			if (!Unit_IsTileOccupied(u2)) return 0;
 			u2->o.position.x = 0xFFFF;
 			u2->o.position.y = 0xFFFF;
+			ObjectGrid_UpdateUnit(u2);
 			return 1;
 
 		case IT_STRUCTURE: {
@@ -1882,6 +1923,7 @@ uint16 Script_Unit_IdleAction(ScriptEngine *script)
 
 	if (movementType == MOVEMENT_FOOT && random > 8) {
 		u->spriteOffset = Tools_Random_256() & 0x3F;
+		Server_MarkUnitDirty(u);
 		Unit_UpdateMap(2, u);
 	}
 
@@ -2026,6 +2068,7 @@ uint16 Script_Unit_Unknown2BD5(ScriptEngine *script)
 			if (Tools_Index_Encode(u->o.index, IT_UNIT) == u2->o.script.variables[4] && u2->o.houseID == u->o.houseID) return 1;
 
 			u2->targetMove = 0;
+			Server_MarkUnitDirty(u2);
 		} break;
 
 		case IT_STRUCTURE: {
@@ -76,11 +76,17 @@ static const uint8 *Sprites_GetSprite(const uint8 *buffer, uint16 index)
 static void
 Sprites_Load(enum SearchDirectory dir, const char *filename, int start, int end)
 {
-	uint8 *buffer;
+	const uint8 *buffer;
+	uint32 length;
 	uint16 count;
 	uint16 i;
 
-	buffer = File_ReadWholeFile_Ex(dir, filename);
+	buffer = File_GetView_Ex(dir, filename, &length);
+	if (length < 2) {
+		File_ReleaseView(buffer);
+		return;
+	}
+
 	count = READ_LE_UINT16(buffer);
 
 	assert(count == end - start + 1);
@@ -90,8 +96,11 @@ Sprites_Load(enum SearchDirectory dir, const char *filename, int start, int end)
 		const uint8 *src = Sprites_GetSprite(buffer, i);
 		uint8 *dst = NULL;
 
-		if (src != NULL) {
+		/* The view is not padded, so check the sprite is inside it. */
+		if (src != NULL && (uint32)(src - buffer) + 8 <= length) {
 			uint16 size = READ_LE_UINT16(src + 6);
+			if ((uint32)(src - buffer) + size > length) size = length - (src - buffer);
+
 			dst = (uint8 *)malloc(size);
 			memcpy(dst, src, size);
 		}
@@ -100,7 +109,7 @@ Sprites_Load(enum SearchDirectory dir, const char *filename, int start, int end)
 		g_sprites[start + i] = dst;
 	}
 
-	free(buffer);
+	File_ReleaseView(buffer);
 }
 
 /**
@@ -213,7 +222,9 @@ static void Sprites_LoadICNFile(const char *filename)
 }
 
 /**
- * Loads the sprites for tiles.
+ * Loads the sprites for tiles, unless they are already loaded.  The
+ * tiles come from the global data directory, so they are the same for
+ * every campaign.
  */
 void Sprites_LoadTiles(void)
 {
@@ -255,42 +266,30 @@ static uint32
 Sprites_LoadCPSFile(enum SearchDirectory dir, const char *filename,
 		Screen screenID, uint8 *palette)
 {
-	uint8 index;
-	uint16 size;
-	uint8 *buffer;
-	uint8 *buffer2;
+	const uint8 *file;
+	uint32 length;
+	uint32 size;
 	uint16 paletteSize;
 
-	buffer = GFX_Screen_Get_ByIndex(screenID);
-
-	index = File_Open_Ex(dir, filename, FILE_MODE_READ);
-	size = File_Read_LE16(index);
-
-	File_Read(index, buffer, 8);
-
-	size -= 8;
-
-	paletteSize = READ_LE_UINT16(buffer + 6);
-
-	if (palette != NULL && paletteSize != 0) {
-		File_Read(index, palette, paletteSize);
-	} else {
-		File_Seek(index, paletteSize, 1);
+	/* Decode straight from the file, which is the size, then the
+	 * header with the length of the palette, the palette and the image.
+	 */
+	file = File_GetView_Ex(dir, filename, &length);
+	if (length < 10) {
+		File_ReleaseView(file);
+		return 0;
 	}
 
-	buffer[6] = 0;	/* dont read palette next time */
-	buffer[7] = 0;
-	size -= paletteSize;
+	paletteSize = READ_LE_UINT16(file + 2 + 6);
 
-	buffer2 = GFX_Screen_Get_ByIndex(screenID);
-	buffer2 += GFX_Screen_GetSize_ByIndex(screenID) - size - 8;
-
-	memmove(buffer2, buffer, 8);
-	File_Read(index, buffer2 + 8, size);
+	if (palette != NULL && paletteSize != 0 && 10u + paletteSize <= length) {
+		memcpy(palette, file + 10, paletteSize);
+	}
 
-	File_Close(index);
+	size = Sprites_Decode(file + 2, GFX_Screen_Get_ByIndex(screenID));
+	File_ReleaseView(file);
 
-	return Sprites_Decode(buffer2, buffer);
+	return size;
 }
 
 /**
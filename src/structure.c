@@ -24,6 +24,7 @@
 #include "net/server.h"
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
+#include "objectgrid.h"
 #include "opendune.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
@@ -103,12 +104,10 @@ void GameLoop_Structure(void)
 		g_scriptCurrentUnit      = NULL;
 		g_scriptCurrentTeam      = NULL;
 
-		if (enhancement_fog_of_war)
-			Structure_RemoveFog(UNVEILCAUSE_STRUCTURE_VISION, s);
-
 		if (tickPalace && s->o.type == STRUCTURE_PALACE) {
 			if (s->countDown != 0) {
 				s->countDown--;
+				Server_MarkStructureDirty(s);
 			}
 
 			/* Check if we have to fire the weapon for the AI immediately */
@@ -125,6 +124,8 @@ void GameLoop_Structure(void)
 			if (s->o.flags.s.upgrading) {
 				uint16 upgradeCost = si->o.buildCredits / 40;
 
+				Server_MarkStructureDirty(s);
+
 				if (upgradeCost <= h->credits) {
 					h->credits -= upgradeCost;
 
@@ -152,6 +153,8 @@ void GameLoop_Structure(void)
 			} else if (s->o.flags.s.repairing) {
 				uint16 repairCost;
 
+				Server_MarkStructureDirty(s);
+
 				switch (enhancement_repair_cost_formula) {
 					default:
 					case REPAIR_COST_v107:
@@ -201,6 +204,8 @@ void GameLoop_Structure(void)
 					uint16 buildSpeed;
 					uint16 buildCost;
 
+					Server_MarkStructureDirty(s);
+
 					if (s->o.type == STRUCTURE_CONSTRUCTION_YARD) {
 						oi = &g_table_structureInfo[s->objectType].o;
 					} else if (s->o.type == STRUCTURE_REPAIR) {
@@ -330,6 +335,8 @@ void GameLoop_Structure(void)
 					if (start_next) {
 						uint16 object_type;
 
+						Server_MarkStructureDirty(s);
+
 						object_type = BuildQueue_RemoveHead(&s->queue);
 						while (object_type != 0xFFFF) {
 							bool can_build = false;
@@ -364,6 +371,8 @@ void GameLoop_Structure(void)
 						uint16 repairSpeed;
 						uint16 repairCost;
 
+						Server_MarkStructureDirty(s);
+
 						ui = &g_table_unitInfo[Unit_Get_ByIndex(s->o.linkedID)->o.type];
 
 						repairSpeed = 256;
@@ -390,6 +399,7 @@ void GameLoop_Structure(void)
 						}
 					} else if (h->credits != 0) {
 						/* Automaticly resume repairing when there is money again */
+						if (s->o.flags.s.onHold) Server_MarkStructureDirty(s);
 						s->o.flags.s.onHold = false;
 					}
 				}
@@ -529,6 +539,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 	if (position == 0xFFFF) return false;
 
 	si = &g_table_structureInfo[s->o.type];
+	Server_MarkStructureDirty(s);
 
 	/* ENHANCEMENT -- If the construction yard was captured, we need to reset the house.
 	 * This is also needed because concrete slabs and walls are shared, creating problems with saved games.
@@ -562,6 +573,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 			t->houseID  = s->o.houseID;
 
 			g_mapSpriteID[position] |= 0x8000;
+			Map_InvalidateTile(position);
 
 			Tile_RemoveFogInRadius(1 << s->o.houseID, UNVEILCAUSE_STRUCTURE_PLACED,
 					Tile_UnpackTile(position), 1);
@@ -589,6 +601,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 				t->houseID = s->o.houseID;
 
 				g_mapSpriteID[curPos] |= 0x8000;
+				Map_InvalidateTile(curPos);
 
 				Tile_RemoveFogInRadius(1 << s->o.houseID, UNVEILCAUSE_STRUCTURE_PLACED,
 						Tile_UnpackTile(curPos), 1);
@@ -610,6 +623,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 					t->houseID = s->o.houseID;
 
 					g_mapSpriteID[curPos] |= 0x8000;
+					Map_InvalidateTile(curPos);
 
 					Tile_RemoveFogInRadius(1 << s->o.houseID, UNVEILCAUSE_STRUCTURE_PLACED,
 							Tile_UnpackTile(curPos), 1);
@@ -657,6 +671,7 @@ bool Structure_Place(Structure *s, uint16 position, enum HouseType houseID)
 	s->o.position = Tile_UnpackTile(position);
 	s->o.position.x &= 0xFF00;
 	s->o.position.y &= 0xFF00;
+	ObjectGrid_UpdateStructure(s);
 
 	s->rotationSpriteDiff = 0;
 	s->o.hitpoints  = si->o.hitpoints;
@@ -789,6 +804,7 @@ Structure_Server_SetState(Structure *s, enum StructureState state)
 {
 	if (s == NULL) return;
 	s->state = state;
+	Server_MarkStructureDirty(s);
 
 	Structure_UpdateMap(s);
 }
@@ -981,6 +997,8 @@ Structure_Server_ActivateSpecial(Structure *s)
 	House *h = House_Get_ByIndex(s->o.houseID);
 	const HouseInfo *hi = &g_table_houseInfo[s->o.houseID];
 
+	Server_MarkStructureDirty(s);
+
 	switch (hi->specialWeapon) {
 		case HOUSE_WEAPON_MISSILE: {
 			Unit *u;
@@ -1100,21 +1118,15 @@ Structure_Server_ActivateSpecial(Structure *s)
 }
 
 /**
- * Remove the fog around a structure.
+ * Get the position the structure sees the fog around from.
  *
  * @param s The Structure.
  */
-void
-Structure_RemoveFog(enum TileUnveilCause cause, const Structure *s)
+tile32
+Structure_GetFogPosition(const Structure *s)
 {
-	const StructureInfo *si;
-	tile32 position;
-
-	if (s == NULL) return;
-
-	si = &g_table_structureInfo[s->o.type];
-
-	position = s->o.position;
+	const StructureInfo *si = &g_table_structureInfo[s->o.type];
+	tile32 position = s->o.position;
 
 	/* ENHANCEMENT -- Fog is removed around the top left corner instead of the center of a structure. */
 	if (g_dune2_enhanced) {
@@ -1122,8 +1134,22 @@ Structure_RemoveFog(enum TileUnveilCause cause, const Structure *s)
 		position.y += 256 * (g_table_structure_layoutSize[si->layout].height - 1) / 2;
 	}
 
+	return position;
+}
+
+/**
+ * Remove the fog around a structure.
+ *
+ * @param s The Structure.
+ */
+void
+Structure_RemoveFog(enum TileUnveilCause cause, const Structure *s)
+{
+	if (s == NULL) return;
+
 	Tile_RemoveFogInRadius(House_GetAllies(s->o.houseID), cause,
-			position, si->o.fogUncoverRadius);
+			Structure_GetFogPosition(s),
+			g_table_structureInfo[s->o.type].o.fogUncoverRadius);
 }
 
 /**
@@ -1149,6 +1175,7 @@ static void Structure_Destroy(Structure *s)
 	s->o.flags.s.allocated = false;
 	s->o.flags.s.repairing = false;
 	s->o.script.delay = 0;
+	Server_MarkStructureDirty(s);
 
 	Script_Reset(&s->o.script, g_scriptStructure);
 	Script_Load(&s->o.script, s->o.type);
@@ -1244,6 +1271,7 @@ bool Structure_Damage(Structure *s, uint16 damage, uint16 range)
 	} else {
 		s->o.hitpoints = 0;
 	}
+	Server_MarkStructureDirty(s);
 
 	if (s->o.hitpoints == 0) {
 		g_scenario.structuresLost[s->o.houseID]++;
@@ -1448,6 +1476,7 @@ bool Structure_ConnectWall(uint16 position, bool recurse)
 
 	tile->groundSpriteID = spriteID;
 	g_mapSpriteID[position] |= 0x8000;
+	Map_InvalidateTile(position);
 
 	return true;
 }
@@ -1478,8 +1507,11 @@ void Structure_UntargetMe(Structure *s)
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
-		if (u->targetMove == encoded) u->targetMove = 0;
-		if (u->targetAttack == encoded) u->targetAttack = 0;
+		if (u->targetMove == encoded || u->targetAttack == encoded) {
+			if (u->targetMove == encoded) u->targetMove = 0;
+			if (u->targetAttack == encoded) u->targetAttack = 0;
+			Server_MarkUnitDirty(u);
+		}
 		if (u->o.script.variables[4] == encoded) Object_Script_Variable4_Clear(&u->o);
 	}
 
@@ -1576,6 +1608,8 @@ void Structure_Remove(Structure *s)
 			t->groundSpriteID = g_mapSpriteID[curPacked] & 0x1FF;
 			t->overlaySpriteID = 0;
 		}
+
+		Map_InvalidateTile(curPacked);
 	}
 
 	if (!g_debugScenario) {
@@ -1671,6 +1705,7 @@ void Structure_Server_CancelBuild(Structure *s)
 	s->o.flags.s.onHold = false;
 	s->countDown = 0;
 	s->o.linkedID = 0xFF;
+	Server_MarkStructureDirty(s);
 }
 
 /**
@@ -1697,6 +1732,7 @@ bool Structure_Server_BuildObject(Structure *s, uint16 objectType)
 	if (!si->o.flags.factory) return false;
 
 	Structure_Server_SetRepairingState(s, 0);
+	Server_MarkStructureDirty(s);
 
 	if (objectType == 0xFFFD) {
 		Structure_Server_SetUpgradingState(s, 1);
@@ -1809,12 +1845,16 @@ Structure_Server_SetUpgradingState(Structure *s, int state)
 
 		s->o.flags.s.upgrading = false;
 		s->o.flags.s.onHold = false;
+		Server_MarkStructureDirty(s);
 
 		ret = true;
 	}
 
 	// make sure, upgrade is possible, if structure is indeed upgradable.
-	if (s->upgradeTimeLeft == 0 && Structure_IsUpgradable(s)) s->upgradeTimeLeft = 100;
+	if (s->upgradeTimeLeft == 0 && Structure_IsUpgradable(s)) {
+		s->upgradeTimeLeft = 100;
+		Server_MarkStructureDirty(s);
+	}
 
 	if (state == 0 || s->o.flags.s.upgrading || s->upgradeTimeLeft == 0) return ret;
 
@@ -1824,6 +1864,7 @@ Structure_Server_SetUpgradingState(Structure *s, int state)
 	s->o.flags.s.onHold = true;
 	s->o.flags.s.repairing = false;
 	s->o.flags.s.upgrading = true;
+	Server_MarkStructureDirty(s);
 
 	return true;
 }
@@ -1854,6 +1895,7 @@ Structure_Server_SetRepairingState(Structure *s, int state)
 
 		s->o.flags.s.repairing = false;
 		s->o.flags.s.onHold = false;
+		Server_MarkStructureDirty(s);
 
 		ret = true;
 	}
@@ -1865,6 +1907,7 @@ Structure_Server_SetRepairingState(Structure *s, int state)
 
 	s->o.flags.s.onHold = true;
 	s->o.flags.s.repairing = true;
+	Server_MarkStructureDirty(s);
 
 	return true;
 }
@@ -1905,6 +1948,7 @@ void Structure_UpdateMap(Structure *s)
 
 		t->groundSpriteID = iconMap[i] + s->rotationSpriteDiff;
 		t->overlaySpriteID = 0;
+		Map_InvalidateTile(position);
 	}
 
 	if (s->state >= STRUCTURE_STATE_IDLE) {
@@ -48,6 +48,8 @@ extern double Timer_GetUnitRotationFrame(void);
 
 extern bool Timer_SetTimer(enum TimerType timer, bool set);
 extern int64_t Timer_GetTimer(enum TimerType timer);
+extern void Timer_AddTicks(enum TimerType timer, int64_t ticks);
+extern double Timer_GetTime(void);
 extern bool Timer_IsStarted(enum TimerType timer);
 extern void Timer_Sleep(int tics);
 extern void Timer_RegisterSource(void);
@@ -89,6 +89,29 @@ Timer_GetTimer(enum TimerType timer)
 	return al_get_timer_count(s_timer[timer]);
 }
 
+/**
+ * Move a stopped timer on by the given number of ticks, for running
+ * the game logic faster than real time.
+ */
+void
+Timer_AddTicks(enum TimerType timer, int64_t ticks)
+{
+	assert(timer <= TIMER_GAME);
+	assert(!al_get_timer_started(s_timer[timer]));
+
+	al_add_timer_count(s_timer[timer], ticks);
+}
+
+/**
+ * @return Seconds since the program started, for measuring how long
+ *         something takes.
+ */
+double
+Timer_GetTime(void)
+{
+	return al_get_time();
+}
+
 bool
 Timer_IsStarted(enum TimerType timer)
 {
@@ -0,0 +1,392 @@
+/* timerwheel.c
+ *
+ * Hierarchical timer wheel.
+ *
+ * Level 0 has a slot for each of the next 256 ticks.  Each further
+ * level has 64 slots, each as long as the whole level below it.  When
+ * the wheel reaches the start of a slot on a higher level, the timers
+ * in it are put back on the wheel, and so move down towards level 0.
+ * Timers further away than the top level reaches wait in its last
+ * slot.
+ *
+ * Adding and removing a timer are O(1).  Advancing skips over ticks
+ * while the levels that would be visited are empty, so going a long
+ * way at once is cheap too.
+ *
+ * Timers that are due are put on a list in the order they came due,
+ * and in the order they were added within a tick, for the owner to
+ * take one at a time.  A timer added for the current tick or earlier
+ * goes on the end of that list, so it is still taken in the same tick.
+ * The binary heaps the wheel replaced took timers due in the same tick
+ * in whatever order the heap held them; first come, first served is
+ * meant, and does not depend on how the timers were laid out.
+ *
+ * Timers can also be indexed by tile, so the owner can find the timers
+ * on a tile without going through them all.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timerwheel.h"
+
+enum {
+	TIMERWHEEL_LIST_DUE     = 0,
+	TIMERWHEEL_LEVEL0_BITS  = 8,
+	TIMERWHEEL_LEVELN_BITS  = 6,
+	TIMERWHEEL_RANGE_BITS   = TIMERWHEEL_LEVEL0_BITS + (TIMERWHEEL_LEVELS - 1) * TIMERWHEEL_LEVELN_BITS
+};
+
+/** Number of ticks covered by one slot of the level. */
+static int
+TimerWheel_GetShift(int level)
+{
+	return (level == 0) ? 0 : TIMERWHEEL_LEVEL0_BITS + (level - 1) * TIMERWHEEL_LEVELN_BITS;
+}
+
+/** Index of the first slot of the level in head and tail. */
+static int
+TimerWheel_GetFirstList(int level)
+{
+	return (level == 0) ? 1 : 1 + (1 << TIMERWHEEL_LEVEL0_BITS) + (level - 1) * (1 << TIMERWHEEL_LEVELN_BITS);
+}
+
+static int
+TimerWheel_GetSlotMask(int level)
+{
+	return (level == 0) ? (1 << TIMERWHEEL_LEVEL0_BITS) - 1 : (1 << TIMERWHEEL_LEVELN_BITS) - 1;
+}
+
+static int
+TimerWheel_GetLevel(uint16 list)
+{
+	int level = 0;
+
+	while (level + 1 < TIMERWHEEL_LEVELS && list >= TimerWheel_GetFirstList(level + 1))
+		level++;
+
+	return level;
+}
+
+static uint16
+TimerWheel_GetList(int level, int64_t tick)
+{
+	return TimerWheel_GetFirstList(level) + ((tick >> TimerWheel_GetShift(level)) & TimerWheel_GetSlotMask(level));
+}
+
+static void
+TimerWheel_Append(TimerWheel *wheel, uint16 id, uint16 list)
+{
+	TimerWheelNode *n = &wheel->node[id];
+
+	n->list = list;
+	n->next = TIMERWHEEL_NONE;
+	n->prev = wheel->tail[list];
+
+	if (n->prev == TIMERWHEEL_NONE) {
+		wheel->head[list] = id;
+	} else {
+		wheel->node[n->prev].next = id;
+	}
+
+	wheel->tail[list] = id;
+
+	if (list != TIMERWHEEL_LIST_DUE)
+		wheel->count[TimerWheel_GetLevel(list)]++;
+}
+
+static void
+TimerWheel_Unlink(TimerWheel *wheel, uint16 id)
+{
+	TimerWheelNode *n = &wheel->node[id];
+
+	if (n->list == TIMERWHEEL_NONE)
+		return;
+
+	if (n->prev == TIMERWHEEL_NONE) {
+		wheel->head[n->list] = n->next;
+	} else {
+		wheel->node[n->prev].next = n->next;
+	}
+
+	if (n->next == TIMERWHEEL_NONE) {
+		wheel->tail[n->list] = n->prev;
+	} else {
+		wheel->node[n->next].prev = n->prev;
+	}
+
+	if (n->list != TIMERWHEEL_LIST_DUE)
+		wheel->count[TimerWheel_GetLevel(n->list)]--;
+
+	n->list = TIMERWHEEL_NONE;
+}
+
+static void
+TimerWheel_Insert(TimerWheel *wheel, uint16 id)
+{
+	const int64_t tick = wheel->node[id].tick;
+	const int64_t delta = tick - wheel->now;
+
+	if (delta <= 0) {
+		TimerWheel_Append(wheel, id, TIMERWHEEL_LIST_DUE);
+		return;
+	}
+
+	if (delta >= ((int64_t)1 << TIMERWHEEL_RANGE_BITS)) {
+		const int64_t last = wheel->now + ((int64_t)1 << TIMERWHEEL_RANGE_BITS) - 1;
+
+		TimerWheel_Append(wheel, id, TimerWheel_GetList(TIMERWHEEL_LEVELS - 1, last));
+		return;
+	}
+
+	int level = 0;
+	while (delta >= ((int64_t)1 << TimerWheel_GetShift(level + 1)))
+		level++;
+
+	TimerWheel_Append(wheel, id, TimerWheel_GetList(level, tick));
+}
+
+void
+TimerWheel_Init(TimerWheel *wheel, int64_t now)
+{
+	wheel->now = now;
+	memset(wheel->count, 0, sizeof(wheel->count));
+	memset(wheel->head, 0xFF, sizeof(wheel->head));
+	memset(wheel->tail, 0xFF, sizeof(wheel->tail));
+	memset(wheel->tileHead, 0xFF, sizeof(wheel->tileHead));
+
+	wheel->num_node = 0;
+	wheel->freeHead = TIMERWHEEL_NONE;
+
+	if (wheel->node != NULL)
+		return;
+
+	wheel->max_node = 32;
+	wheel->node = malloc(wheel->max_node * sizeof(wheel->node[0]));
+	assert(wheel->node != NULL);
+}
+
+void
+TimerWheel_Free(TimerWheel *wheel)
+{
+	wheel->num_node = 0;
+	wheel->max_node = 0;
+	wheel->freeHead = TIMERWHEEL_NONE;
+
+	free(wheel->node);
+	wheel->node = NULL;
+}
+
+/**
+ * Add a timer due at the given tick.
+ *
+ * @param index Stored in the node for the owner.
+ * @return The timer, or TIMERWHEEL_NONE if out of memory.
+ */
+uint16
+TimerWheel_Add(TimerWheel *wheel, int64_t tick, uint16 index)
+{
+	uint16 id = wheel->freeHead;
+
+	if (id != TIMERWHEEL_NONE) {
+		wheel->freeHead = wheel->node[id].next;
+	} else {
+		if (wheel->num_node >= TIMERWHEEL_NONE)
+			return TIMERWHEEL_NONE;
+
+		if (wheel->num_node >= wheel->max_node) {
+			const int new_size = 2 * wheel->max_node;
+			TimerWheelNode *ptr = realloc(wheel->node, new_size * sizeof(wheel->node[0]));
+
+			if (ptr == NULL)
+				return TIMERWHEEL_NONE;
+
+			wheel->max_node = new_size;
+			wheel->node = ptr;
+		}
+
+		id = wheel->num_node++;
+	}
+
+	TimerWheelNode *n = &wheel->node[id];
+
+	n->tick = tick;
+	n->list = TIMERWHEEL_NONE;
+	n->packed = TIMERWHEEL_NONE;
+	n->index = index;
+
+	TimerWheel_Insert(wheel, id);
+	return id;
+}
+
+/**
+ * Cancel the timer and forget it.
+ */
+void
+TimerWheel_Remove(TimerWheel *wheel, uint16 id)
+{
+	TimerWheel_Unlink(wheel, id);
+	TimerWheel_SetTile(wheel, id, TIMERWHEEL_NONE);
+
+	wheel->node[id].next = wheel->freeHead;
+	wheel->freeHead = id;
+}
+
+/**
+ * Make the timer due at the given tick instead, including a timer
+ * taken with TimerWheel_PopDue.
+ */
+void
+TimerWheel_Schedule(TimerWheel *wheel, uint16 id, int64_t tick)
+{
+	TimerWheel_Unlink(wheel, id);
+	wheel->node[id].tick = tick;
+	TimerWheel_Insert(wheel, id);
+}
+
+/**
+ * Put the timers in the slot back on the wheel, now that the wheel has
+ * reached its start.
+ */
+static void
+TimerWheel_Cascade(TimerWheel *wheel, int level)
+{
+	const uint16 list = TimerWheel_GetList(level, wheel->now);
+	uint16 id = wheel->head[list];
+
+	wheel->head[list] = TIMERWHEEL_NONE;
+	wheel->tail[list] = TIMERWHEEL_NONE;
+
+	while (id != TIMERWHEEL_NONE) {
+		const uint16 next = wheel->node[id].next;
+
+		wheel->count[level]--;
+		TimerWheel_Insert(wheel, id);
+		id = next;
+	}
+}
+
+/**
+ * Advance the wheel to the given tick, putting the timers due by then
+ * on the due list.
+ */
+void
+TimerWheel_Advance(TimerWheel *wheel, int64_t now)
+{
+	while (wheel->now < now) {
+		int level = 0;
+
+		while (level < TIMERWHEEL_LEVELS && wheel->count[level] == 0)
+			level++;
+
+		if (level == TIMERWHEEL_LEVELS) {
+			wheel->now = now;
+			break;
+		}
+
+		/* Nothing happens until the next slot of that level starts. */
+		if (level > 0) {
+			const int64_t last = wheel->now | (((int64_t)1 << TimerWheel_GetShift(level)) - 1);
+
+			if (last >= now) {
+				wheel->now = now;
+				break;
+			}
+
+			wheel->now = last;
+		}
+
+		wheel->now++;
+
+		for (int l = 1; l < TIMERWHEEL_LEVELS; l++) {
+			if ((wheel->now & (((int64_t)1 << TimerWheel_GetShift(l)) - 1)) != 0)
+				break;
+
+			TimerWheel_Cascade(wheel, l);
+		}
+
+		/* Move the slot onto the end of the due list. */
+		const uint16 list = TimerWheel_GetList(0, wheel->now);
+		uint16 id = wheel->head[list];
+
+		while (id != TIMERWHEEL_NONE) {
+			const uint16 next = wheel->node[id].next;
+
+			TimerWheel_Unlink(wheel, id);
+			TimerWheel_Append(wheel, id, TIMERWHEEL_LIST_DUE);
+			id = next;
+		}
+	}
+}
+
+/**
+ * Take the next timer that is due.  It stays allocated, to be put back
+ * with TimerWheel_Schedule or forgotten with TimerWheel_Remove.
+ *
+ * @return The timer, or TIMERWHEEL_NONE if none is due.
+ */
+uint16
+TimerWheel_PopDue(TimerWheel *wheel)
+{
+	const uint16 id = wheel->head[TIMERWHEEL_LIST_DUE];
+
+	if (id != TIMERWHEEL_NONE)
+		TimerWheel_Unlink(wheel, id);
+
+	return id;
+}
+
+/**
+ * Index the timer by the tile, or by no tile if packed is
+ * TIMERWHEEL_NONE.
+ */
+void
+TimerWheel_SetTile(TimerWheel *wheel, uint16 id, uint16 packed)
+{
+	TimerWheelNode *n = &wheel->node[id];
+
+	if (packed >= TIMERWHEEL_TILE_MAX)
+		packed = TIMERWHEEL_NONE;
+
+	if (n->packed == packed)
+		return;
+
+	if (n->packed != TIMERWHEEL_NONE) {
+		if (n->tilePrev == TIMERWHEEL_NONE) {
+			wheel->tileHead[n->packed] = n->tileNext;
+		} else {
+			wheel->node[n->tilePrev].tileNext = n->tileNext;
+		}
+
+		if (n->tileNext != TIMERWHEEL_NONE)
+			wheel->node[n->tileNext].tilePrev = n->tilePrev;
+	}
+
+	n->packed = packed;
+
+	if (packed != TIMERWHEEL_NONE) {
+		n->tilePrev = TIMERWHEEL_NONE;
+		n->tileNext = wheel->tileHead[packed];
+
+		if (n->tileNext != TIMERWHEEL_NONE)
+			wheel->node[n->tileNext].tilePrev = id;
+
+		wheel->tileHead[packed] = id;
+	}
+}
+
+uint16
+TimerWheel_GetFirstOnTile(const TimerWheel *wheel, uint16 packed)
+{
+	if (packed >= TIMERWHEEL_TILE_MAX)
+		return TIMERWHEEL_NONE;
+
+	return wheel->tileHead[packed];
+}
+
+uint16
+TimerWheel_GetNextOnTile(const TimerWheel *wheel, uint16 id)
+{
+	return wheel->node[id].tileNext;
+}
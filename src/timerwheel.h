@@ -0,0 +1,59 @@
+/** @file src/timerwheel.h Hierarchical timer wheel. */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <inttypes.h>
+#include "map.h"
+#include "types.h"
+
+enum {
+	TIMERWHEEL_NONE     = 0xFFFF,
+	TIMERWHEEL_LEVELS   = 4,
+	TIMERWHEEL_SLOTS    = 256 + 3 * 64,
+	TIMERWHEEL_TILE_MAX = MAP_SIZE_MAX * MAP_SIZE_MAX
+};
+
+typedef struct TimerWheelNode {
+	int64_t tick;                                           /*!< When the timer is due. */
+	uint16 next, prev;                                      /*!< Timers on the same list. */
+	uint16 tileNext, tilePrev;                              /*!< Timers on the same tile. */
+	uint16 list;                                            /*!< The list it is on, or TIMERWHEEL_NONE. */
+	uint16 packed;                                          /*!< The tile it is indexed by, or TIMERWHEEL_NONE. */
+	uint16 index;                                           /*!< Free for the owner, e.g. to find its data. */
+} TimerWheelNode;
+
+typedef struct TimerWheel {
+	int64_t now;                                            /*!< Last tick the wheel was advanced to. */
+	int count[TIMERWHEEL_LEVELS];                           /*!< Timers on each level. */
+
+	/* List 0 holds the timers that are due, the rest the slots. */
+	uint16 head[1 + TIMERWHEEL_SLOTS];
+	uint16 tail[1 + TIMERWHEEL_SLOTS];
+	uint16 tileHead[TIMERWHEEL_TILE_MAX];
+
+	int num_node;
+	int max_node;
+	uint16 freeHead;
+	TimerWheelNode *node;
+} TimerWheel;
+
+extern void TimerWheel_Init(TimerWheel *wheel, int64_t now);
+extern void TimerWheel_Free(TimerWheel *wheel);
+extern uint16 TimerWheel_Add(TimerWheel *wheel, int64_t tick, uint16 index);
+extern void TimerWheel_Remove(TimerWheel *wheel, uint16 id);
+extern void TimerWheel_Schedule(TimerWheel *wheel, uint16 id, int64_t tick);
+extern void TimerWheel_Advance(TimerWheel *wheel, int64_t now);
+extern uint16 TimerWheel_PopDue(TimerWheel *wheel);
+
+extern void TimerWheel_SetTile(TimerWheel *wheel, uint16 id, uint16 packed);
+extern uint16 TimerWheel_GetFirstOnTile(const TimerWheel *wheel, uint16 packed);
+extern uint16 TimerWheel_GetNextOnTile(const TimerWheel *wheel, uint16 id);
+
+static inline TimerWheelNode *
+TimerWheel_GetNode(const TimerWheel *wheel, uint16 id)
+{
+	return &wheel->node[id];
+}
+
+#endif
@@ -344,18 +344,18 @@ Tile_MoveByDirectionUnbounded(tile32 tile, uint8 orient256, uint16 distance)
  * @details Simplified logic.
  */
 tile32
-Tile_MoveByRandom(tile32 tile, uint16 distance, bool centre)
+Tile_MoveByRandom_r(tile32 tile, uint16 distance, bool centre, RandomGeneral *rng)
 {
 	if (distance == 0)
 		return tile;
 
-	uint16 newDistance = Tools_Random_256();
+	uint16 newDistance = Tools_Random_256_r(rng);
 	while (newDistance > distance) {
 		newDistance /= 2;
 	}
 	distance = newDistance;
 
-	const uint8 orient256 = Tools_Random_256();
+	const uint8 orient256 = Tools_Random_256_r(rng);
 	const uint16 x = tile.x + ((k_stepX[orient256] * distance) / 128) * 16;
 	const uint16 y = tile.y - ((k_stepY[orient256] * distance) / 128) * 16;
 
@@ -369,6 +369,12 @@ Tile_MoveByRandom(tile32 tile, uint16 distance, bool centre)
 	return centre ? Tile_Center(tile) : tile;
 }
 
+tile32
+Tile_MoveByRandom(tile32 tile, uint16 distance, bool centre)
+{
+	return Tile_MoveByRandom_r(tile, distance, centre, &g_randomGeneral);
+}
+
 /**
  * @brief   f__B4CD_00A5_0016_24FA.
  * @details Simplified logic.
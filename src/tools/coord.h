@@ -5,6 +5,8 @@
 
 #include "types.h"
 
+struct RandomGeneral;
+
 extern bool   Tile_IsOutOfMap(uint16 packed);
 extern uint8  Tile_GetPackedX(uint16 packed);
 extern uint8  Tile_GetPackedY(uint16 packed);
@@ -22,6 +24,7 @@ extern tile32 Tile_AddTileDiff(tile32 a, tile32 b);
 extern tile32 Tile_MoveByDirection(tile32 tile, uint8 orient256, uint16 distance);
 extern tile32 Tile_MoveByDirectionUnbounded(tile32 tile, uint8 orient256, uint16 distance);
 extern tile32 Tile_MoveByRandom(tile32 tile, uint16 distance, bool centre);
+extern tile32 Tile_MoveByRandom_r(tile32 tile, uint16 distance, bool centre, struct RandomGeneral *rng);
 extern tile32 Tile_MoveByOrientation(tile32 position, uint8 orient256);
 extern int16  Tile_GetDistance(tile32 a, tile32 b);
 extern uint16 Tile_GetDistanceRoundedUp(tile32 a, tile32 b);
@@ -0,0 +1,25 @@
+/**
+ * @file src/tools/hash.c
+ *
+ * FNV-1a hash, for telling whether data has changed.  Not for
+ * anything that needs to be hard to forge.
+ */
+
+#include "types.h"
+#include "hash.h"
+
+/**
+ * Hash more data onto a hash.  Start from TOOLS_HASH_FNV1A_BASIS.
+ */
+uint64_t
+Tools_HashFNV1a(uint64_t hash, const void *data, size_t length)
+{
+	const uint8 *p = data;
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
@@ -0,0 +1,14 @@
+/** @file src/tools/hash.h */
+
+#ifndef TOOLS_HASH_H
+#define TOOLS_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** The value to start a hash from. */
+#define TOOLS_HASH_FNV1A_BASIS  0xCBF29CE484222325ULL
+
+extern uint64_t Tools_HashFNV1a(uint64_t hash, const void *data, size_t length);
+
+#endif
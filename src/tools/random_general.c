@@ -2,26 +2,29 @@
  * @file src/tools/random_general.c
  *
  * General RNG, used during map creation in particular.
+ *
+ * The _r variants use a state of the caller, so that landscapes can be
+ * generated away from the game, e.g. on other threads.
  */
 
 #include "random_general.h"
 
 /** variable_76A2. */
-static uint8 s_seed[4];
+RandomGeneral g_randomGeneral;
 
 /**
- * @brief   Sets s_seed (variable_76A2).
+ * @brief   Sets the seed (variable_76A2).
  * @details f__257A_000D_001A_3B75 between labels (l__0090, l__00AC),
  *          f__257A_000D_001A_3B75 between labels (l__00FD, l__0125),
  *          f__B4B8_0000_001F_3BC3 between labels (l__0000, l__001F).
  */
 void
-Tools_Random_Seed(uint32 seed)
+Tools_Random_Seed_r(RandomGeneral *rng, uint32 seed)
 {
-	s_seed[0] = (seed >>  0) & 0xFF;
-	s_seed[1] = (seed >>  8) & 0xFF;
-	s_seed[2] = (seed >> 16) & 0xFF;
-	s_seed[3] = (seed >> 24) & 0xFF;
+	rng->seed[0] = (seed >>  0) & 0xFF;
+	rng->seed[1] = (seed >>  8) & 0xFF;
+	rng->seed[2] = (seed >> 16) & 0xFF;
+	rng->seed[3] = (seed >> 24) & 0xFF;
 }
 
 /**
@@ -29,17 +32,31 @@ Tools_Random_Seed(uint32 seed)
  * @details Likely to have been hand-written assembly.
  */
 uint8
-Tools_Random_256(void)
+Tools_Random_256_r(RandomGeneral *rng)
 {
-	const uint8 carry0 = (s_seed[0] >> 1) & 0x01;
-	const uint8 carry2 = (s_seed[2] >> 7);
-	s_seed[2] = (s_seed[2] << 1) | carry0;
+	uint8 *seed = rng->seed;
+
+	const uint8 carry0 = (seed[0] >> 1) & 0x01;
+	const uint8 carry2 = (seed[2] >> 7);
+	seed[2] = (seed[2] << 1) | carry0;
 
-	const uint8 carry1 = (s_seed[1] >> 7);
-	s_seed[1] = (s_seed[1] << 1) | carry2;
+	const uint8 carry1 = (seed[1] >> 7);
+	seed[1] = (seed[1] << 1) | carry2;
+
+	const uint8 carry = ((seed[0] >> 2) - seed[0] - (carry1 ^ 0x01)) & 0x01;
+	seed[0] = (carry << 7) | (seed[0] >> 1);
+
+	return seed[0] ^ seed[1];
+}
 
-	const uint8 carry = ((s_seed[0] >> 2) - s_seed[0] - (carry1 ^ 0x01)) & 0x01;
-	s_seed[0] = (carry << 7) | (s_seed[0] >> 1);
+void
+Tools_Random_Seed(uint32 seed)
+{
+	Tools_Random_Seed_r(&g_randomGeneral, seed);
+}
 
-	return s_seed[0] ^ s_seed[1];
+uint8
+Tools_Random_256(void)
+{
+	return Tools_Random_256_r(&g_randomGeneral);
 }
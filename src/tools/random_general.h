@@ -5,7 +5,16 @@
 
 #include "types.h"
 
+typedef struct RandomGeneral {
+	uint8 seed[4];
+} RandomGeneral;
+
+extern RandomGeneral g_randomGeneral;
+
 extern void  Tools_Random_Seed(uint32 seed);
 extern uint8 Tools_Random_256(void);
 
+extern void  Tools_Random_Seed_r(RandomGeneral *rng, uint32 seed);
+extern uint8 Tools_Random_256_r(RandomGeneral *rng);
+
 #endif
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "enum_string.h"
+#include "errorlog.h"
 #include "types.h"
 #include "os/common.h"
 #include "os/math.h"
@@ -22,10 +23,12 @@
 #include "gui/widget.h"
 #include "house.h"
 #include "map.h"
+#include "minimap.h"
 #include "net/net.h"
 #include "net/server.h"
 #include "newui/actionpanel.h"
 #include "newui/menubar.h"
+#include "objectgrid.h"
 #include "opendune.h"
 #include "pool/pool.h"
 #include "pool/pool_house.h"
@@ -305,6 +308,7 @@ static void Unit_Rotate(Unit *unit, uint16 level)
 	}
 
 	unit->orientation[level].current = newCurrent;
+	Server_MarkUnitDirty(unit);
 
 	if (Orientation_256To16(newCurrent) == Orientation_256To16(current) && Orientation_256To8(newCurrent) == Orientation_256To8(current)) return;
 
@@ -415,12 +419,6 @@ void GameLoop_Unit(void)
 
 		if (u->o.flags.s.isNotOnMap) continue;
 
-		/* Do not unveil new tiles for air units (ornithopters), but
-		 * allow them to refresh previously scouted tiles for vision.
-		 */
-		if (enhancement_fog_of_war)
-			Unit_RefreshFog(UNVEILCAUSE_UNIT_VISION, u, ui->flags.isGroundUnit);
-
 		if (tickUnknown4 && u->targetAttack != 0 && ui->o.flags.hasTurret) {
 			tile32 tile;
 
@@ -456,6 +454,7 @@ void GameLoop_Unit(void)
 
 		if (tickBlinking && u->blinkCounter != 0) {
 			u->blinkCounter--;
+			Server_MarkUnitDirty(u);
 			if ((u->blinkCounter % 2) != 0) {
 				u->o.flags.s.isHighlighted = true;
 			} else {
@@ -467,6 +466,7 @@ void GameLoop_Unit(void)
 
 		if (tickMoveIndicator && u->moveIndicatorCounter != 0) {
 			u->moveIndicatorCounter--;
+			Server_MarkUnitDirty(u);
 			if (u->moveIndicatorCounter > 0 && u->moveIndicatorCounter < 10) {
 				u->showMoveIndicator = true;
 			}
@@ -485,6 +485,7 @@ void GameLoop_Unit(void)
 					if (u->spriteOffset >= 0) {
 						u->spriteOffset &= 0x3F;
 						u->spriteOffset++;
+						Server_MarkUnitDirty(u);
 
 						Unit_UpdateMap(2, u);
 
@@ -502,6 +503,7 @@ void GameLoop_Unit(void)
 				if (u->o.type == UNIT_ORNITHOPTER && u->o.flags.s.allocated && u->spriteOffset >= 0) {
 					u->spriteOffset &= 0x3F;
 					u->spriteOffset++;
+					Server_MarkUnitDirty(u);
 
 					Unit_UpdateMap(2, u);
 
@@ -512,6 +514,7 @@ void GameLoop_Unit(void)
 					if (u->actionID == ACTION_HARVEST || u->o.flags.s.isSmoking) {
 						u->spriteOffset &= 0x3F;
 						u->spriteOffset++;
+						Server_MarkUnitDirty(u);
 
 						Unit_UpdateMap(2, u);
 
@@ -521,6 +524,7 @@ void GameLoop_Unit(void)
 							Unit_UpdateMap(2, u);
 
 							u->spriteOffset = 0;
+							Server_MarkUnitDirty(u);
 						}
 					}
 				}
@@ -560,6 +564,7 @@ void GameLoop_Unit(void)
 
 		Unit_Server_SetAction(u, u->nextActionID);
 		u->nextActionID = ACTION_INVALID;
+		Server_MarkUnitDirty(u);
 	}
 }
 
@@ -674,6 +679,7 @@ Unit *Unit_Create(uint16 index, uint8 typeID, uint8 houseID, tile32 position, in
 
 	u->lastPosition     = position;
 	u->o.position       = position;
+	ObjectGrid_UpdateUnit(u);
 	u->o.hitpoints      = ui->o.hitpoints;
 	u->currentDestination.x = 0;
 	u->currentDestination.y = 0;
@@ -759,12 +765,14 @@ Unit_Server_SetAction(Unit *u, enum UnitActionType action)
 		case 0:
 			if (Unit_IsMoving(u)) {
 				u->nextActionID = action;
+				Server_MarkUnitDirty(u);
 				return;
 			}
 			/* FALL-THROUGH */
 		case 1:
 			u->actionID = action;
 			u->nextActionID = ACTION_INVALID;
+			Server_MarkUnitDirty(u);
 			u->currentDestination.x = 0;
 			u->currentDestination.y = 0;
 			u->o.script.delay = 0;
@@ -845,25 +853,10 @@ void Unit_Sort(void)
 	h->unitCountEnemy = 0;
 	h->unitCountAllied = 0;
 
-	for (uint16 i = 0; i < g_unitFindCount - 1; i++) {
-		Unit *u1;
-		Unit *u2;
-		uint16 y1;
-		uint16 y2;
-
-		u1 = g_unitFindArray[i];
-		u2 = g_unitFindArray[i + 1];
-		y1 = u1->o.position.y;
-		y2 = u2->o.position.y;
-		if (g_table_unitInfo[u1->o.type].movementType == MOVEMENT_FOOT) y1 -= 0x100;
-		if (g_table_unitInfo[u2->o.type].movementType == MOVEMENT_FOOT) y2 -= 0x100;
-
-		if ((int16)y1 > (int16)y2) {
-			g_unitFindArray[i] = u2;
-			g_unitFindArray[i + 1] = u1;
-		}
-	}
-
+	/* Units used to be sorted for drawing here, one pass of swaps over
+	 * g_unitFindArray per tick.  The draw order is now kept by the
+	 * draw list, so the game logic visits units in pool order.
+	 */
 	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
@@ -995,6 +988,7 @@ void Unit_SetDestination(Unit *u, uint16 destination)
 
 	u->targetMove = destination;
 	u->route[0]   = 0xFF;
+	Server_MarkUnitDirty(u);
 }
 
 /**
@@ -1137,6 +1131,8 @@ bool Unit_SetPosition(Unit *u, tile32 position)
 	u->o.flags.s.isNotOnMap = false;
 
 	u->o.position = Tile_Center(position);
+	ObjectGrid_UpdateUnit(u);
+	Server_MarkUnitDirty(u);
 
 	if (u->originEncoded == 0) Unit_FindClosestRefinery(u);
 
@@ -1185,6 +1181,7 @@ void Unit_Remove(Unit *u)
 	if (u == NULL) return;
 
 	u->o.flags.s.allocated = true;
+	Server_MarkUnitDirty(u);
 	Unit_UntargetMe(u);
 
 	Unit_Unselect(u);
@@ -1200,32 +1197,21 @@ void Unit_Remove(Unit *u)
 }
 
 /**
- * Gets the best target unit for the given unit.
+ * Gets the best target unit for the given unit, by looking at every unit.
  *
  * @param u The Unit to get the best target for.
  * @param mode How to determine the best target.
+ * @param position The origin of the Unit.
+ * @param distance The maximum distance to the target for modes 1 and 2.
  * @return The best target or NULL if none found.
  */
-Unit *Unit_FindBestTargetUnit(Unit *u, uint16 mode)
+static Unit *
+Unit_FindBestTargetUnit_Scan(Unit *u, uint16 mode, tile32 position, uint16 distance)
 {
-	tile32 position;
-	uint16 distance;
 	PoolFindStruct find;
 	Unit *best = NULL;
 	uint16 bestPriority = 0;
 
-	if (u == NULL) return NULL;
-
-	position = u->o.position;
-	if (u->originEncoded == 0) {
-		u->originEncoded = Tools_Index_Encode(Tile_PackTile(position), IT_TILE);
-	} else {
-		position = Tools_Index_GetTile(u->originEncoded);
-	}
-
-	distance = g_table_unitInfo[u->o.type].fireDistance << 8;
-	if (mode == 2) distance <<= 1;
-
 	for (Unit *target = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			target != NULL;
 			target = Unit_FindNext(&find)) {
@@ -1250,6 +1236,84 @@ Unit *Unit_FindBestTargetUnit(Unit *u, uint16 mode)
 	return best;
 }
 
+/**
+ * Gets the best target unit within the distance of a position, using
+ *  the ObjectGrid.  Gives the same result as Unit_FindBestTargetUnit_Scan.
+ *
+ * @param u The Unit to get the best target for.
+ * @param origin The position to measure the distance from.
+ * @param distance The maximum distance to the target.
+ * @return The best target or NULL if none found.
+ */
+static Unit *
+Unit_FindBestTargetUnit_InRange(Unit *u, tile32 origin, uint16 distance)
+{
+	ObjectGridFindStruct find;
+	Unit *best = NULL;
+	uint16 bestPriority = 0;
+
+	for (Unit *target = ObjectGrid_FindFirstUnit(&find, origin, distance);
+			target != NULL;
+			target = ObjectGrid_FindNextUnit(&find)) {
+		if (Tile_GetDistance(origin, target->o.position) > distance) continue;
+
+		const uint16 priority = Unit_GetTargetUnitPriority(u, target);
+		if ((int16)priority < (int16)bestPriority) continue;
+
+		/* The first of equal targets in g_unitFindArray wins. */
+		if ((int16)priority == (int16)bestPriority) {
+			if (best == NULL || Unit_GetFindIndex(target) > Unit_GetFindIndex(best)) continue;
+		}
+
+		best = target;
+		bestPriority = priority;
+	}
+
+	if (bestPriority == 0) return NULL;
+
+	return best;
+}
+
+/**
+ * Gets the best target unit for the given unit.
+ *
+ * @param u The Unit to get the best target for.
+ * @param mode How to determine the best target.
+ * @return The best target or NULL if none found.
+ */
+Unit *Unit_FindBestTargetUnit(Unit *u, uint16 mode)
+{
+	tile32 position;
+	uint16 distance;
+
+	if (u == NULL) return NULL;
+
+	position = u->o.position;
+	if (u->originEncoded == 0) {
+		u->originEncoded = Tools_Index_Encode(Tile_PackTile(position), IT_TILE);
+	} else {
+		position = Tools_Index_GetTile(u->originEncoded);
+	}
+
+	distance = g_table_unitInfo[u->o.type].fireDistance << 8;
+	if (mode == 2) distance <<= 1;
+
+	if (mode != 1 && mode != 2)
+		return Unit_FindBestTargetUnit_Scan(u, mode, position, distance);
+
+	Unit *best = Unit_FindBestTargetUnit_InRange(u, (mode == 1) ? u->o.position : position, distance);
+
+#ifdef OBJECTGRID_VERIFY
+	const Unit *expected = Unit_FindBestTargetUnit_Scan(u, mode, position, distance);
+	if (best != expected) {
+		Warning("ObjectGrid: unit %d found target %d instead of %d\n", u->o.index,
+				(best == NULL) ? -1 : best->o.index, (expected == NULL) ? -1 : expected->o.index);
+	}
+#endif
+
+	return best;
+}
+
 /**
  * Get the priority for a target. Various of things have influence on this score,
  *  most noticeable the movementType of the target, his distance to you, and
@@ -1299,19 +1363,18 @@ static uint16 Unit_Sandworm_GetTargetPriority(Unit *unit, Unit *target)
 }
 
 /**
- * Find the best target, based on the score. Only considers units on sand.
+ * Find the best target by looking at every unit.
  *
  * @param unit The unit to search a target for.
  * @return A target Unit, or NULL if none is found.
  */
-Unit *Unit_Sandworm_FindBestTarget(Unit *unit)
+static Unit *
+Unit_Sandworm_FindBestTarget_Scan(Unit *unit)
 {
 	Unit *best = NULL;
 	PoolFindStruct find;
 	uint16 bestPriority = 0;
 
-	if (unit == NULL) return NULL;
-
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
@@ -1328,6 +1391,73 @@ Unit *Unit_Sandworm_FindBestTarget(Unit *unit)
 	return best;
 }
 
+/**
+ * Find the best target by looking at rings of cells of the ObjectGrid,
+ *  nearest first, until no target further away can score higher.
+ *  Gives the same result as Unit_Sandworm_FindBestTarget_Scan.
+ *
+ * @param unit The unit to search a target for.
+ * @return A target Unit, or NULL if none is found.
+ */
+static Unit *
+Unit_Sandworm_FindBestTarget_Rings(Unit *unit)
+{
+	ObjectGridFindStruct find;
+	Unit *best = NULL;
+	uint16 bestPriority = 0;
+
+	for (uint8 ring = 0; ring < OBJECTGRID_RING_MAX; ring++) {
+		const uint16 distance = ObjectGrid_GetRingDistance(ring) >> 8;
+
+		/* The highest priority of a wheeled unit on the move, see
+		 * Unit_Sandworm_GetTargetPriority.
+		 */
+		if (distance >= 2 && (0x1388 * 4) / distance < bestPriority) break;
+
+		for (Unit *u = ObjectGrid_FindFirstUnitInRing(&find, unit->o.position, ring);
+				u != NULL;
+				u = ObjectGrid_FindNextUnit(&find)) {
+			const uint16 priority = Unit_Sandworm_GetTargetPriority(unit, u);
+
+			if (priority == 0 || priority < bestPriority) continue;
+
+			/* The last of equal targets in g_unitFindArray wins. */
+			if (priority == bestPriority && Unit_GetFindIndex(u) < Unit_GetFindIndex(best)) continue;
+
+			best = u;
+			bestPriority = priority;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Find the best target, based on the score. Only considers units on sand.
+ *
+ * @param unit The unit to search a target for.
+ * @return A target Unit, or NULL if none is found.
+ */
+Unit *Unit_Sandworm_FindBestTarget(Unit *unit)
+{
+	if (unit == NULL) return NULL;
+
+	if (!ObjectGrid_IsPositionInside(unit->o.position))
+		return Unit_Sandworm_FindBestTarget_Scan(unit);
+
+	Unit *best = Unit_Sandworm_FindBestTarget_Rings(unit);
+
+#ifdef OBJECTGRID_VERIFY
+	const Unit *expected = Unit_Sandworm_FindBestTarget_Scan(unit);
+	if (best != expected) {
+		Warning("ObjectGrid: sandworm %d found target %d instead of %d\n", unit->o.index,
+				(best == NULL) ? -1 : best->o.index, (expected == NULL) ? -1 : expected->o.index);
+	}
+#endif
+
+	return best;
+}
+
 /**
  * Initiate the first movement of a Unit when the pathfinder has found a route.
  *
@@ -1370,6 +1500,7 @@ bool Unit_StartMovement(Unit *unit)
 
 	if (unit->o.type == UNIT_SABOTEUR && type == LST_WALL) speed = 255;
 	unit->o.flags.s.isSmoking = false;
+	Server_MarkUnitDirty(unit);
 
 	/* ENHANCEMENT -- the flag is never set to false in original Dune2; in result, once the wobbling starts, it never stops. */
 	if (enhancement_fix_everlasting_unit_wobble) {
@@ -1435,6 +1566,7 @@ void Unit_SetTarget(Unit *unit, uint16 encoded)
 	}
 
 	unit->targetAttack = encoded;
+	Server_MarkUnitDirty(unit);
 
 	if (!g_table_unitInfo[unit->o.type].o.flags.hasTurret) {
 		unit->targetMove = encoded;
@@ -1463,6 +1595,8 @@ bool Unit_Deviation_Decrease(Unit *unit, uint16 amount)
 		amount = g_table_houseInfo[unit->o.houseID].toughness;
 	}
 
+	Server_MarkUnitDirty(unit);
+
 	if (unit->deviated > amount) {
 		unit->deviated -= amount;
 		return false;
@@ -1474,6 +1608,9 @@ bool Unit_Deviation_Decrease(Unit *unit, uint16 amount)
 	Unit_UpdateMap(2, unit);
 	unit->o.flags.s.bulletIsBig = false;
 
+	/* The unit is drawn in its own colour on the minimap again. */
+	Minimap_InvalidateTile(Tile_PackTile(unit->o.position));
+
 	if (House_IsHuman(unit->o.houseID)) {
 		Unit_Server_SetAction(unit, ui->o.actionsPlayer[3]);
 	} else {
@@ -1487,6 +1624,23 @@ bool Unit_Deviation_Decrease(Unit *unit, uint16 amount)
 	return true;
 }
 
+/**
+ * Get the radius the unit removes fog in.
+ *
+ * @param unit The Unit.
+ * @return The radius, or 0 if the unit cannot see, e.g. when it is
+ *  being carried.
+ */
+uint16
+Unit_GetFogRadius(const Unit *unit)
+{
+	if (unit->o.flags.s.isNotOnMap) return 0;
+	if (unit->o.flags.s.inTransport) return 0;
+	if ((unit->o.position.x == 0xFFFF && unit->o.position.y == 0xFFFF) || (unit->o.position.x == 0 && unit->o.position.y == 0)) return 0;
+
+	return Unit_GetFogUncoverRadius(unit->o.type, g_table_unitInfo[unit->o.type].o.fogUncoverRadius);
+}
+
 /**
  * Remove fog arount the given unit.
  *
@@ -1498,11 +1652,8 @@ Unit_RefreshFog(enum TileUnveilCause cause, const Unit *unit, bool unveil)
 	uint16 fogUncoverRadius;
 
 	if (unit == NULL) return;
-	if (unit->o.flags.s.isNotOnMap) return;
-	if (unit->o.flags.s.inTransport) return;
-	if ((unit->o.position.x == 0xFFFF && unit->o.position.y == 0xFFFF) || (unit->o.position.x == 0 && unit->o.position.y == 0)) return;
 
-	fogUncoverRadius = Unit_GetFogUncoverRadius(unit->o.type, g_table_unitInfo[unit->o.type].o.fogUncoverRadius);
+	fogUncoverRadius = Unit_GetFogRadius(unit);
 	if (fogUncoverRadius == 0) return;
 
 	Tile_RefreshFogInRadius(House_GetAllies(Unit_GetHouseID(unit)), cause,
@@ -1548,8 +1699,10 @@ bool Unit_Deviate(Unit *unit, uint16 probability, uint8 houseID)
 
 	unit->deviated = 120;
 	unit->deviatedHouse = houseID;
+	Server_MarkUnitDirty(unit);
 
 	Unit_UpdateMap(2, unit);
+	Minimap_InvalidateTile(Tile_PackTile(unit->o.position));
 
 	if (House_IsHuman(houseID)) {
 		/* Make brutal AI know about its own deviated units. */
@@ -1596,6 +1749,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 	if (unit == NULL || !unit->o.flags.s.used) return false;
 
 	ui = &g_table_unitInfo[unit->o.type];
+	Server_MarkUnitDirty(unit);
 
 	newPosition = Tile_MoveByDirection(unit->o.position, unit->orientation[0].current, distance);
 
@@ -1646,6 +1800,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 	} else {
 		unit->wobbleIndex = 0;
 	}
+	Server_MarkUnitDirty(unit);
 
 	d = Tile_GetDistance(newPosition, unit->currentDestination);
 	packed = Tile_PackTile(newPosition);
@@ -1734,6 +1889,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 
 			if (type == LST_WALL || type == LST_STRUCTURE || type == LST_ENTIRELY_MOUNTAIN) {
 				unit->o.position = newPosition;
+				ObjectGrid_UpdateUnit(unit);
 
 				Map_MakeExplosion((ui->explosionType + unit->o.hitpoints / 10) & 3, unit->o.position, unit->o.hitpoints, unit->originEncoded);
 
@@ -1851,6 +2007,7 @@ bool Unit_Move(Unit *unit, uint16 distance)
 
 	unit->distanceToDestination = distance;
 	unit->o.position = newPosition;
+	ObjectGrid_UpdateUnit(unit);
 
 	Unit_UpdateMap(1, unit);
 
@@ -1890,6 +2047,7 @@ bool Unit_Damage(Unit *unit, uint16 damage, uint16 range)
 	} else {
 		unit->o.hitpoints = 0;
 	}
+	Server_MarkUnitDirty(unit);
 
 	Unit_Deviation_Decrease(unit, 0);
 
@@ -1980,8 +2138,11 @@ Unit_UntargetEncodedIndex(uint16 encoded)
 	for (Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_INVALID);
 			u != NULL;
 			u = Unit_FindNext(&find)) {
-		if (u->targetMove == encoded) u->targetMove = 0;
-		if (u->targetAttack == encoded) u->targetAttack = 0;
+		if (u->targetMove == encoded || u->targetAttack == encoded) {
+			if (u->targetMove == encoded) u->targetMove = 0;
+			if (u->targetAttack == encoded) u->targetAttack = 0;
+			Server_MarkUnitDirty(u);
+		}
 		if (u->o.script.variables[4] == encoded) Object_Script_Variable4_Clear(&u->o);
 	}
 }
@@ -2033,6 +2194,7 @@ void Unit_SetOrientation(Unit *unit, int8 orientation, bool rotateInstantly, uin
 
 	if (rotateInstantly) {
 		unit->orientation[level].current = orientation;
+		Server_MarkUnitDirty(unit);
 		return;
 	}
 
@@ -2265,7 +2427,7 @@ bool Unit_IsTileOccupied(Unit *unit)
 	ui = &g_table_unitInfo[unit->o.type];
 	packed = Tile_PackTile(unit->o.position);
 
-	speed = g_table_landscapeInfo[Map_GetLandscapeType(packed)].movementSpeed[ui->movementType];
+	speed = Map_GetMovementSpeed(packed, ui->movementType);
 	if (speed == 0) return true;
 
 	if (unit->o.type == UNIT_SANDWORM || ui->movementType == MOVEMENT_WINGER) return false;
@@ -2534,6 +2696,7 @@ void Unit_Hide(Unit *unit)
 	unit->o.flags.s.bulletIsBig = true;
 	Unit_UpdateMap(0, unit);
 	unit->o.flags.s.bulletIsBig = false;
+	Server_MarkUnitDirty(unit);
 
 	Script_Reset(&unit->o.script, g_scriptUnit);
 	Unit_UntargetMe(unit);
@@ -2580,6 +2743,7 @@ Unit_CallUnitByType(enum UnitType type, uint8 houseID, uint16 target, bool creat
 
 	if (unit != NULL) {
 		unit->targetMove = target;
+		Server_MarkUnitDirty(unit);
 
 		Object_Script_Variable4_Set(&unit->o, target);
 	}
@@ -2610,6 +2774,7 @@ void Unit_EnterStructure(Unit *unit, Structure *s)
 
 	unit->o.seenByHouses |= s->o.seenByHouses;
 	Unit_Hide(unit);
+	Server_MarkStructureDirty(s);
 
 	if (House_AreAllied(s->o.houseID, Unit_GetHouseID(unit))) {
 		const enum StructureState state
@@ -2669,7 +2834,10 @@ void Unit_EnterStructure(Unit *unit, Structure *s)
 
 		if (s->o.linkedID != 0xFF) {
 			Unit *u = Unit_Get_ByIndex(s->o.linkedID);
-			if (u != NULL) u->o.houseID = Unit_GetHouseID(unit);
+			if (u != NULL) {
+				u->o.houseID = Unit_GetHouseID(unit);
+				Server_MarkUnitDirty(u);
+			}
 		}
 
 		House_CalculatePowerAndCredit(h);
@@ -2733,47 +2901,63 @@ Unit_StructureInRange(const Unit *unit, const Structure *s, uint16 distance)
 }
 
 /**
- * Gets the best target structure for the given unit.
+ * Check if a structure is a candidate target for the given mode.
+ *
+ * @param unit The Unit to get the best target for.
+ * @param s The Structure to check.
+ * @param mode How to determine the best target.
+ * @param position The origin of the Unit.
+ * @param distance The fire distance of the Unit.
+ * @return True if the structure may be targeted.
+ */
+static bool
+Unit_IsCandidateTargetStructure(const Unit *unit, const Structure *s, uint16 mode, tile32 position, uint16 distance)
+{
+	tile32 curPosition;
+
+	if (Structure_SharesPoolElement(s->o.type))
+		return false;
+
+	if (mode != 0 && mode != 4) {
+		if (mode == 1) {
+			if (!Unit_StructureInRange(unit, s, distance)) return false;
+		} else {
+			if (mode != 2) return false;
+
+			curPosition.x = s->o.position.x + g_table_structure_layoutTileDiff[g_table_structureInfo[s->o.type].layout].x;
+			curPosition.y = s->o.position.y + g_table_structure_layoutTileDiff[g_table_structureInfo[s->o.type].layout].y;
+			if (Tile_GetDistance(position, curPosition) > distance * 2) return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Gets the best target structure for the given unit, by looking at
+ *  every structure.
  *
  * @param unit The Unit to get the best target for.
  * @param mode How to determine the best target.
+ * @param position The origin of the Unit.
+ * @param distance The fire distance of the Unit.
  * @return The best target or NULL if none found.
  */
 static const Structure *
-Unit_FindBestTargetStructure(Unit *unit, uint16 mode)
+Unit_FindBestTargetStructure_Scan(Unit *unit, uint16 mode, tile32 position, uint16 distance)
 {
 	const Structure *best = NULL;
 	uint16 bestPriority = 0;
-	tile32 position;
-	uint16 distance;
 	PoolFindStruct find;
 
-	if (unit == NULL) return NULL;
-
-	position = Tools_Index_GetTile(unit->originEncoded);
-	distance = g_table_unitInfo[unit->o.type].fireDistance << 8;
-
 	for (const Structure *s = Structure_FindFirst(&find, HOUSE_INVALID, STRUCTURE_INVALID);
 			s != NULL;
 			s = Structure_FindNext(&find)) {
-		tile32 curPosition;
 		uint16 priority;
 
-		if (Structure_SharesPoolElement(s->o.type))
+		if (!Unit_IsCandidateTargetStructure(unit, s, mode, position, distance))
 			continue;
 
-		if (mode != 0 && mode != 4) {
-			if (mode == 1) {
-				if (!Unit_StructureInRange(unit, s, distance)) continue;
-			} else {
-				if (mode != 2) continue;
-
-				curPosition.x = s->o.position.x + g_table_structure_layoutTileDiff[g_table_structureInfo[s->o.type].layout].x;
-				curPosition.y = s->o.position.y + g_table_structure_layoutTileDiff[g_table_structureInfo[s->o.type].layout].y;
-				if (Tile_GetDistance(position, curPosition) > distance * 2) continue;
-			}
-		}
-
 		priority = Unit_GetTargetStructurePriority(unit, s);
 
 		if (priority >= bestPriority) {
@@ -2787,6 +2971,85 @@ Unit_FindBestTargetStructure(Unit *unit, uint16 mode)
 	return best;
 }
 
+/**
+ * Gets the best target structure for the given unit, using the
+ *  ObjectGrid.  Gives the same result as
+ *  Unit_FindBestTargetStructure_Scan for modes 1 and 2.
+ *
+ * @param unit The Unit to get the best target for.
+ * @param mode How to determine the best target.
+ * @param position The origin of the Unit.
+ * @param distance The fire distance of the Unit.
+ * @return The best target or NULL if none found.
+ */
+static const Structure *
+Unit_FindBestTargetStructure_InRange(Unit *unit, uint16 mode, tile32 position, uint16 distance)
+{
+	const Structure *best = NULL;
+	uint16 bestPriority = 0;
+	ObjectGridFindStruct find;
+
+	/* Structures are indexed by their top-left tile, which is up to
+	 * three tiles away from the tiles checked for the distance.
+	 */
+	const tile32 origin = (mode == 1) ? unit->o.position : position;
+	const uint16 range = min(((mode == 1) ? distance : distance * 2) + 0x300, 0xFFFF);
+
+	for (const Structure *s = ObjectGrid_FindFirstStructure(&find, origin, range);
+			s != NULL;
+			s = ObjectGrid_FindNextStructure(&find)) {
+		uint16 priority;
+
+		if (!Unit_IsCandidateTargetStructure(unit, s, mode, position, distance))
+			continue;
+
+		priority = Unit_GetTargetStructurePriority(unit, s);
+		if (priority == 0 || priority < bestPriority) continue;
+
+		/* The last of equal targets in the pool wins. */
+		if (priority == bestPriority && Structure_GetFindIndex(s) < Structure_GetFindIndex(best)) continue;
+
+		best = s;
+		bestPriority = priority;
+	}
+
+	return best;
+}
+
+/**
+ * Gets the best target structure for the given unit.
+ *
+ * @param unit The Unit to get the best target for.
+ * @param mode How to determine the best target.
+ * @return The best target or NULL if none found.
+ */
+static const Structure *
+Unit_FindBestTargetStructure(Unit *unit, uint16 mode)
+{
+	tile32 position;
+	uint16 distance;
+
+	if (unit == NULL) return NULL;
+
+	position = Tools_Index_GetTile(unit->originEncoded);
+	distance = g_table_unitInfo[unit->o.type].fireDistance << 8;
+
+	if (mode != 1 && mode != 2)
+		return Unit_FindBestTargetStructure_Scan(unit, mode, position, distance);
+
+	const Structure *best = Unit_FindBestTargetStructure_InRange(unit, mode, position, distance);
+
+#ifdef OBJECTGRID_VERIFY
+	const Structure *expected = Unit_FindBestTargetStructure_Scan(unit, mode, position, distance);
+	if (best != expected) {
+		Warning("ObjectGrid: unit %d found target structure %d instead of %d\n", unit->o.index,
+				(best == NULL) ? -1 : best->o.index, (expected == NULL) ? -1 : expected->o.index);
+	}
+#endif
+
+	return best;
+}
+
 /**
  * Get the score of entering this tile from a direction.
  *
@@ -2826,11 +3089,10 @@ int16 Unit_GetTileEnterScore(Unit *unit, uint16 packed, uint16 orient8)
 	}
 
 	type = Map_GetLandscapeType(packed);
+	res = Map_GetMovementSpeed(packed, ui->movementType);
 
 	if (g_dune2_enhanced) {
-		res = g_table_landscapeInfo[type].movementSpeed[ui->movementType] * ui->movingSpeedFactor / 256;
-	} else {
-		res = g_table_landscapeInfo[type].movementSpeed[ui->movementType];
+		res = res * ui->movingSpeedFactor / 256;
 	}
 
 	if (unit->o.type == UNIT_SABOTEUR && type == LST_WALL) {
@@ -2907,6 +3169,7 @@ void Unit_RemovePlayer(Unit *unit)
 	if (!unit->o.flags.s.allocated) return;
 
 	unit->o.flags.s.allocated = false;
+	Server_MarkUnitDirty(unit);
 	UnitAI_DetachFromSquad(unit);
 	Unit_RemoveFromTeam(unit);
 
@@ -2964,6 +3227,8 @@ void Unit_UpdateMap(uint16 type, Unit *unit)
 		if (Object_GetByPackedTile(packed) == NULL) {
 			t->index = unit->o.index + 1;
 			t->hasUnit = true;
+			Server_MarkTileDirty(packed);
+			Minimap_InvalidateTile(packed);
 		}
 	}
 
@@ -2993,6 +3258,8 @@ void Unit_RemoveFromTile(Unit *unit, uint16 packed)
 	if (t->hasUnit && Unit_Get_ByPackedTile(packed) == unit && (packed != Tile_PackTile(unit->currentDestination) || unit->o.flags.s.bulletIsBig)) {
 		t->index = 0;
 		t->hasUnit = false;
+		Server_MarkTileDirty(packed);
+		Minimap_InvalidateTile(packed);
 	}
 }
 
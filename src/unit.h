@@ -166,6 +166,7 @@ extern void Unit_Remove(Unit *u);
 extern bool Unit_StartMovement(Unit *unit);
 extern void Unit_SetTarget(Unit* unit, uint16 encoded);
 extern bool Unit_Deviation_Decrease(Unit* unit, uint16 amount);
+extern uint16 Unit_GetFogRadius(const Unit *unit);
 extern void Unit_RefreshFog(enum TileUnveilCause cause, const Unit *u, bool unveil);
 extern void Unit_RemoveFog(enum TileUnveilCause cause, const Unit *u);
 extern bool Unit_Deviate(Unit *unit, uint16 probability, uint8 houseID);
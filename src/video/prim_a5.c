@@ -6,13 +6,18 @@
 
 #include "prim.h"
 
+#include "spritebatch_a5.h"
+
 extern ALLEGRO_COLOR paltoRGB[256];
 
+/* Primitives are drawn immediately, after any sprites queued before them. */
+
 /*--------------------------------------------------------------*/
 
 void
 Prim_Line(float x1, float y1, float x2, float y2, uint8 c, float thickness)
 {
+	SpriteBatch_Flush();
 	al_draw_line(x1, y1, x2, y2, paltoRGB[c], thickness);
 }
 
@@ -20,6 +25,7 @@ void
 Prim_Hline(int x1, int y, int x2, uint8 c)
 {
 	assert(x1 <= x2);
+	SpriteBatch_Flush();
 	al_draw_line(x1, y + 0.5f, x2 + 0.99f, y + 0.5f, paltoRGB[c], 1.0f);
 }
 
@@ -27,6 +33,7 @@ void
 Prim_Vline(int x, int y1, int y2, uint8 c)
 {
 	assert(y1 <= y2);
+	SpriteBatch_Flush();
 	al_draw_line(x + 0.5f, y1, x + 0.5f, y2 + 0.99f, paltoRGB[c], 1.0f);
 }
 
@@ -35,18 +42,21 @@ Prim_Vline(int x, int y1, int y2, uint8 c)
 void
 Prim_Circle(float cx, float cy, float rd, uint8 c, float thickness)
 {
+	SpriteBatch_Flush();
 	al_draw_circle(cx, cy, rd, paltoRGB[c], thickness);
 }
 
 void
 Prim_Circle_i(int cx, int cy, int rd, uint8 c)
 {
+	SpriteBatch_Flush();
 	al_draw_circle(cx + 0.5f, cy + 0.5f, rd + 0.5f, paltoRGB[c], 1.0f);
 }
 
 void
 Prim_Circle_RGBA(float cx, float cy, float rd, unsigned char r, unsigned char g, unsigned char b, unsigned char alpha, float thickness)
 {
+	SpriteBatch_Flush();
 	al_draw_circle(cx, cy, rd, al_map_rgba(r, g, b, alpha), thickness);
 }
 
@@ -55,18 +65,21 @@ Prim_Circle_RGBA(float cx, float cy, float rd, unsigned char r, unsigned char g,
 void
 Prim_FillCircle(float cx, float cy, float rd, uint8 c)
 {
+	SpriteBatch_Flush();
 	al_draw_filled_circle(cx, cy, rd, paltoRGB[c]);
 }
 
 void
 Prim_FillCircle_i(int cx, int cy, int rd, uint8 c)
 {
+	SpriteBatch_Flush();
 	al_draw_filled_circle(cx + 0.5f, cy + 0.5f, rd + 0.5f, paltoRGB[c]);
 }
 
 void
 Prim_FillCircle_RGBA(float cx, float cy, float rd, unsigned char r, unsigned char g, unsigned char b, unsigned char alpha)
 {
+	SpriteBatch_Flush();
 	al_draw_filled_circle(cx, cy, rd, al_map_rgba(r, g, b, alpha));
 }
 
@@ -75,6 +88,7 @@ Prim_FillCircle_RGBA(float cx, float cy, float rd, unsigned char r, unsigned cha
 void
 Prim_Rect(float x1, float y1, float x2, float y2, uint8 c, float thickness)
 {
+	SpriteBatch_Flush();
 	al_draw_rectangle(x1, y1, x2, y2, paltoRGB[c], thickness);
 }
 
@@ -84,12 +98,14 @@ Prim_Rect_i(int x1, int y1, int x2, int y2, uint8 c)
 	assert(x1 <= x2);
 	assert(y1 <= y2);
 
+	SpriteBatch_Flush();
 	al_draw_rectangle(x1 + 0.5f, y1 + 0.5f, x2 + 0.5f, y2 + 0.5f, paltoRGB[c], 1.0f);
 }
 
 void
 Prim_Rect_RGBA(float x1, float y1, float x2, float y2, unsigned char r, unsigned char g, unsigned char b, unsigned char alpha, float thickness)
 {
+	SpriteBatch_Flush();
 	al_draw_rectangle(x1, y1, x2, y2, al_map_rgba(r, g, b, alpha), thickness);
 }
 
@@ -98,6 +114,7 @@ Prim_Rect_RGBA(float x1, float y1, float x2, float y2, unsigned char r, unsigned
 void
 Prim_FillRect(float x1, float y1, float x2, float y2, uint8 c)
 {
+	SpriteBatch_Flush();
 	al_draw_filled_rectangle(x1, y1, x2, y2, paltoRGB[c]);
 }
 
@@ -107,6 +124,7 @@ Prim_FillRect_i(int x1, int y1, int x2, int y2, uint8 c)
 	assert(x1 <= x2);
 	assert(y1 <= y2);
 
+	SpriteBatch_Flush();
 	al_draw_filled_rectangle(x1 + 0.01f, y1 + 0.01f, x2 + 0.99f, y2 + 0.99f, paltoRGB[c]);
 }
 
@@ -117,6 +135,7 @@ Prim_FillRect_RGBA(float x1, float y1, float x2, float y2,
 	assert(x1 <= x2);
 	assert(y1 <= y2);
 
+	SpriteBatch_Flush();
 	al_draw_filled_rectangle(x1, y1, x2, y2, al_map_rgba(r, g, b, alpha));
 }
 
@@ -126,6 +145,7 @@ Prim_FillRect_RGBA(float x1, float y1, float x2, float y2,
 void
 Prim_FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3, uint8 c)
 {
+	SpriteBatch_Flush();
 	al_draw_filled_triangle(x1, y1, x2, y2, x3, y3, paltoRGB[c]);
 }
 #endif
@@ -260,5 +280,6 @@ Prim_DrawBorder(float x, float y, float w, float h, int thickness, bool outline,
 		vtx[33].x = x + 2.0f,   vtx[33].y = y + h - 1.0f;
 	}
 
+	SpriteBatch_Flush();
 	al_draw_indexed_prim(vtx, NULL, NULL, &idx[start], end - start, ALLEGRO_PRIM_TRIANGLE_LIST);
 }
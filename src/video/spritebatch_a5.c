@@ -0,0 +1,369 @@
+/** @file src/video/spritebatch_a5.c
+ *
+ * Sprite batching.
+ *
+ * Between SpriteBatch_Begin and SpriteBatch_End, sprites are queued
+ * rather than drawn, with their corners already transformed to the
+ * target bitmap.  When the batch is flushed, each sprite is drawn
+ * together with the later sprites that share its atlas and blender,
+ * as long as they do not overlap anything drawn in between, so the
+ * picture is the same as drawing them in order.  Each group is one
+ * al_draw_prim call.
+ *
+ * Anything else that draws to the target must flush the batch first.
+ * Changing the target bitmap flushes the batch automatically.
+ *
+ * Outside a batch, sprites are drawn immediately.  Either way, the
+ * draw calls, texture switches and blender changes are counted for
+ * the FPS display.
+ */
+
+#include <assert.h>
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+#include <string.h>
+#include "../os/math.h"
+
+#include "spritebatch_a5.h"
+
+enum {
+	SPRITEBATCH_MAX         = 1024,
+	SPRITEBATCH_LOOKAHEAD   = 256,  /* Sprites to search for more of a group. */
+	SPRITEBATCH_BLOCKERS    = 32    /* Sprites skipped before giving up. */
+};
+
+typedef struct SpriteBatchCommand {
+	ALLEGRO_BITMAP *texture;
+	enum SpriteBlend blend;
+	float x1, y1, x2, y2;                               /*!< Bounds on the target. */
+	ALLEGRO_VERTEX v[4];                                /*!< Corners, clockwise. */
+} SpriteBatchCommand;
+
+static SpriteBatchCommand s_command[SPRITEBATCH_MAX];
+static bool s_emitted[SPRITEBATCH_MAX];
+static ALLEGRO_VERTEX s_vertex[6 * SPRITEBATCH_MAX];
+static int s_count;
+static int s_depth;
+static ALLEGRO_BITMAP *s_target;
+
+static SpriteBatchStats s_stats;
+static ALLEGRO_BITMAP *s_lastTexture;
+static enum SpriteBlend s_blend = SPRITEBLEND_ALPHA;
+
+static void
+SpriteBatch_SetBlender(enum SpriteBlend blend)
+{
+	if (s_blend == blend)
+		return;
+
+	if (blend == SPRITEBLEND_ADD) {
+		al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_ONE);
+	} else {
+		al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_INVERSE_ALPHA);
+	}
+
+	s_blend = blend;
+	s_stats.blenderChanges++;
+}
+
+static void
+SpriteBatch_CountDraw(ALLEGRO_BITMAP *texture)
+{
+	if (s_lastTexture != texture) {
+		s_lastTexture = texture;
+		s_stats.textureSwitches++;
+	}
+
+	s_stats.drawCalls++;
+}
+
+static ALLEGRO_BITMAP *
+SpriteBatch_GetTexture(ALLEGRO_BITMAP *bmp, float *ox, float *oy)
+{
+	ALLEGRO_BITMAP *parent = al_get_parent_bitmap(bmp);
+
+	if (parent == NULL) {
+		*ox = 0.0f;
+		*oy = 0.0f;
+		return bmp;
+	}
+
+	*ox = al_get_bitmap_x(bmp);
+	*oy = al_get_bitmap_y(bmp);
+	return parent;
+}
+
+static bool
+SpriteBatch_Overlaps(const SpriteBatchCommand *a, const SpriteBatchCommand *b)
+{
+	return (a->x1 < b->x2 && b->x1 < a->x2 && a->y1 < b->y2 && b->y1 < a->y2);
+}
+
+/**
+ * Collect the sprites that can be drawn with sprite i, ending with the
+ * first that would have to move past a sprite it overlaps, and put
+ * their triangles in s_vertex.
+ *
+ * @return The number of vertices.
+ */
+static int
+SpriteBatch_BuildGroup(int i)
+{
+	const SpriteBatchCommand *first = &s_command[i];
+	const int end = min(s_count, i + SPRITEBATCH_LOOKAHEAD);
+	int blocker[SPRITEBATCH_BLOCKERS];
+	int num_blockers = 0;
+	int n = 0;
+
+	for (int j = i; j < end; j++) {
+		const SpriteBatchCommand *c = &s_command[j];
+
+		if (s_emitted[j])
+			continue;
+
+		bool blocked = (c->texture != first->texture || c->blend != first->blend);
+
+		for (int k = 0; !blocked && k < num_blockers; k++)
+			blocked = SpriteBatch_Overlaps(c, &s_command[blocker[k]]);
+
+		if (blocked) {
+			if (num_blockers >= SPRITEBATCH_BLOCKERS)
+				break;
+
+			blocker[num_blockers++] = j;
+			continue;
+		}
+
+		s_vertex[n++] = c->v[0];
+		s_vertex[n++] = c->v[1];
+		s_vertex[n++] = c->v[2];
+		s_vertex[n++] = c->v[0];
+		s_vertex[n++] = c->v[2];
+		s_vertex[n++] = c->v[3];
+		s_emitted[j] = true;
+	}
+
+	return n;
+}
+
+/**
+ * Draw the queued sprites to the bitmap they were queued for.
+ */
+void
+SpriteBatch_Flush(void)
+{
+	if (s_count == 0)
+		return;
+
+	ALLEGRO_BITMAP *old_target = al_get_target_bitmap();
+	ALLEGRO_TRANSFORM old_trans, identity;
+
+	if (old_target != s_target)
+		al_set_target_bitmap(s_target);
+
+	/* The corners are already transformed. */
+	al_copy_transform(&old_trans, al_get_current_transform());
+	al_identity_transform(&identity);
+	al_use_transform(&identity);
+
+	memset(s_emitted, 0, s_count * sizeof(s_emitted[0]));
+
+	for (int i = 0; i < s_count; i++) {
+		if (s_emitted[i])
+			continue;
+
+		ALLEGRO_BITMAP *texture = s_command[i].texture;
+		const enum SpriteBlend blend = s_command[i].blend;
+		const int n = SpriteBatch_BuildGroup(i);
+
+		SpriteBatch_SetBlender(blend);
+		SpriteBatch_CountDraw(texture);
+		al_draw_prim(s_vertex, NULL, texture, 0, n, ALLEGRO_PRIM_TRIANGLE_LIST);
+	}
+
+	SpriteBatch_SetBlender(SPRITEBLEND_ALPHA);
+	al_use_transform(&old_trans);
+
+	if (old_target != s_target)
+		al_set_target_bitmap(old_target);
+
+	s_count = 0;
+}
+
+void
+SpriteBatch_Begin(void)
+{
+	s_depth++;
+}
+
+void
+SpriteBatch_End(void)
+{
+	assert(s_depth > 0);
+
+	if (--s_depth == 0)
+		SpriteBatch_Flush();
+}
+
+/**
+ * Draw the queued sprites and draw immediately until resumed, e.g.
+ * while a stencil is in use.
+ *
+ * @return The depth to pass to SpriteBatch_Resume.
+ */
+int
+SpriteBatch_Suspend(void)
+{
+	const int depth = s_depth;
+
+	SpriteBatch_Flush();
+	s_depth = 0;
+	return depth;
+}
+
+void
+SpriteBatch_Resume(int depth)
+{
+	assert(s_depth == 0);
+
+	SpriteBatch_Flush();
+	s_depth = depth;
+}
+
+/**
+ * Queue the sw by sh region of bmp at (sx, sy), with (0, 0) to
+ * (sw, sh) mapped to the target by trans.
+ */
+static void
+SpriteBatch_Queue(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float sx, float sy, float sw, float sh,
+		const ALLEGRO_TRANSFORM *trans, int flags, enum SpriteBlend blend)
+{
+	const float corner[4][2] = { { 0.0f, 0.0f }, { sw, 0.0f }, { sw, sh }, { 0.0f, sh } };
+
+	if (al_get_target_bitmap() != s_target) {
+		SpriteBatch_Flush();
+		s_target = al_get_target_bitmap();
+	}
+
+	if (s_count >= SPRITEBATCH_MAX)
+		SpriteBatch_Flush();
+
+	SpriteBatchCommand *c = &s_command[s_count++];
+	float ox, oy;
+
+	c->texture = SpriteBatch_GetTexture(bmp, &ox, &oy);
+	c->blend = blend;
+
+	float u[2] = { ox + sx, ox + sx + sw };
+	float v[2] = { oy + sy, oy + sy + sh };
+
+	if (flags & ALLEGRO_FLIP_HORIZONTAL) {
+		u[0] = ox + sx + sw;
+		u[1] = ox + sx;
+	}
+
+	if (flags & ALLEGRO_FLIP_VERTICAL) {
+		v[0] = oy + sy + sh;
+		v[1] = oy + sy;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		ALLEGRO_VERTEX *vtx = &c->v[i];
+		float x = corner[i][0];
+		float y = corner[i][1];
+
+		al_transform_coordinates(trans, &x, &y);
+
+		vtx->x = x;
+		vtx->y = y;
+		vtx->z = 0.0f;
+		vtx->u = u[(i == 1 || i == 2) ? 1 : 0];
+		vtx->v = v[(i >= 2) ? 1 : 0];
+		vtx->color = tint;
+
+		if (i == 0) {
+			c->x1 = c->x2 = x;
+			c->y1 = c->y2 = y;
+		} else {
+			c->x1 = min(c->x1, x);
+			c->y1 = min(c->y1, y);
+			c->x2 = max(c->x2, x);
+			c->y2 = max(c->y2, y);
+		}
+	}
+
+	s_stats.sprites++;
+}
+
+/**
+ * Draw the sw by sh region of bmp at (sx, sy), scaled to dw by dh at
+ * (dx, dy), like al_draw_tinted_scaled_bitmap.
+ */
+void
+SpriteBatch_Draw(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float sx, float sy, float sw, float sh,
+		float dx, float dy, float dw, float dh, int flags, enum SpriteBlend blend)
+{
+	if (sw <= 0.0f || sh <= 0.0f)
+		return;
+
+	if (s_depth == 0) {
+		float ox, oy;
+
+		SpriteBatch_SetBlender(blend);
+		SpriteBatch_CountDraw(SpriteBatch_GetTexture(bmp, &ox, &oy));
+		al_draw_tinted_scaled_bitmap(bmp, tint, sx, sy, sw, sh, dx, dy, dw, dh, flags);
+		SpriteBatch_SetBlender(SPRITEBLEND_ALPHA);
+		s_stats.sprites++;
+		return;
+	}
+
+	ALLEGRO_TRANSFORM trans;
+
+	al_build_transform(&trans, dx, dy, dw / sw, dh / sh, 0.0f);
+	al_compose_transform(&trans, al_get_current_transform());
+	SpriteBatch_Queue(bmp, tint, sx, sy, sw, sh, &trans, flags, blend);
+}
+
+/**
+ * Draw bmp rotated about (cx, cy), which is placed at (dx, dy), like
+ * al_draw_tinted_rotated_bitmap.
+ */
+void
+SpriteBatch_DrawRotated(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float cx, float cy, float dx, float dy, float angle, int flags)
+{
+	if (s_depth == 0) {
+		float ox, oy;
+
+		SpriteBatch_CountDraw(SpriteBatch_GetTexture(bmp, &ox, &oy));
+		al_draw_tinted_rotated_bitmap(bmp, tint, cx, cy, dx, dy, angle, flags);
+		s_stats.sprites++;
+		return;
+	}
+
+	ALLEGRO_TRANSFORM trans;
+
+	al_identity_transform(&trans);
+	al_translate_transform(&trans, -cx, -cy);
+	al_rotate_transform(&trans, angle);
+	al_translate_transform(&trans, dx, dy);
+	al_compose_transform(&trans, al_get_current_transform());
+	SpriteBatch_Queue(bmp, tint, 0.0f, 0.0f, al_get_bitmap_width(bmp), al_get_bitmap_height(bmp),
+			&trans, flags, SPRITEBLEND_ALPHA);
+}
+
+/**
+ * Get the counts since the last call, and start counting again.
+ */
+void
+SpriteBatch_EndFrame(SpriteBatchStats *stats)
+{
+	assert(s_depth == 0);
+
+	SpriteBatch_Flush();
+	*stats = s_stats;
+	memset(&s_stats, 0, sizeof(s_stats));
+	s_lastTexture = NULL;
+}
@@ -0,0 +1,35 @@
+/** @file src/video/spritebatch_a5.h Sprite batching. */
+
+#ifndef VIDEO_SPRITEBATCH_A5_H
+#define VIDEO_SPRITEBATCH_A5_H
+
+#include <allegro5/allegro.h>
+#include "types.h"
+
+enum SpriteBlend {
+	SPRITEBLEND_ALPHA,      /* ALLEGRO_ALPHA, ALLEGRO_INVERSE_ALPHA. */
+	SPRITEBLEND_ADD,        /* ALLEGRO_ALPHA, ALLEGRO_ONE, for highlights. */
+
+	SPRITEBLEND_MAX
+};
+
+typedef struct SpriteBatchStats {
+	int sprites;
+	int drawCalls;
+	int textureSwitches;
+	int blenderChanges;
+} SpriteBatchStats;
+
+extern void SpriteBatch_Begin(void);
+extern void SpriteBatch_End(void);
+extern int SpriteBatch_Suspend(void);
+extern void SpriteBatch_Resume(int depth);
+extern void SpriteBatch_Flush(void);
+extern void SpriteBatch_Draw(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float sx, float sy, float sw, float sh,
+		float dx, float dy, float dw, float dh, int flags, enum SpriteBlend blend);
+extern void SpriteBatch_DrawRotated(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float cx, float cy, float dx, float dy, float angle, int flags);
+extern void SpriteBatch_EndFrame(SpriteBatchStats *stats);
+
+#endif
@@ -58,6 +58,10 @@ extern struct FadeInAux *Video_InitFadeInCPS(const char *filename, int x, int y,
 extern struct FadeInAux *Video_InitFadeInShape(enum ShapeID shapeID, enum HouseType houseID, int x, int y);
 
 extern void Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode);
+extern bool Video_PrepareTerrainChunks(void);
+extern void Video_BeginTerrainChunk(int chunk);
+extern void Video_EndTerrainChunk(void);
+extern void Video_DrawTerrainChunk(int chunk, int sx, int sy, int w, int h, int x, int y);
 
 #include "video_a5.h"
 
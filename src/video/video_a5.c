@@ -40,6 +40,7 @@
 
 #include "video_a5.h"
 
+#include "spritebatch_a5.h"
 #include "../common_a5.h"
 #include "../config.h"
 #include "../enhancement.h"
@@ -50,14 +51,20 @@
 #include "../input/input_a5.h"
 #include "../input/mouse.h"
 #include "../map.h"
+#include "../minimap.h"
 #include "../newui/viewport.h"
 #include "../opendune.h"
+#include "../pool/pool.h"
+#include "../pool/pool_unit.h"
+#include "../profiler.h"
 #include "../scenario.h"
 #include "../sprites.h"
+#include "../string.h"
 #include "../structure.h"
 #include "../table/widgetinfo.h"
 #include "../timer/timer.h"
 #include "../tools/coord.h"
+#include "../tools/hash.h"
 #include "../tools/random_xorshift.h"
 #include "../wsa.h"
 
@@ -178,10 +185,17 @@ static ALLEGRO_MOUSE_CURSOR *s_cursor[CURSOR_MAX];
 static ALLEGRO_BITMAP *s_minimap;
 static int s_minimap_colour[MAP_SIZE_MAX * MAP_SIZE_MAX];
 
+static ALLEGRO_BITMAP *s_terrain_chunk[MAP_CHUNK_MAX];
+static int s_terrain_chunk_scale;   /* Texels per pixel of a 16x16 tile. */
+static ALLEGRO_BITMAP *s_terrain_old_target;
+
 static bool take_screenshot = false;
-static bool show_fps = false;
+static bool dump_profile = false;
+static int show_fps = 0;            /* 1 for the FPS, 2 with the profiler. */
 static FadeInAux s_fadeInAux;
 
+static const ALLEGRO_COLOR s_white = { 1.0f, 1.0f, 1.0f, 1.0f };
+
 /* VideoA5_GetNextXY:
  *
  * Returns (x, y) if the sprite will fit into the texture at (x, y).
@@ -432,6 +446,15 @@ VideoA5_Init(void)
 #undef APPEND_FLAG
 }
 
+static void
+VideoA5_UninitTerrainChunks(void)
+{
+	for (int chunk = 0; chunk < MAP_CHUNK_MAX; chunk++) {
+		al_destroy_bitmap(s_terrain_chunk[chunk]);
+		s_terrain_chunk[chunk] = NULL;
+	}
+}
+
 static void
 VideoA5_UninitCPSStore(void)
 {
@@ -481,6 +504,8 @@ VideoA5_Uninit(void)
 	al_destroy_bitmap(s_minimap);
 	s_minimap = NULL;
 
+	VideoA5_UninitTerrainChunks();
+
 	al_destroy_bitmap(interface_texture);
 	interface_texture = NULL;
 
@@ -528,10 +553,13 @@ VideoA5_ToggleFullscreen(void)
 	Timer_IsStarted(TIMER_GAME) ? Video_GrabCursor() : Video_UngrabCursor();
 }
 
+/**
+ * Show the FPS, then the profiler as well, then neither.
+ */
 void
 VideoA5_ToggleFPS(void)
 {
-	show_fps = !show_fps;
+	show_fps = (show_fps + 1) % 3;
 }
 
 void
@@ -540,6 +568,16 @@ VideoA5_CaptureScreenshot(void)
 	take_screenshot = true;
 }
 
+/**
+ * Write the profiler's trace to the personal data directory at the end
+ * of the frame.
+ */
+void
+VideoA5_DumpProfile(void)
+{
+	dump_profile = true;
+}
+
 static void
 VideoA5_CopyBitmap(int src_stride, const unsigned char *raw, ALLEGRO_BITMAP *dest, enum BitmapCopyMode mode)
 {
@@ -621,12 +659,86 @@ VideoA5_CreateWhiteMaskIndexed(unsigned char *buf,
 	}
 }
 
+static void
+VideoA5_DrawDebugText(int x, int y, ALLEGRO_COLOR colour, const char *str)
+{
+	/* Don't clobber the current font state. */
+	for (int i = 0; str[i] != '\0'; i++) {
+		const unsigned char c = str[i];
+
+		if (s_font[2][c] != NULL)
+			al_draw_tinted_bitmap(s_font[2][c], colour, x + 6 * i, y, 0);
+	}
+}
+
+/**
+ * Draw the time in each profiled scope as a graph stacked up to the
+ * frame time, newest frame on the right, with the median and 99th
+ * percentile of each below it.
+ */
+static void
+VideoA5_DrawProfiler(int x, int y)
+{
+	static const unsigned char colour[PROFILER_SCOPE_MAX][3] = {
+		{ 0x80, 0x80, 0x80 }, { 0xE0, 0x40, 0x40 }, { 0xE0, 0xA0, 0x40 },
+		{ 0xE0, 0xE0, 0x40 }, { 0x40, 0xA0, 0xE0 }, { 0x40, 0xE0, 0xE0 },
+		{ 0xA0, 0x40, 0xE0 }, { 0xE0, 0x40, 0xE0 }, { 0x40, 0xE0, 0x40 },
+	};
+	static ALLEGRO_VERTEX l_vertex[2 * PROFILER_FRAME_MAX * PROFILER_SCOPE_MAX];
+	const float px_per_ms = 2.0f;
+	const int h = 100;
+	const int frames = Profiler_GetFrameCount();
+	int n = 0;
+
+	al_draw_filled_rectangle(x, y, x + PROFILER_FRAME_MAX, y + h, al_map_rgba(0, 0, 0, 0xC0));
+
+	for (int f = 0; f < frames; f++) {
+		const float fx = x + PROFILER_FRAME_MAX - f - 0.5f;
+		float fy = y + h;
+
+		for (enum ProfilerScope scope = 0; scope < PROFILER_SCOPE_MAX; scope++) {
+			const float top = max(y, fy - px_per_ms * Profiler_GetSelfTime(f, scope));
+			const ALLEGRO_COLOR c = al_map_rgb(colour[scope][0], colour[scope][1], colour[scope][2]);
+
+			if (top >= fy)
+				continue;
+
+			l_vertex[n++] = (ALLEGRO_VERTEX){ .x = fx, .y = fy, .color = c };
+			l_vertex[n++] = (ALLEGRO_VERTEX){ .x = fx, .y = top, .color = c };
+			fy = top;
+		}
+	}
+
+	if (n > 0)
+		al_draw_prim(l_vertex, NULL, NULL, 0, n, ALLEGRO_PRIM_LINE_LIST);
+
+	/* 60 frames per second. */
+	al_draw_line(x, y + h - px_per_ms * 1000.0f / 60.0f, x + PROFILER_FRAME_MAX, y + h - px_per_ms * 1000.0f / 60.0f,
+			al_map_rgb(0xFF, 0xFF, 0xFF), 1.0f);
+
+	VideoA5_DrawDebugText(x, y + h + 4, paltoRGB[15], "SCOPE                        P50    P99 MS");
+
+	for (enum ProfilerScope scope = 0; scope < PROFILER_SCOPE_MAX; scope++) {
+		char str[64];
+		float p50, p99;
+
+		Profiler_GetPercentiles(scope, &p50, &p99);
+		snprintf(str, sizeof(str), "%-26s %6.2f %6.2f", Profiler_GetName(scope), p50, p99);
+		VideoA5_DrawDebugText(x, y + h + 14 + 10 * scope,
+				al_map_rgb(colour[scope][0], colour[scope][1], colour[scope][2]), str);
+	}
+}
+
 void
 VideoA5_Tick(void)
 {
 	static double l_last_time;
 	static double l_last_fps;
 	static int l_fps;
+	SpriteBatchStats stats;
+	WSAStats wsa;
+
+	SpriteBatch_EndFrame(&stats);
 
 	if (take_screenshot) {
 		struct tm *tm;
@@ -649,16 +761,50 @@ VideoA5_Tick(void)
 		fprintf(stdout, "screenshot: %s\n", filepath);
 	}
 
+	if (dump_profile) {
+		struct tm *tm;
+		time_t timep;
+		char filename[PATH_MAX];
+		char filepath[PATH_MAX];
+
+		dump_profile = false;
+
+		timep = time(NULL);
+		tm = localtime(&timep);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+		strftime(filename, sizeof(filename), "profile_%Y%m%d_%H%M%S.json", tm);
+		snprintf(filepath, sizeof(filepath), "%s/%s", g_personal_data_dir, filename);
+#pragma GCC diagnostic pop
+
+		if (Profiler_DumpTrace(filepath)) {
+			fprintf(stdout, "profile: %s\n", filepath);
+		} else {
+			fprintf(stderr, "Could not write %s\n", filepath);
+		}
+	}
+
 	if (show_fps) {
 		const double curr_time = al_get_time();
-		char str[16];
+		char str[64];
 
-		/* Don't clobber the current font state. */
-		int len = snprintf(str, sizeof(str), "FPS:%4.2f", l_last_fps);
-		for (int i = 0; i < len; i++) {
-			const unsigned char c = str[i];
-			al_draw_tinted_bitmap(s_font[2][c], paltoRGB[15], 2 + 6 * i, 40, 0);
-		}
+		snprintf(str, sizeof(str), "FPS:%4.2f", l_last_fps);
+		VideoA5_DrawDebugText(2, 40, paltoRGB[15], str);
+
+		/* Counts for the frame just drawn, not including these. */
+		snprintf(str, sizeof(str), "SPR:%d DRAW:%d TEX:%d BLEND:%d",
+				stats.sprites, stats.drawCalls, stats.textureSwitches, stats.blenderChanges);
+		VideoA5_DrawDebugText(2, 50, paltoRGB[15], str);
+
+		WSA_GetStats(&wsa);
+		snprintf(str, sizeof(str), "WSA:%d PRE:%d AVG:%.2fMS MAX:%.2fMS",
+				wsa.framesDecoded, wsa.framesPrefetched,
+				(wsa.framesDecoded == 0) ? 0.0 : wsa.decodeTime / wsa.framesDecoded, wsa.decodeTimeMax);
+		VideoA5_DrawDebugText(2, 60, paltoRGB[15], str);
+
+		if (show_fps == 2)
+			VideoA5_DrawProfiler(2, 74);
 
 		l_fps++;
 		if (curr_time - l_last_time >= 0.5f) {
@@ -688,6 +834,34 @@ VideoA5_Tick(void)
 
 /*--------------------------------------------------------------*/
 
+/**
+ * Draw the w by h region of bmp at (sx, sy) to (dx, dy), through the
+ * sprite batch.
+ */
+static void
+VideoA5_DrawRegion(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float sx, float sy, float w, float h, float dx, float dy)
+{
+	SpriteBatch_Draw(bmp, tint, sx, sy, w, h, dx, dy, w, h, 0, SPRITEBLEND_ALPHA);
+}
+
+static void
+VideoA5_DrawSprite(ALLEGRO_BITMAP *bmp, ALLEGRO_COLOR tint,
+		float x, float y, int flags, enum SpriteBlend blend)
+{
+	const float w = al_get_bitmap_width(bmp);
+	const float h = al_get_bitmap_height(bmp);
+
+	SpriteBatch_Draw(bmp, tint, 0.0f, 0.0f, w, h, x, y, w, h, flags, blend);
+}
+
+static void
+VideoA5_DrawSpriteScaled(ALLEGRO_BITMAP *bmp, float x, float y, float w, float h, int flags)
+{
+	SpriteBatch_Draw(bmp, s_white, 0.0f, 0.0f, al_get_bitmap_width(bmp), al_get_bitmap_height(bmp),
+			x, y, w, h, flags, SPRITEBLEND_ALPHA);
+}
+
 void
 Video_SetPalette(const uint8 *palette, int from, int length)
 {
@@ -713,6 +887,7 @@ Video_SetPalette(const uint8 *palette, int from, int length)
 void
 Video_SetClippingArea(int x, int y, int w, int h)
 {
+	SpriteBatch_Flush();
 	al_set_clipping_rectangle(x, y, w, h);
 }
 
@@ -774,16 +949,25 @@ Video_ShadeScreen(int alpha)
 
 	alpha = clamp(0x00, alpha, 0xFF);
 
+	SpriteBatch_Flush();
 	A5_UseTransform(SCREENDIV_MAIN);
 	al_draw_filled_rectangle(0.0f, 0.0f, TRUE_DISPLAY_WIDTH, TRUE_DISPLAY_HEIGHT, al_map_rgba(0, 0, 0, alpha));
 
 	A5_UseTransform(prev_transform);
 }
 
+/**
+ * Queue sprites until released, so that they can be drawn in fewer
+ * batches.  May be nested.
+ */
 void
 Video_HoldBitmapDrawing(bool hold)
 {
-	al_hold_bitmap_drawing(hold);
+	if (hold) {
+		SpriteBatch_Begin();
+	} else {
+		SpriteBatch_End();
+	}
 }
 
 /*--------------------------------------------------------------*/
@@ -1093,6 +1277,8 @@ VideoA5_InitFadeInSprite(ALLEGRO_BITMAP *src, int x, int y, int w, int h, bool f
 void
 Video_DrawFadeIn(const FadeInAux *aux)
 {
+	SpriteBatch_Flush();
+
 	switch (g_graphics_driver) {
 		case GRAPHICS_DRIVER_OPENGL:
 			VideoA5_DrawDissolve_GLStencil(aux);
@@ -1338,6 +1524,8 @@ VideoA5_DrawCPS(enum SearchDirectory dir, const char *filename)
 {
 	CPSStore *cps = VideoA5_LoadCPS(dir, filename);
 
+	SpriteBatch_Flush();
+
 	if (cps != NULL)
 		al_draw_bitmap(cps->bmp, 0, 0, 0);
 }
@@ -1347,6 +1535,8 @@ VideoA5_DrawCPSCoordinates(enum SearchDirectory dir, const char *filename, int d
 {
 	CPSStore *cps = VideoA5_LoadCPS(dir, filename);
 
+	SpriteBatch_Flush();
+
 	if (cps != NULL)
 		al_draw_bitmap(cps->bmp, dx, dy, 0);
 }
@@ -1356,6 +1546,8 @@ VideoA5_DrawCPSRegion(enum SearchDirectory dir, const char *filename, int sx, in
 {
 	CPSStore *cps = VideoA5_LoadCPS(dir, filename);
 
+	SpriteBatch_Flush();
+
 	if (cps != NULL)
 		al_draw_bitmap_region(cps->bmp, sx, sy, w, h, dx, dy, 0);
 }
@@ -1377,8 +1569,8 @@ VideoA5_DrawCPSSpecial(enum CPSID cpsID, enum HouseType houseID, int x, int y)
 	if (CPS_CONQUEST_EN <= cpsID && cpsID <= CPS_CONQUEST_DE) {
 		const ALLEGRO_COLOR col = al_map_rgb(tint[houseID][0], tint[houseID][1], tint[houseID][2]);
 
-		al_draw_bitmap_region(interface_texture, sx, sy, coord->w, coord->h, x, y, 0);
-		al_draw_tinted_bitmap_region(interface_texture, col, sx, sy + 30, coord->w, 20, x, y, 0);
+		VideoA5_DrawRegion(interface_texture, s_white, sx, sy, coord->w, coord->h, x, y);
+		VideoA5_DrawRegion(interface_texture, col, sx, sy + 30, coord->w, 20, x, y);
 		return;
 	}
 
@@ -1392,7 +1584,7 @@ VideoA5_DrawCPSSpecial(enum CPSID cpsID, enum HouseType houseID, int x, int y)
 		}
 	}
 
-	al_draw_bitmap_region(interface_texture, sx, sy, coord->w, coord->h, x, y, 0);
+	VideoA5_DrawRegion(interface_texture, s_white, sx, sy, coord->w, coord->h, x, y);
 }
 
 void
@@ -1412,8 +1604,8 @@ VideoA5_DrawCPSSpecialScale(enum CPSID cpsID, enum HouseType houseID, int x, int
 		sy += 4 * houseID;
 	}
 
-	al_draw_scaled_bitmap(interface_texture, sx, sy, coord->w, coord->h,
-			x, y, scale * coord->w, scale * coord->h, 0);
+	SpriteBatch_Draw(interface_texture, s_white, sx, sy, coord->w, coord->h,
+			x, y, scale * coord->w, scale * coord->h, 0, SPRITEBLEND_ALPHA);
 }
 
 FadeInAux *
@@ -1941,26 +2133,26 @@ VideoA5_DrawIcon(uint16 iconID, enum HouseType houseID, int x, int y)
 	const float scalex = g_screenDiv[SCREENDIV_VIEWPORT].scalex;
 	if (2.99f <= scalex
 			&& icon_texture48 != NULL && coord->sx48 != 0 && coord->sy48 != 0) {
-		al_draw_scaled_bitmap(icon_texture48, coord->sx48, coord->sy48, 48, 48, x, y, TILE_SIZE, TILE_SIZE, 0);
+		SpriteBatch_Draw(icon_texture48, s_white, coord->sx48, coord->sy48, 48, 48, x, y, TILE_SIZE, TILE_SIZE, 0, SPRITEBLEND_ALPHA);
 
 		if (overlay) {
-			al_draw_tinted_scaled_bitmap(icon_texture48, paltoRGB[WINDTRAP_COLOUR],
-					overlay->sx48, overlay->sy48, 48, 48, x, y, TILE_SIZE, TILE_SIZE, 0);
+			SpriteBatch_Draw(icon_texture48, paltoRGB[WINDTRAP_COLOUR],
+					overlay->sx48, overlay->sy48, 48, 48, x, y, TILE_SIZE, TILE_SIZE, 0, SPRITEBLEND_ALPHA);
 		}
 	} else if (1.99f <= scalex && scalex <= 2.01f
 			&& icon_texture32 != NULL && coord->sx32 != 0 && coord->sy32 != 0) {
-		al_draw_scaled_bitmap(icon_texture32, coord->sx32, coord->sy32, 32, 32, x, y, TILE_SIZE, TILE_SIZE, 0);
+		SpriteBatch_Draw(icon_texture32, s_white, coord->sx32, coord->sy32, 32, 32, x, y, TILE_SIZE, TILE_SIZE, 0, SPRITEBLEND_ALPHA);
 
 		if (overlay) {
-			al_draw_tinted_scaled_bitmap(icon_texture32, paltoRGB[WINDTRAP_COLOUR],
-					overlay->sx32, overlay->sy32, 32, 32, x, y, TILE_SIZE, TILE_SIZE, 0);
+			SpriteBatch_Draw(icon_texture32, paltoRGB[WINDTRAP_COLOUR],
+					overlay->sx32, overlay->sy32, 32, 32, x, y, TILE_SIZE, TILE_SIZE, 0, SPRITEBLEND_ALPHA);
 		}
 	} else {
-		al_draw_bitmap_region(icon_texture, coord->sx, coord->sy, TILE_SIZE, TILE_SIZE, x, y, 0);
+		VideoA5_DrawRegion(icon_texture, s_white, coord->sx, coord->sy, TILE_SIZE, TILE_SIZE, x, y);
 
 		if (overlay) {
-			al_draw_tinted_bitmap_region(icon_texture, paltoRGB[WINDTRAP_COLOUR],
-					overlay->sx, overlay->sy, TILE_SIZE, TILE_SIZE, x, y, 0);
+			VideoA5_DrawRegion(icon_texture, paltoRGB[WINDTRAP_COLOUR],
+					overlay->sx, overlay->sy, TILE_SIZE, TILE_SIZE, x, y);
 		}
 	}
 }
@@ -1975,8 +2167,8 @@ VideoA5_DrawIconAlpha(uint16 iconID, int x, int y, unsigned char alpha)
 
 	ALLEGRO_COLOR tint = al_map_rgba(0, 0, 0, alpha);
 
-	al_draw_tinted_bitmap_region(icon_texture, tint,
-			coord->sx, coord->sy, TILE_SIZE, TILE_SIZE, x, y, 0);
+	VideoA5_DrawRegion(icon_texture, tint,
+			coord->sx, coord->sy, TILE_SIZE, TILE_SIZE, x, y);
 }
 
 void
@@ -1999,8 +2191,8 @@ VideoA5_DrawRectCross(int x1, int y1, int w, int h, unsigned char c)
 	} else {
 		const int idx = ((h - 1) << 2) | w;
 
-		al_draw_tinted_bitmap_region(icon_texture, paltoRGB[c],
-				sx[idx], 975, w * TILE_SIZE, h * TILE_SIZE, x1, y1, 0);
+		VideoA5_DrawRegion(icon_texture, paltoRGB[c],
+				sx[idx], 975, w * TILE_SIZE, h * TILE_SIZE, x1, y1);
 	}
 }
 
@@ -2398,11 +2590,8 @@ VideoA5_DrawShape(enum ShapeID shapeID, enum HouseType houseID, int x, int y, in
 
 	if ((flags & 0x300) == 0x100) {
 		/* Highlight. */
-		al_draw_bitmap(s_shape[shapeID][houseID], x, y, al_flags);
-
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_ONE);
-		al_draw_bitmap(s_shape[shapeID][houseID], x, y, al_flags);
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_INVERSE_ALPHA);
+		VideoA5_DrawSprite(s_shape[shapeID][houseID], s_white, x, y, al_flags, SPRITEBLEND_ALPHA);
+		VideoA5_DrawSprite(s_shape[shapeID][houseID], s_white, x, y, al_flags, SPRITEBLEND_ADD);
 	} else if ((flags & 0x300) == 0x200) {
 		/* Blur tile (sandworm, sonic wave). */
 		const int s_variable_60[8] = {1, 3, 2, 5, 4, 3, 2, 1};
@@ -2410,6 +2599,9 @@ VideoA5_DrawShape(enum ShapeID shapeID, enum HouseType houseID, int x, int y, in
 
 		ALLEGRO_BITMAP *brush = s_shape[shapeID][houseID];
 
+		/* The stencil must see everything drawn before it. */
+		const int depth = SpriteBatch_Suspend();
+
 		switch (g_graphics_driver) {
 			case GRAPHICS_DRIVER_OPENGL:
 				VideoA5_DrawBlur_GLStencil(brush, x, y, s_variable_60[effect]);
@@ -2426,13 +2618,15 @@ VideoA5_DrawShape(enum ShapeID shapeID, enum HouseType houseID, int x, int y, in
 				/* VideoA5_DrawBlur_DestMinusSrc(brush, x, y, s_variable_60[effect]); */
 				break;
 		}
+
+		SpriteBatch_Resume(depth);
 	} else if ((flags & 0x300) == 0x300) {
 		/* Shadow. */
 		ALLEGRO_COLOR tint = al_map_rgba(0, 0, 0, flags & 0xF0);
-		al_draw_tinted_bitmap(s_shape[shapeID][houseID], tint, x, y, al_flags);
+		VideoA5_DrawSprite(s_shape[shapeID][houseID], tint, x, y, al_flags, SPRITEBLEND_ALPHA);
 	} else {
 		/* Normal. */
-		al_draw_bitmap(s_shape[shapeID][houseID], x, y, al_flags);
+		VideoA5_DrawSprite(s_shape[shapeID][houseID], s_white, x, y, al_flags, SPRITEBLEND_ALPHA);
 	}
 }
 
@@ -2453,9 +2647,9 @@ VideoA5_DrawShapeRotate(enum ShapeID shapeID, enum HouseType houseID, int x, int
 
 	if ((flags & 0x300) == 0x300) {
 		ALLEGRO_COLOR tint = al_map_rgba(0, 0, 0, flags & 0xF0);
-		al_draw_tinted_rotated_bitmap(bmp, tint, cx, cy, x, y, angle, al_flags);
+		SpriteBatch_DrawRotated(bmp, tint, cx, cy, x, y, angle, al_flags);
 	} else {
-		al_draw_rotated_bitmap(bmp, cx, cy, x, y, angle, al_flags);
+		SpriteBatch_DrawRotated(bmp, s_white, cx, cy, x, y, angle, al_flags);
 	}
 }
 
@@ -2467,7 +2661,7 @@ VideoA5_DrawShapeScale(enum ShapeID shapeID, int x, int y, int w, int h, int fla
 	ALLEGRO_BITMAP *bmp = s_shape[shapeID][HOUSE_HARKONNEN];
 	assert(bmp != NULL);
 
-	al_draw_scaled_bitmap(bmp, 0, 0, al_get_bitmap_width(bmp), al_get_bitmap_height(bmp), x, y, w, h, flags);
+	VideoA5_DrawSpriteScaled(bmp, x, y, w, h, flags);
 }
 
 void
@@ -2477,7 +2671,7 @@ VideoA5_DrawShapeGrey(enum ShapeID shapeID, int x, int y, int flags)
 	assert(SHAPE_CONCRETE_SLAB <= shapeID && shapeID <= SHAPE_SANDWORM);
 	assert(s_shape[greyID][HOUSE_HARKONNEN] != NULL);
 
-	al_draw_bitmap(s_shape[greyID][HOUSE_HARKONNEN], x, y, flags);
+	VideoA5_DrawSprite(s_shape[greyID][HOUSE_HARKONNEN], s_white, x, y, flags, SPRITEBLEND_ALPHA);
 }
 
 void
@@ -2489,7 +2683,7 @@ VideoA5_DrawShapeGreyScale(enum ShapeID shapeID, int x, int y, int w, int h, int
 	ALLEGRO_BITMAP *bmp = s_shape[greyID][HOUSE_HARKONNEN];
 	assert(bmp != NULL);
 
-	al_draw_scaled_bitmap(bmp, 0, 0, al_get_bitmap_width(bmp), al_get_bitmap_height(bmp), x, y, w, h, flags);
+	VideoA5_DrawSpriteScaled(bmp, x, y, w, h, flags);
 }
 
 void
@@ -2498,7 +2692,7 @@ VideoA5_DrawShapeTint(enum ShapeID shapeID, int x, int y, unsigned char c, int f
 	assert(shapeID < SHAPEID_MAX);
 	assert(s_shape[shapeID][HOUSE_HARKONNEN] != NULL);
 
-	al_draw_tinted_bitmap(s_shape[shapeID][HOUSE_HARKONNEN], paltoRGB[c], x, y, flags);
+	VideoA5_DrawSprite(s_shape[shapeID][HOUSE_HARKONNEN], paltoRGB[c], x, y, flags, SPRITEBLEND_ALPHA);
 }
 
 FadeInAux *
@@ -2655,7 +2849,7 @@ VideoA5_DrawChar(unsigned char c, const uint8 *pal, int x, int y)
 	const ALLEGRO_COLOR fg = paltoRGB[pal[1]];
 
 	if (s_font[fnt][c] != NULL)
-		al_draw_tinted_bitmap(s_font[fnt][c], fg, x, y, 0);
+		VideoA5_DrawSprite(s_font[fnt][c], fg, x, y, 0, SPRITEBLEND_ALPHA);
 }
 
 void
@@ -2670,7 +2864,7 @@ VideoA5_DrawCharAlpha(unsigned char c, const uint8 *pal, int x, int y, unsigned
 				alpha);
 
 	if (s_font[fnt][c] != NULL)
-		al_draw_tinted_bitmap(s_font[fnt][c], tint, x, y, 0);
+		VideoA5_DrawSprite(s_font[fnt][c], tint, x, y, 0, SPRITEBLEND_ALPHA);
 }
 
 /*--------------------------------------------------------------*/
@@ -2713,6 +2907,8 @@ VideoA5_InitWSA(unsigned char *buf)
 bool
 VideoA5_DrawWSA(void *wsa, int frame, int sx, int sy, int dx, int dy, int w, int h)
 {
+	/* Scratch may be in the batch. */
+	SpriteBatch_Flush();
 	VideoA5_ResizeScratchBitmap(w, h);
 	if (scratch == NULL)
 		return false;
@@ -2741,18 +2937,165 @@ VideoA5_DrawWSAStatic(int frame, int x, int y)
 	const int sy = 65 * ty;
 	assert(0 <= frame && frame < 21);
 
-	al_draw_bitmap_region(interface_texture, sx, sy, 64, 64, x, y, 0);
+	VideoA5_DrawRegion(interface_texture, s_white, sx, sy, 64, 64, x, y);
 }
 
 /*--------------------------------------------------------------*/
 
+static int
+VideoA5_GetMinimapColour(uint16 packed, enum MinimapDrawMode mode)
+{
+	const Tile *t = &g_map[packed];
+	int colour = 12;
+
+	if (mode == MINIMAP_SAVE) {
+		uint16 type = Map_GetLandscapeTypeOriginal(packed);
+		colour = g_table_landscapeInfo[type].radarColour;
+	} else if (g_playerHouse->flags.radarActivated
+			&& Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
+		const bool fogged = enhancement_fog_of_war && Map_IsTileFogged(g_playerHouseID, packed);
+		Unit *u;
+
+		if (fogged) {
+		} else if (t->hasUnit && ((u = Unit_Get_ByPackedTile(packed)) != NULL)) {
+			/* Sandworms are drawn over the minimap. */
+			if (u->o.type != UNIT_SANDWORM)
+				colour = g_table_houseInfo[Unit_GetHouseID(u)].minimapColor;
+		}
+
+		if (colour == 12) {
+			uint16 type = Map_GetLandscapeTypeVisible(packed);
+
+			if (g_table_landscapeInfo[type].radarColour == 0xFFFF) {
+				colour = g_table_houseInfo[t->houseID].minimapColor;
+			} else if (fogged) {
+				colour = -g_table_landscapeInfo[type].radarColour;
+			} else {
+				colour = g_table_landscapeInfo[type].radarColour;
+			}
+		}
+
+		/* Redraw the tile once it becomes fogged. */
+		if (enhancement_fog_of_war && !fogged)
+			Minimap_ScheduleFogExpiry(packed);
+	} else if (t->hasStructure && t->houseID == g_playerHouseID) {
+		colour = g_table_houseInfo[t->houseID].minimapColor;
+	}
+
+	return colour;
+}
+
+/**
+ * Check whether anything that affects every tile on the minimap
+ * changed since it was last drawn.
+ */
+static bool
+VideoA5_MinimapStateChanged(int map_scale)
+{
+	static int l_map_scale = -1;
+	static enum HouseType l_houseID = HOUSE_INVALID;
+	static bool l_radarActivated;
+	static bool l_fogOfWar;
+
+	const bool radarActivated = g_playerHouse->flags.radarActivated;
+
+	if (l_map_scale == map_scale
+	 && l_houseID == g_playerHouseID
+	 && l_radarActivated == radarActivated
+	 && l_fogOfWar == enhancement_fog_of_war)
+		return false;
+
+	l_map_scale = map_scale;
+	l_houseID = g_playerHouseID;
+	l_radarActivated = radarActivated;
+	l_fogOfWar = enhancement_fog_of_war;
+	return true;
+}
+
+static int
+VideoA5_FindMinimapSandworms(const MapInfo *mapInfo, int *position, int max)
+{
+	PoolFindStruct find;
+	int num = 0;
+
+	if (!g_playerHouse->flags.radarActivated)
+		return 0;
+
+	for (const Unit *u = Unit_FindFirst(&find, HOUSE_INVALID, UNIT_SANDWORM);
+			u != NULL && num < max;
+			u = Unit_FindNext(&find)) {
+		const uint16 packed = Tile_PackTile(u->o.position);
+		const int x = Tile_GetPackedX(packed) - mapInfo->minX;
+		const int y = Tile_GetPackedY(packed) - mapInfo->minY;
+
+		if (x < 0 || x >= mapInfo->sizeX || y < 0 || y >= mapInfo->sizeY)
+			continue;
+
+		if (!g_map[packed].hasUnit || Unit_Get_ByPackedTile(packed) != u)
+			continue;
+
+		if (!Map_IsUnveiledToHouse(g_playerHouseID, packed)
+				|| (enhancement_fog_of_war && Map_IsTileFogged(g_playerHouseID, packed)))
+			continue;
+
+		position[2*num + 0] = x;
+		position[2*num + 1] = y;
+		num++;
+	}
+
+	return num;
+}
+
+static void
+VideoA5_UploadMinimap(const MapInfo *mapInfo, int x1, int y1, int x2, int y2)
+{
+	ALLEGRO_LOCKED_REGION *reg = al_lock_bitmap_region(s_minimap,
+			x1, y1, x2 - x1 + 1, y2 - y1 + 1,
+			ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+
+	for (int y = y1; y <= y2; y++) {
+		unsigned char *row = &((unsigned char *)reg->data)[reg->pitch*(y - y1)];
+
+		for (int x = x1; x <= x2; x++) {
+			unsigned char *pixel = &row[reg->pixel_size*(x - x1)];
+
+			if (s_minimap_colour[mapInfo->sizeX * y + x] >= 0) {
+				const unsigned char c = s_minimap_colour[mapInfo->sizeX * y + x];
+
+				pixel[0] = paletteRGB[3*c + 0];
+				pixel[1] = paletteRGB[3*c + 1];
+				pixel[2] = paletteRGB[3*c + 2];
+				pixel[3] = 0xFF;
+			} else {
+				const unsigned char c = -s_minimap_colour[mapInfo->sizeX * y + x];
+
+				/* Negative colour denotes darkened for fog of war. */
+				pixel[0] = paletteRGB[3*c + 0] / 2;
+				pixel[1] = paletteRGB[3*c + 1] / 2;
+				pixel[2] = paletteRGB[3*c + 2] / 2;
+				pixel[3] = 0xFF;
+			}
+		}
+	}
+
+	al_unlock_bitmap(s_minimap);
+}
+
+/**
+ * Draw the minimap.  In game, only the tiles queued by Minimap_Update
+ * are recoloured, and only the rectangle around those which changed
+ * is uploaded.
+ */
 void
 Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode)
 {
 	const MapInfo *mapInfo = &g_mapInfos[map_scale];
-	bool redraw = false;
 	int sandworm_position[4 * 2];
 	int num_sandworms = 0;
+	int x1 = mapInfo->sizeX, y1 = mapInfo->sizeY;
+	int x2 = -1, y2 = -1;
+
+	SpriteBatch_Flush();
 
 	if (mode == MINIMAP_RESTORE) {
 		al_draw_scaled_bitmap(s_minimap, 0.0f, 0.0f, mapInfo->sizeX, mapInfo->sizeY,
@@ -2760,84 +3103,57 @@ Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode)
 		return;
 	}
 
-	for (int y = 0; y < mapInfo->sizeY; y++) {
-		uint16 packed = Tile_PackXY(mapInfo->minX, mapInfo->minY + y);
-		int i = mapInfo->sizeX * y;
-
-		for (int x = 0; x < mapInfo->sizeX; x++, i++, packed++) {
-			const Tile *t = &g_map[packed];
-			int colour = 12;
+	if (mode == MINIMAP_SAVE || VideoA5_MinimapStateChanged(map_scale))
+		Minimap_InvalidateAll();
 
-			if (mode == 1) {
-				uint16 type = Map_GetLandscapeTypeOriginal(packed);
-				colour = g_table_landscapeInfo[type].radarColour;
-			} else if (g_playerHouse->flags.radarActivated
-					&& Map_IsUnveiledToHouse(g_playerHouseID, packed)) {
-				Unit *u;
-
-				if (enhancement_fog_of_war && g_mapVisible[packed].timeout[g_playerHouseID] <= g_timerGame) {
-				} else if (t->hasUnit && ((u = Unit_Get_ByPackedTile(packed)) != NULL)) {
-					if (u->o.type == UNIT_SANDWORM) {
-						/* Really shouldn't have more than 3, but anyway. */
-						if (num_sandworms < 4) {
-							sandworm_position[2*num_sandworms + 0] = x;
-							sandworm_position[2*num_sandworms + 1] = y;
-							num_sandworms++;
-						}
-					} else {
-						colour = g_table_houseInfo[Unit_GetHouseID(u)].minimapColor;
-					}
+	if (Minimap_Update()) {
+		for (int y = 0; y < mapInfo->sizeY; y++) {
+			uint16 packed = Tile_PackXY(mapInfo->minX, mapInfo->minY + y);
+			int i = mapInfo->sizeX * y;
+
+			for (int x = 0; x < mapInfo->sizeX; x++, i++, packed++) {
+				const int colour = VideoA5_GetMinimapColour(packed, mode);
+
+				if (s_minimap_colour[i] != colour) {
+					s_minimap_colour[i] = colour;
+					x1 = 0;
+					y1 = 0;
+					x2 = mapInfo->sizeX - 1;
+					y2 = mapInfo->sizeY - 1;
 				}
+			}
+		}
+	} else {
+		int packed;
 
-				if (colour == 12) {
-					uint16 type = Map_GetLandscapeTypeVisible(packed);
+		while ((packed = Minimap_PopDirtyTile()) >= 0) {
+			const int x = Tile_GetPackedX(packed) - mapInfo->minX;
+			const int y = Tile_GetPackedY(packed) - mapInfo->minY;
 
-					if (g_table_landscapeInfo[type].radarColour == 0xFFFF) {
-						colour = g_table_houseInfo[t->houseID].minimapColor;
-					} else if (enhancement_fog_of_war && g_mapVisible[packed].timeout[g_playerHouseID] <= g_timerGame) {
-						colour = -g_table_landscapeInfo[type].radarColour;
-					} else {
-						colour = g_table_landscapeInfo[type].radarColour;
-					}
-				}
-			} else if (t->hasStructure && t->houseID == g_playerHouseID) {
-				colour = g_table_houseInfo[t->houseID].minimapColor;
-			}
+			if (x < 0 || x >= mapInfo->sizeX || y < 0 || y >= mapInfo->sizeY)
+				continue;
+
+			const int i = mapInfo->sizeX * y + x;
+			const int colour = VideoA5_GetMinimapColour(packed, mode);
 
 			if (s_minimap_colour[i] != colour) {
 				s_minimap_colour[i] = colour;
-				redraw = true;
+				x1 = min(x1, x);
+				y1 = min(y1, y);
+				x2 = max(x2, x);
+				y2 = max(y2, y);
 			}
 		}
 	}
 
-	if (redraw) {
-		ALLEGRO_LOCKED_REGION *reg = al_lock_bitmap(s_minimap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
-
-		for (int y = 0; y < mapInfo->sizeY; y++) {
-			unsigned char *row = &((unsigned char *)reg->data)[reg->pitch*y];
-
-			for (int x = 0; x < mapInfo->sizeX; x++) {
-				if (s_minimap_colour[mapInfo->sizeX * y + x] >= 0) {
-					const unsigned char c = s_minimap_colour[mapInfo->sizeX * y + x];
+	if (x1 <= x2)
+		VideoA5_UploadMinimap(mapInfo, x1, y1, x2, y2);
 
-					row[reg->pixel_size*x + 0] = paletteRGB[3*c + 0];
-					row[reg->pixel_size*x + 1] = paletteRGB[3*c + 1];
-					row[reg->pixel_size*x + 2] = paletteRGB[3*c + 2];
-					row[reg->pixel_size*x + 3] = 0xFF;
-				} else {
-					const unsigned char c = -s_minimap_colour[mapInfo->sizeX * y + x];
-
-					/* Negative colour denotes darkened for fog of war. */
-					row[reg->pixel_size*x + 0] = paletteRGB[3*c + 0] / 2;
-					row[reg->pixel_size*x + 1] = paletteRGB[3*c + 1] / 2;
-					row[reg->pixel_size*x + 2] = paletteRGB[3*c + 2] / 2;
-					row[reg->pixel_size*x + 3] = 0xFF;
-				}
-			}
-		}
-
-		al_unlock_bitmap(s_minimap);
+	/* The saved minimap shows the original landscape. */
+	if (mode == MINIMAP_SAVE) {
+		Minimap_InvalidateAll();
+	} else {
+		num_sandworms = VideoA5_FindMinimapSandworms(mapInfo, sandworm_position, 4);
 	}
 
 	al_draw_scaled_bitmap(s_minimap, 0.0f, 0.0f, mapInfo->sizeX, mapInfo->sizeY,
@@ -2856,6 +3172,107 @@ Video_DrawMinimap(int left, int top, int map_scale, enum MinimapDrawMode mode)
 
 /*--------------------------------------------------------------*/
 
+/**
+ * The terrain chunks are rendered with the same icons that
+ * VideoA5_DrawIcon would choose for the viewport's scale.
+ */
+static int
+VideoA5_GetTerrainChunkScale(void)
+{
+	const float scalex = g_screenDiv[SCREENDIV_VIEWPORT].scalex;
+
+	if (2.99f <= scalex && icon_texture48 != NULL)
+		return 3;
+
+	if (1.99f <= scalex && scalex <= 2.01f && icon_texture32 != NULL)
+		return 2;
+
+	return 1;
+}
+
+/**
+ * Create the terrain chunks for the viewport's scale.  Changing the
+ * scale invalidates every chunk.
+ *
+ * @return False if the chunks could not be created, in which case the
+ *         terrain should be drawn tile by tile.
+ */
+bool
+Video_PrepareTerrainChunks(void)
+{
+	const int scale = VideoA5_GetTerrainChunkScale();
+	const int size = MAP_CHUNK_SIZE * TILE_SIZE * scale;
+
+	if (s_terrain_chunk_scale != scale) {
+		VideoA5_UninitTerrainChunks();
+		s_terrain_chunk_scale = scale;
+		Map_InvalidateVisibleAll();
+	}
+
+	for (int chunk = 0; chunk < MAP_CHUNK_MAX; chunk++) {
+		if (s_terrain_chunk[chunk] != NULL)
+			continue;
+
+		s_terrain_chunk[chunk] = al_create_bitmap(size, size);
+
+		if (s_terrain_chunk[chunk] == NULL) {
+			VideoA5_UninitTerrainChunks();
+			Map_InvalidateVisibleAll();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Make the chunk the drawing target, cleared, and scaled so that
+ * tiles are drawn TILE_SIZE apart.  Tile (0, 0) of the chunk is drawn
+ * at (0, 0).
+ */
+void
+Video_BeginTerrainChunk(int chunk)
+{
+	assert(0 <= chunk && chunk < MAP_CHUNK_MAX);
+	assert(s_terrain_chunk[chunk] != NULL);
+
+	ALLEGRO_TRANSFORM trans;
+
+	/* The chunk may be in the batch. */
+	SpriteBatch_Flush();
+
+	s_terrain_old_target = al_get_target_bitmap();
+	al_set_target_bitmap(s_terrain_chunk[chunk]);
+
+	al_build_transform(&trans, 0.0f, 0.0f, s_terrain_chunk_scale, s_terrain_chunk_scale, 0.0f);
+	al_use_transform(&trans);
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+}
+
+void
+Video_EndTerrainChunk(void)
+{
+	al_set_target_bitmap(s_terrain_old_target);
+	s_terrain_old_target = NULL;
+}
+
+/**
+ * Draw the w by h region of the chunk at (sx, sy), in pixels of 16x16
+ * tiles, to (x, y).
+ */
+void
+Video_DrawTerrainChunk(int chunk, int sx, int sy, int w, int h, int x, int y)
+{
+	assert(0 <= chunk && chunk < MAP_CHUNK_MAX);
+
+	const int scale = s_terrain_chunk_scale;
+
+	SpriteBatch_Draw(s_terrain_chunk[chunk], s_white,
+			scale * sx, scale * sy, scale * w, scale * h, x, y, w, h, 0, SPRITEBLEND_ALPHA);
+}
+
+/*--------------------------------------------------------------*/
+
 int
 VideoA5_GetDesktopWidth(void)
 {
@@ -2980,6 +3397,397 @@ Video_InitMentatSprites(bool use_benepal)
 	Widget_SetCurrentWidget(old_widget);
 }
 
+/*--------------------------------------------------------------*/
+
+/* Atlas cache:
+ *
+ * The finished icon, shape, region and interface textures are saved to
+ * the personal data directory, along with the rectangle of each shape.
+ * The data files read while building the atlases are recorded in the
+ * cache.  On the next start the cache is loaded, provided that those
+ * files and the palette have not changed.  The files are not read
+ * again to tell: their size, their place in their PAK file, and the
+ * time they or their PAK file were modified are compared instead.
+ */
+
+#define ATLAS_CACHE_FILENAME    "atlas.cache"
+#define ATLAS_CACHE_MAGIC       "DDATLAS"
+
+enum {
+	ATLAS_CACHE_VERSION = 3,
+	ATLAS_TEXTURE_MAX   = 4,
+	ATLAS_SOURCE_MAX    = 64
+};
+
+enum AtlasShapeTexture {
+	ATLAS_SHAPE_NONE,
+	ATLAS_SHAPE_SHAPE_TEXTURE,
+	ATLAS_SHAPE_REGION_TEXTURE,
+	ATLAS_SHAPE_PREVIOUS_HOUSE  /* Same bitmap as houseID - 1. */
+};
+
+typedef struct AtlasCacheHeader {
+	char magic[8];
+	uint32 version;
+	uint32 width, height;
+	uint32 sourceCount;
+	uint64_t key;
+} AtlasCacheHeader;
+
+typedef struct AtlasCacheSource {
+	uint32 dir;
+	char filename[60];
+} AtlasCacheSource;
+
+typedef struct AtlasCacheShape {
+	uint16 texture;
+	uint16 x, y, w, h;
+} AtlasCacheShape;
+
+static AtlasCacheSource s_atlasSource[ATLAS_SOURCE_MAX];
+static unsigned int s_atlasSourceCount;
+static bool s_atlasSourceOverflow;
+
+static void
+VideoA5_RecordAtlasSource(enum SearchDirectory dir, const char *filename)
+{
+	for (unsigned int i = 0; i < s_atlasSourceCount; i++) {
+		if (s_atlasSource[i].dir == (uint32)dir && strcmp(s_atlasSource[i].filename, filename) == 0)
+			return;
+	}
+
+	if (s_atlasSourceCount >= ATLAS_SOURCE_MAX || strlen(filename) >= sizeof(s_atlasSource[0].filename)) {
+		s_atlasSourceOverflow = true;
+		return;
+	}
+
+	AtlasCacheSource *src = &s_atlasSource[s_atlasSourceCount++];
+
+	memset(src, 0, sizeof(*src));
+	src->dir = dir;
+	strcpy(src->filename, filename);
+}
+
+static uint64_t
+VideoA5_HashAtlasFile(uint64_t hash, enum SearchDirectory dir, const char *filename)
+{
+	FileStamp stamp;
+	const bool found = File_GetStamp_Ex(dir, filename, &stamp);
+
+	if (!found)
+		memset(&stamp, 0, sizeof(stamp));
+
+	hash = Tools_HashFNV1a(hash, &found, sizeof(found));
+	return Tools_HashFNV1a(hash, &stamp, sizeof(stamp));
+}
+
+/**
+ * Hash everything the atlases are built from: the data files read while
+ * building them, the rubble mask, the palette, the language and the
+ * texture size.
+ */
+static uint64_t
+VideoA5_GetAtlasCacheKey(const AtlasCacheSource *source, unsigned int count)
+{
+	const uint32 data[] = {
+		ATLAS_CACHE_VERSION,
+		g_widgetProperties[WINDOWID_RENDER_TEXTURE].width,
+		g_widgetProperties[WINDOWID_RENDER_TEXTURE].height,
+		g_gameConfig.language
+	};
+
+	uint64_t key = TOOLS_HASH_FNV1A_BASIS;
+
+	key = Tools_HashFNV1a(key, data, sizeof(data));
+	key = Tools_HashFNV1a(key, paletteRGB, sizeof(paletteRGB));
+
+	char path[PATH_MAX];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-truncation"
+	snprintf(path, sizeof(path), "%s/gfx/rubblemask.png", g_dune_data_dir);
+#pragma GCC diagnostic pop
+	key = VideoA5_HashAtlasFile(key, SEARCHDIR_ABSOLUTE, path);
+
+	for (unsigned int i = 0; i < count; i++) {
+		key = Tools_HashFNV1a(key, &source[i], sizeof(source[i]));
+		key = VideoA5_HashAtlasFile(key, source[i].dir, source[i].filename);
+	}
+
+	return key;
+}
+
+static void
+VideoA5_GetAtlasCacheFilename(char *filename, size_t len, const char *suffix)
+{
+	snprintf(filename, len, "%s/%s%s", g_personal_data_dir, ATLAS_CACHE_FILENAME, suffix);
+}
+
+static bool
+VideoA5_GetAtlasShape(enum ShapeID shapeID, enum HouseType houseID, AtlasCacheShape *shape)
+{
+	ALLEGRO_BITMAP *bmp = s_shape[shapeID][houseID];
+
+	memset(shape, 0, sizeof(*shape));
+
+	if (bmp == NULL) {
+		shape->texture = ATLAS_SHAPE_NONE;
+		return true;
+	}
+
+	if ((houseID > HOUSE_HARKONNEN) && (bmp == s_shape[shapeID][houseID - 1])) {
+		shape->texture = ATLAS_SHAPE_PREVIOUS_HOUSE;
+		return true;
+	}
+
+	ALLEGRO_BITMAP *parent = al_get_parent_bitmap(bmp);
+
+	if (parent == shape_texture) {
+		shape->texture = ATLAS_SHAPE_SHAPE_TEXTURE;
+	} else if (parent == region_texture) {
+		shape->texture = ATLAS_SHAPE_REGION_TEXTURE;
+	} else {
+		return false;
+	}
+
+	shape->x = al_get_bitmap_x(bmp);
+	shape->y = al_get_bitmap_y(bmp);
+	shape->w = al_get_bitmap_width(bmp);
+	shape->h = al_get_bitmap_height(bmp);
+	return true;
+}
+
+static bool
+VideoA5_WriteAtlasTexture(FILE *fp, ALLEGRO_BITMAP *bmp)
+{
+	const int w = al_get_bitmap_width(bmp);
+	const int h = al_get_bitmap_height(bmp);
+	bool ok = true;
+
+	ALLEGRO_LOCKED_REGION *reg = al_lock_bitmap(bmp, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	if (reg == NULL)
+		return false;
+
+	for (int y = 0; ok && y < h; y++) {
+		const unsigned char *row = (const unsigned char *)reg->data + y * reg->pitch;
+
+		ok = (fwrite(row, 4, w, fp) == (size_t)w);
+	}
+
+	al_unlock_bitmap(bmp);
+	return ok;
+}
+
+static bool
+VideoA5_ReadAtlasTexture(ALLEGRO_BITMAP *bmp, const unsigned char *src)
+{
+	const int w = al_get_bitmap_width(bmp);
+	const int h = al_get_bitmap_height(bmp);
+
+	ALLEGRO_LOCKED_REGION *reg = al_lock_bitmap(bmp, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	if (reg == NULL)
+		return false;
+
+	for (int y = 0; y < h; y++) {
+		unsigned char *row = (unsigned char *)reg->data + y * reg->pitch;
+
+		memcpy(row, src + 4 * w * y, 4 * w);
+	}
+
+	al_unlock_bitmap(bmp);
+	return true;
+}
+
+/**
+ * Save the atlases, the shape rectangles and the data files they were
+ * built from.  The cache is written to a temporary file first, so that
+ * an interrupted write never leaves a truncated cache behind.
+ */
+static void
+VideoA5_SaveAtlasCache(void)
+{
+	ALLEGRO_BITMAP *texture[ATLAS_TEXTURE_MAX] = { icon_texture, shape_texture, region_texture, interface_texture };
+	char filename[PATH_MAX + sizeof(ATLAS_CACHE_FILENAME) + 1];
+	char tmpname[PATH_MAX + sizeof(ATLAS_CACHE_FILENAME) + 5];
+	AtlasCacheHeader header;
+
+	/* Without the full list of files, the cache could not be checked. */
+	if (s_atlasSourceOverflow)
+		return;
+
+	VideoA5_GetAtlasCacheFilename(filename, sizeof(filename), "");
+	VideoA5_GetAtlasCacheFilename(tmpname, sizeof(tmpname), ".tmp");
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ATLAS_CACHE_MAGIC, sizeof(ATLAS_CACHE_MAGIC));
+	header.version = ATLAS_CACHE_VERSION;
+	header.width = g_widgetProperties[WINDOWID_RENDER_TEXTURE].width;
+	header.height = g_widgetProperties[WINDOWID_RENDER_TEXTURE].height;
+	header.sourceCount = s_atlasSourceCount;
+	header.key = VideoA5_GetAtlasCacheKey(s_atlasSource, s_atlasSourceCount);
+
+	for (int i = 0; i < ATLAS_TEXTURE_MAX; i++) {
+		if (texture[i] == NULL
+				|| al_get_bitmap_width(texture[i]) != (int)header.width
+				|| al_get_bitmap_height(texture[i]) != (int)header.height)
+			return;
+	}
+
+	FILE *fp = fopen(tmpname, "wb");
+	if (fp == NULL)
+		return;
+
+	bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1)
+	       && (fwrite(s_atlasSource, sizeof(s_atlasSource[0]), s_atlasSourceCount, fp) == s_atlasSourceCount)
+	       && (fwrite(s_icon, sizeof(s_icon), 1, fp) == 1);
+
+	for (enum ShapeID shapeID = 0; ok && shapeID < SHAPEID_MAX; shapeID++) {
+		for (enum HouseType houseID = HOUSE_HARKONNEN; ok && houseID < HOUSE_NEUTRAL; houseID++) {
+			AtlasCacheShape shape;
+
+			ok = VideoA5_GetAtlasShape(shapeID, houseID, &shape)
+			  && (fwrite(&shape, sizeof(shape), 1, fp) == 1);
+		}
+	}
+
+	for (int i = 0; ok && i < ATLAS_TEXTURE_MAX; i++)
+		ok = VideoA5_WriteAtlasTexture(fp, texture[i]);
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+#ifdef ALLEGRO_WINDOWS
+	/* rename does not replace an existing file here. */
+	if (ok)
+		remove(filename);
+#endif
+
+	if (ok)
+		ok = (rename(tmpname, filename) == 0);
+
+	if (!ok) {
+		Warning("Could not write the atlas cache %s.\n", filename);
+		remove(tmpname);
+	}
+}
+
+/**
+ * Load the atlases and the shape rectangles from the cache, if it was
+ * built from the same data.  Nothing is changed if the cache is missing
+ * or out of date.
+ *
+ * @return True if the textures and shapes were loaded.
+ */
+static bool
+VideoA5_LoadAtlasCache(void)
+{
+	const int WINDOW_W = g_widgetProperties[WINDOWID_RENDER_TEXTURE].width;
+	const int WINDOW_H = g_widgetProperties[WINDOWID_RENDER_TEXTURE].height;
+	const size_t texture_size = 4 * (size_t)WINDOW_W * WINDOW_H;
+	const size_t shape_size = sizeof(AtlasCacheShape) * SHAPEID_MAX * HOUSE_NEUTRAL;
+	const size_t expected = sizeof(s_icon) + shape_size + ATLAS_TEXTURE_MAX * texture_size;
+	char filename[PATH_MAX + sizeof(ATLAS_CACHE_FILENAME) + 1];
+	AtlasCacheSource source[ATLAS_SOURCE_MAX];
+	AtlasCacheHeader header;
+
+	VideoA5_GetAtlasCacheFilename(filename, sizeof(filename), "");
+
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+		return false;
+
+	if (fread(&header, sizeof(header), 1, fp) != 1
+			|| memcmp(header.magic, ATLAS_CACHE_MAGIC, sizeof(ATLAS_CACHE_MAGIC)) != 0
+			|| header.version != ATLAS_CACHE_VERSION
+			|| header.width != (uint32)WINDOW_W
+			|| header.height != (uint32)WINDOW_H
+			|| header.sourceCount > ATLAS_SOURCE_MAX
+			|| fread(source, sizeof(source[0]), header.sourceCount, fp) != header.sourceCount) {
+		fclose(fp);
+		return false;
+	}
+
+	for (unsigned int i = 0; i < header.sourceCount; i++)
+		source[i].filename[sizeof(source[i].filename) - 1] = '\0';
+
+	if (header.key != VideoA5_GetAtlasCacheKey(source, header.sourceCount)) {
+		fclose(fp);
+		return false;
+	}
+
+	/* Read one byte more than expected to catch a longer file. */
+	unsigned char *data = malloc(expected + 1);
+	const size_t len = (data != NULL) ? fread(data, 1, expected + 1, fp) : 0;
+	fclose(fp);
+
+	if (len != expected) {
+		free(data);
+		return false;
+	}
+
+	const unsigned char *icon = data;
+	const AtlasCacheShape *shape = (const AtlasCacheShape *)(icon + sizeof(s_icon));
+	const unsigned char *pixels = (const unsigned char *)shape + shape_size;
+
+	for (int i = 0; i < SHAPEID_MAX * HOUSE_NEUTRAL; i++) {
+		const AtlasCacheShape *s = &shape[i];
+
+		if ((s->texture == ATLAS_SHAPE_SHAPE_TEXTURE || s->texture == ATLAS_SHAPE_REGION_TEXTURE)
+				&& (s->x + s->w <= WINDOW_W && s->y + s->h <= WINDOW_H))
+			continue;
+
+		if ((s->texture == ATLAS_SHAPE_NONE)
+				|| (s->texture == ATLAS_SHAPE_PREVIOUS_HOUSE && (i % HOUSE_NEUTRAL) != HOUSE_HARKONNEN))
+			continue;
+
+		free(data);
+		return false;
+	}
+
+	/* Textures. */
+	const int bitmap_flags = al_get_new_bitmap_flags();
+	al_set_new_bitmap_flags(bitmap_flags & ~ALLEGRO_NO_PRESERVE_TEXTURE);
+	icon_texture = al_create_bitmap(WINDOW_W, WINDOW_H);
+	al_set_new_bitmap_flags(bitmap_flags);
+	assert(icon_texture != NULL);
+
+	VideoA5_ReadAtlasTexture(icon_texture,      pixels + 0 * texture_size);
+	VideoA5_ReadAtlasTexture(shape_texture,     pixels + 1 * texture_size);
+	VideoA5_ReadAtlasTexture(region_texture,    pixels + 2 * texture_size);
+	VideoA5_ReadAtlasTexture(interface_texture, pixels + 3 * texture_size);
+
+	/* Icons and shapes. */
+	memcpy(s_icon, icon, sizeof(s_icon));
+
+	for (enum ShapeID shapeID = 0; shapeID < SHAPEID_MAX; shapeID++) {
+		for (enum HouseType houseID = HOUSE_HARKONNEN; houseID < HOUSE_NEUTRAL; houseID++) {
+			const AtlasCacheShape *s = &shape[shapeID * HOUSE_NEUTRAL + houseID];
+
+			switch (s->texture) {
+				case ATLAS_SHAPE_SHAPE_TEXTURE:
+					s_shape[shapeID][houseID] = al_create_sub_bitmap(shape_texture, s->x, s->y, s->w, s->h);
+					assert(s_shape[shapeID][houseID] != NULL);
+					break;
+
+				case ATLAS_SHAPE_REGION_TEXTURE:
+					s_shape[shapeID][houseID] = al_create_sub_bitmap(region_texture, s->x, s->y, s->w, s->h);
+					assert(s_shape[shapeID][houseID] != NULL);
+					break;
+
+				case ATLAS_SHAPE_PREVIOUS_HOUSE:
+					s_shape[shapeID][houseID] = s_shape[shapeID][houseID - 1];
+					break;
+
+				default:
+					s_shape[shapeID][houseID] = NULL;
+					break;
+			}
+		}
+	}
+
+	free(data);
+	return true;
+}
+
 void
 VideoA5_InitSprites(void)
 {
@@ -2988,23 +3796,44 @@ VideoA5_InitSprites(void)
 	const Screen oldScreenID = GFX_Screen_SetActive(SCREEN_0);
 	const enum WindowID old_widget = Widget_SetCurrentWidget(WINDOWID_RENDER_TEXTURE);
 
+	const double start_time = al_get_time();
+
 	unsigned char *buf = GFX_Screen_GetActive();
 
 	VideoA5_ReadPalette("IBM.PAL");
 
-	memset(buf, 0, WINDOW_W * WINDOW_H);
-	VideoA5_InitIcons(buf);
+	const bool cached = g_gameConfig.atlasCache && VideoA5_LoadAtlasCache();
+
+	if (cached) {
+		/* VideoA5_InitShapes leaves the English buttons loaded. */
+		Sprites_InitCHOAM("BTTN.ENG", "CHOAM.ENG");
+
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitCursor(buf);
+
+		VideoA5_LoadCPS(SEARCHDIR_GLOBAL_DATA_DIR, "FAME.CPS");
+		VideoA5_LoadCPS(SEARCHDIR_GLOBAL_DATA_DIR, "MAPMACH.CPS");
+	} else {
+		s_atlasSourceCount = 0;
+		s_atlasSourceOverflow = false;
+		File_SetReadCallback(VideoA5_RecordAtlasSource);
+
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitIcons(buf);
+
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitShapes(buf);
+		VideoA5_InitCursor(buf);
 
-	memset(buf, 0, WINDOW_W * WINDOW_H);
-	VideoA5_InitShapes(buf);
-	VideoA5_InitCursor(buf);
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitCPS();
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitWSA(buf);
+		memset(buf, 0, WINDOW_W * WINDOW_H);
+		VideoA5_InitFonts(buf);
 
-	memset(buf, 0, WINDOW_W * WINDOW_H);
-	VideoA5_InitCPS();
-	memset(buf, 0, WINDOW_W * WINDOW_H);
-	VideoA5_InitWSA(buf);
-	memset(buf, 0, WINDOW_W * WINDOW_H);
-	VideoA5_InitFonts(buf);
+		File_SetReadCallback(NULL);
+	}
 
 #if OUTPUT_TEXTURES
 	al_save_bitmap("interface.png", interface_texture);
@@ -3016,9 +3845,16 @@ VideoA5_InitSprites(void)
 	al_set_new_bitmap_flags(bitmap_flags);
 	VideoA5_InitFonts(NULL);
 
+	if (g_gameConfig.atlasCache && !cached)
+		VideoA5_SaveAtlasCache();
+
 	al_set_target_backbuffer(display);
 	al_set_blender(ALLEGRO_ADD, ALLEGRO_ALPHA, ALLEGRO_INVERSE_ALPHA);
 
+	fprintf(stdout, "Sprites initialised in %.0f ms (%s).\n",
+			1000.0 * (al_get_time() - start_time),
+			!g_gameConfig.atlasCache ? "atlas cache disabled" : cached ? "atlas cache" : "atlas cache rebuilt");
+
 	GFX_Screen_SetActive(oldScreenID);
 	Widget_SetCurrentWidget(old_widget);
 }
@@ -3032,6 +3868,10 @@ VideoA5_DisplayFound(void)
 	scratch = NULL;
 
 	memset(s_minimap_colour, 0, sizeof(s_minimap_colour));
+	Minimap_InvalidateAll();
+
+	/* The terrain chunks do not preserve their contents. */
+	Map_InvalidateVisibleAll();
 }
 
 int
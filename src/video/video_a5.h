@@ -23,6 +23,7 @@ extern void VideoA5_Uninit(void);
 extern void VideoA5_ToggleFullscreen(void);
 extern void VideoA5_ToggleFPS(void);
 extern void VideoA5_CaptureScreenshot(void);
+extern void VideoA5_DumpProfile(void);
 extern void VideoA5_Tick(void);
 
 extern void VideoA5_InitSprites(void);
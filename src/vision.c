@@ -0,0 +1,339 @@
+/** @file src/vision.c
+ *
+ * Incremental fog of war vision.
+ *
+ * Every Unit and Structure that removes fog is an observer.  Each
+ * house has a count of the observers in range of every tile.  When an
+ * observer crosses a tile boundary, or appears or disappears, its old
+ * circle is taken off the counts and the new one added.  Only then are
+ * tiles unveiled, using a stamp precomputed for each radius.
+ *
+ * While a tile is counted its timeout is held (FOGOFWAR_TIMEOUT_HELD),
+ * which is as if it were refreshed every tick.  When the last observer
+ * leaves, the timeout starts from that tick.
+ *
+ * Observers also report the units and structures in view every tick,
+ * which used to happen as a side effect of unveiling each tile.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "os/math.h"
+
+#include "vision.h"
+
+#include "enhancement.h"
+#include "house.h"
+#include "map.h"
+#include "opendune.h"
+#include "pool/pool_structure.h"
+#include "pool/pool_unit.h"
+#include "structure.h"
+#include "tools/coord.h"
+#include "unit.h"
+
+enum {
+	VISION_RADIUS_MAX   = 15,
+	VISION_STAMP_WIDTH  = 2 * VISION_RADIUS_MAX + 1,
+	VISION_TILE_MAX     = MAP_SIZE_MAX * MAP_SIZE_MAX,
+	VISION_PACKED_NONE  = 0xFFFF
+};
+
+/** The circle an observer was last counted on. */
+typedef struct VisionStamp {
+	uint16 packed;                                          /*!< Centre tile, or VISION_PACKED_NONE. */
+	uint8 radius;
+	uint8 houses;                                           /*!< Human houses that see through the observer. */
+	bool unveil;                                            /*!< False if the observer only keeps scouted tiles unfogged. */
+} VisionStamp;
+
+typedef struct VisionPlanes {
+	uint16 observers[HOUSE_MAX][VISION_TILE_MAX];           /*!< Observers in range of the tile. */
+	uint16 scouts[HOUSE_MAX][VISION_TILE_MAX];              /*!< Observers in range that may unveil the tile. */
+} VisionPlanes;
+
+static VisionPlanes s_vision;
+static VisionStamp s_unitStamp[UNIT_INDEX_MAX_RAISED];
+static VisionStamp s_structureStamp[STRUCTURE_INDEX_MAX_SOFT + STRUCTURE_INDEX_RAISED_AMOUNT];
+
+/** Half the width of each row of the stamp of each radius. */
+static int8 s_stampHalfWidth[VISION_RADIUS_MAX + 1][VISION_STAMP_WIDTH];
+
+/**
+ * Build the stamps, using the same distance as Tile_RefreshFogInRadius.
+ */
+static void
+Vision_InitStamps(void)
+{
+	const tile32 centre = Tile_MakeXY(VISION_RADIUS_MAX, VISION_RADIUS_MAX);
+
+	for (int radius = 0; radius <= VISION_RADIUS_MAX; radius++) {
+		for (int dy = -VISION_RADIUS_MAX; dy <= VISION_RADIUS_MAX; dy++) {
+			int dx = -1;
+
+			while (dx < VISION_RADIUS_MAX) {
+				const tile32 t = Tile_MakeXY(VISION_RADIUS_MAX + dx + 1, VISION_RADIUS_MAX + dy);
+
+				if (Tile_GetDistanceRoundedUp(centre, t) > radius)
+					break;
+
+				dx++;
+			}
+
+			s_stampHalfWidth[radius][VISION_RADIUS_MAX + dy] = dx;
+		}
+	}
+}
+
+/**
+ * Forget all observers.  Called when the fog of war is reset, which
+ *  clears the held timeouts too.
+ */
+void
+Vision_Init(void)
+{
+	memset(&s_vision, 0, sizeof(s_vision));
+	memset(s_unitStamp, 0xFF, sizeof(s_unitStamp));
+	memset(s_structureStamp, 0xFF, sizeof(s_structureStamp));
+	Vision_InitStamps();
+}
+
+bool
+Vision_IsTileObserved(enum HouseType houseID, uint16 packed)
+{
+	return s_vision.observers[houseID][packed] != 0;
+}
+
+static void
+Vision_AddObserver(const VisionStamp *stamp, enum TileUnveilCause cause,
+		uint16 packed)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!(stamp->houses & (1 << h)))
+			continue;
+
+		s_vision.observers[h][packed]++;
+
+		if (stamp->unveil) {
+			s_vision.scouts[h][packed]++;
+			Map_UnveilTile(h, cause, packed);
+		} else {
+			Map_RefreshTile(h, cause, packed);
+		}
+	}
+}
+
+static void
+Vision_RemoveObserver(const VisionStamp *stamp, enum TileUnveilCause cause,
+		uint16 packed)
+{
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!(stamp->houses & (1 << h)))
+			continue;
+
+		if (stamp->unveil)
+			s_vision.scouts[h][packed]--;
+
+		if (--s_vision.observers[h][packed] == 0)
+			Map_ReleaseTile(h, cause, packed);
+	}
+}
+
+static void
+Vision_ApplyStamp(const VisionStamp *stamp, enum TileUnveilCause cause,
+		bool add)
+{
+	if (stamp->packed == VISION_PACKED_NONE)
+		return;
+
+	const int x = Tile_GetPackedX(stamp->packed);
+	const int y = Tile_GetPackedY(stamp->packed);
+	const int radius = stamp->radius;
+
+	for (int j = max(-radius, -y); j <= min(radius, MAP_SIZE_MAX - 1 - y); j++) {
+		const int w = s_stampHalfWidth[radius][VISION_RADIUS_MAX + j];
+
+		for (int i = max(-w, -x); i <= min(w, MAP_SIZE_MAX - 1 - x); i++) {
+			const uint16 packed = Tile_PackXY(x + i, y + j);
+
+			if (add) {
+				Vision_AddObserver(stamp, cause, packed);
+			} else {
+				Vision_RemoveObserver(stamp, cause, packed);
+			}
+		}
+	}
+}
+
+/**
+ * Move the observer's circle on the counts, if it changed.
+ */
+static void
+Vision_MoveStamp(VisionStamp *stamp, const VisionStamp *next,
+		enum TileUnveilCause cause)
+{
+	if (stamp->packed == next->packed
+			&& (stamp->packed == VISION_PACKED_NONE
+				|| (stamp->radius == next->radius
+					&& stamp->houses == next->houses
+					&& stamp->unveil == next->unveil))) {
+		return;
+	}
+
+	/* Add first, so tiles in both circles are never released. */
+	Vision_ApplyStamp(next, cause, true);
+	Vision_ApplyStamp(stamp, cause, false);
+	*stamp = *next;
+}
+
+static uint8
+Vision_GetHouses(enum HouseType houseID)
+{
+	uint8 houses = House_GetAllies(houseID);
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (!House_IsHuman(h))
+			houses &= ~(1 << h);
+	}
+
+	return houses;
+}
+
+/**
+ * Fill in the circle the observer should be counted on, following
+ *  Tile_RefreshFogInRadius.
+ */
+static void
+Vision_SetStamp(VisionStamp *stamp, enum HouseType houseID,
+		tile32 position, uint16 radius, bool unveil)
+{
+	const uint16 packed = Tile_PackTile(position);
+
+	stamp->packed = VISION_PACKED_NONE;
+
+	if (radius == 0 || !Map_IsValidPosition(packed))
+		return;
+
+	stamp->houses = Vision_GetHouses(houseID);
+	if (stamp->houses == 0)
+		return;
+
+	/* The largest radius in the tables is 10. */
+	stamp->packed = packed;
+	stamp->radius = min(radius, VISION_RADIUS_MAX);
+	stamp->unveil = unveil;
+}
+
+static void
+Vision_GetUnitStamp(const Unit *u, VisionStamp *stamp)
+{
+	stamp->packed = VISION_PACKED_NONE;
+
+	if (!u->o.flags.s.used)
+		return;
+
+	/* Do not unveil new tiles for air units (ornithopters), but
+	 * allow them to refresh previously scouted tiles for vision.
+	 */
+	Vision_SetStamp(stamp, Unit_GetHouseID(u), u->o.position,
+			Unit_GetFogRadius(u), g_table_unitInfo[u->o.type].flags.isGroundUnit);
+}
+
+static void
+Vision_GetStructureStamp(const Structure *s, VisionStamp *stamp)
+{
+	stamp->packed = VISION_PACKED_NONE;
+
+	if (!s->o.flags.s.used || s->o.flags.s.isNotOnMap)
+		return;
+
+	Vision_SetStamp(stamp, s->o.houseID, Structure_GetFogPosition(s),
+			g_table_structureInfo[s->o.type].o.fogUncoverRadius, true);
+}
+
+/**
+ * Report the unit to the houses that have it in view.
+ */
+static void
+Vision_SpotUnit(Unit *u)
+{
+	const uint16 packed = Tile_PackTile(u->o.position);
+
+	if (Tile_IsOutOfMap(packed) || Unit_Get_ByPackedTile(packed) != u)
+		return;
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		if (s_vision.scouts[h][packed] != 0)
+			Unit_HouseUnitCount_Add(u, h);
+	}
+}
+
+/**
+ * Mark the structure as seen by the houses that have any of its tiles
+ *  in view.
+ */
+static void
+Vision_SpotStructure(Structure *s)
+{
+	const StructureInfo *si = &g_table_structureInfo[s->o.type];
+	const uint16 *layoutTile = g_table_structure_layoutTiles[si->layout];
+	const uint16 packed = Tile_PackTile(s->o.position);
+
+	for (enum HouseType h = HOUSE_HARKONNEN; h < HOUSE_NEUTRAL; h++) {
+		const uint8 allies = House_GetAllies(h);
+
+		if ((s->o.seenByHouses & allies) == allies)
+			continue;
+
+		for (int i = 0; i < g_table_structure_layoutTileCount[si->layout]; i++) {
+			const uint16 p = packed + layoutTile[i];
+
+			if (p < VISION_TILE_MAX && s_vision.scouts[h][p] != 0
+					&& Structure_Get_ByPackedTile(p) == s) {
+				s->o.seenByHouses |= allies;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Update the counts for observers that moved, appeared or disappeared,
+ *  then report what the houses have in view.
+ */
+void
+Vision_Tick(void)
+{
+	if (!enhancement_fog_of_war || g_debugScenario)
+		return;
+
+	const uint16 structureMax = StructurePool_GetIndex(STRUCTURE_INDEX_MAX_SOFT);
+
+	for (uint16 index = 0; index < UnitPool_GetMaxIndex(); index++) {
+		VisionStamp stamp;
+
+		Vision_GetUnitStamp(Unit_Get_ByIndex(index), &stamp);
+		Vision_MoveStamp(&s_unitStamp[index], &stamp, UNVEILCAUSE_UNIT_VISION);
+	}
+
+	for (uint16 index = 0; index < structureMax; index++) {
+		VisionStamp stamp;
+
+		Vision_GetStructureStamp(Structure_Get_ByIndex(index), &stamp);
+		Vision_MoveStamp(&s_structureStamp[index], &stamp, UNVEILCAUSE_STRUCTURE_VISION);
+	}
+
+	for (uint16 index = 0; index < UnitPool_GetMaxIndex(); index++) {
+		Unit *u = Unit_Get_ByIndex(index);
+
+		if (u->o.flags.s.used && !u->o.flags.s.isNotOnMap)
+			Vision_SpotUnit(u);
+	}
+
+	for (uint16 index = 0; index < structureMax; index++) {
+		Structure *s = Structure_Get_ByIndex(index);
+
+		if (s->o.flags.s.used && !s->o.flags.s.isNotOnMap)
+			Vision_SpotStructure(s);
+	}
+}
@@ -0,0 +1,13 @@
+/** @file src/vision.h Incremental fog of war vision. */
+
+#ifndef VISION_H
+#define VISION_H
+
+#include "enum_house.h"
+#include "types.h"
+
+extern void Vision_Init(void);
+extern void Vision_Tick(void);
+extern bool Vision_IsTileObserved(enum HouseType houseID, uint16 packed);
+
+#endif
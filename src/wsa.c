@@ -1,10 +1,18 @@
-/** @file src/wsa.c WSA routines. */
+/** @file src/wsa.c WSA routines.
+ *
+ * Each frame of a WSA is a Format80 compressed delta, which is XORed
+ * onto the previous frame with Format40.  Uncompressing a delta only
+ * depends on the file, so a worker thread uncompresses the frames that
+ * follow the one on screen into a small ring.  WSA_DisplayFrame then
+ * only has to XOR them on, in order.
+ */
 
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
 #include "os/math.h"
 #include "os/endian.h"
+#include "os/thread.h"
 #include "gfx.h"
 
 #include "wsa.h"
@@ -13,6 +21,11 @@
 #include "codec/format80.h"
 #include "file.h"
 #include "gui/widget.h"
+#include "timer/timer.h"
+
+enum {
+	WSA_PREFETCH_FRAMES = 8
+};
 
 
 /**
@@ -57,6 +70,43 @@ typedef struct WSAFileHeader {
 	uint32 animationOffsetEnd;      /*!< Offset where animation ends. */
 } WSAFileHeader;
 
+/**
+ * The file of the WSA last loaded, kept open between frames for the
+ *  worker, and for frames played from disk.  The header lives in memory of the caller, which may be
+ *  reused without unloading it, so the view is kept here by filename.
+ */
+static struct {
+	char filename[13];
+	const uint8 *view;
+	uint32 length;
+} s_wsaFile;
+
+/**
+ * Deltas of the frames of the open file, uncompressed ahead by a worker
+ *  thread.  The worker fills slots at head, WSA_GotoNextFrame empties
+ *  them at tail.
+ */
+static struct {
+	Thread thread;
+	Semaphore free;                                         /*!< Slots the worker may fill. */
+	Semaphore filled;                                       /*!< Slots ready to be applied. */
+	volatile bool stop;                                     /*!< Set to make the worker return. */
+
+	uint16 frames;                                          /*!< Frames of the WSA. */
+	uint16 frameLast;                                       /*!< Last frame before wrapping to frame 1. */
+	uint16 lengthSpecial;                                   /*!< Length of the palette before each frame. */
+	uint16 bufferLength;                                    /*!< Length of a delta. */
+	uint16 frameNext;                                       /*!< Next frame the worker uncompresses. */
+	unsigned int head;                                      /*!< Next slot the worker fills. */
+	unsigned int tail;                                      /*!< Next slot to be applied. */
+
+	uint16 frame[WSA_PREFETCH_FRAMES];                      /*!< Frame in each slot. */
+	bool valid[WSA_PREFETCH_FRAMES];                        /*!< False if the frame could not be read. */
+	uint8 *buffer;                                          /*!< The deltas, bufferLength bytes each. */
+} s_wsaPrefetch;
+
+static WSAStats s_wsaStats;
+
 /**
  * Get the amount of frames a WSA has.
  */
@@ -96,18 +146,186 @@ static uint32 WSA_GetFrameOffset_FromMemory(WSAHeader *header, uint16 frame)
 /**
  * Get the offset in the file which stores the animation data for a given
  *  frame.
- * @param fileno The fileno of an opened WSA.
+ * @param file The content of the WSA file.
+ * @param length The length of the WSA file.
  * @param frame The frame of animation.
  * @return The offset for the animation from the beginning of the file.
  */
-static uint32 WSA_GetFrameOffset_FromDisk(uint8 fileno, uint16 frame)
+static uint32 WSA_GetFrameOffset_FromDisk(const uint8 *file, uint32 length, uint16 frame)
+{
+	if ((uint32)frame * 4 + 14 > length) return 0;
+
+	return READ_LE_UINT32(file + frame * 4 + 10);
+}
+
+/**
+ * Uncompress the delta of a frame from the WSA file.
+ * @return False if the frame is not in the file.
+ */
+static bool WSA_DecodeDelta(const uint8 *file, uint32 fileLength, uint16 frame, uint16 lengthSpecial, uint8 *dst, uint16 dstLength)
+{
+	uint32 positionStart;
+	uint32 positionEnd;
+	uint32 length;
+
+	positionStart = WSA_GetFrameOffset_FromDisk(file, fileLength, frame);
+	positionEnd = WSA_GetFrameOffset_FromDisk(file, fileLength, frame + 1);
+	length = positionEnd - positionStart;
+
+	if (positionStart == 0 || positionEnd == 0 || length == 0 || positionEnd + lengthSpecial > fileLength) return false;
+
+	Format80_Decode(dst, file + positionStart + lengthSpecial, dstLength);
+	return true;
+}
+
+static ThreadStatus WSA_Prefetch_ThreadProc(void *data)
+{
+	VARIABLE_NOT_USED(data);
+
+	while (true) {
+		Semaphore_Lock(s_wsaPrefetch.free);
+		if (s_wsaPrefetch.stop) break;
+
+		const unsigned int slot = s_wsaPrefetch.head % WSA_PREFETCH_FRAMES;
+		const uint16 frame = s_wsaPrefetch.frameNext;
+
+		s_wsaPrefetch.frame[slot] = frame;
+		s_wsaPrefetch.valid[slot] = WSA_DecodeDelta(s_wsaFile.view, s_wsaFile.length, frame, s_wsaPrefetch.lengthSpecial,
+				s_wsaPrefetch.buffer + slot * s_wsaPrefetch.bufferLength, s_wsaPrefetch.bufferLength);
+
+		s_wsaPrefetch.frameNext = (frame >= s_wsaPrefetch.frameLast) ? 1 : frame + 1;
+		s_wsaPrefetch.head++;
+		Semaphore_Unlock(s_wsaPrefetch.filled);
+	}
+
+	return 0;
+}
+
+/**
+ * Stop the worker, dropping the frames it uncompressed.
+ */
+static void WSA_Prefetch_Stop(void)
+{
+	if (s_wsaPrefetch.thread == NULL) return;
+
+	s_wsaPrefetch.stop = true;
+	Semaphore_Unlock(s_wsaPrefetch.free);
+	Thread_Wait(s_wsaPrefetch.thread, NULL);
+	s_wsaPrefetch.thread = NULL;
+
+	Semaphore_Destroy(s_wsaPrefetch.free);
+	Semaphore_Destroy(s_wsaPrefetch.filled);
+	s_wsaPrefetch.free = NULL;
+	s_wsaPrefetch.filled = NULL;
+}
+
+/**
+ * Start uncompressing the frames of the open file from the given one
+ *  on.  Without a worker, frames are uncompressed as they are needed.
+ */
+static void WSA_Prefetch_Start(uint16 frame)
 {
-	uint32 offset;
+	WSA_Prefetch_Stop();
+
+	if (s_wsaFile.view == NULL || s_wsaPrefetch.buffer == NULL) return;
+
+	s_wsaPrefetch.free = Semaphore_Create(WSA_PREFETCH_FRAMES);
+	s_wsaPrefetch.filled = Semaphore_Create(0);
+	s_wsaPrefetch.stop = false;
+	s_wsaPrefetch.frameNext = (frame > s_wsaPrefetch.frameLast) ? 1 : frame;
+	s_wsaPrefetch.head = 0;
+	s_wsaPrefetch.tail = 0;
 
-	File_Seek(fileno, frame * 4 + 10, 0);
-	offset = File_Read_LE32(fileno);
+	if (s_wsaPrefetch.free != NULL && s_wsaPrefetch.filled != NULL) {
+		s_wsaPrefetch.thread = Thread_Create(WSA_Prefetch_ThreadProc, NULL);
+	}
+
+	if (s_wsaPrefetch.thread == NULL) {
+		Semaphore_Destroy(s_wsaPrefetch.free);
+		Semaphore_Destroy(s_wsaPrefetch.filled);
+		s_wsaPrefetch.free = NULL;
+		s_wsaPrefetch.filled = NULL;
+	}
+}
+
+/**
+ * Get the delta of a frame from the worker, waiting for it if needed.
+ *  If the worker is at another frame, it is moved on to the frame
+ *  after this one.
+ * @return The delta, to be released with WSA_Prefetch_Release(), or
+ *  NULL if it has to be uncompressed by the caller.
+ */
+static const uint8 *WSA_Prefetch_Take(const WSAHeader *header, uint16 frame)
+{
+	if (s_wsaPrefetch.thread == NULL) return NULL;
+	if (s_wsaPrefetch.bufferLength != header->bufferLength || s_wsaPrefetch.frames != header->frames) return NULL;
+	if (strncmp(s_wsaFile.filename, header->filename, sizeof(s_wsaFile.filename)) != 0) return NULL;
+
+	Semaphore_Lock(s_wsaPrefetch.filled);
+
+	const unsigned int slot = s_wsaPrefetch.tail % WSA_PREFETCH_FRAMES;
+
+	if (s_wsaPrefetch.frame[slot] != frame || !s_wsaPrefetch.valid[slot]) {
+		WSA_Prefetch_Start(frame + 1);
+		return NULL;
+	}
 
-	return offset;
+	return s_wsaPrefetch.buffer + slot * s_wsaPrefetch.bufferLength;
+}
+
+/**
+ * Give the slot returned by WSA_Prefetch_Take() back to the worker.
+ */
+static void WSA_Prefetch_Release(void)
+{
+	s_wsaPrefetch.tail++;
+	Semaphore_Unlock(s_wsaPrefetch.free);
+}
+
+/**
+ * Release the file kept open by WSA_GetFile().
+ */
+static void WSA_ReleaseFile(void)
+{
+	WSA_Prefetch_Stop();
+
+	free(s_wsaPrefetch.buffer);
+	s_wsaPrefetch.buffer = NULL;
+
+	File_ReleaseView(s_wsaFile.view);
+
+	s_wsaFile.filename[0] = '\0';
+	s_wsaFile.view = NULL;
+	s_wsaFile.length = 0;
+}
+
+/**
+ * Get the content of a WSA file, opening it only if it is not the one
+ *  already open.
+ * @param filename The name of the file.
+ * @param length Where to store the length of the file.
+ * @return The content of the file, valid until another file is opened.
+ */
+static const uint8 *WSA_GetFile(const char *filename, uint32 *length)
+{
+	if (s_wsaFile.view == NULL || strncmp(s_wsaFile.filename, filename, sizeof(s_wsaFile.filename)) != 0) {
+		WSA_ReleaseFile();
+
+		s_wsaFile.view = File_GetView_Ex(SEARCHDIR_CAMPAIGN_DIR, filename, &s_wsaFile.length);
+		strncpy(s_wsaFile.filename, filename, sizeof(s_wsaFile.filename) - 1);
+	}
+
+	*length = s_wsaFile.length;
+	return s_wsaFile.view;
+}
+
+/**
+ * Get the frames decoded since the last WSA was loaded, and how long
+ *  decoding them took.
+ */
+void WSA_GetStats(WSAStats *stats)
+{
+	*stats = s_wsaStats;
 }
 
 /**
@@ -121,62 +339,53 @@ static uint16 WSA_GotoNextFrame(void *wsa, uint16 frame, uint8 *dst)
 {
 	WSAHeader *header = (WSAHeader *)wsa;
 	uint16 lengthSpecial;
-	uint8 *buffer;
+	const uint8 *delta;
+	double start;
+	double duration;
+
+	start = Timer_GetTime();
 
 	lengthSpecial = 0;
 	if (header->flags.isSpecial) lengthSpecial = 0x300;
 
-	buffer = header->buffer;
+	delta = WSA_Prefetch_Take(header, frame);
 
-	if (header->flags.dataInMemory) {
+	if (delta != NULL) {
+		s_wsaStats.framesPrefetched++;
+	} else if (header->flags.dataInMemory) {
 		uint32 positionStart;
-		uint32 positionEnd;
-		uint32 length;
-		uint8 *positionFrame;
 
+		/* The file content follows the buffer, so decode straight from it. */
 		positionStart = WSA_GetFrameOffset_FromMemory(header, frame);
-		positionEnd = WSA_GetFrameOffset_FromMemory(header, frame + 1);
-		length = positionEnd - positionStart;
-
-		positionFrame = header->fileContent + positionStart;
-		buffer += header->bufferLength - length;
-
-		memmove(buffer, positionFrame, length);
+		Format80_Decode(header->buffer, header->fileContent + positionStart, header->bufferLength);
+		delta = header->buffer;
 	} else if (header->flags.dataOnDisk) {
-		uint8 fileno;
-		uint32 positionStart;
-		uint32 positionEnd;
-		uint32 length;
-		uint32 res;
+		const uint8 *file;
+		uint32 fileLength;
 
-		fileno = File_Open_Ex(SEARCHDIR_CAMPAIGN_DIR, header->filename, FILE_MODE_READ);
-
-		positionStart = WSA_GetFrameOffset_FromDisk(fileno, frame);
-		positionEnd = WSA_GetFrameOffset_FromDisk(fileno, frame + 1);
-		length = positionEnd - positionStart;
-
-		if (positionStart == 0 || positionEnd == 0 || length == 0) {
-			File_Close(fileno);
-			return 0;
-		}
+		/* Decode the frame straight from the file, which stays open for the next frame. */
+		file = WSA_GetFile(header->filename, &fileLength);
 
-		buffer += header->bufferLength - length;
-
-		File_Seek(fileno, positionStart + lengthSpecial, 0);
-		res = File_Read(fileno, buffer, length);
-		File_Close(fileno);
-
-		if (res != length) return 0;
+		if (!WSA_DecodeDelta(file, fileLength, frame, lengthSpecial, header->buffer, header->bufferLength)) return 0;
+		delta = header->buffer;
+	} else {
+		delta = header->buffer;
 	}
 
-	Format80_Decode(header->buffer, buffer, header->bufferLength);
-
 	if (header->flags.displayInBuffer) {
-		Format40_Decode(dst, header->buffer);
+		Format40_Decode(dst, delta);
 	} else {
-		Format40_Decode_XorToScreen(dst, header->buffer, header->width);
+		Format40_Decode_XorToScreen(dst, delta, header->width);
 	}
 
+	if (delta != header->buffer) WSA_Prefetch_Release();
+
+	duration = 1e3 * (Timer_GetTime() - start);
+
+	s_wsaStats.framesDecoded++;
+	s_wsaStats.decodeTime += duration;
+	s_wsaStats.decodeTimeMax = max(s_wsaStats.decodeTimeMax, duration);
+
 	return 1;
 }
 
@@ -196,7 +405,8 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 	uint32 bufferSizeMinimal;
 	uint32 bufferSizeOptimal;
 	uint16 lengthHeader;
-	uint8 fileno;
+	const uint8 *file;
+	uint32 fileLength;
 	uint16 lengthSpecial;
 	uint16 lengthAnimation;
 	uint32 lengthFileContent;
@@ -204,15 +414,24 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 	uint8 *buffer;
 
 	memset(&flags, 0, sizeof(flags));
+	memset(&s_wsaStats, 0, sizeof(s_wsaStats));
+
+	WSA_Prefetch_Stop();
 
-	fileno = File_Open_Ex(SEARCHDIR_CAMPAIGN_DIR, filename, FILE_MODE_READ);
-	fileheader.frames = File_Read_LE16(fileno);
-	fileheader.width = File_Read_LE16(fileno);
-	fileheader.height = File_Read_LE16(fileno);
-	fileheader.requiredBufferSize = File_Read_LE16(fileno);
-	fileheader.isSpecial = File_Read_LE16(fileno);
-	fileheader.animationOffsetStart = File_Read_LE32(fileno);
-	fileheader.animationOffsetEnd = File_Read_LE32(fileno);
+	file = WSA_GetFile(filename, &fileLength);
+	if (fileLength < 18) {
+		WSA_ReleaseFile();
+
+		return NULL;
+	}
+
+	fileheader.frames = READ_LE_UINT16(file + 0);
+	fileheader.width = READ_LE_UINT16(file + 2);
+	fileheader.height = READ_LE_UINT16(file + 4);
+	fileheader.requiredBufferSize = READ_LE_UINT16(file + 6);
+	fileheader.isSpecial = READ_LE_UINT16(file + 8);
+	fileheader.animationOffsetStart = READ_LE_UINT32(file + 10);
+	fileheader.animationOffsetEnd = READ_LE_UINT32(file + 14);
 
 	lengthSpecial = 0;
 	if (fileheader.isSpecial) {
@@ -221,7 +440,7 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 		lengthSpecial = 0x300;
 	}
 
-	lengthFileContent = File_Seek(fileno, 0, 2);
+	lengthFileContent = fileLength;
 
 	lengthAnimation = 0;
 	if (fileheader.animationOffsetStart != 0) {
@@ -230,6 +449,13 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 		flags.hasNoAnimation = true;
 	}
 
+	lengthHeader = ((fileheader.frames & 0x7FFF) + 2) * 4;
+	if ((uint32)lengthSpecial + lengthAnimation + lengthHeader + 10 > fileLength) {
+		WSA_ReleaseFile();
+
+		return NULL;
+	}
+
 	lengthFileContent -= lengthSpecial + lengthAnimation + 10;
 
 	displaySize = 0;
@@ -242,7 +468,7 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 	bufferSizeOptimal = bufferSizeMinimal + lengthFileContent;
 
 	if (wsaSize > 1 && wsaSize < bufferSizeMinimal) {
-		File_Close(fileno);
+		WSA_ReleaseFile();
 
 		return NULL;
 	}
@@ -289,33 +515,37 @@ void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserve
 	header->buffer       = buffer;
 	strncpy(header->filename, filename, sizeof(header->filename));
 
-	lengthHeader = (fileheader.frames + 2) * 4;
-
 	if (wsaSize >= bufferSizeOptimal) {
 		header->fileContent = buffer + header->bufferLength;
 
-		File_Seek(fileno, 10, 0);
-		File_Read(fileno, header->fileContent, lengthHeader);
-		File_Seek(fileno, lengthAnimation + lengthSpecial, 1);
-		File_Read(fileno, header->fileContent + lengthHeader, lengthFileContent - lengthHeader);
+		memcpy(header->fileContent, file + 10, lengthHeader);
+		memcpy(header->fileContent + lengthHeader, file + 10 + lengthHeader + lengthAnimation + lengthSpecial, lengthFileContent - lengthHeader);
 
 		header->flags.dataInMemory = true;
 		if (WSA_GetFrameOffset_FromMemory(header, header->frames + 1) == 0) header->flags.noAnimation = true;
 	} else {
 		header->flags.dataOnDisk = true;
-		if (WSA_GetFrameOffset_FromDisk(fileno, header->frames + 1) == 0) header->flags.noAnimation = true;
+		if (WSA_GetFrameOffset_FromDisk(file, fileLength, header->frames + 1) == 0) header->flags.noAnimation = true;
 	}
 
-	{
-		uint8 *b;
-		b = buffer + header->bufferLength - lengthAnimation;
+	/* Decode the first frame straight from the file. */
+	if (lengthAnimation != 0) Format80_Decode(buffer, file + lengthHeader + lengthSpecial + 10, header->bufferLength);
+
+	/* Keep the file open for the worker, which uncompresses frame 1 on. */
+	if (!header->flags.hasNoAnimation && header->frames > 1) {
+		s_wsaPrefetch.frames        = header->frames;
+		s_wsaPrefetch.frameLast     = header->flags.noAnimation ? header->frames - 1 : header->frames;
+		s_wsaPrefetch.lengthSpecial = lengthSpecial;
+		s_wsaPrefetch.bufferLength  = header->bufferLength;
 
-		File_Seek(fileno, lengthHeader + lengthSpecial + 10, 0);
-		File_Read(fileno, b, lengthAnimation);
-		File_Close(fileno);
+		free(s_wsaPrefetch.buffer);
+		s_wsaPrefetch.buffer = malloc((size_t)WSA_PREFETCH_FRAMES * header->bufferLength);
 
-		Format80_Decode(buffer, b, header->bufferLength);
+		WSA_Prefetch_Start(1);
+	} else if (header->flags.dataInMemory) {
+		WSA_ReleaseFile();
 	}
+
 	return wsa;
 }
 
@@ -328,6 +558,7 @@ void WSA_Unload(void *wsa)
 	WSAHeader *header = (WSAHeader *)wsa;
 
 	if (wsa == NULL) return;
+	if (strncmp(s_wsaFile.filename, header->filename, sizeof(s_wsaFile.filename)) == 0) WSA_ReleaseFile();
 	if (!header->flags.malloced) return;
 
 	free(wsa);
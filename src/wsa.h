@@ -8,9 +8,17 @@ enum {
 	RADAR_ANIMATION_DELAY = 3,
 };
 
+typedef struct WSAStats {
+	int framesDecoded;                                      /*!< Frames decoded since the WSA was loaded. */
+	int framesPrefetched;                                   /*!< Frames uncompressed ahead by the worker. */
+	double decodeTime;                                      /*!< Milliseconds spent decoding on the caller's thread. */
+	double decodeTimeMax;                                   /*!< Milliseconds for the slowest frame. */
+} WSAStats;
+
 extern uint16 WSA_GetFrameCount(void *wsa);
 extern void *WSA_LoadFile(const char *filename, void *wsa, uint32 wsaSize, bool reserveDisplayFrame);
 extern void WSA_Unload(void *wsa);
 extern bool WSA_DisplayFrame(void *wsa, uint16 frameNext, uint16 posX, uint16 posY, Screen screenID);
+extern void WSA_GetStats(WSAStats *stats);
 
 #endif /* WSA_H */